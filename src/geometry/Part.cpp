@@ -44,6 +44,7 @@ Copyright (c) 2005-2016, University of Oxford.
 #include "VesselSegment.hpp"
 #include "Vessel.hpp"
 #include "VesselSurfaceGenerator.hpp"
+#include "VesselNetworkBatch.hpp"
 #include "Part.hpp"
 
 template<unsigned DIM>
@@ -319,16 +320,19 @@ template <unsigned DIM>
 void Part<DIM>::BooleanWithNetwork(boost::shared_ptr<VesselNetwork<DIM> > pVesselNetwork)
 {
     // Remove any vessel with both nodes outside the domain
-    std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = pVesselNetwork->GetVessels();
+    VesselNetworkBatch<DIM> batch(pVesselNetwork);
+    std::set<boost::shared_ptr<Vessel<DIM> > > vessels_to_remove;
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = pVesselNetwork->rGetVessels();
     for(unsigned idx=0;idx<vessels.size();idx++)
     {
         if(!IsPointInPart(vessels[idx]->GetStartNode()->rGetLocation()) &&
                 !IsPointInPart(vessels[idx]->GetEndNode()->rGetLocation()))
         {
-            pVesselNetwork->RemoveVessel(vessels[idx], true);
+            vessels_to_remove.insert(vessels[idx]);
         }
     }
-    pVesselNetwork->UpdateAll();
+    pVesselNetwork->RemoveVessels(vessels_to_remove, true);
+    batch.Commit();
 }
 
 template<unsigned DIM>
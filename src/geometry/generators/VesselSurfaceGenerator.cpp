@@ -63,7 +63,7 @@ template<unsigned DIM>
 std::vector<DimensionalChastePoint<DIM> > VesselSurfaceGenerator<DIM>::GetHoles()
 {
     std::vector<DimensionalChastePoint<DIM> > hole_locations;
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = mpVesselNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = mpVesselNetwork->rGetVesselSegments();
     for (unsigned idx = 0; idx < segments.size(); idx++)
     {
         hole_locations.push_back(segments[idx]->GetMidPoint());
@@ -84,7 +84,7 @@ std::vector<std::vector<boost::shared_ptr<Polygon> > > VesselSurfaceGenerator<DI
 
     // Generate a surface for each segment
     std::vector<std::vector<boost::shared_ptr<Polygon> > > segment_polygons;
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = mpVesselNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = mpVesselNetwork->rGetVesselSegments();
 
     for (unsigned idx = 0; idx < segments.size(); idx++)
     {
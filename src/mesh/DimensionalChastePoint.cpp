@@ -33,6 +33,7 @@
 
  */
 
+#include <cmath>
 #include "UblasIncludes.hpp"
 #include "DimensionalChastePoint.hpp"
 
@@ -85,6 +86,12 @@ void DimensionalChastePoint<DIM>::SetReferenceLengthScale(units::quantity<unit::
     mReferenceLength = lenthScale;
 }
 
+template<unsigned DIM>
+bool DimensionalChastePoint<DIM>::HasSameReferenceLengthScale(const DimensionalChastePoint<DIM>& rLocation) const
+{
+    return mReferenceLength == rLocation.mReferenceLength;
+}
+
 template<unsigned DIM>
 double DimensionalChastePoint<DIM>::GetScalingFactor(const DimensionalChastePoint<DIM>& rLocation) const
 {
@@ -95,9 +102,9 @@ double DimensionalChastePoint<DIM>::GetScalingFactor(const DimensionalChastePoin
         EXCEPTION("Point has zero reference length");
     }
 
-    if(mReferenceLength != rLocation.GetReferenceLengthScale())
+    if(!HasSameReferenceLengthScale(rLocation))
     {
-        scaling_length = rLocation.GetReferenceLengthScale()/mReferenceLength;
+        scaling_length = rLocation.mReferenceLength/mReferenceLength;
     }
 
     return scaling_length;
@@ -112,16 +119,16 @@ bool DimensionalChastePoint<DIM>::IsCoincident(const DimensionalChastePoint<DIM>
         scaling_length = GetScalingFactor(rLocation);
     }
 
-    bool returned_value = true;
+    const c_vector<double, DIM>& r_location = ChastePoint<DIM>::rGetLocation();
+    const c_vector<double, DIM>& r_other_location = rLocation.rGetLocation();
     for (unsigned dim=0; dim<DIM; dim++)
     {
-        if (rLocation[dim]*scaling_length != ChastePoint<DIM>::rGetLocation()[dim])
+        if (r_other_location[dim]*scaling_length != r_location[dim])
         {
-            returned_value = false;
-            break;
+            return false;
         }
     }
-    return returned_value;
+    return true;
 }
 
 template<unsigned DIM>
@@ -132,7 +139,28 @@ units::quantity<unit::length> DimensionalChastePoint<DIM>::GetDistance(const Dim
     {
         scaling_length = GetScalingFactor(rLocation);
     }
-    return norm_2(rLocation.rGetLocation()*scaling_length - ChastePoint<DIM>::rGetLocation())*mReferenceLength;
+
+    // Accumulate directly on the raw coordinates, the common case of matching length scales needs no rescaling
+    const c_vector<double, DIM>& r_location = ChastePoint<DIM>::rGetLocation();
+    const c_vector<double, DIM>& r_other_location = rLocation.rGetLocation();
+    double distance_squared = 0.0;
+    if(scaling_length == 1.0)
+    {
+        for (unsigned dim=0; dim<DIM; dim++)
+        {
+            double diff = r_other_location[dim] - r_location[dim];
+            distance_squared += diff*diff;
+        }
+    }
+    else
+    {
+        for (unsigned dim=0; dim<DIM; dim++)
+        {
+            double diff = r_other_location[dim]*scaling_length - r_location[dim];
+            distance_squared += diff*diff;
+        }
+    }
+    return std::sqrt(distance_squared)*mReferenceLength;
 }
 
 template<unsigned DIM>
@@ -146,25 +174,28 @@ DimensionalChastePoint<DIM> DimensionalChastePoint<DIM>::GetPointProjection(cons
     double scaling_length_probe = 1.0;
     if(checkDimensions)
     {
-        if(rStartLocation.GetReferenceLengthScale() == 0.0*unit::metres)
-        {
-            EXCEPTION("Point has zero reference length");
-        }
-
-        if(rStartLocation.GetReferenceLengthScale() != rEndLocation.GetReferenceLengthScale())
-        {
-            scaling_length_end = rEndLocation.GetReferenceLengthScale()/rStartLocation.GetReferenceLengthScale();
-        }
-
-        if(rStartLocation.GetReferenceLengthScale() != rProbeLocation.GetReferenceLengthScale())
-        {
-            scaling_length_probe = rProbeLocation.GetReferenceLengthScale()/rStartLocation.GetReferenceLengthScale();
-        }
+        scaling_length_end = rStartLocation.GetScalingFactor(rEndLocation);
+        scaling_length_probe = rStartLocation.GetScalingFactor(rProbeLocation);
     }
 
-    c_vector<double, DIM> start_location = rStartLocation.rGetLocation();
-    c_vector<double, DIM> end_location = rEndLocation.rGetLocation()*scaling_length_end;
-    c_vector<double, DIM> probe_location = rProbeLocation.rGetLocation()*scaling_length_probe;
+    // Only take rescaled copies of the end and probe locations if their length scales differ from the start location's
+    const c_vector<double, DIM>& start_location = rStartLocation.rGetLocation();
+    c_vector<double, DIM> scaled_end_location;
+    c_vector<double, DIM> scaled_probe_location;
+    const c_vector<double, DIM>* p_end_location = &rEndLocation.rGetLocation();
+    const c_vector<double, DIM>* p_probe_location = &rProbeLocation.rGetLocation();
+    if(scaling_length_end != 1.0)
+    {
+        scaled_end_location = rEndLocation.rGetLocation()*scaling_length_end;
+        p_end_location = &scaled_end_location;
+    }
+    if(scaling_length_probe != 1.0)
+    {
+        scaled_probe_location = rProbeLocation.rGetLocation()*scaling_length_probe;
+        p_probe_location = &scaled_probe_location;
+    }
+    const c_vector<double, DIM>& end_location = *p_end_location;
+    const c_vector<double, DIM>& probe_location = *p_probe_location;
 
     c_vector<double, DIM> segment_vector = end_location - start_location;
     c_vector<double, DIM> point_vector = probe_location - start_location;
@@ -196,7 +227,7 @@ DimensionalChastePoint<DIM> DimensionalChastePoint<DIM>::GetPointProjection(cons
     // Point projection is inside segment, get distance to point projection
     double projection_ratio = dp_segment_point / dp_segment_segment;
     DimensionalChastePoint<DIM> projected_point = DimensionalChastePoint<DIM>(start_location + projection_ratio * segment_vector,
-                                                                              rStartLocation.GetReferenceLengthScale());
+                                                                              rStartLocation.mReferenceLength);
     return projected_point;
 }
 
@@ -210,44 +241,47 @@ units::quantity<unit::length> DimensionalChastePoint<DIM>::GetDistance(const Dim
     double scaling_length_probe = 1.0;
     if(checkDimensions)
     {
-        if(rStartLocation.GetReferenceLengthScale() == 0.0*unit::metres)
-        {
-            EXCEPTION("Point has zero reference length");
-        }
-
-        if(rStartLocation.GetReferenceLengthScale() != rEndLocation.GetReferenceLengthScale())
-        {
-            scaling_length_end = rEndLocation.GetReferenceLengthScale()/rStartLocation.GetReferenceLengthScale();
-        }
-
-        if(rStartLocation.GetReferenceLengthScale() != rProbeLocation.GetReferenceLengthScale())
-        {
-            scaling_length_probe = rProbeLocation.GetReferenceLengthScale()/rStartLocation.GetReferenceLengthScale();
-        }
+        scaling_length_end = rStartLocation.GetScalingFactor(rEndLocation);
+        scaling_length_probe = rStartLocation.GetScalingFactor(rProbeLocation);
     }
 
-    c_vector<double, DIM> start_location = rStartLocation.rGetLocation();
-    c_vector<double, DIM> end_location = rEndLocation.rGetLocation()*scaling_length_end;
-    c_vector<double, DIM> probe_location = rProbeLocation.rGetLocation()*scaling_length_probe;
+    // Work in the start location's length scale throughout, rescaling only the points that need it
+    const c_vector<double, DIM>& start_location = rStartLocation.rGetLocation();
+    c_vector<double, DIM> scaled_end_location;
+    c_vector<double, DIM> scaled_probe_location;
+    const c_vector<double, DIM>* p_end_location = &rEndLocation.rGetLocation();
+    const c_vector<double, DIM>* p_probe_location = &rProbeLocation.rGetLocation();
+    if(scaling_length_end != 1.0)
+    {
+        scaled_end_location = rEndLocation.rGetLocation()*scaling_length_end;
+        p_end_location = &scaled_end_location;
+    }
+    if(scaling_length_probe != 1.0)
+    {
+        scaled_probe_location = rProbeLocation.rGetLocation()*scaling_length_probe;
+        p_probe_location = &scaled_probe_location;
+    }
+    const c_vector<double, DIM>& end_location = *p_end_location;
+    const c_vector<double, DIM>& probe_location = *p_probe_location;
 
     c_vector<double, DIM> segment_vector = end_location - start_location;
     double dp_segment_point = inner_prod(segment_vector, probe_location - start_location);
     // Point projection is outside segment, return node0 distance
     if (dp_segment_point <= 0.0)
     {
-        return rStartLocation.GetDistance(rProbeLocation);
+        return norm_2(probe_location - start_location) * rStartLocation.mReferenceLength;
     }
 
     double dp_segment_segment = inner_prod(segment_vector, segment_vector);
     // Point projection is outside segment, return node1 distance
     if (dp_segment_segment <= dp_segment_point)
     {
-        return rEndLocation.GetDistance(rProbeLocation);
+        return norm_2(probe_location - end_location) * rStartLocation.mReferenceLength;
     }
 
     // Point projection is inside segment, get distance to point projection
     double projection_ratio = dp_segment_point / dp_segment_segment;
-    return norm_2(start_location + projection_ratio * segment_vector - probe_location) * rStartLocation.GetReferenceLengthScale();
+    return norm_2(start_location + projection_ratio * segment_vector - probe_location) * rStartLocation.mReferenceLength;
 }
 
 template<unsigned DIM>
@@ -259,6 +293,10 @@ DimensionalChastePoint<DIM> DimensionalChastePoint<DIM>::GetMidPoint(const Dimen
         scaling_length = GetScalingFactor(rLocation);
     }
 
+    if(scaling_length == 1.0)
+    {
+        return DimensionalChastePoint<DIM>((rLocation.rGetLocation() + ChastePoint<DIM>::rGetLocation()) / 2.0, mReferenceLength);
+    }
     return DimensionalChastePoint<DIM>((rLocation.rGetLocation()*scaling_length + ChastePoint<DIM>::rGetLocation()) / 2.0, mReferenceLength);
 }
 
@@ -271,7 +309,17 @@ c_vector<double, DIM> DimensionalChastePoint<DIM>::GetUnitTangent(const Dimensio
         scaling_length = GetScalingFactor(rLocation);
     }
 
-    return (rLocation.rGetLocation()*scaling_length - ChastePoint<DIM>::rGetLocation()) / (GetDistance(rLocation)/mReferenceLength);
+    // Form the difference once and normalize it, rather than rescaling again through GetDistance
+    c_vector<double, DIM> difference;
+    if(scaling_length == 1.0)
+    {
+        noalias(difference) = rLocation.rGetLocation() - ChastePoint<DIM>::rGetLocation();
+    }
+    else
+    {
+        noalias(difference) = rLocation.rGetLocation()*scaling_length - ChastePoint<DIM>::rGetLocation();
+    }
+    return difference / norm_2(difference);
 }
 
 template<unsigned DIM>
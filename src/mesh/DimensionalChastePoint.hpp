@@ -123,6 +123,14 @@ public:
      */
     void SetReferenceLengthScale(units::quantity<unit::length> lenthScale);
 
+    /**
+     * Return true if the input point shares this point's reference length scale. In this case
+     * GetScalingFactor is one and geometric operations act on the raw coordinates directly, without rescaling.
+     * @param rLocation the input point
+     * @return whether the two points have the same reference length scale
+     */
+    bool HasSameReferenceLengthScale(const DimensionalChastePoint<DIM>& rLocation) const;
+
     /**
      * Get the ratio of length scales between this point and the input point
      * @param rLocation the input point
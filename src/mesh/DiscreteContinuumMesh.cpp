@@ -267,7 +267,7 @@ std::vector<std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > > > Discret
     unsigned num_elements = this->GetNumElements();
     mSegmentElementMap = std::vector<std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > > >(num_elements);
 
-    std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > > segments = mpNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > >& segments = mpNetwork->rGetVesselSegments();
 
     for (unsigned jdx = 0; jdx < segments.size(); jdx++)
     {
@@ -406,7 +406,7 @@ const std::vector<std::vector<boost::shared_ptr<VesselNode<SPACE_DIM> > > >& Reg
         mPointNodeMap.push_back(empty_node_pointers);
     }
 
-    std::vector<boost::shared_ptr<VesselNode<SPACE_DIM> > > nodes = mpNetwork->GetNodes();
+    const std::vector<boost::shared_ptr<VesselNode<SPACE_DIM> > >& nodes = mpNetwork->rGetNodes();
 
     for (unsigned idx = 0; idx < nodes.size(); idx++)
     {
@@ -496,7 +496,7 @@ bool RegularGrid<ELEMENT_DIM, SPACE_DIM>::IsSegmentAtLatticeSite(unsigned index,
 }
 
 template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
-std::vector<std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > > > RegularGrid<ELEMENT_DIM, SPACE_DIM>::GetPointSegmentMap(
+const std::vector<std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > > >& RegularGrid<ELEMENT_DIM, SPACE_DIM>::GetPointSegmentMap(
         bool update, bool useVesselSurface)
 {
     if (!update)
@@ -517,7 +517,7 @@ std::vector<std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > > > Regular
         mPointSegmentMap.push_back(empty_seg_pointers);
     }
 
-    std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > > segments = mpNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > >& segments = mpNetwork->rGetVesselSegments();
     unsigned num_points = GetNumberOfPoints();
     units::quantity<unit::length> cut_off_length = sqrt(1.0 / 2.0) * mSpacing;
     for (unsigned jdx = 0; jdx < segments.size(); jdx++)
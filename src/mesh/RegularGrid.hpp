@@ -246,7 +246,7 @@ public:
      * @bool update update the map
      * @return the point segment map
      */
-    std::vector<std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > > > GetPointSegmentMap(bool update = true, bool useVesselSurface = false);
+    const std::vector<std::vector<boost::shared_ptr<VesselSegment<SPACE_DIM> > > >& GetPointSegmentMap(bool update = true, bool useVesselSurface = false);
 
     bool IsSegmentAtLatticeSite(unsigned index, bool update);
 
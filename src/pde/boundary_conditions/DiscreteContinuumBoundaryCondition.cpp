@@ -222,7 +222,7 @@ std::pair<bool, units::quantity<unit::concentration> > DiscreteContinuumBoundary
         }
         else
         {
-            std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = this->mpNetwork->GetVesselSegments();
+            const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = this->mpNetwork->rGetVesselSegments();
             for (unsigned jdx = 0; jdx <  segments.size(); jdx++)
             {
                 if (segments[jdx]->GetDistance(location)/segments[jdx]->GetNode(0)->GetReferenceLengthScale()  <= tolerance)
@@ -244,7 +244,7 @@ std::pair<bool, units::quantity<unit::concentration> > DiscreteContinuumBoundary
         }
         else
         {
-            std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = this->mpNetwork->GetVesselSegments();
+            const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = this->mpNetwork->rGetVesselSegments();
             for (unsigned jdx = 0; jdx <  segments.size(); jdx++)
             {
                 if (segments[jdx]->GetDistance(location)/segments[jdx]->GetNode(0)->GetReferenceLengthScale()  <= segments[jdx]->GetRadius()/segments[jdx]->GetNode(0)->GetReferenceLengthScale() + tolerance)
@@ -341,7 +341,7 @@ void DiscreteContinuumBoundaryCondition<DIM>::UpdateRegularGridFacetBoundaryCond
 template<unsigned DIM>
 void DiscreteContinuumBoundaryCondition<DIM>::UpdateRegularGridSegmentBoundaryConditions(boost::shared_ptr<std::vector<std::pair<bool, units::quantity<unit::concentration> > > >pBoundaryConditions)
 {
-    std::vector<std::vector<boost::shared_ptr<VesselSegment<DIM> > > > point_segment_map = mpRegularGrid->GetPointSegmentMap(true, !(mType == BoundaryConditionType::VESSEL_LINE));
+    const std::vector<std::vector<boost::shared_ptr<VesselSegment<DIM> > > >& point_segment_map = mpRegularGrid->GetPointSegmentMap(true, !(mType == BoundaryConditionType::VESSEL_LINE));
     for(unsigned idx=0; idx<point_segment_map.size(); idx++)
     {
         if(point_segment_map[idx].size()>0)
@@ -112,7 +112,7 @@ std::vector<units::quantity<unit::concentration_flow_rate> > CellBasedDiscreteSo
     units::quantity<unit::length> grid_spacing = this->mpRegularGrid->GetSpacing();
     units::quantity<unit::volume> grid_volume = units::pow<3>(grid_spacing);
 
-    std::vector<std::vector<CellPtr> > point_cell_map = this->mpRegularGrid->GetPointCellMap();
+    const std::vector<std::vector<CellPtr> >& point_cell_map = this->mpRegularGrid->GetPointCellMap();
     for(unsigned idx=0; idx<point_cell_map.size(); idx++)
     {
         values[idx] += mCellConstantInUValue * double(point_cell_map[idx].size())/grid_volume;
@@ -130,7 +130,7 @@ std::vector<units::quantity<unit::rate> > CellBasedDiscreteSource<DIM>::GetLinea
     }
 
     std::vector<units::quantity<unit::rate> > values(this->mpRegularGrid->GetNumberOfPoints(), 0.0*unit::per_second);
-    std::vector<std::vector<CellPtr> > point_cell_map = this->mpRegularGrid->GetPointCellMap();
+    const std::vector<std::vector<CellPtr> >& point_cell_map = this->mpRegularGrid->GetPointCellMap();
     for(unsigned idx=0; idx<point_cell_map.size(); idx++)
     {
         values[idx] += mCellLinearInUValue * double(point_cell_map[idx].size());
@@ -88,7 +88,7 @@ std::vector<units::quantity<unit::concentration_flow_rate> > CellStateDependentD
     unsigned apoptotic_label = apoptotic_property->GetColour();
 
     // Loop through all points
-    std::vector<std::vector<CellPtr> > point_cell_map = this->mpRegularGrid->GetPointCellMap();
+    const std::vector<std::vector<CellPtr> >& point_cell_map = this->mpRegularGrid->GetPointCellMap();
     for(unsigned idx=0; idx<point_cell_map.size(); idx++)
     {
         for(unsigned jdx=0; jdx<point_cell_map[idx].size(); jdx++)
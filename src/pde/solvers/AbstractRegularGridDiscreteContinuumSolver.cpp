@@ -312,7 +312,7 @@ void AbstractRegularGridDiscreteContinuumSolver<DIM>::UpdateCellData()
     }
 
     this->mpRegularGrid->SetCellPopulation(*(this->mpCellPopulation));
-    std::vector<std::vector<CellPtr> > point_cell_map = this->mpRegularGrid->GetPointCellMap();
+    const std::vector<std::vector<CellPtr> >& point_cell_map = this->mpRegularGrid->GetPointCellMap();
     for(unsigned idx=0; idx<point_cell_map.size(); idx++)
     {
         for(unsigned jdx=0; jdx<point_cell_map[idx].size(); jdx++)
@@ -221,16 +221,16 @@ void GreensFunctionSolver<DIM>::GenerateSubSegments()
     // Set up the sub-segment points and map to original segments
     units::quantity<unit::length> max_subsegment_length = mSubsegmentCutoff;
 
-    std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = this->mpNetwork->GetVessels();
-    typename std::vector<boost::shared_ptr<Vessel<DIM> > >::iterator vessel_iter;
-    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::iterator segment_iter;
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = this->mpNetwork->rGetVessels();
+    typename std::vector<boost::shared_ptr<Vessel<DIM> > >::const_iterator vessel_iter;
+    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::const_iterator segment_iter;
 
     // Iterate over all segments and store midpoints and lengths of subsegment regions for
     // the greens functions calculation. Create a map of subsegment index to the parent segment
     // for later use.
     for (vessel_iter = vessels.begin(); vessel_iter != vessels.end(); vessel_iter++)
     {
-        std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = (*vessel_iter)->GetSegments();
+        const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = (*vessel_iter)->rGetSegments();
         for (segment_iter = segments.begin(); segment_iter != segments.end(); segment_iter++)
         {
             units::quantity<unit::length> segment_length = (*segment_iter)->GetLength();
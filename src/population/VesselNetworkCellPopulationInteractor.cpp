@@ -95,9 +95,7 @@ void VesselNetworkCellPopulationInteractor<DIM>::PartitionNetworkOverCells(Abstr
                 pVessel->DivideSegment(cell_location);
                 pVessel->UpdateNodes();
             }
-            mpNetwork->UpdateNodes();
-            mpNetwork->UpdateSegments();
-            mpNetwork->UpdateVesselNodes();
+            mpNetwork->UpdateAll();
         }
     }
 }
@@ -33,6 +33,7 @@ Copyright (c) 2005-2016, University of Oxford.
 
  */
 
+#include <boost/make_shared.hpp>
 #include "SmartPointers.hpp"
 #include "Exception.hpp"
 #include "UblasIncludes.hpp"
@@ -44,7 +45,7 @@ Vessel<DIM>::Vessel(boost::shared_ptr<VesselSegment<DIM> > pSegment) : AbstractV
         mSegments(std::vector<boost::shared_ptr<VesselSegment<DIM> > >()),
         mNodes(std::vector<boost::shared_ptr<VesselNode<DIM> > >()),
         mNodesUpToDate(false),
-        mpFlowProperties(boost::shared_ptr<VesselFlowProperties<DIM> >(new VesselFlowProperties<DIM>()))
+        mpFlowProperties(boost::make_shared<VesselFlowProperties<DIM> >())
 {
     mSegments.push_back(pSegment);
     mpFlowProperties->UpdateSegments(mSegments);
@@ -56,7 +57,7 @@ Vessel<DIM>::Vessel(std::vector<boost::shared_ptr<VesselSegment<DIM> > > segment
         mSegments(segments),
         mNodes(std::vector<boost::shared_ptr<VesselNode<DIM> > >()),
         mNodesUpToDate(false),
-        mpFlowProperties(boost::shared_ptr<VesselFlowProperties<DIM> >(new VesselFlowProperties<DIM>()))
+        mpFlowProperties(boost::make_shared<VesselFlowProperties<DIM> >())
 {
     if (segments.size() > 1)
     {
@@ -91,7 +92,7 @@ Vessel<DIM>::Vessel(std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes) :
         mSegments(std::vector<boost::shared_ptr<VesselSegment<DIM> > >()),
         mNodes(std::vector<boost::shared_ptr<VesselNode<DIM> > >()),
         mNodesUpToDate(false),
-        mpFlowProperties(boost::shared_ptr<VesselFlowProperties<DIM> >(new VesselFlowProperties<DIM>()))
+        mpFlowProperties(boost::make_shared<VesselFlowProperties<DIM> >())
 {
 
     if (nodes.size() < 2)
@@ -113,7 +114,7 @@ Vessel<DIM>::Vessel(boost::shared_ptr<VesselNode<DIM> > pStartNode, boost::share
     :        mSegments(std::vector<boost::shared_ptr<VesselSegment<DIM> > >()),
              mNodes(std::vector<boost::shared_ptr<VesselNode<DIM> > >()),
              mNodesUpToDate(false),
-             mpFlowProperties(boost::shared_ptr<VesselFlowProperties<DIM> >(new VesselFlowProperties<DIM>()))
+             mpFlowProperties(boost::make_shared<VesselFlowProperties<DIM> >())
 {
     mSegments.push_back(VesselSegment<DIM>::Create(pStartNode, pEndNode));
     mpFlowProperties->UpdateSegments(mSegments);
@@ -636,6 +637,12 @@ std::vector<boost::shared_ptr<VesselSegment<DIM> > > Vessel<DIM>::GetSegments()
     return mSegments;
 }
 
+template<unsigned DIM>
+const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& Vessel<DIM>::rGetSegments()
+{
+    return mSegments;
+}
+
 template<unsigned DIM>
 boost::shared_ptr<VesselNode<DIM> > Vessel<DIM>::GetStartNode()
 {
@@ -700,7 +707,7 @@ void Vessel<DIM>::RemoveSegments(SegmentLocation::Value location)
 template<unsigned DIM>
 void Vessel<DIM>::SetFlowProperties(const VesselFlowProperties<DIM> & rFlowProperties)
 {
-    this->mpFlowProperties = boost::shared_ptr<VesselFlowProperties<DIM> >(new VesselFlowProperties<DIM> (rFlowProperties));
+    this->mpFlowProperties = boost::make_shared<VesselFlowProperties<DIM> >(rFlowProperties);
     this->mpFlowProperties->UpdateSegments(mSegments);
 }
 
@@ -719,6 +726,12 @@ boost::shared_ptr<Vessel<DIM> > Vessel<DIM>::Shared()
     return this->shared_from_this();
 }
 
+template<unsigned DIM>
+void Vessel<DIM>::SetNodesOutOfDate()
+{
+    mNodesUpToDate = false;
+}
+
 template<unsigned DIM>
 void Vessel<DIM>::UpdateNodes()
 {
@@ -278,6 +278,13 @@ public:
      */
     std::vector<boost::shared_ptr<VesselSegment<DIM> > > GetSegments();
 
+    /**
+     * Return a reference to the vessel segment vector, avoids a copy
+     *
+     * @return a reference to the vessel segment vector
+     */
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& rGetSegments();
+
     /**
      * @return the vessel stat node
      */
@@ -312,6 +319,12 @@ public:
      */
     void SetFlowProperties(const VesselFlowProperties<DIM>& rFlowProperties);
 
+    /**
+     * Mark the data in mNodes as stale, so it is rebuilt the next time the nodes are requested.
+     * This avoids repeated rebuilds when many segment nodes are replaced in turn.
+     */
+    void SetNodesOutOfDate();
+
     /**
      * Update the data in mNodes
      */
@@ -34,7 +34,16 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
 #include <iostream>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <limits.h>
 #include <math.h>
+#include <float.h>
+#include <boost/cstdint.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/cuthill_mckee_ordering.hpp>
 #include "SmartPointers.hpp"
 #include "OutputFileHandler.hpp"
 #include "SegmentFlowProperties.hpp"
@@ -49,7 +58,23 @@ VesselNetwork<DIM>::VesselNetwork() : AbstractVesselNetworkComponent<DIM>(),
   mNodes(),
   mNodesUpToDate(false),
   mVesselNodes(),
-  mVesselNodesUpToDate(false)
+  mVesselNodesUpToDate(false),
+  mVesselIndices(),
+  mVesselIndicesUpToDate(false),
+  mSegmentIndices(),
+  mNodeIndices(),
+  mNodeReferenceCounts(),
+  mVesselNodeIndices(),
+  mVesselNodeReferenceCounts(),
+  mpSpatialIndex(VesselNetworkSpatialIndex<DIM>::Create()),
+  mSpatialIndexUpToDate(false),
+  mBatchDepth(0),
+  mMergeOnCommit(false),
+  mTopologyVersion(0),
+  mGeometryVersion(0),
+  mSegmentNodeIndices(),
+  mSegmentNodeIndicesVersion(0),
+  mReconnectedSegmentsVersion(0)
 {
 
 }
@@ -67,30 +92,164 @@ boost::shared_ptr<VesselNetwork<DIM> > VesselNetwork<DIM>::Create()
     return pSelf;
 }
 
+template <unsigned DIM>
+boost::shared_ptr<VesselNetwork<DIM> > VesselNetwork<DIM>::Create(boost::shared_ptr<VesselNetwork<DIM> > pExistingNetwork)
+{
+    MAKE_PTR(VesselNetwork<DIM>, pSelf);
+
+    // Copy each node once, looking up the copies when building the segments
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = pExistingNetwork->rGetNodes();
+    boost::unordered_map<VesselNode<DIM>*, boost::shared_ptr<VesselNode<DIM> > > node_copies;
+    for(unsigned idx=0; idx<r_nodes.size(); idx++)
+    {
+        boost::shared_ptr<VesselNode<DIM> > p_node = VesselNode<DIM>::Create(r_nodes[idx]);
+        p_node->SetRadius(r_nodes[idx]->GetRadius());
+        p_node->SetId(r_nodes[idx]->GetId());
+        node_copies[r_nodes[idx].get()] = p_node;
+    }
+
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& r_vessels = pExistingNetwork->rGetVessels();
+    std::vector<boost::shared_ptr<Vessel<DIM> > > new_vessels;
+    new_vessels.reserve(r_vessels.size());
+    for(unsigned idx=0; idx<r_vessels.size(); idx++)
+    {
+        const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& r_segments = r_vessels[idx]->rGetSegments();
+        std::vector<boost::shared_ptr<VesselSegment<DIM> > > new_segments;
+        new_segments.reserve(r_segments.size());
+        for(unsigned jdx=0; jdx<r_segments.size(); jdx++)
+        {
+            boost::shared_ptr<VesselSegment<DIM> > p_segment = VesselSegment<DIM>::Create(node_copies[r_segments[jdx]->GetNode(0).get()],
+                                                                                         node_copies[r_segments[jdx]->GetNode(1).get()]);
+            p_segment->CopyDataFromExistingSegment(r_segments[jdx]);
+            p_segment->SetId(r_segments[jdx]->GetId());
+            new_segments.push_back(p_segment);
+        }
+        boost::shared_ptr<Vessel<DIM> > p_vessel = Vessel<DIM>::Create(new_segments);
+        p_vessel->CopyDataFromExistingVessel(r_vessels[idx]);
+        p_vessel->SetFlowProperties(*(r_vessels[idx]->GetFlowProperties()));
+        p_vessel->SetId(r_vessels[idx]->GetId());
+        new_vessels.push_back(p_vessel);
+    }
+    pSelf->AddVessels(new_vessels);
+    return pSelf;
+}
+
 template <unsigned DIM>
 void VesselNetwork<DIM>::AddVessel(boost::shared_ptr<Vessel<DIM> > pVessel)
 {
+    mTopologyVersion++;
     mVessels.push_back(pVessel);
-    mSegmentsUpToDate = false;
-    mNodesUpToDate = false;
-    mVesselNodesUpToDate = false;
+    if(mVesselIndicesUpToDate)
+    {
+        mVesselIndices[pVessel.get()] = mVessels.size()-1;
+    }
+    AddVesselToCaches(pVessel);
 }
 
 template <unsigned DIM>
 void VesselNetwork<DIM>::AddVessels(std::vector<boost::shared_ptr<Vessel<DIM> > > vessels)
 {
+    mTopologyVersion++;
+    if(mVesselIndicesUpToDate)
+    {
+        for(unsigned idx=0; idx<vessels.size(); idx++)
+        {
+            mVesselIndices[vessels[idx].get()] = mVessels.size()+idx;
+        }
+    }
     mVessels.insert(mVessels.end(), vessels.begin(), vessels.end());
-    mSegmentsUpToDate = false;
-    mNodesUpToDate = false;
-    mVesselNodesUpToDate = false;
+    for(unsigned idx=0; idx<vessels.size(); idx++)
+    {
+        AddVesselToCaches(vessels[idx]);
+    }
+}
+
+template <unsigned DIM>
+template<class COMPONENT>
+void VesselNetwork<DIM>::AddToCache(const boost::shared_ptr<COMPONENT>& rpComponent, std::vector<boost::shared_ptr<COMPONENT> >& rCache,
+                                    boost::unordered_map<COMPONENT*, unsigned>& rIndices)
+{
+    if(rIndices.insert(std::make_pair(rpComponent.get(), unsigned(rCache.size()))).second)
+    {
+        rCache.push_back(rpComponent);
+    }
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::AddNodeReference(const boost::shared_ptr<VesselNode<DIM> >& rpNode, std::vector<boost::shared_ptr<VesselNode<DIM> > >& rCache,
+                                          boost::unordered_map<VesselNode<DIM>*, unsigned>& rIndices,
+                                          boost::unordered_map<VesselNode<DIM>*, unsigned>& rCounts)
+{
+    if(++rCounts[rpNode.get()] == 1)
+    {
+        AddToCache(rpNode, rCache, rIndices);
+    }
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::AddVesselToCaches(boost::shared_ptr<Vessel<DIM> > pVessel)
+{
+    if(mSpatialIndexUpToDate || mSegmentsUpToDate)
+    {
+        const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = pVessel->rGetSegments();
+        for(unsigned idx=0; idx<segments.size(); idx++)
+        {
+            if(mSpatialIndexUpToDate)
+            {
+                mpSpatialIndex->InsertSegment(segments[idx]);
+            }
+            if(mSegmentsUpToDate)
+            {
+                AddToCache(segments[idx], mSegments, mSegmentIndices);
+            }
+        }
+    }
+    if(mNodesUpToDate)
+    {
+        const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = pVessel->rGetNodes();
+        for(unsigned idx=0; idx<r_nodes.size(); idx++)
+        {
+            AddNodeReference(r_nodes[idx], mNodes, mNodeIndices, mNodeReferenceCounts);
+        }
+    }
+    if(mVesselNodesUpToDate)
+    {
+        AddNodeReference(pVessel->GetStartNode(), mVesselNodes, mVesselNodeIndices, mVesselNodeReferenceCounts);
+        AddNodeReference(pVessel->GetEndNode(), mVesselNodes, mVesselNodeIndices, mVesselNodeReferenceCounts);
+    }
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::BeginBatch()
+{
+    if(mBatchDepth == 0)
+    {
+        mMergeOnCommit = false;
+    }
+    mBatchDepth++;
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::CommitBatch(bool merge)
+{
+    if(mBatchDepth == 0)
+    {
+        EXCEPTION("No batch of changes has been started on the network.");
+    }
+    mMergeOnCommit = mMergeOnCommit || merge;
+    mBatchDepth--;
+    if(mBatchDepth == 0)
+    {
+        UpdateAll(mMergeOnCommit);
+    }
 }
 
 template <unsigned DIM>
 void VesselNetwork<DIM>::CopySegmentFlowProperties(unsigned index)
 {
-    boost::shared_ptr<SegmentFlowProperties<DIM> > properties = GetVesselSegments()[index]->GetFlowProperties();
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = GetVesselSegments();
-    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::iterator it;
+    boost::shared_ptr<SegmentFlowProperties<DIM> > properties = GetVesselSegment(index)->GetFlowProperties();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = rGetVesselSegments();
+    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::const_iterator it;
     for(it = segments.begin(); it != segments.end(); it++)
     {
         (*it)->SetFlowProperties(*properties);
@@ -100,6 +259,7 @@ void VesselNetwork<DIM>::CopySegmentFlowProperties(unsigned index)
 template <unsigned DIM>
 std::vector<boost::shared_ptr<Vessel<DIM> > > VesselNetwork<DIM>::CopyVessels()
 {
+    RefreshVessels();
     return CopyVessels(mVessels);
 }
 
@@ -148,7 +308,7 @@ boost::shared_ptr<VesselNode<DIM> > VesselNetwork<DIM>::DivideVessel(boost::shar
     else
     {
         bool locatedInsideVessel = false;
-        std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = pVessel->GetSegments();
+        const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = pVessel->rGetSegments();
         for (unsigned idx = 0; idx < segments.size(); idx++)
         {
             if (segments[idx]->GetDistance(location)/segments[idx]->GetNode(0)->GetReferenceLengthScale() <= 1e-6)
@@ -164,7 +324,19 @@ boost::shared_ptr<VesselNode<DIM> > VesselNetwork<DIM>::DivideVessel(boost::shar
         }
     }
 
-    boost::shared_ptr<VesselNode<DIM> > p_new_node = pVessel->DivideSegment(location); // network segments and nodes out of date
+    UpdateVesselIndices();
+    typename boost::unordered_map<Vessel<DIM>*, unsigned>::const_iterator index_iter = mVesselIndices.find(pVessel.get());
+    if(index_iter == mVesselIndices.end())
+    {
+        EXCEPTION("Vessel is not contained inside network.");
+    }
+    unsigned vessel_index = index_iter->second;
+
+    // Keep the old vessel's segments and nodes, they are released from the cached collections only after the new
+    // vessels are added so those that carry over keep their positions.
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > old_segments = pVessel->GetSegments();
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > old_nodes = pVessel->GetNodes();
+    boost::shared_ptr<VesselNode<DIM> > p_new_node = pVessel->DivideSegment(location);
 
     // create two new vessels and assign them the old vessel's properties
     std::vector<boost::shared_ptr<VesselSegment<DIM> > > start_segments;
@@ -181,10 +353,14 @@ boost::shared_ptr<VesselNode<DIM> > VesselNetwork<DIM>::DivideVessel(boost::shar
         }
     }
 
-    if (segment_index == segments.size()-1)
+    if (segment_index >= segments.size()-1)
     {
         EXCEPTION("Vessel segment not found.");
     }
+
+    // The network is only changed once the division is known to be valid
+    mTopologyVersion++;
+    RemoveFromVesselList(vessel_index);
     for (unsigned idx = segment_index+1; idx < segments.size(); idx++)
     {
         end_segments.push_back(segments[idx]);
@@ -199,10 +375,25 @@ boost::shared_ptr<VesselNode<DIM> > VesselNetwork<DIM>::DivideVessel(boost::shar
 
     AddVessel(p_new_vessel1);
     AddVessel(p_new_vessel2);
-    RemoveVessel(pVessel, false);
-    mSegmentsUpToDate = false;
-    mNodesUpToDate = false;
-    mVesselNodesUpToDate = false;
+
+    std::set<VesselSegment<DIM>*> kept_segments;
+    for(unsigned idx=0; idx<start_segments.size(); idx++)
+    {
+        kept_segments.insert(start_segments[idx].get());
+    }
+    for(unsigned idx=0; idx<end_segments.size(); idx++)
+    {
+        kept_segments.insert(end_segments[idx].get());
+    }
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > removed_segments;
+    for(unsigned idx=0; idx<old_segments.size(); idx++)
+    {
+        if(kept_segments.find(old_segments[idx].get()) == kept_segments.end())
+        {
+            removed_segments.push_back(old_segments[idx]);
+        }
+    }
+    RemoveFromCaches(removed_segments, old_nodes);
 
     return p_new_node;
 }
@@ -211,24 +402,41 @@ template <unsigned DIM>
 void VesselNetwork<DIM>::ExtendVessel(boost::shared_ptr<Vessel<DIM> > pVessel, boost::shared_ptr<VesselNode<DIM> > pEndNode,
                                         boost::shared_ptr<VesselNode<DIM> > pNewNode)
 {
+    mTopologyVersion++;
+    boost::shared_ptr<VesselSegment<DIM> > p_segment;
     if(pVessel->GetStartNode() == pEndNode)
     {
-        boost::shared_ptr<VesselSegment<DIM> > p_segment = VesselSegment<DIM>::Create(pNewNode, pEndNode);
-        p_segment->SetFlowProperties(*(pEndNode->GetSegments()[0]->GetFlowProperties()));
-        p_segment->SetRadius(pEndNode->GetSegments()[0]->GetRadius());
+        p_segment = VesselSegment<DIM>::Create(pNewNode, pEndNode);
+        p_segment->SetFlowProperties(*(pEndNode->GetSegment(0)->GetFlowProperties()));
+        p_segment->SetRadius(pEndNode->GetSegment(0)->GetRadius());
         pVessel->AddSegment(p_segment);
     }
     else
     {
-        boost::shared_ptr<VesselSegment<DIM> > p_segment = VesselSegment<DIM>::Create(pEndNode, pNewNode);
-        p_segment->SetFlowProperties(*(pEndNode->GetSegments()[0]->GetFlowProperties()));
-        p_segment->SetRadius(pEndNode->GetSegments()[0]->GetRadius());
+        p_segment = VesselSegment<DIM>::Create(pEndNode, pNewNode);
+        p_segment->SetFlowProperties(*(pEndNode->GetSegment(0)->GetFlowProperties()));
+        p_segment->SetRadius(pEndNode->GetSegment(0)->GetRadius());
         pVessel->AddSegment(p_segment);
     }
 
-    mSegmentsUpToDate = false;
-    mNodesUpToDate = false;
-    mVesselNodesUpToDate = false;
+    if(mSpatialIndexUpToDate)
+    {
+        mpSpatialIndex->InsertSegment(p_segment);
+    }
+    if(mSegmentsUpToDate)
+    {
+        AddToCache(p_segment, mSegments, mSegmentIndices);
+    }
+    if(mNodesUpToDate)
+    {
+        AddNodeReference(pNewNode, mNodes, mNodeIndices, mNodeReferenceCounts);
+    }
+    if(mVesselNodesUpToDate)
+    {
+        // The new node replaces the old one at this end of the vessel
+        RemoveNodeReference(pEndNode, mVesselNodes, mVesselNodeIndices, mVesselNodeReferenceCounts);
+        AddNodeReference(pNewNode, mVesselNodes, mVesselNodeIndices, mVesselNodeReferenceCounts);
+    }
 }
 
 template <unsigned DIM>
@@ -242,8 +450,9 @@ boost::shared_ptr<Vessel<DIM> > VesselNetwork<DIM>::FormSprout(const Dimensional
         EXCEPTION("No vessel located at sprout base.");
     }
 
-    // divide vessel at location of sprout base
-    boost::shared_ptr<VesselNode<DIM> > p_new_node = DivideVessel(nearest_segment.first->GetVessel(), sproutBaseLocation);
+    // divide vessel at location of sprout base, the segment may be replaced in the division so keep its vessel
+    boost::shared_ptr<Vessel<DIM> > p_parent_vessel = nearest_segment.first->GetVessel();
+    boost::shared_ptr<VesselNode<DIM> > p_new_node = DivideVessel(p_parent_vessel, sproutBaseLocation);
 
     // create new vessel
     boost::shared_ptr<VesselNode<DIM> > p_new_node_at_tip = VesselNode<DIM>::Create(p_new_node);
@@ -260,15 +469,67 @@ boost::shared_ptr<Vessel<DIM> > VesselNetwork<DIM>::FormSprout(const Dimensional
 
     boost::shared_ptr<Vessel<DIM> > p_new_vessel = Vessel<DIM>::Create(p_new_segment);
     // Sprouting won't save you.
-    p_new_vessel->GetFlowProperties()->SetRegressionTime(nearest_segment.first->GetVessel()->GetFlowProperties()->GetRegressionTime());
+    p_new_vessel->GetFlowProperties()->SetRegressionTime(p_parent_vessel->GetFlowProperties()->GetRegressionTime());
     AddVessel(p_new_vessel);
     return p_new_vessel;
 }
 
+template <unsigned DIM>
+boost::shared_ptr<VesselNode<DIM> > VesselNetwork<DIM>::GetFirstNode(const std::vector<boost::shared_ptr<VesselNode<DIM> > >& rNodes)
+{
+    if(rNodes.size() < 2)
+    {
+        return rNodes.empty() ? boost::shared_ptr<VesselNode<DIM> >() : rNodes[0];
+    }
+
+    if(!mNodesUpToDate)
+    {
+        UpdateNodes();
+    }
+    boost::shared_ptr<VesselNode<DIM> > p_first_node = rNodes[0];
+    unsigned first_index = UINT_MAX;
+    for(unsigned idx=0; idx<rNodes.size(); idx++)
+    {
+        typename boost::unordered_map<VesselNode<DIM>*, unsigned>::const_iterator it = mNodeIndices.find(rNodes[idx].get());
+        if(it != mNodeIndices.end() && it->second < first_index)
+        {
+            first_index = it->second;
+            p_first_node = rNodes[idx];
+        }
+    }
+    return p_first_node;
+}
+
+template <unsigned DIM>
+boost::shared_ptr<VesselSegment<DIM> > VesselNetwork<DIM>::GetFirstSegment(const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& rSegments)
+{
+    if(rSegments.size() < 2)
+    {
+        return rSegments.empty() ? boost::shared_ptr<VesselSegment<DIM> >() : rSegments[0];
+    }
+
+    if(!mSegmentsUpToDate)
+    {
+        UpdateSegments();
+    }
+    boost::shared_ptr<VesselSegment<DIM> > p_first_segment = rSegments[0];
+    unsigned first_index = UINT_MAX;
+    for(unsigned idx=0; idx<rSegments.size(); idx++)
+    {
+        typename boost::unordered_map<VesselSegment<DIM>*, unsigned>::const_iterator it = mSegmentIndices.find(rSegments[idx].get());
+        if(it != mSegmentIndices.end() && it->second < first_index)
+        {
+            first_index = it->second;
+            p_first_segment = rSegments[idx];
+        }
+    }
+    return p_first_segment;
+}
+
 template <unsigned DIM>
 void VesselNetwork<DIM>::SetNodeRadiiFromSegments()
 {
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = GetNodes();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = rGetNodes();
     for(unsigned idx=0; idx<nodes.size(); idx++)
     {
         units::quantity<unit::length> av_radius = 0.0 * unit::metres;
@@ -288,8 +549,8 @@ std::pair<DimensionalChastePoint<DIM>, DimensionalChastePoint<DIM> > VesselNetwo
     units::quantity<unit::length> y_max = -DBL_MAX*unit::metres;
     units::quantity<unit::length> z_max = -DBL_MAX*unit::metres;
 
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = GetNodes();
-    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator it;
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = rGetNodes();
+    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::const_iterator it;
     for(it = nodes.begin(); it != nodes.end(); it++)
     {
         DimensionalChastePoint<DIM> location = (*it)->rGetLocation();
@@ -375,236 +636,77 @@ std::map<std::string, double> VesselNetwork<DIM>::GetOutputData()
 template <unsigned DIM>
 units::quantity<unit::length> VesselNetwork<DIM>::GetDistanceToNearestNode(const DimensionalChastePoint<DIM>& rLocation)
 {
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = GetNodes();
-    boost::shared_ptr<VesselNode<DIM> > nearest_node;
-    units::quantity<unit::length> min_distance = DBL_MAX*unit::metres;
-
-    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator node_iter;
-    for(node_iter = nodes.begin(); node_iter != nodes.end(); node_iter++)
-    {
-        units::quantity<unit::length> node_distance = (*node_iter)->GetDistance(rLocation);
-        if (node_distance < min_distance)
-        {
-            min_distance = node_distance;
-            nearest_node = (*node_iter) ;
-        }
-    }
-    return min_distance;
+    UpdateSpatialIndex();
+    return mpSpatialIndex->GetNearestNodes(rLocation).second;
 }
 
 template <unsigned DIM>
 boost::shared_ptr<VesselNode<DIM> > VesselNetwork<DIM>::GetNearestNode(boost::shared_ptr<VesselNode<DIM> > pInputNode)
 {
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = GetNodes();
-    boost::shared_ptr<VesselNode<DIM> > nearest_node;
-    units::quantity<unit::length> min_distance = DBL_MAX*unit::metres;
-
-    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator node_iter;
-    for(node_iter = nodes.begin(); node_iter != nodes.end(); node_iter++)
-    {
-        if((*node_iter) != pInputNode)
-        {
-            units::quantity<unit::length> node_distance = (*node_iter)->GetDistance(pInputNode->rGetLocation());
-            if (node_distance < min_distance)
-            {
-                min_distance = node_distance;
-                nearest_node = (*node_iter) ;
-            }
-        }
-    }
-    return nearest_node;
+    UpdateSpatialIndex();
+    return GetFirstNode(mpSpatialIndex->GetNearestNodes(pInputNode->rGetLocation(), pInputNode).first);
 }
 
 template <unsigned DIM>
 boost::shared_ptr<VesselNode<DIM> > VesselNetwork<DIM>::GetNearestNode(const DimensionalChastePoint<DIM>& location)
 {
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = GetNodes();
-    boost::shared_ptr<VesselNode<DIM> > nearest_node;
-    units::quantity<unit::length> min_distance = DBL_MAX*unit::metres;
+    UpdateSpatialIndex();
+    return GetFirstNode(mpSpatialIndex->GetNearestNodes(location).first);
+}
 
-    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator node_iter;
-    for(node_iter = nodes.begin(); node_iter != nodes.end(); node_iter++)
+template <unsigned DIM>
+std::vector<boost::shared_ptr<VesselNode<DIM> > > VesselNetwork<DIM>::GetNearestNodes(const std::vector<DimensionalChastePoint<DIM> >& rLocations)
+{
+    UpdateSpatialIndex();
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > nearest_nodes(rLocations.size());
+    for(unsigned idx=0; idx<rLocations.size(); idx++)
     {
-        units::quantity<unit::length> node_distance = (*node_iter)->GetDistance(location);
-        if (node_distance < min_distance)
-        {
-            min_distance = node_distance;
-            nearest_node = (*node_iter) ;
-        }
+        nearest_nodes[idx] = GetFirstNode(mpSpatialIndex->GetNearestNodes(rLocations[idx]).first);
     }
-
-    return nearest_node;
+    return nearest_nodes;
 }
 
 template <unsigned DIM>
 std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> > VesselNetwork<DIM>::GetNearestSegment(boost::shared_ptr<VesselSegment<DIM> > pSegment)
 {
-    boost::shared_ptr<VesselSegment<DIM> > nearest_segment;
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = GetVesselSegments();
-
-    double min_distance = DBL_MAX;
-    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::iterator segment_iter;
-    for(segment_iter = segments.begin(); segment_iter != segments.end(); segment_iter++)
-    {
-        if(!pSegment->IsConnectedTo((*segment_iter)))
-        {
-            // Get the segment to segment distance (http://geomalgorithms.com/a07-_distance.html#dist3D_Segment_to_Segment())
-            c_vector<double, DIM> u = (*segment_iter)->GetNode(1)->rGetLocation().rGetLocation() - (*segment_iter)->GetNode(0)->rGetLocation().rGetLocation();
-            c_vector<double, DIM> v = pSegment->GetNode(1)->rGetLocation().rGetLocation() - pSegment->GetNode(0)->rGetLocation().rGetLocation();
-            c_vector<double, DIM> w = (*segment_iter)->GetNode(0)->rGetLocation().rGetLocation() - pSegment->GetNode(0)->rGetLocation().rGetLocation();
-
-            double a = inner_prod(u,u);
-            double b = inner_prod(u,v);
-            double c = inner_prod(v,v);
-            double d = inner_prod(u,w);
-            double e = inner_prod(v,w);
-
-            double dv = a * c - b * b;
-            double sc, sn, sd = dv;
-            double tc, tn ,td = dv;
-
-            if(dv < 1.e-12) // almost parallel segments
-            {
-                sn = 0.0;
-                sd = 1.0;
-                tn = e;
-                td = c;
-            }
-            else // get the closest point on the equivalent infinite lines
-            {
-                sn = (b*e - c*d);
-                tn = (a*e - b*d);
-                if ( sn < 0.0)
-                {
-                    sn = 0.0;
-                    tn = e;
-                    td = c;
-                }
-                else if(sn > sd)
-                {
-                    sn =sd;
-                    tn = e+ b;
-                    td = c;
-                }
-            }
-
-            if(tn < 0.0)
-            {
-                tn = 0.0;
-                if(-d < 0.0)
-                {
-                    sn = 0.0;
-                }
-                else if(-d > a)
-                {
-                    sn = sd;
-                }
-                else
-                {
-                    sn = -d;
-                    sd = a;
-                }
-            }
-            else if(tn > td)
-            {
-                tn = td;
-                if((-d + b) < 0.0)
-                {
-                    sn = 0.0;
-                }
-                else if((-d + b) > a)
-                {
-                    sn = sd;
-                }
-                else
-                {
-                    sn = (-d + b);
-                    sd = a;
-                }
-            }
-
-            sc = (std::abs(sn) < 1.e-12 ? 0.0 : sn/sd);
-            tc = (std::abs(tn) < 1.e-12 ? 0.0 : tn/td);
-            c_vector<double, DIM> dp = w + (sc * u) - (tc * v);
-
-            double segment_distance = norm_2(dp);
-            if (segment_distance < min_distance)
-            {
-                min_distance = segment_distance;
-                nearest_segment = (*segment_iter) ;
-            }
-        }
-
-    }
-    std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> > return_pair =
-            std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> >(nearest_segment, min_distance * segments[0]->GetNode(0)->GetReferenceLengthScale());
-    return return_pair;
+    UpdateSpatialIndex();
+    std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> > nearest_segments =
+            mpSpatialIndex->GetNearestSegments(pSegment);
+    return std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> >(GetFirstSegment(nearest_segments.first), nearest_segments.second);
 }
 
 template <unsigned DIM>
 std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> > VesselNetwork<DIM>::GetNearestSegment(boost::shared_ptr<VesselNode<DIM> > pNode,
                                                                                                                           bool sameVessel)
 {
-    boost::shared_ptr<VesselSegment<DIM> > nearest_segment;
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = GetVesselSegments();
-
-    units::quantity<unit::length>  min_distance = DBL_MAX * unit::metres;
-    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::iterator segment_iter;
-    for(segment_iter = segments.begin(); segment_iter != segments.end(); segment_iter++)
-    {
-        units::quantity<unit::length> segment_distance = (*segment_iter)->GetDistance(pNode->rGetLocation());
-
-        if (segment_distance < min_distance && (*segment_iter)->GetNode(0) != pNode && (*segment_iter)->GetNode(1) != pNode)
-        {
-            if(sameVessel)
-            {
-                min_distance = segment_distance;
-                nearest_segment = (*segment_iter) ;
-            }
-            else
-            {
-                bool same_vessel = false;
-                std::vector<boost::shared_ptr<VesselSegment<DIM> > > node_segs = pNode->GetSegments();
-                for(unsigned idx=0;idx<node_segs.size();idx++)
-                {
-                    if(node_segs[idx]->GetVessel() == (*segment_iter)->GetVessel())
-                    {
-                        same_vessel = true;
-                    }
-                }
-                if(!same_vessel)
-                {
-                    min_distance = segment_distance;
-                    nearest_segment = (*segment_iter);
-                }
-            }
-        }
-    }
-    std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> > return_pair =
-            std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> >(nearest_segment, min_distance);
-    return return_pair;
+    UpdateSpatialIndex();
+    std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> > nearest_segments =
+            mpSpatialIndex->GetNearestSegments(pNode, sameVessel);
+    return std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> >(GetFirstSegment(nearest_segments.first), nearest_segments.second);
 }
 
 template <unsigned DIM>
 std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> >  VesselNetwork<DIM>::GetNearestSegment(const DimensionalChastePoint<DIM>& location)
 {
-    boost::shared_ptr<VesselSegment<DIM> > nearest_segment;
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = GetVesselSegments();
+    UpdateSpatialIndex();
+    std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> > nearest_segments =
+            mpSpatialIndex->GetNearestSegments(location);
+    return std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> >(GetFirstSegment(nearest_segments.first), nearest_segments.second);
+}
 
-    units::quantity<unit::length>  min_distance = DBL_MAX * unit::metres;
-    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::iterator segment_iter;
-    for(segment_iter = segments.begin(); segment_iter != segments.end(); segment_iter++)
+template <unsigned DIM>
+std::vector<std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> > > VesselNetwork<DIM>::GetNearestSegments(const std::vector<DimensionalChastePoint<DIM> >& rLocations)
+{
+    UpdateSpatialIndex();
+    std::vector<std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> > > nearest_segments;
+    nearest_segments.reserve(rLocations.size());
+    for(unsigned idx=0; idx<rLocations.size(); idx++)
     {
-        units::quantity<unit::length>  segment_distance = (*segment_iter)->GetDistance(location);
-        if (segment_distance < min_distance)
-        {
-            min_distance = segment_distance;
-            nearest_segment = (*segment_iter) ;
-        }
+        std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> > candidates =
+                mpSpatialIndex->GetNearestSegments(rLocations[idx]);
+        nearest_segments.push_back(std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> >(GetFirstSegment(candidates.first), candidates.second));
     }
-    std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> > return_pair =
-            std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> >(nearest_segment, min_distance);
-    return return_pair;
+    return nearest_segments;
 }
 
 template <unsigned DIM>
@@ -616,6 +718,7 @@ boost::shared_ptr<Vessel<DIM> > VesselNetwork<DIM>::GetNearestVessel(const Dimen
 template <unsigned DIM>
 void VesselNetwork<DIM>::RemoveShortVessels(units::quantity<unit::length> cutoff, bool endsOnly)
 {
+    RefreshVessels();
     std::vector<boost::shared_ptr<Vessel<DIM> > > vessels_to_remove;
 
     for(unsigned idx=0; idx<mVessels.size(); idx++)
@@ -633,72 +736,280 @@ void VesselNetwork<DIM>::RemoveShortVessels(units::quantity<unit::length> cutoff
         }
     }
 
-    for(unsigned idx=0; idx<vessels_to_remove.size(); idx++)
-    {
-        RemoveVessel(vessels_to_remove[idx]);
-    }
+    RemoveVessels(std::set<boost::shared_ptr<Vessel<DIM> > >(vessels_to_remove.begin(), vessels_to_remove.end()));
 }
 
 template <unsigned DIM>
 void VesselNetwork<DIM>::MergeShortVessels(units::quantity<unit::length> cutoff)
 {
-    std::vector<boost::shared_ptr<Vessel<DIM> > > vessels_to_merge;
+    RefreshVessels();
+
+    // Contract the short vessels shortest first. Contracting a vessel merges the group of nodes holding its
+    // end node into the group holding its start node, with the groups tracked as a union-find. The union-find
+    // owns its nodes so they stay alive while the removed vessels release theirs.
+    typedef std::pair<units::quantity<unit::length>, unsigned> LengthIndexPair;
+    std::priority_queue<LengthIndexPair, std::vector<LengthIndexPair>, std::greater<LengthIndexPair> > vessels_to_merge;
     for(unsigned idx=0; idx<mVessels.size(); idx++)
     {
-        if(mVessels[idx]->GetLength() < cutoff)
+        units::quantity<unit::length> length = mVessels[idx]->GetLength();
+        if(length < cutoff)
+        {
+            vessels_to_merge.push(LengthIndexPair(length, idx));
+        }
+    }
+    if(vessels_to_merge.empty())
+    {
+        return;
+    }
+
+    boost::unordered_map<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM> > > parents;
+    std::set<boost::shared_ptr<Vessel<DIM> > > merged_vessels;
+    while(!vessels_to_merge.empty())
+    {
+        boost::shared_ptr<Vessel<DIM> > p_vessel = mVessels[vessels_to_merge.top().second];
+        vessels_to_merge.pop();
+        boost::shared_ptr<VesselNode<DIM> > p_start_node = FindMergedNode(parents, p_vessel->GetStartNode());
+        boost::shared_ptr<VesselNode<DIM> > p_end_node = FindMergedNode(parents, p_vessel->GetEndNode());
+        if(p_start_node != p_end_node)
         {
-            vessels_to_merge.push_back(mVessels[idx]);
+            parents[p_end_node] = p_start_node;
         }
+        merged_vessels.insert(p_vessel);
     }
+    RemoveVessels(merged_vessels, true);
 
-    // Get the nodes, remove the vessel, move the nodes together
-    for(unsigned idx=0; idx<vessels_to_merge.size(); idx++)
+    // Attach the remaining segments of each merged node to the representative of its group
+    typename boost::unordered_map<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM> > >::iterator parent_iter;
+    for(parent_iter = parents.begin(); parent_iter != parents.end(); parent_iter++)
     {
-        vessels_to_merge[idx]->GetEndNode()->SetLocation(vessels_to_merge[idx]->GetStartNode()->rGetLocation());
-        RemoveVessel(vessels_to_merge[idx], true);
+        boost::shared_ptr<VesselNode<DIM> > p_node = FindMergedNode(parents, parent_iter->second);
+        std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = parent_iter->first->GetSegments();
+        for(unsigned idx=0; idx<segments.size(); idx++)
+        {
+            if (segments[idx]->GetNode(0) == parent_iter->first)
+            {
+                segments[idx]->ReplaceNode(0, p_node);
+            }
+            else if(segments[idx]->GetNode(1) == parent_iter->first)
+            {
+                segments[idx]->ReplaceNode(1, p_node);
+            }
+        }
     }
 
     mSegmentsUpToDate = false;
     mNodesUpToDate = false;
     mVesselNodesUpToDate = false;
-    MergeCoincidentNodes();
+    mSpatialIndexUpToDate = false;
+    mTopologyVersion++;
 }
 
 template <unsigned DIM>
-unsigned VesselNetwork<DIM>::NumberOfNodesNearLocation(const DimensionalChastePoint<DIM>& rLocation, double tolerance)
+boost::shared_ptr<VesselNode<DIM> > VesselNetwork<DIM>::FindMergedNode(boost::unordered_map<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM> > >& rParents,
+                                                                     boost::shared_ptr<VesselNode<DIM> > pNode)
 {
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = GetNodes();
-    unsigned num_nodes = 0;
+    boost::shared_ptr<VesselNode<DIM> > p_root = pNode;
+    typename boost::unordered_map<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM> > >::iterator it = rParents.find(p_root);
+    while(it != rParents.end())
+    {
+        p_root = it->second;
+        it = rParents.find(p_root);
+    }
 
-    for(unsigned idx = 0; idx < nodes.size(); idx++)
+    // Point every node on the path straight at the representative
+    it = rParents.find(pNode);
+    while(it != rParents.end() && it->second != p_root)
     {
-        if(nodes[idx]->GetDistance(rLocation)/nodes[idx]->GetReferenceLengthScale() <= tolerance + 1.e-6)
-        {
-            num_nodes++;
-        }
+        boost::shared_ptr<VesselNode<DIM> > p_next = it->second;
+        it->second = p_root;
+        it = rParents.find(p_next);
     }
-    return num_nodes;
+    return p_root;
 }
 
 template <unsigned DIM>
-std::vector<boost::shared_ptr<VesselNode<DIM> > > VesselNetwork<DIM>::GetNodes()
+boost::shared_ptr<Vessel<DIM> > VesselNetwork<DIM>::GetContinuingVessel(boost::shared_ptr<Vessel<DIM> > pVessel,
+                                                                        boost::shared_ptr<VesselNode<DIM> > pNode,
+                                                                        double maxAngle)
 {
-    if(!mNodesUpToDate)
+    boost::shared_ptr<Vessel<DIM> > p_next_vessel;
+    if(pNode->GetNumberOfSegments() != 2)
     {
-        UpdateNodes();
+        return p_next_vessel;
     }
 
-    return mNodes;
-}
+    boost::shared_ptr<VesselSegment<DIM> > p_segment = pNode->GetSegment(0);
+    boost::shared_ptr<VesselSegment<DIM> > p_next_segment = pNode->GetSegment(1);
+    if(p_segment->GetVessel() != pVessel)
+    {
+        std::swap(p_segment, p_next_segment);
+    }
+    if(p_segment->GetVessel() != pVessel || p_next_segment->GetVessel() == pVessel || !p_next_segment->GetVessel())
+    {
+        return p_next_vessel;
+    }
 
-template <unsigned DIM>
-boost::shared_ptr<VesselNode<DIM> > VesselNetwork<DIM>::GetNode(unsigned index)
-{
-    if(!mNodesUpToDate)
+    // The turn between the direction into the node and the direction out of it
+    if(maxAngle < M_PI)
     {
-        UpdateNodes();
+        c_vector<double, DIM> in_direction = p_segment->GetOppositeNode(pNode)->rGetLocation().GetUnitTangent(pNode->rGetLocation());
+        c_vector<double, DIM> out_direction = pNode->rGetLocation().GetUnitTangent(p_next_segment->GetOppositeNode(pNode)->rGetLocation());
+        double cosine = std::max(-1.0, std::min(1.0, inner_prod(in_direction, out_direction)));
+        if(std::acos(cosine) > maxAngle)
+        {
+            return p_next_vessel;
+        }
     }
 
+    p_next_vessel = p_next_segment->GetVessel();
+    return p_next_vessel;
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::MergeVesselsAtDegreeTwoNodes(double maxAngle)
+{
+    RefreshVessels();
+
+    // Grow a chain of vessels out from each vessel not yet in a chain, first past its end node then past its start
+    std::vector<std::vector<boost::shared_ptr<VesselSegment<DIM> > > > chain_segments;
+    std::vector<boost::shared_ptr<Vessel<DIM> > > chain_first_vessels;
+    std::set<boost::shared_ptr<Vessel<DIM> > > joined_vessels;
+    boost::unordered_map<Vessel<DIM>*, bool> visited;
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
+    {
+        boost::shared_ptr<Vessel<DIM> > p_vessel = mVessels[idx];
+        if(visited.find(p_vessel.get()) != visited.end() || p_vessel->GetStartNode() == p_vessel->GetEndNode())
+        {
+            continue;
+        }
+        visited[p_vessel.get()] = true;
+
+        // Each chain is a run of vessels with the nodes where they meet
+        std::deque<boost::shared_ptr<Vessel<DIM> > > chain(1, p_vessel);
+        boost::shared_ptr<VesselNode<DIM> > p_front_node = p_vessel->GetStartNode();
+        boost::shared_ptr<VesselNode<DIM> > p_back_node = p_vessel->GetEndNode();
+        for(unsigned direction=0; direction<2; direction++)
+        {
+            boost::shared_ptr<VesselNode<DIM> >& rp_node = (direction == 0) ? p_back_node : p_front_node;
+            boost::shared_ptr<VesselNode<DIM> >& rp_other_end_node = (direction == 0) ? p_front_node : p_back_node;
+            boost::shared_ptr<Vessel<DIM> > p_current = (direction == 0) ? chain.back() : chain.front();
+            while(true)
+            {
+                boost::shared_ptr<Vessel<DIM> > p_next = GetContinuingVessel(p_current, rp_node, maxAngle);
+                if(!p_next || visited.find(p_next.get()) != visited.end() || p_next->GetStartNode() == p_next->GetEndNode())
+                {
+                    break;
+                }
+
+                // Joining a vessel which closes a loop would leave the chain's two end segments connected
+                boost::shared_ptr<VesselNode<DIM> > p_far_node = p_next->GetNodeAtOppositeEnd(rp_node);
+                if(p_far_node == rp_other_end_node)
+                {
+                    break;
+                }
+                visited[p_next.get()] = true;
+                if(direction == 0)
+                {
+                    chain.push_back(p_next);
+                }
+                else
+                {
+                    chain.push_front(p_next);
+                }
+                rp_node = p_far_node;
+                p_current = p_next;
+            }
+        }
+
+        if(chain.size() < 2)
+        {
+            continue;
+        }
+
+        // Collect the segments in order from the chain's front node
+        std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments;
+        boost::shared_ptr<VesselNode<DIM> > p_node = p_front_node;
+        for(unsigned jdx=0; jdx<chain.size(); jdx++)
+        {
+            const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& r_vessel_segments = chain[jdx]->rGetSegments();
+            if(chain[jdx]->GetStartNode() == p_node)
+            {
+                segments.insert(segments.end(), r_vessel_segments.begin(), r_vessel_segments.end());
+            }
+            else
+            {
+                segments.insert(segments.end(), r_vessel_segments.rbegin(), r_vessel_segments.rend());
+            }
+            p_node = chain[jdx]->GetNodeAtOppositeEnd(p_node);
+            joined_vessels.insert(chain[jdx]);
+        }
+        chain_segments.push_back(segments);
+        chain_first_vessels.push_back(chain.front());
+    }
+
+    if(chain_segments.empty())
+    {
+        return;
+    }
+
+    // Replace each chain with a single vessel taking the data of its first vessel
+    RemoveVessels(joined_vessels);
+    std::vector<boost::shared_ptr<Vessel<DIM> > > new_vessels;
+    for(unsigned idx=0; idx<chain_segments.size(); idx++)
+    {
+        boost::shared_ptr<Vessel<DIM> > p_new_vessel = Vessel<DIM>::Create(chain_segments[idx]);
+        p_new_vessel->CopyDataFromExistingVessel(chain_first_vessels[idx]);
+        p_new_vessel->GetFlowProperties()->SetRegressionTime(chain_first_vessels[idx]->GetFlowProperties()->GetRegressionTime());
+        new_vessels.push_back(p_new_vessel);
+    }
+    AddVessels(new_vessels);
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::Simplify(units::quantity<unit::length> cutoff, double maxAngle)
+{
+    MergeShortVessels(cutoff);
+    MergeVesselsAtDegreeTwoNodes(maxAngle);
+}
+
+template <unsigned DIM>
+unsigned VesselNetwork<DIM>::NumberOfNodesNearLocation(const DimensionalChastePoint<DIM>& rLocation, double tolerance)
+{
+    // The index returns a superset of the nodes within the largest possible search distance
+    UpdateSpatialIndex();
+    units::quantity<unit::length> search_distance = (tolerance + 1.e-6) * mpSpatialIndex->GetMaximumNodeLengthScale();
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = mpSpatialIndex->GetNodesNearLocation(rLocation, search_distance);
+    unsigned num_nodes = 0;
+
+    for(unsigned idx = 0; idx < nodes.size(); idx++)
+    {
+        if(nodes[idx]->GetDistance(rLocation)/nodes[idx]->GetReferenceLengthScale() <= tolerance + 1.e-6)
+        {
+            num_nodes++;
+        }
+    }
+    return num_nodes;
+}
+
+template <unsigned DIM>
+std::vector<boost::shared_ptr<VesselNode<DIM> > > VesselNetwork<DIM>::GetNodes()
+{
+    return rGetNodes();
+}
+
+template <unsigned DIM>
+const std::vector<boost::shared_ptr<VesselNode<DIM> > >& VesselNetwork<DIM>::rGetNodes()
+{
+    RefreshNodes();
+
+    return mNodes;
+}
+
+template <unsigned DIM>
+boost::shared_ptr<VesselNode<DIM> > VesselNetwork<DIM>::GetNode(unsigned index)
+{
+    RefreshNodes();
+
     return mNodes[index];
 }
 
@@ -710,7 +1021,7 @@ unsigned VesselNetwork<DIM>::GetNumberOfNodes()
         UpdateNodes();
     }
 
-    return mNodes.size();
+    return mNodeIndices.size();
 }
 
 template <unsigned DIM>
@@ -721,48 +1032,59 @@ unsigned VesselNetwork<DIM>::GetNumberOfVesselNodes()
         UpdateVesselNodes();
     }
 
-    return mVesselNodes.size();
+    return mVesselNodeIndices.size();
 }
 
 template <unsigned DIM>
 unsigned VesselNetwork<DIM>::GetNodeIndex(boost::shared_ptr<VesselNode<DIM> > node)
 {
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > vec_nodes = GetNodes();
+    RefreshNodes();
 
-    unsigned index = 0;
-
-    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator it;
-    for(it = vec_nodes.begin(); it != vec_nodes.end(); it++)
+    typename boost::unordered_map<VesselNode<DIM>*, unsigned>::const_iterator it = mNodeIndices.find(node.get());
+    if(it == mNodeIndices.end())
     {
-        if(*it == node)
-        {
-            return index;
-        }
-        index ++;
+        EXCEPTION("Node is not in the network.");
     }
-    EXCEPTION("Node is not in the network.");
-
+    return it->second;
 }
 
 template <unsigned DIM>
 unsigned VesselNetwork<DIM>::GetNumberOfVessels()
 {
+    RefreshVessels();
     return mVessels.size();
 }
 
 template <unsigned DIM>
 std::vector<boost::shared_ptr<VesselNode<DIM> > > VesselNetwork<DIM>::GetVesselEndNodes()
 {
-    if(!mVesselNodesUpToDate)
+    return rGetVesselEndNodes();
+}
+
+template <unsigned DIM>
+const std::vector<boost::shared_ptr<VesselNode<DIM> > >& VesselNetwork<DIM>::rGetVesselEndNodes()
+{
+    RefreshVesselNodes();
+    return mVesselNodes;
+}
+
+template <unsigned DIM>
+unsigned VesselNetwork<DIM>::GetVesselEndNodeIndex(boost::shared_ptr<VesselNode<DIM> > pNode)
+{
+    RefreshVesselNodes();
+
+    typename boost::unordered_map<VesselNode<DIM>*, unsigned>::const_iterator it = mVesselNodeIndices.find(pNode.get());
+    if(it == mVesselNodeIndices.end())
     {
-        UpdateVesselNodes();
+        EXCEPTION("Node is not at the end of a vessel in the network.");
     }
-    return mVesselNodes;
+    return it->second;
 }
 
 template <unsigned DIM>
 boost::shared_ptr<Vessel<DIM> > VesselNetwork<DIM>::GetVessel(unsigned index)
 {
+    RefreshVessels();
     if(index  >= mVessels.size())
     {
         EXCEPTION("Requested vessel index out of range");
@@ -774,14 +1096,40 @@ boost::shared_ptr<Vessel<DIM> > VesselNetwork<DIM>::GetVessel(unsigned index)
 template <unsigned DIM>
 std::vector<boost::shared_ptr<Vessel<DIM> > > VesselNetwork<DIM>::GetVessels()
 {
+    RefreshVessels();
     return mVessels;
 }
 
+template <unsigned DIM>
+const std::vector<boost::shared_ptr<Vessel<DIM> > >& VesselNetwork<DIM>::rGetVessels()
+{
+    RefreshVessels();
+    return mVessels;
+}
+
+
+template <unsigned DIM>
+bool VesselNetwork<DIM>::IsInBatch()
+{
+    return mBatchDepth > 0;
+}
+
+template <unsigned DIM>
+unsigned VesselNetwork<DIM>::GetTopologyVersion()
+{
+    return mTopologyVersion;
+}
+
+template <unsigned DIM>
+unsigned VesselNetwork<DIM>::GetGeometryVersion()
+{
+    return mGeometryVersion;
+}
 
 template <unsigned DIM>
 unsigned VesselNetwork<DIM>::GetMaxBranchesOnNode()
 {
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = GetVesselEndNodes();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = rGetVesselEndNodes();
     unsigned num_nodes = nodes.size();
 
     // Get maximum number of segments attached to a node in the whole network.
@@ -802,43 +1150,52 @@ unsigned VesselNetwork<DIM>::GetMaxBranchesOnNode()
 template <unsigned DIM>
 unsigned VesselNetwork<DIM>::GetVesselIndex(boost::shared_ptr<Vessel<DIM> > pVessel)
 {
-    unsigned index = 0;
-    typename std::vector<boost::shared_ptr<Vessel<DIM> > >::iterator it;
-    for(it = mVessels.begin(); it != mVessels.end(); it++)
+    RefreshVessels();
+    UpdateVesselIndices();
+
+    typename boost::unordered_map<Vessel<DIM>*, unsigned>::const_iterator it = mVesselIndices.find(pVessel.get());
+    if(it == mVesselIndices.end())
     {
-        if(*it == pVessel)
-        {
-            return index;
-        }
-        index ++;
+        EXCEPTION("Input vessel is not in the network.");
     }
-    EXCEPTION("Input vessel is not in the network.");
+    return it->second;
 }
 
 template <unsigned DIM>
 unsigned VesselNetwork<DIM>::GetVesselSegmentIndex(boost::shared_ptr<VesselSegment<DIM> > pVesselSegment)
 {
-    unsigned index = 0;
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = GetVesselSegments();
-    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::iterator it;
-    for(it = segments.begin(); it != segments.end(); it++)
+    RefreshSegments();
+
+    typename boost::unordered_map<VesselSegment<DIM>*, unsigned>::const_iterator it = mSegmentIndices.find(pVesselSegment.get());
+    if(it == mSegmentIndices.end())
     {
-        if(*it == pVesselSegment)
-        {
-            return index;
-        }
-        index++;
+        EXCEPTION("Input vessel is not in the network.");
     }
-    EXCEPTION("Input vessel is not in the network.");
+    return it->second;
 }
 
 template <unsigned DIM>
-std::vector<boost::shared_ptr<VesselSegment<DIM> > > VesselNetwork<DIM>::GetVesselSegments()
+boost::shared_ptr<VesselSegment<DIM> > VesselNetwork<DIM>::GetVesselSegment(unsigned index)
 {
-    if(!mSegmentsUpToDate)
+    RefreshSegments();
+
+    if(index >= mSegments.size())
     {
-        UpdateSegments();
+        EXCEPTION("Requested segment index out of range");
     }
+    return mSegments[index];
+}
+
+template <unsigned DIM>
+std::vector<boost::shared_ptr<VesselSegment<DIM> > > VesselNetwork<DIM>::GetVesselSegments()
+{
+    return rGetVesselSegments();
+}
+
+template <unsigned DIM>
+const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& VesselNetwork<DIM>::rGetVesselSegments()
+{
+    RefreshSegments();
 
     return mSegments;
 }
@@ -846,8 +1203,11 @@ std::vector<boost::shared_ptr<VesselSegment<DIM> > > VesselNetwork<DIM>::GetVess
 template <unsigned DIM>
 bool VesselNetwork<DIM>::NodeIsInNetwork(boost::shared_ptr<VesselNode<DIM> > pSourceNode)
 {
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = GetNodes();
-    return (std::find(nodes.begin(), nodes.end(), pSourceNode) != nodes.end());
+    if(!mNodesUpToDate)
+    {
+        UpdateNodes();
+    }
+    return mNodeIndices.find(pSourceNode.get()) != mNodeIndices.end();
 }
 
 template <unsigned DIM>
@@ -862,7 +1222,7 @@ void VesselNetwork<DIM>::MergeCoincidentNodes(std::vector<boost::shared_ptr<Vess
     std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes;
     for(unsigned idx = 0; idx <pVessels.size(); idx++)
     {
-        std::vector<boost::shared_ptr<VesselNode<DIM> > > vessel_nodes = pVessels[idx]->GetNodes();
+        const std::vector<boost::shared_ptr<VesselNode<DIM> > >& vessel_nodes = pVessels[idx]->rGetNodes();
         nodes.insert(nodes.end(), vessel_nodes.begin(), vessel_nodes.end());
     }
     MergeCoincidentNodes(nodes, tolerance);
@@ -871,59 +1231,151 @@ void VesselNetwork<DIM>::MergeCoincidentNodes(std::vector<boost::shared_ptr<Vess
 template <unsigned DIM>
 void VesselNetwork<DIM>::MergeCoincidentNodes(std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes, double tolerance)
 {
-    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator it;
-    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator it2;
-    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::iterator it3;
+    if(nodes.size()<2)
+    {
+        return;
+    }
 
-    for(it = nodes.begin(); it != nodes.end(); it++)
+    // Express all node locations in the reference length of the first node so they can be bucketed
+    // on a common grid. The tolerance is relative to each node's own reference length, so the
+    // largest reference length sets the bucket width.
+    units::quantity<unit::length> common_length = nodes[0]->GetReferenceLengthScale();
+    std::vector<c_vector<double, DIM> > locations(nodes.size());
+    c_vector<double, DIM> lower_corner = nodes[0]->rGetLocation().rGetLocation();
+    c_vector<double, DIM> upper_corner = lower_corner;
+    double max_length_ratio = 0.0;
+    for(unsigned idx=0; idx<nodes.size(); idx++)
+    {
+        double length_ratio = nodes[idx]->GetReferenceLengthScale()/common_length;
+        max_length_ratio = std::max(max_length_ratio, length_ratio);
+        locations[idx] = nodes[idx]->rGetLocation().rGetLocation()*length_ratio;
+        for(unsigned jdx=0; jdx<DIM; jdx++)
+        {
+            lower_corner[jdx] = std::min(lower_corner[jdx], locations[idx][jdx]);
+            upper_corner[jdx] = std::max(upper_corner[jdx], locations[idx][jdx]);
+        }
+    }
+
+    // Any positive bucket width finds every coincident pair in the neighbouring buckets, since the
+    // coincidence test itself is applied to each candidate. Buckets are kept at least wide enough that
+    // the network extent fits in the packed cell keys below.
+    double limit = double(1<<20);
+    double cell_width = std::max(tolerance*max_length_ratio, norm_inf(upper_corner - lower_corner)/limit);
+    if(!(cell_width>0.0))
     {
-        for(it2 = nodes.begin(); it2 != nodes.end(); it2++)
+        cell_width = 1.0;
+    }
+
+    // Bucket the node list positions by cell. Cell indices are packed into 21 bits per
+    // dimension; distant cells which alias only add candidates which fail the coincidence test.
+    unsigned long long mask = ((unsigned long long)(1)<<21) - 1;
+    std::vector<c_vector<int, DIM> > cell_indices(nodes.size());
+    boost::unordered_map<unsigned long long, std::vector<unsigned> > buckets;
+    for(unsigned idx=0; idx<nodes.size(); idx++)
+    {
+        unsigned long long key = 0;
+        for(unsigned jdx=0; jdx<DIM; jdx++)
+        {
+            double cell_coordinate = std::floor((locations[idx][jdx]-lower_corner[jdx])/cell_width);
+            cell_indices[idx][jdx] = int(std::max(-limit, std::min(limit, cell_coordinate)));
+            key |= ((unsigned long long)(cell_indices[idx][jdx] + (1<<20)) & mask) << (21*jdx);
+        }
+        buckets[key].push_back(idx);
+    }
+
+    unsigned num_neighbours = (DIM==2) ? 9 : 27;
+    std::vector<unsigned> candidates;
+    bool nodes_merged = false;
+    for(unsigned idx=0; idx<nodes.size(); idx++)
+    {
+        // Collect the list positions in the 3^DIM neighbouring buckets
+        candidates.clear();
+        for(unsigned neighbour=0; neighbour<num_neighbours; neighbour++)
+        {
+            unsigned long long key = 0;
+            unsigned remainder = neighbour;
+            for(unsigned jdx=0; jdx<DIM; jdx++)
+            {
+                int offset = int(remainder%3) - 1;
+                remainder/=3;
+                key |= ((unsigned long long)(cell_indices[idx][jdx] + offset + (1<<20)) & mask) << (21*jdx);
+            }
+            typename boost::unordered_map<unsigned long long, std::vector<unsigned> >::const_iterator bucket = buckets.find(key);
+            if(bucket != buckets.end())
+            {
+                candidates.insert(candidates.end(), bucket->second.begin(), bucket->second.end());
+            }
+        }
+
+        // Visit candidates in list order, as for a full pairwise scan, so merges resolve the same way.
+        // Aliased buckets can repeat a position.
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        boost::shared_ptr<VesselNode<DIM> > p_node = nodes[idx];
+        for(unsigned jdx=0; jdx<candidates.size(); jdx++)
         {
+            boost::shared_ptr<VesselNode<DIM> > p_other_node = nodes[candidates[jdx]];
+
             // If the nodes are not identical
-            if ((*it) != (*it2))
+            if (p_node != p_other_node)
             {
                 // If the node locations are the same - according to the ChastePoint definition
                 bool is_coincident = false;
                 if(tolerance >0.0)
                 {
-                    is_coincident = (*it)->GetDistance((*it2)->rGetLocation())/(*it)->GetReferenceLengthScale() <= tolerance;
+                    is_coincident = p_node->GetDistance(p_other_node->rGetLocation())/p_node->GetReferenceLengthScale() <= tolerance;
                 }
                 else
                 {
-                    is_coincident = (*it)->IsCoincident((*it2)->rGetLocation());
+                    is_coincident = p_node->IsCoincident(p_other_node->rGetLocation());
                 }
 
                 if(is_coincident)
                 {
-                    // Replace the node corresponding to 'it2' with the one corresponding to 'it'
-                    // in all segments.
-                    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = (*it2)->GetSegments();
-                    for(it3 = segments.begin(); it3 != segments.end(); it3++)
+                    nodes_merged = true;
+
+                    // Replace the other node with this one in all segments.
+                    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = p_other_node->GetSegments();
+                    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::iterator it;
+                    for(it = segments.begin(); it != segments.end(); it++)
                     {
-                        if ((*it3)->GetNode(0) == (*it2))
+                        if ((*it)->GetNode(0) == p_other_node)
                         {
-                            (*it3)->ReplaceNode(0, (*it));
+                            (*it)->ReplaceNode(0, p_node);
                         }
-                        else if(((*it3)->GetNode(1) == (*it2)))
+                        else if(((*it)->GetNode(1) == p_other_node))
                         {
-                            (*it3)->ReplaceNode(1, (*it));
+                            (*it)->ReplaceNode(1, p_node);
                         }
                     }
                 }
             }
         }
     }
-    mSegmentsUpToDate = false;
-    mNodesUpToDate = false;
-    mVesselNodesUpToDate = false;
+    if(nodes_merged)
+    {
+        mSegmentsUpToDate = false;
+        mNodesUpToDate = false;
+        mVesselNodesUpToDate = false;
+        mSpatialIndexUpToDate = false;
+        mTopologyVersion++;
+    }
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::SetSpatialIndexCellWidth(units::quantity<unit::length> width)
+{
+    mpSpatialIndex->SetCellWidth(width);
+    mSpatialIndexUpToDate = false;
 }
 
 template <unsigned DIM>
 void VesselNetwork<DIM>::SetSegmentProperties(boost::shared_ptr<VesselSegment<DIM> >  prototype)
 {
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = rGetVesselSegments();
 
-    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::iterator it;
+    typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::const_iterator it;
     for(it = segments.begin(); it != segments.end(); it++)
     {
         (*it)->SetRadius(prototype->GetRadius());
@@ -937,6 +1389,7 @@ void VesselNetwork<DIM>::SetSegmentProperties(boost::shared_ptr<VesselSegment<DI
 template <unsigned DIM>
 void VesselNetwork<DIM>::Translate(DimensionalChastePoint<DIM> rTranslationVector)
 {
+    RefreshVessels();
     Translate(rTranslationVector, mVessels);
 }
 
@@ -946,7 +1399,7 @@ void VesselNetwork<DIM>::Translate(DimensionalChastePoint<DIM> rTranslationVecto
     std::set<boost::shared_ptr<VesselNode<DIM> > > nodes;
     for(unsigned idx = 0; idx <vessels.size(); idx++)
     {
-        std::vector<boost::shared_ptr<VesselNode<DIM> > > vessel_nodes = vessels[idx]->GetNodes();
+        const std::vector<boost::shared_ptr<VesselNode<DIM> > >& vessel_nodes = vessels[idx]->rGetNodes();
         std::copy(vessel_nodes.begin(), vessel_nodes.end(), std::inserter(nodes, nodes.begin()));
     }
 
@@ -957,35 +1410,367 @@ void VesselNetwork<DIM>::Translate(DimensionalChastePoint<DIM> rTranslationVecto
         old_loc.Translate(rTranslationVector);
         (*node_iter)->SetLocation(old_loc);
     }
+    mSpatialIndexUpToDate = false;
+    mGeometryVersion++;
 }
 
 template <unsigned DIM>
-void VesselNetwork<DIM>::RemoveVessel(boost::shared_ptr<Vessel<DIM> > pVessel, bool deleteVessel)
+void VesselNetwork<DIM>::Reorder(NetworkOrdering::Value ordering)
 {
+    RefreshVessels();
+    if(mVessels.empty())
+    {
+        return;
+    }
 
-    typename std::vector<boost::shared_ptr<Vessel<DIM> > >::iterator it = std::find(mVessels.begin(), mVessels.end(), pVessel);
-    if(it != mVessels.end())
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = rGetVesselEndNodes();
+    unsigned num_nodes = r_nodes.size();
+    std::vector<unsigned> start_nodes(mVessels.size());
+    std::vector<unsigned> end_nodes(mVessels.size());
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
     {
-        if(deleteVessel)
+        start_nodes[idx] = GetVesselEndNodeIndex(mVessels[idx]->GetStartNode());
+        end_nodes[idx] = GetVesselEndNodeIndex(mVessels[idx]->GetEndNode());
+    }
+
+    // The current index of the end node to be placed at each new position
+    std::vector<unsigned> node_order(num_nodes);
+    if(ordering == NetworkOrdering::MORTON)
+    {
+        std::vector<c_vector<double, DIM> > locations(num_nodes);
+        c_vector<double, DIM> lower = scalar_vector<double>(DIM, DBL_MAX);
+        c_vector<double, DIM> upper = scalar_vector<double>(DIM, -DBL_MAX);
+        for(unsigned idx=0; idx<num_nodes; idx++)
         {
-            (*it)->Remove();
+            locations[idx] = r_nodes[idx]->rGetLocation().rGetLocation() * (r_nodes[idx]->GetReferenceLengthScale() / unit::metres);
+            for(unsigned jdx=0; jdx<DIM; jdx++)
+            {
+                lower[jdx] = std::min(lower[jdx], locations[idx][jdx]);
+                upper[jdx] = std::max(upper[jdx], locations[idx][jdx]);
+            }
+        }
+
+        // Interleave the bits of the locations snapped to a 2^21 grid over the bounding box
+        const unsigned num_bits = 21;
+        const double max_cell = double((1u << num_bits) - 1u);
+        std::vector<std::pair<boost::uint64_t, unsigned> > codes(num_nodes);
+        for(unsigned idx=0; idx<num_nodes; idx++)
+        {
+            boost::uint64_t code = 0;
+            for(unsigned jdx=0; jdx<DIM; jdx++)
+            {
+                double width = upper[jdx] - lower[jdx];
+                boost::uint64_t cell = 0;
+                if(width > 0.0)
+                {
+                    cell = boost::uint64_t((locations[idx][jdx] - lower[jdx]) / width * max_cell);
+                }
+                for(unsigned bit=0; bit<num_bits; bit++)
+                {
+                    code |= ((cell >> bit) & 1u) << (bit * DIM + jdx);
+                }
+            }
+            codes[idx] = std::pair<boost::uint64_t, unsigned>(code, idx);
+        }
+        std::sort(codes.begin(), codes.end());
+        for(unsigned idx=0; idx<num_nodes; idx++)
+        {
+            node_order[idx] = codes[idx].second;
         }
-        mVessels.erase(it);
     }
     else
+    {
+        typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS,
+                boost::property<boost::vertex_color_t, boost::default_color_type,
+                boost::property<boost::vertex_degree_t, int> > > Graph;
+        Graph graph(num_nodes);
+        for(unsigned idx=0; idx<mVessels.size(); idx++)
+        {
+            if(start_nodes[idx] != end_nodes[idx])
+            {
+                boost::add_edge(start_nodes[idx], end_nodes[idx], graph);
+            }
+        }
+        std::vector<boost::graph_traits<Graph>::vertex_descriptor> inverse_permutation(num_nodes);
+        boost::cuthill_mckee_ordering(graph, inverse_permutation.rbegin(), boost::get(boost::vertex_color, graph),
+                                      boost::make_degree_map(graph));
+        for(unsigned idx=0; idx<num_nodes; idx++)
+        {
+            node_order[idx] = inverse_permutation[idx];
+        }
+    }
+
+    std::vector<unsigned> node_ranks(num_nodes);
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > ordered_nodes(num_nodes);
+    for(unsigned idx=0; idx<num_nodes; idx++)
+    {
+        node_ranks[node_order[idx]] = idx;
+        ordered_nodes[idx] = r_nodes[node_order[idx]];
+    }
+
+    // Order the vessels by their lowest, then highest, numbered end node
+    std::vector<std::pair<std::pair<unsigned, unsigned>, unsigned> > vessel_keys(mVessels.size());
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
+    {
+        unsigned start_rank = node_ranks[start_nodes[idx]];
+        unsigned end_rank = node_ranks[end_nodes[idx]];
+        vessel_keys[idx].first = std::pair<unsigned, unsigned>(std::min(start_rank, end_rank), std::max(start_rank, end_rank));
+        vessel_keys[idx].second = idx;
+    }
+    std::sort(vessel_keys.begin(), vessel_keys.end());
+    std::vector<boost::shared_ptr<Vessel<DIM> > > ordered_vessels(mVessels.size());
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
+    {
+        ordered_vessels[idx] = mVessels[vessel_keys[idx].second];
+    }
+    mVessels.swap(ordered_vessels);
+    mVesselIndicesUpToDate = false;
+
+    // Rebuild the caches in the new vessel order, then apply the exact end node order
+    UpdateSegments();
+    UpdateNodes();
+    UpdateVesselNodes();
+    mVesselNodes.swap(ordered_nodes);
+    mVesselNodeIndices.clear();
+    for(unsigned idx=0; idx<mVesselNodes.size(); idx++)
+    {
+        mVesselNodeIndices[mVesselNodes[idx].get()] = idx;
+    }
+    UpdateVesselIds();
+    mTopologyVersion++;
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::RemoveVessel(boost::shared_ptr<Vessel<DIM> > pVessel, bool deleteVessel)
+{
+    // Check the vessel is in the network before anything is changed
+    UpdateVesselIndices();
+    typename boost::unordered_map<Vessel<DIM>*, unsigned>::const_iterator index_iter = mVesselIndices.find(pVessel.get());
+    if(index_iter == mVesselIndices.end())
     {
         EXCEPTION("Vessel is not contained inside network.");
     }
+    mTopologyVersion++;
 
-    mSegmentsUpToDate = false;
-    mNodesUpToDate = false;
-    mVesselNodesUpToDate = false;
+    // Segments may have been handed over to other vessels, so only remove those still owned
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > owned_segments;
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = pVessel->rGetSegments();
+    for(unsigned idx=0; idx<segments.size(); idx++)
+    {
+        if(segments[idx]->GetVessel() == pVessel)
+        {
+            owned_segments.push_back(segments[idx]);
+        }
+    }
+    RemoveFromCaches(owned_segments, pVessel->rGetNodes());
+    if(deleteVessel)
+    {
+        pVessel->Remove();
+    }
+    RemoveFromVesselList(index_iter->second);
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::RemoveVessels(const std::set<boost::shared_ptr<Vessel<DIM> > >& rVessels, bool deleteVessels)
+{
+    RefreshVessels();
+    if(rVessels.empty())
+    {
+        return;
+    }
+
+    // Mark the vessels to be removed, checking they are all in the network before anything is changed
+    std::vector<bool> remove_flags(mVessels.size(), false);
+    unsigned num_marked = 0;
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
+    {
+        if(rVessels.count(mVessels[idx]) > 0)
+        {
+            remove_flags[idx] = true;
+            num_marked++;
+        }
+    }
+    if(num_marked != rVessels.size())
+    {
+        EXCEPTION("Vessel is not contained inside network.");
+    }
+
+    mTopologyVersion++;
+
+    // Compact the surviving vessels in place, releasing the segment and node references of the removed ones
+    unsigned num_kept = 0;
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
+    {
+        if(!remove_flags[idx])
+        {
+            if(num_kept != idx)
+            {
+                mVessels[num_kept] = mVessels[idx];
+            }
+            num_kept++;
+            continue;
+        }
+
+        boost::shared_ptr<Vessel<DIM> > p_vessel = mVessels[idx];
+        std::vector<boost::shared_ptr<VesselSegment<DIM> > > owned_segments;
+        const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = p_vessel->rGetSegments();
+        for(unsigned jdx=0; jdx<segments.size(); jdx++)
+        {
+            if(segments[jdx]->GetVessel() == p_vessel)
+            {
+                owned_segments.push_back(segments[jdx]);
+            }
+        }
+        RemoveFromCaches(owned_segments, p_vessel->rGetNodes());
+        if(deleteVessels)
+        {
+            p_vessel->Remove();
+        }
+    }
+    mVessels.resize(num_kept);
+    mVesselIndicesUpToDate = false;
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::RemoveFromVesselList(unsigned index)
+{
+    RemoveFromCache(mVessels[index].get(), mVessels, mVesselIndices);
+}
+
+template <unsigned DIM>
+template<class COMPONENT>
+void VesselNetwork<DIM>::RemoveFromCache(COMPONENT* pComponent, std::vector<boost::shared_ptr<COMPONENT> >& rCache,
+                                         boost::unordered_map<COMPONENT*, unsigned>& rIndices)
+{
+    typename boost::unordered_map<COMPONENT*, unsigned>::iterator it = rIndices.find(pComponent);
+    if(it != rIndices.end())
+    {
+        rCache[it->second].reset();
+        rIndices.erase(it);
+
+        // Gaps at the end can be dropped straight away
+        while(!rCache.empty() && !rCache.back())
+        {
+            rCache.pop_back();
+        }
+    }
+}
+
+template <unsigned DIM>
+template<class COMPONENT>
+void VesselNetwork<DIM>::RemoveGaps(std::vector<boost::shared_ptr<COMPONENT> >& rCache, boost::unordered_map<COMPONENT*, unsigned>& rIndices)
+{
+    if(rCache.size() != rIndices.size())
+    {
+        unsigned num_components = 0;
+        for(unsigned idx=0; idx<rCache.size(); idx++)
+        {
+            if(rCache[idx])
+            {
+                rIndices[rCache[idx].get()] = num_components;
+                rCache[num_components] = rCache[idx];
+                num_components++;
+            }
+        }
+        rCache.resize(num_components);
+    }
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::RemoveNodeReference(const boost::shared_ptr<VesselNode<DIM> >& rpNode, std::vector<boost::shared_ptr<VesselNode<DIM> > >& rCache,
+                                             boost::unordered_map<VesselNode<DIM>*, unsigned>& rIndices,
+                                             boost::unordered_map<VesselNode<DIM>*, unsigned>& rCounts)
+{
+    typename boost::unordered_map<VesselNode<DIM>*, unsigned>::iterator it = rCounts.find(rpNode.get());
+    if(it != rCounts.end() && --(it->second) == 0)
+    {
+        rCounts.erase(it);
+        RemoveFromCache(rpNode.get(), rCache, rIndices);
+    }
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::RemoveFromCaches(const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& rSegments,
+                                          const std::vector<boost::shared_ptr<VesselNode<DIM> > >& rNodes)
+{
+    for(unsigned idx=0; idx<rSegments.size(); idx++)
+    {
+        if(mSpatialIndexUpToDate)
+        {
+            mpSpatialIndex->RemoveSegment(rSegments[idx]);
+        }
+        if(mSegmentsUpToDate)
+        {
+            RemoveFromCache(rSegments[idx].get(), mSegments, mSegmentIndices);
+        }
+    }
+    if(mNodesUpToDate)
+    {
+        for(unsigned idx=0; idx<rNodes.size(); idx++)
+        {
+            RemoveNodeReference(rNodes[idx], mNodes, mNodeIndices, mNodeReferenceCounts);
+        }
+    }
+    if(mVesselNodesUpToDate && !rNodes.empty())
+    {
+        RemoveNodeReference(rNodes.front(), mVesselNodes, mVesselNodeIndices, mVesselNodeReferenceCounts);
+        RemoveNodeReference(rNodes.back(), mVesselNodes, mVesselNodeIndices, mVesselNodeReferenceCounts);
+    }
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::RefreshVessels()
+{
+    // Gaps are only left while the vessel indices are up to date
+    if(mVesselIndicesUpToDate)
+    {
+        RemoveGaps(mVessels, mVesselIndices);
+    }
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::RefreshNodes()
+{
+    if(!mNodesUpToDate)
+    {
+        UpdateNodes();
+    }
+    else
+    {
+        RemoveGaps(mNodes, mNodeIndices);
+    }
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::RefreshSegments()
+{
+    if(!mSegmentsUpToDate)
+    {
+        UpdateSegments();
+    }
+    else
+    {
+        RemoveGaps(mSegments, mSegmentIndices);
+    }
+}
+
+template <unsigned DIM>
+void VesselNetwork<DIM>::RefreshVesselNodes()
+{
+    if(!mVesselNodesUpToDate)
+    {
+        UpdateVesselNodes();
+    }
+    else
+    {
+        RemoveGaps(mVesselNodes, mVesselNodeIndices);
+    }
 }
 
 template <unsigned DIM>
 void VesselNetwork<DIM>::SetNodeRadii(units::quantity<unit::length> radius)
 {
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = GetNodes();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = rGetNodes();
 
     for(unsigned idx=0; idx<nodes.size();idx++)
     {
@@ -997,7 +1782,7 @@ void VesselNetwork<DIM>::SetNodeRadii(units::quantity<unit::length> radius)
 template <unsigned DIM>
 void VesselNetwork<DIM>::SetSegmentRadii(units::quantity<unit::length> radius)
 {
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = rGetVesselSegments();
 
     for(unsigned idx=0; idx<segments.size();idx++)
     {
@@ -1008,7 +1793,7 @@ void VesselNetwork<DIM>::SetSegmentRadii(units::quantity<unit::length> radius)
 template <unsigned DIM>
 void VesselNetwork<DIM>::SetSegmentViscosity(units::quantity<unit::dynamic_viscosity> viscosity)
 {
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = rGetVesselSegments();
     for(unsigned idx=0; idx<segments.size(); idx++)
     {
         segments[idx]->GetFlowProperties()->SetViscosity(viscosity);
@@ -1018,37 +1803,70 @@ void VesselNetwork<DIM>::SetSegmentViscosity(units::quantity<unit::dynamic_visco
 template <unsigned DIM>
 void VesselNetwork<DIM>::UpdateAll(bool merge)
 {
+    if(mBatchDepth > 0)
+    {
+        mMergeOnCommit = mMergeOnCommit || merge;
+        UpdateReconnectedSegments();
+        return;
+    }
+
     if(merge)
     {
         MergeCoincidentNodes();
     }
+
+    // Rebuild the collections, keeping the old ones to tell if segments or nodes have been changed directly
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > old_segments;
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > old_nodes;
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > old_vessel_nodes;
+    old_segments.swap(mSegments);
+    old_nodes.swap(mNodes);
+    old_vessel_nodes.swap(mVesselNodes);
     UpdateSegments();
     UpdateVesselNodes();
     UpdateNodes();
     UpdateVesselIds();
+
+    std::vector<unsigned> segment_node_indices(2*mSegments.size(), UINT_MAX);
+    for(unsigned idx=0; idx<mSegments.size(); idx++)
+    {
+        for(unsigned jdx=0; jdx<2; jdx++)
+        {
+            typename boost::unordered_map<VesselNode<DIM>*, unsigned>::const_iterator it = mNodeIndices.find(mSegments[idx]->GetNode(jdx).get());
+            if(it != mNodeIndices.end())
+            {
+                segment_node_indices[2*idx+jdx] = it->second;
+            }
+        }
+    }
+    if(mSegmentNodeIndicesVersion == mTopologyVersion && (old_segments != mSegments || old_nodes != mNodes
+            || old_vessel_nodes != mVesselNodes || segment_node_indices != mSegmentNodeIndices))
+    {
+        mTopologyVersion++;
+    }
+    mSegmentNodeIndices.swap(segment_node_indices);
+    mSegmentNodeIndicesVersion = mTopologyVersion;
+    mReconnectedSegmentsVersion = VesselSegment<DIM>::GetLatestNodesVersion();
+
+    // Nodes may have been moved since the index was built
+    mSpatialIndexUpToDate = false;
+    mGeometryVersion++;
 }
 
 template<unsigned DIM>
 void VesselNetwork<DIM>::UpdateNodes()
 {
+    RefreshVessels();
     mNodes.clear();
+    mNodeIndices.clear();
+    mNodeReferenceCounts.clear();
     typename std::vector<boost::shared_ptr<Vessel<DIM> > >::iterator it;
     for(it = mVessels.begin(); it != mVessels.end(); it++)
     {
-        for (unsigned idx=0; idx<(*it)->GetNumberOfNodes(); idx++)
+        const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_vessel_nodes = (*it)->rGetNodes();
+        for (unsigned idx=0; idx<r_vessel_nodes.size(); idx++)
         {
-            (*it)->GetNode(idx)->SetComparisonId(0);
-        }
-    }
-    for(it = mVessels.begin(); it != mVessels.end(); it++)
-    {
-        for (unsigned idx=0; idx<(*it)->GetNumberOfNodes(); idx++)
-        {
-            if((*it)->GetNode(idx)->GetComparisonId()==0)
-            {
-                mNodes.push_back((*it)->GetNode(idx));
-                (*it)->GetNode(idx)->SetComparisonId(1);
-            }
+            AddNodeReference(r_vessel_nodes[idx], mNodes, mNodeIndices, mNodeReferenceCounts);
         }
     }
     mNodesUpToDate = true;
@@ -1057,68 +1875,178 @@ void VesselNetwork<DIM>::UpdateNodes()
 template<unsigned DIM>
 void VesselNetwork<DIM>::UpdateSegments()
 {
+    RefreshVessels();
     mSegments.clear();
+    mSegmentIndices.clear();
     typename std::vector<boost::shared_ptr<Vessel<DIM> > >::iterator it;
     for(it = mVessels.begin(); it != mVessels.end(); it++)
     {
-        std::vector<boost::shared_ptr<VesselSegment<DIM> > > vessel_segments = (*it)->GetSegments();
-        std::copy(vessel_segments.begin(), vessel_segments.end(), std::back_inserter(mSegments));
+        const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& vessel_segments = (*it)->rGetSegments();
+        for(unsigned idx=0; idx<vessel_segments.size(); idx++)
+        {
+            AddToCache(vessel_segments[idx], mSegments, mSegmentIndices);
+        }
     }
     mSegmentsUpToDate = true;
 }
 
 template<unsigned DIM>
-void VesselNetwork<DIM>::UpdateVesselNodes()
+void VesselNetwork<DIM>::UpdateReconnectedSegments()
 {
-    mVesselNodes.clear();
-    typename std::vector<boost::shared_ptr<Vessel<DIM> > >::iterator it;
-    for(it = mVessels.begin(); it != mVessels.end(); it++)
+    RefreshVessels();
+    unsigned latest_version = VesselSegment<DIM>::GetLatestNodesVersion();
+    if(latest_version == mReconnectedSegmentsVersion)
     {
-        (*it)->UpdateNodes();
-        (*it)->GetStartNode()->SetComparisonId(0);
-        (*it)->GetEndNode()->SetComparisonId(0);
+        return;
     }
-    for(it = mVessels.begin(); it != mVessels.end(); it++)
+
+    // Look up the segments reconnected since the last call if they are all known and the segment cache can be
+    // trusted, otherwise check every segment in the network
+    bool segments_reconnected = false;
+    std::vector<const VesselSegment<DIM>*> reconnected_segments;
+    bool use_reconnected = mSegmentsUpToDate &&
+            VesselSegment<DIM>::GetReconnectedSegments(mReconnectedSegmentsVersion, reconnected_segments);
+    for(unsigned idx=0; use_reconnected && idx<reconnected_segments.size(); idx++)
     {
-        if((*it)->GetStartNode()->GetComparisonId()==0)
+        if(mSegmentIndices.find(const_cast<VesselSegment<DIM>*>(reconnected_segments[idx])) != mSegmentIndices.end())
         {
-            mVesselNodes.push_back((*it)->GetStartNode());
-            (*it)->GetStartNode()->SetComparisonId(1);
+            segments_reconnected = true;
+            break;
         }
-        if((*it)->GetEndNode()->GetComparisonId()==0)
+    }
+    for(unsigned idx=0; !use_reconnected && idx<mVessels.size() && !segments_reconnected; idx++)
+    {
+        const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& r_segments = mVessels[idx]->rGetSegments();
+        for(unsigned jdx=0; jdx<r_segments.size(); jdx++)
         {
-            mVesselNodes.push_back((*it)->GetEndNode());
-            (*it)->GetEndNode()->SetComparisonId(1);
+            if(r_segments[jdx]->GetNodesVersion() > mReconnectedSegmentsVersion)
+            {
+                segments_reconnected = true;
+                break;
+            }
         }
     }
+    mReconnectedSegmentsVersion = latest_version;
+
+    if(segments_reconnected)
+    {
+        mNodesUpToDate = false;
+        mVesselNodesUpToDate = false;
+        mTopologyVersion++;
+    }
+}
+
+template<unsigned DIM>
+void VesselNetwork<DIM>::UpdateSpatialIndex()
+{
+    if(!mSpatialIndexUpToDate || mpSpatialIndex->IsUnbalanced())
+    {
+        mpSpatialIndex->Build(GetVesselSegments());
+        mSpatialIndexUpToDate = true;
+    }
+    else
+    {
+        // Segments reconnected and nodes moved directly, such as migrating tips, are picked up without a rebuild
+        mpSpatialIndex->UpdateReconnectedSegments();
+        mpSpatialIndex->UpdateMovedNodes();
+    }
+}
+
+template<unsigned DIM>
+void VesselNetwork<DIM>::UpdateVesselIndices()
+{
+    if(!mVesselIndicesUpToDate)
+    {
+        mVesselIndices.clear();
+        for(unsigned idx=0; idx<mVessels.size(); idx++)
+        {
+            mVesselIndices[mVessels[idx].get()] = idx;
+        }
+        mVesselIndicesUpToDate = true;
+    }
+}
+
+template<unsigned DIM>
+void VesselNetwork<DIM>::UpdateVesselNodes()
+{
+    RefreshVessels();
+    mVesselNodes.clear();
+    mVesselNodeIndices.clear();
+    mVesselNodeReferenceCounts.clear();
+    typename std::vector<boost::shared_ptr<Vessel<DIM> > >::iterator it;
+    for(it = mVessels.begin(); it != mVessels.end(); it++)
+    {
+        (*it)->UpdateNodes();
+        AddNodeReference((*it)->GetStartNode(), mVesselNodes, mVesselNodeIndices, mVesselNodeReferenceCounts);
+        AddNodeReference((*it)->GetEndNode(), mVesselNodes, mVesselNodeIndices, mVesselNodeReferenceCounts);
+    }
     mVesselNodesUpToDate = true;
 }
 
 template<unsigned DIM>
 void VesselNetwork<DIM>::UpdateVesselIds()
 {
+    RefreshVessels();
     for(unsigned idx=0;idx<mVessels.size();idx++)
     {
         mVessels[idx]->SetId(idx);
     }
 }
 
-template<unsigned DIM>
-bool VesselNetwork<DIM>::VesselCrossesLineSegment(const DimensionalChastePoint<DIM>& coordinate_1,
-                                                  const DimensionalChastePoint<DIM>& coordinate_2,
-                                                  double tolerance)
+template <unsigned DIM>
+bool VesselNetwork<DIM>::IsLineSegmentCrossed(const DimensionalChastePoint<DIM>& rCoord1,
+                                              const DimensionalChastePoint<DIM>& rCoord2,
+                                              double tolerance)
 {
-    boost::shared_ptr<VesselSegment<DIM> > temp_segment = VesselSegment<DIM>::Create(VesselNode<DIM>::Create(coordinate_1), VesselNode<DIM>::Create(coordinate_2));
-    std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> > nearest_segment = GetNearestSegment(temp_segment);
+    units::quantity<unit::length> search_distance = (tolerance + 1.e-6) * mpSpatialIndex->GetMaximumNodeLengthScale();
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > candidates = mpSpatialIndex->GetSegmentsNearLineSegment(rCoord1, rCoord2, search_distance);
+    for(unsigned idx=0; idx<candidates.size(); idx++)
+    {
+        // Work in the length scale of the segment's first node
+        const DimensionalChastePoint<DIM>& r_start = candidates[idx]->GetNode(0)->rGetLocation();
+        const DimensionalChastePoint<DIM>& r_end = candidates[idx]->GetNode(1)->rGetLocation();
+        c_vector<double, DIM> end_location = r_end.rGetLocation()*r_start.GetScalingFactor(r_end);
+        c_vector<double, DIM> coord1_location = rCoord1.rGetLocation()*r_start.GetScalingFactor(rCoord1);
+        c_vector<double, DIM> coord2_location = rCoord2.rGetLocation()*r_start.GetScalingFactor(rCoord2);
+
+        double segment_distance = VesselNetworkSpatialIndex<DIM>::GetSegmentToSegmentDistance(r_start.rGetLocation(), end_location,
+                                                                                              coord1_location, coord2_location);
+        if(segment_distance > tolerance)
+        {
+            continue;
+        }
 
-    // todo a false here does not necessarily guarantee that a vessel does not cross a line segment since get nearest
-    // segment only returns one segment
-    double nearest_seg_dist = nearest_segment.second / nearest_segment.first->GetNode(0)->GetReferenceLengthScale();
-    double coord1_distance = nearest_segment.first->GetDistance(coordinate_1) / nearest_segment.first->GetNode(0)->GetReferenceLengthScale();
-    double coord2_distance = nearest_segment.first->GetDistance(coordinate_2) / nearest_segment.first->GetNode(0)->GetReferenceLengthScale();
+        units::quantity<unit::length> reference_length = r_start.GetReferenceLengthScale();
+        double coord1_distance = candidates[idx]->GetDistance(rCoord1) / reference_length;
+        double coord2_distance = candidates[idx]->GetDistance(rCoord2) / reference_length;
+        if((coord1_distance > tolerance) && (coord2_distance > tolerance))
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-    bool crosses_segment = (nearest_seg_dist<= tolerance) && (coord1_distance > tolerance) && (coord2_distance > tolerance);
-    return  crosses_segment;
+template <unsigned DIM>
+bool VesselNetwork<DIM>::VesselCrossesLineSegment(const DimensionalChastePoint<DIM>& rCoord1,
+                                                  const DimensionalChastePoint<DIM>& rCoord2,
+                                                  double tolerance)
+{
+    UpdateSpatialIndex();
+    return IsLineSegmentCrossed(rCoord1, rCoord2, tolerance);
+}
+
+template <unsigned DIM>
+std::vector<bool> VesselNetwork<DIM>::VesselsCrossLineSegments(const std::vector<std::pair<DimensionalChastePoint<DIM>, DimensionalChastePoint<DIM> > >& rLineSegments,
+                                                               double tolerance)
+{
+    UpdateSpatialIndex();
+    std::vector<bool> crosses(rLineSegments.size(), false);
+    for(unsigned idx=0; idx<rLineSegments.size(); idx++)
+    {
+        crosses[idx] = IsLineSegmentCrossed(rLineSegments[idx].first, rLineSegments[idx].second, tolerance);
+    }
+    return crosses;
 }
 
 template<unsigned DIM>
@@ -36,15 +36,29 @@ Copyright (c) 2005-2016, University of Oxford.
 #ifndef VESSELNETWORK_HPP_
 #define VESSELNETWORK_HPP_
 
+#include <math.h>
 #include <vector>
 #include <set>
 #include <map>
+#include <boost/unordered_map.hpp>
 #include "Vessel.hpp"
 #include "VesselSegment.hpp"
 #include "VesselNode.hpp"
 #include "UblasIncludes.hpp"
 #include "UnitCollection.hpp"
 #include "AbstractVesselNetworkComponent.hpp"
+#include "VesselNetworkSpatialIndex.hpp"
+
+/**
+ * Struct to denote the orderings available when renumbering a network
+ */
+struct NetworkOrdering
+{
+    enum Value
+    {
+        REVERSE_CUTHILL_MCKEE, MORTON
+    };
+};
 
 /**
  * A vessel network is a collection of vessels.
@@ -61,7 +75,9 @@ private:
     std::vector<boost::shared_ptr<Vessel<DIM> > > mVessels;
 
     /**
-     * Container for vessel segments in the VesselNetwork.
+     * Container for vessel segments in the VesselNetwork. Adding, extending, dividing and removing vessels
+     * through the network patches this collection in place, with new segments appended and removed ones leaving
+     * a gap until the collection is next read. It is only in vessel order after a full update.
      */
     std::vector<boost::shared_ptr<VesselSegment<DIM> > > mSegments;
 
@@ -71,7 +87,7 @@ private:
     bool mSegmentsUpToDate;
 
     /**
-     * Container for nodes in the VesselNetwork.
+     * Container for nodes in the VesselNetwork, patched in the same way as mSegments.
      */
     std::vector<boost::shared_ptr<VesselNode<DIM> > > mNodes;
 
@@ -81,7 +97,7 @@ private:
     bool mNodesUpToDate;
 
     /**
-     * Container for vessel nodes in the VesselNetwork.
+     * Container for vessel nodes in the VesselNetwork, patched in the same way as mSegments.
      */
     std::vector<boost::shared_ptr<VesselNode<DIM> > > mVesselNodes;
 
@@ -90,6 +106,244 @@ private:
      */
     bool mVesselNodesUpToDate;
 
+    /**
+     * The position of each vessel in mVessels.
+     */
+    boost::unordered_map<Vessel<DIM>*, unsigned> mVesselIndices;
+
+    /**
+     * Is the data in mVesselIndices up to date.
+     */
+    bool mVesselIndicesUpToDate;
+
+    /**
+     * The position of each segment in mSegments, updated along with mSegments.
+     */
+    boost::unordered_map<VesselSegment<DIM>*, unsigned> mSegmentIndices;
+
+    /**
+     * The position of each node in mNodes, updated along with mNodes.
+     */
+    boost::unordered_map<VesselNode<DIM>*, unsigned> mNodeIndices;
+
+    /**
+     * The number of times each node appears in the network vessels, updated along with mNodes.
+     */
+    boost::unordered_map<VesselNode<DIM>*, unsigned> mNodeReferenceCounts;
+
+    /**
+     * The position of each vessel node in mVesselNodes, updated along with mVesselNodes.
+     */
+    boost::unordered_map<VesselNode<DIM>*, unsigned> mVesselNodeIndices;
+
+    /**
+     * The number of vessel ends at each vessel node, updated along with mVesselNodes.
+     */
+    boost::unordered_map<VesselNode<DIM>*, unsigned> mVesselNodeReferenceCounts;
+
+    /**
+     * Spatial index used for nearest node and nearest segment queries.
+     */
+    boost::shared_ptr<VesselNetworkSpatialIndex<DIM> > mpSpatialIndex;
+
+    /**
+     * Is the spatial index up to date.
+     */
+    bool mSpatialIndexUpToDate;
+
+    /**
+     * The number of batches of changes currently open on the network, see BeginBatch.
+     */
+    unsigned mBatchDepth;
+
+    /**
+     * Whether coincident nodes should be merged when the open batch is committed.
+     */
+    bool mMergeOnCommit;
+
+    /**
+     * Counter incremented whenever vessels are added, removed, divided, extended or merged through the network,
+     * nodes are merged, or a full update finds that the segments or nodes have been changed directly. Used by
+     * snapshots of the network to tell when their connectivity is stale.
+     */
+    unsigned mTopologyVersion;
+
+    /**
+     * Counter incremented whenever the network is fully updated or translated, after which node locations and
+     * vessel data may have changed even though the topology has not.
+     */
+    unsigned mGeometryVersion;
+
+    /**
+     * The positions in the node collection of the two nodes of each segment, as of the last full update. Used
+     * to tell whether segments have been reconnected directly between full updates.
+     */
+    std::vector<unsigned> mSegmentNodeIndices;
+
+    /**
+     * The topology version at the last full update. Direct changes are only looked for if no change has been
+     * made through the network since, as the topology version has already moved on otherwise.
+     */
+    unsigned mSegmentNodeIndicesVersion;
+
+    /**
+     * The latest segment node stamp when the caches were last checked for reconnected segments.
+     */
+    unsigned mReconnectedSegmentsVersion;
+
+    /**
+     * Return the node which comes first in the network node collection, used to resolve ties in
+     * nearest node queries consistently.
+     * @param rNodes the candidate nodes
+     * @return the first of the candidate nodes, or an empty pointer if there are none
+     */
+    boost::shared_ptr<VesselNode<DIM> > GetFirstNode(const std::vector<boost::shared_ptr<VesselNode<DIM> > >& rNodes);
+
+    /**
+     * Return the segment which comes first in the network segment collection, used to resolve ties in
+     * nearest segment queries consistently.
+     * @param rSegments the candidate segments
+     * @return the first of the candidate segments, or an empty pointer if there are none
+     */
+    boost::shared_ptr<VesselSegment<DIM> > GetFirstSegment(const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& rSegments);
+
+    /**
+     * Add a component to the end of a cached collection, if it is not already in it
+     * @param rpComponent the component
+     * @param rCache the cached collection
+     * @param rIndices the positions of components in the collection
+     */
+    template<class COMPONENT>
+    static void AddToCache(const boost::shared_ptr<COMPONENT>& rpComponent, std::vector<boost::shared_ptr<COMPONENT> >& rCache,
+                           boost::unordered_map<COMPONENT*, unsigned>& rIndices);
+
+    /**
+     * Remove a component from a cached collection, leaving a gap unless it is at the end
+     * @param pComponent the component
+     * @param rCache the cached collection
+     * @param rIndices the positions of components in the collection
+     */
+    template<class COMPONENT>
+    static void RemoveFromCache(COMPONENT* pComponent, std::vector<boost::shared_ptr<COMPONENT> >& rCache,
+                                boost::unordered_map<COMPONENT*, unsigned>& rIndices);
+
+    /**
+     * Close any gaps in a cached collection left by removed components, keeping the order of the others
+     * @param rCache the cached collection
+     * @param rIndices the positions of components in the collection
+     */
+    template<class COMPONENT>
+    static void RemoveGaps(std::vector<boost::shared_ptr<COMPONENT> >& rCache, boost::unordered_map<COMPONENT*, unsigned>& rIndices);
+
+    /**
+     * Count a reference to a node in a cached node collection, adding the node on its first reference
+     * @param rpNode the node
+     * @param rCache the cached collection
+     * @param rIndices the positions of nodes in the collection
+     * @param rCounts the number of references to each node
+     */
+    static void AddNodeReference(const boost::shared_ptr<VesselNode<DIM> >& rpNode, std::vector<boost::shared_ptr<VesselNode<DIM> > >& rCache,
+                                 boost::unordered_map<VesselNode<DIM>*, unsigned>& rIndices,
+                                 boost::unordered_map<VesselNode<DIM>*, unsigned>& rCounts);
+
+    /**
+     * Release a reference to a node in a cached node collection, removing the node when none remain
+     * @param rpNode the node
+     * @param rCache the cached collection
+     * @param rIndices the positions of nodes in the collection
+     * @param rCounts the number of references to each node
+     */
+    static void RemoveNodeReference(const boost::shared_ptr<VesselNode<DIM> >& rpNode, std::vector<boost::shared_ptr<VesselNode<DIM> > >& rCache,
+                                    boost::unordered_map<VesselNode<DIM>*, unsigned>& rIndices,
+                                    boost::unordered_map<VesselNode<DIM>*, unsigned>& rCounts);
+
+    /**
+     * Add a vessel's segments and nodes to the cached collections and the spatial index, where these are up to date
+     * @param pVessel the vessel
+     */
+    void AddVesselToCaches(boost::shared_ptr<Vessel<DIM> > pVessel);
+
+    /**
+     * Remove a vessel from the vessel list, leaving a gap so that the other vessels keep their order. The gaps
+     * are closed by RefreshVessels. Needs the vessel indices to be up to date.
+     * @param index the position of the vessel in the list
+     */
+    void RemoveFromVesselList(unsigned index);
+
+    /**
+     * Remove segments and release a vessel's nodes from the cached collections and the spatial index, where these are up to date
+     * @param rSegments the segments leaving the network
+     * @param rNodes the nodes of the vessel leaving the network, from its start to its end
+     */
+    void RemoveFromCaches(const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& rSegments,
+                          const std::vector<boost::shared_ptr<VesselNode<DIM> > >& rNodes);
+
+    /**
+     * Close any gaps left in mVessels by removed vessels, keeping the order of the others
+     */
+    void RefreshVessels();
+
+    /**
+     * Rebuild mNodes if it is out of date, otherwise close any gaps left by removed nodes
+     */
+    void RefreshNodes();
+
+    /**
+     * Rebuild mSegments if it is out of date, otherwise close any gaps left by removed segments
+     */
+    void RefreshSegments();
+
+    /**
+     * Rebuild mVesselNodes if it is out of date, otherwise close any gaps left by removed nodes
+     */
+    void RefreshVesselNodes();
+
+    /**
+     * Bring the caches up to date with segments which have had a node replaced directly since they were last
+     * checked, found from the segment node stamps. The spatial index re-indexes only those segments, the node
+     * collections are rebuilt on next use as the nodes the segments were detached from are not known here.
+     */
+    void UpdateReconnectedSegments();
+
+    /**
+     * Rebuild the spatial index if it is out of date
+     */
+    void UpdateSpatialIndex();
+
+    /**
+     * Returns whether a vessel crosses a line segment, assuming the spatial index is up to date
+     * @param rCoord1 the start of the line segment
+     * @param rCoord2 the end of the line segment
+     * @param tolerance how close to crossing is considered crossing
+     * @return whether a vessel crosses the line segment
+     */
+    bool IsLineSegmentCrossed(const DimensionalChastePoint<DIM>& rCoord1, const DimensionalChastePoint<DIM>& rCoord2, double tolerance);
+
+    /**
+     * Return the representative node of the group of merged nodes containing a node, compressing the path to it
+     * @param rParents the parent of each node which has been merged into another
+     * @param pNode the node
+     * @return the representative node
+     */
+    static boost::shared_ptr<VesselNode<DIM> > FindMergedNode(boost::unordered_map<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM> > >& rParents,
+                                                              boost::shared_ptr<VesselNode<DIM> > pNode);
+
+    /**
+     * Return the vessel which continues a vessel through one of its end nodes, if the node joins exactly two
+     * vessels and the turn between their segments there is within the tolerance
+     * @param pVessel the vessel
+     * @param pNode the end node of the vessel to continue through
+     * @param maxAngle the largest turn, in radians, between the two vessels' segments at the node
+     * @return the continuing vessel, or an empty pointer if there is none
+     */
+    boost::shared_ptr<Vessel<DIM> > GetContinuingVessel(boost::shared_ptr<Vessel<DIM> > pVessel, boost::shared_ptr<VesselNode<DIM> > pNode,
+                                                        double maxAngle);
+
+    /**
+     * Rebuild the vessel index map if it is out of date
+     */
+    void UpdateVesselIndices();
+
 public:
 
     /**
@@ -102,6 +356,15 @@ public:
      */
     static boost::shared_ptr<VesselNetwork<DIM> > Create();
 
+    /**
+     * Construct a copy of an existing network and return a shared pointer to it. Nodes, segments and vessels
+     * are copied along with their radii and flow properties. Nodes shared between segments in the existing
+     * network are shared in the copy, so no merging of coincident nodes is needed.
+     * @param pExistingNetwork the network to copy
+     * @return a shared pointer to the copy
+     */
+    static boost::shared_ptr<VesselNetwork<DIM> > Create(boost::shared_ptr<VesselNetwork<DIM> > pExistingNetwork);
+
     /**
      * Destructor
      */
@@ -112,6 +375,38 @@ public:
      */
     void AddVessel(boost::shared_ptr<Vessel<DIM> > pVessel);
 
+    /**
+     * Start a batch of changes to the network. Until the batch is committed, sprouting, extending, dividing and
+     * removing vessels patch the cached collections and spatial index with only the segments and nodes they touch,
+     * and calls to UpdateAll only pick up segments reconnected directly, so that the collections are restored to
+     * vessel order, ids renumbered and nodes merged once at the end. Batches can be nested, only committing the
+     * outermost one updates the network.
+     */
+    void BeginBatch();
+
+    /**
+     * Commit a batch of changes started with BeginBatch.
+     * @param merge whether to merge co-incident nodes when the outermost batch is committed
+     */
+    void CommitBatch(bool merge=false);
+
+    /**
+     * @return whether a batch of changes is open on the network
+     */
+    bool IsInBatch();
+
+    /**
+     * @return a counter which changes whenever the vessels or their connectivity are changed through the network,
+     * or a full update finds the segments or nodes have been changed directly
+     */
+    unsigned GetTopologyVersion();
+
+    /**
+     * @return a counter which changes whenever the network is fully updated or translated, so node locations or
+     * vessel data may have changed without a change in topology
+     */
+    unsigned GetGeometryVersion();
+
     /**
      * Adds a collection of vessels to the VesselNetwork
      */
@@ -133,7 +428,8 @@ public:
     std::vector<boost::shared_ptr<Vessel<DIM> > > CopyVessels(std::vector<boost::shared_ptr<Vessel<DIM> > > vessels);
 
     /**
-     * Divides a vessel into two at the specified location.
+     * Divides a vessel into two at the specified location. The last vessel in the network takes the divided
+     * vessel's position and the two new vessels are added at the end.
      */
     boost::shared_ptr<VesselNode<DIM> > DivideVessel(boost::shared_ptr<Vessel<DIM> > pVessel,
                                                      const DimensionalChastePoint<DIM>& location);
@@ -167,6 +463,13 @@ public:
      */
     boost::shared_ptr<VesselNode<DIM> > GetNearestNode(boost::shared_ptr<VesselNode<DIM> > pInputNode);
 
+    /**
+     * Get the nodes nearest to each of the specified locations
+     * @param rLocations the locations
+     * @return the nearest node to each location
+     */
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > GetNearestNodes(const std::vector<DimensionalChastePoint<DIM> >& rLocations);
+
     /**
      * Get the segment nearest to the specified segment and the distance to it
      */
@@ -182,13 +485,22 @@ public:
      */
     std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> > GetNearestSegment(const DimensionalChastePoint<DIM>& location);
 
+    /**
+     * Get the segments nearest to each of the specified locations and the distances to them
+     * @param rLocations the locations
+     * @return the nearest segment to each location and the distance to it
+     */
+    std::vector<std::pair<boost::shared_ptr<VesselSegment<DIM> >, units::quantity<unit::length> > > GetNearestSegments(const std::vector<DimensionalChastePoint<DIM> >& rLocations);
+
     /**
      * Get the segment nearest to the specified location
      */
     boost::shared_ptr<Vessel<DIM> > GetNearestVessel(const DimensionalChastePoint<DIM>& location);
 
     /**
-     * Get index of nearest node
+     * Get the index of a node in the network node collection
+     * @param node the node
+     * @return the index of the node, as used in GetNode and GetNodes
      */
     unsigned GetNodeIndex(boost::shared_ptr<VesselNode<DIM> > node);
 
@@ -213,6 +525,14 @@ public:
      */
     std::vector<boost::shared_ptr<VesselNode<DIM> > > GetNodes();
 
+    /**
+     * Return a reference to the network node vector, avoids a copy. The reference is only valid until the
+     * network is next changed.
+     *
+     * @return a reference to the network node vector
+     */
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& rGetNodes();
+
     /**
      * Return the number of nodes in the network.
      */
@@ -244,6 +564,21 @@ public:
      */
     std::vector<boost::shared_ptr<VesselNode<DIM> > > GetVesselEndNodes();
 
+    /**
+     * Return a reference to the vessel end node vector, avoids a copy. The reference is only valid until the
+     * network is next changed.
+     *
+     * @return a reference to the vessel end node vector
+     */
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& rGetVesselEndNodes();
+
+    /**
+     * Return the index of a node in the vessel end node collection
+     * @param pNode the node
+     * @return the index of the node, as used in GetVesselEndNodes
+     */
+    unsigned GetVesselEndNodeIndex(boost::shared_ptr<VesselNode<DIM> > pNode);
+
     /**
      * Return the Index of the specified vessel
      */
@@ -254,11 +589,26 @@ public:
      */
     unsigned GetVesselSegmentIndex(boost::shared_ptr<VesselSegment<DIM> > pVesselSegment);
 
+    /**
+     * Return the indexed vessel segment
+     * @param index the index of the segment, as used in GetVesselSegments
+     * @return the segment
+     */
+    boost::shared_ptr<VesselSegment<DIM> > GetVesselSegment(unsigned index);
+
     /**
      * Return the vessel segments in the network
      */
     std::vector<boost::shared_ptr<VesselSegment<DIM> > > GetVesselSegments();
 
+    /**
+     * Return a reference to the network segment vector, avoids a copy. The reference is only valid until the
+     * network is next changed.
+     *
+     * @return a reference to the network segment vector
+     */
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& rGetVesselSegments();
+
     /**
      * Return the indexed vessel
      */
@@ -269,6 +619,14 @@ public:
      */
     std::vector<boost::shared_ptr<Vessel<DIM> > > GetVessels();
 
+    /**
+     * Return a reference to the network vessel vector, avoids a copy. The reference is only valid until the
+     * network is next changed.
+     *
+     * @return a reference to the network vessel vector
+     */
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& rGetVessels();
+
     /**
      * Return whether node is in network.
      * @param pSourceNode the node
@@ -277,11 +635,28 @@ public:
     bool NodeIsInNetwork(boost::shared_ptr<VesselNode<DIM> > pSourceNode);
 
     /**
-     * Merge short vessels in the network
+     * Merge short vessels in the network. Each vessel shorter than the cutoff is contracted, shortest first, by
+     * replacing its end node with its start node in the rest of the network. Chains and clusters of short
+     * vessels collapse onto a single node.
      * @param cutoff how short is short
      */
     void MergeShortVessels(units::quantity<unit::length> cutoff = 10.0 * 1.e-6 * unit::metres);
 
+    /**
+     * Join vessels which meet end to end at nodes attached to no other vessel into single vessels. Useful for
+     * tidying up networks read from file, where every segment is often a vessel of its own.
+     * @param maxAngle the largest turn, in radians, between two vessels' segments at the node for them to be joined
+     */
+    void MergeVesselsAtDegreeTwoNodes(double maxAngle = M_PI);
+
+    /**
+     * Simplify the network, merging vessels shorter than the cutoff and then joining vessels which meet end to
+     * end with a turn no larger than the maximum angle.
+     * @param cutoff how short is short
+     * @param maxAngle the largest turn, in radians, at a node joining two vessels for them to be joined
+     */
+    void Simplify(units::quantity<unit::length> cutoff = 10.0 * 1.e-6 * unit::metres, double maxAngle = M_PI);
+
     /**
      * Merge nodes with the same spatial location. Useful for
      * tidying up networks read from file.
@@ -306,12 +681,34 @@ public:
     void MergeCoincidentNodes(std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes, double tolerance = 0.0);
 
     /**
-     * Removes a vessel from the network
+     * Renumber the vessels and vessel end nodes to improve memory locality. Reverse Cuthill-McKee ordering
+     * of the vessel end node graph reduces the bandwidth of the flow and haematocrit systems, Morton ordering
+     * of the end node locations keeps spatially close nodes close in memory. Vessels are then ordered by
+     * their lowest numbered end node and the segment and node collections follow the vessel order. Vessel ids
+     * are reset to the new vessel indices.
+     *
+     * The end node order holds until the network caches are next fully rebuilt, after which it is recovered
+     * approximately from the vessel order.
+     *
+     * @param ordering the ordering to use
+     */
+    void Reorder(NetworkOrdering::Value ordering = NetworkOrdering::REVERSE_CUTHILL_MCKEE);
+
+    /**
+     * Removes a vessel from the network. The last vessel in the network takes the removed vessel's position.
      * @param pVessel the vessel to remove
      * @param deleteVessel also remove the vessel from its child segments and nodes if true.
      */
     void RemoveVessel(boost::shared_ptr<Vessel<DIM> > pVessel, bool deleteVessel = false);
 
+    /**
+     * Removes a set of vessels from the network in a single pass over the vessel collection. Cheaper than
+     * repeated calls to RemoveVessel when many vessels are removed at once.
+     * @param rVessels the vessels to remove
+     * @param deleteVessels also remove the vessels from their child segments and nodes if true.
+     */
+    void RemoveVessels(const std::set<boost::shared_ptr<Vessel<DIM> > >& rVessels, bool deleteVessels = false);
+
     /**
      * Remove short vessels from the network
      * @param cutoff the minumum vessel length
@@ -330,6 +727,13 @@ public:
      */
     void SetNodeRadiiFromSegments();
 
+    /**
+     * Set the width of the grid cells used by the spatial index for nearest node and segment queries. By default
+     * the mean segment length is used.
+     * @param width the cell width, zero restores the default
+     */
+    void SetSpatialIndexCellWidth(units::quantity<unit::length> width);
+
     /**
      * Set the properties of the segments in the network based on those of the prototype
      * @param prototype a prototype segment from which to copy properties
@@ -382,20 +786,39 @@ public:
     void UpdateVesselIds();
 
     /**
-     * Update all dynamic storage in the vessel network, optionally merge coincident nodes
+     * Update all dynamic storage in the vessel network, optionally merge coincident nodes. This should be called
+     * after segments are changed other than through the network, so that the spatial index used in nearest node
+     * and segment queries is rebuilt. Moved nodes and segments with replaced nodes are also picked up without a
+     * full update, from their stamps. It also restores the node and segment collections to
+     * vessel order, which changes made through the network do not maintain. The topology version only changes
+     * if the rebuilt collections differ from the old ones or nodes are merged, otherwise only the geometry
+     * version changes. Inside a batch only directly reconnected segments are picked up, the rest of the update is
+     * deferred until the batch is committed.
      * @param merge whether to merge co-incident nodes
      */
     void UpdateAll(bool merge=false);
 
     /**
-     * Returns whether a vessel crosses a line segment.
+     * Returns whether a vessel crosses a line segment. Only segments near the line segment in the spatial
+     * index are tested. A segment crosses if it comes within the tolerance of the line segment without
+     * either end of the line segment lying on it.
      * @param rCoord1 the start of the line segment
      * @param rCoord2 the end of the line segment
-     * @param tolerance how close to crossing is considered crossing
-     * @return
+     * @param tolerance how close to crossing is considered crossing, in the segment node length scale
+     * @return whether a vessel crosses the line segment
      */
     bool VesselCrossesLineSegment(const DimensionalChastePoint<DIM>& rCoord1, const DimensionalChastePoint<DIM>& rCoord2, double tolerance = 1e-6);
 
+    /**
+     * Returns whether a vessel crosses each of a collection of line segments, for example all of the candidate
+     * tip moves in an angiogenesis step. The spatial index is brought up to date once for the whole collection.
+     * @param rLineSegments the start and end of each line segment
+     * @param tolerance how close to crossing is considered crossing, in the segment node length scale
+     * @return whether a vessel crosses each line segment
+     */
+    std::vector<bool> VesselsCrossLineSegments(const std::vector<std::pair<DimensionalChastePoint<DIM>, DimensionalChastePoint<DIM> > >& rLineSegments,
+                                               double tolerance = 1e-6);
+
     /**
      * Write the network to file
      * @param rFileName the filename
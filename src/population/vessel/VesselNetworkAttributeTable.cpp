@@ -0,0 +1,337 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#include <cmath>
+#include <boost/unordered_map.hpp>
+#include "Exception.hpp"
+#include "UnitCollection.hpp"
+#include "VesselNetworkAttributeTable.hpp"
+
+template<unsigned DIM>
+VesselNetworkAttributeTable<DIM>::VesselNetworkAttributeTable() :
+    mpNetwork(),
+    mTopologyVersion(0),
+    mIsBuilt(false),
+    mNodes(),
+    mSegments(),
+    mVessels(),
+    mNodeAttributeNames(),
+    mNodeAttributes(),
+    mSegmentAttributeNames(),
+    mSegmentAttributes(),
+    mVesselAttributeNames(),
+    mVesselAttributes()
+{
+    // The built in columns, filled in this order in Update. The names match the component output data.
+    AddNodeAttribute("Node Id");
+    AddNodeAttribute("Node Radius m");
+    AddNodeAttribute("Node Is Migrating");
+    AddNodeAttribute("Node Pressure Pa");
+    AddNodeAttribute("Node Is Input");
+    AddNodeAttribute("Node Is Output");
+
+    AddSegmentAttribute("Segment Id");
+    AddSegmentAttribute("Segment Radius m: ");
+    AddSegmentAttribute("Segment Haematocrit");
+    AddSegmentAttribute("Segment Flow Rate m^3/s");
+    AddSegmentAttribute("Segment Impedance kg/m^4/s");
+    AddSegmentAttribute("Segment Viscosity Pa.s");
+    AddSegmentAttribute("Segment Wall Shear Stress Pa");
+    AddSegmentAttribute("Segment Growth Stimulus s^-1");
+
+    AddVesselAttribute("Vessel Id");
+    AddVesselAttribute("Vessel Radius m");
+    AddVesselAttribute("Vessel Impedance kg/m^4/s");
+    AddVesselAttribute("Vessel Haematocrit");
+    AddVesselAttribute("Vessel Flow Rate m^3/s");
+    AddVesselAttribute("Absolute Vessel Flow Rate m^3/s");
+    AddVesselAttribute("Vessel Viscosity Pa.s");
+    AddVesselAttribute("Vessel Wall Shear Stress Pa");
+    AddVesselAttribute("Vessel Growth Stimulus s^-1");
+    AddVesselAttribute("Vessel Time Until Regression s");
+}
+
+template<unsigned DIM>
+VesselNetworkAttributeTable<DIM>::~VesselNetworkAttributeTable()
+{
+
+}
+
+template<unsigned DIM>
+boost::shared_ptr<VesselNetworkAttributeTable<DIM> > VesselNetworkAttributeTable<DIM>::Create()
+{
+    MAKE_PTR(VesselNetworkAttributeTable<DIM>, pSelf);
+    return pSelf;
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkAttributeTable<DIM>::AddColumn(std::vector<std::string>& rNames,
+                                                     std::vector<std::vector<double> >& rColumns,
+                                                     const std::string& rName, unsigned size)
+{
+    for(unsigned idx=0; idx<rNames.size(); idx++)
+    {
+        if(rNames[idx] == rName)
+        {
+            return idx;
+        }
+    }
+    rNames.push_back(rName);
+    rColumns.push_back(std::vector<double>(size, 0.0));
+    return rNames.size() - 1;
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkAttributeTable<DIM>::FindColumn(const std::vector<std::string>& rNames, const std::string& rName) const
+{
+    for(unsigned idx=0; idx<rNames.size(); idx++)
+    {
+        if(rNames[idx] == rName)
+        {
+            return idx;
+        }
+    }
+    EXCEPTION("Requested attribute '" + rName + "' has not been added to the table.");
+}
+
+template<unsigned DIM>
+template<class COMPONENT>
+void VesselNetworkAttributeTable<DIM>::ReorderColumns(const std::vector<boost::shared_ptr<COMPONENT> >& rOldComponents,
+                                                      const std::vector<boost::shared_ptr<COMPONENT> >& rNewComponents,
+                                                      std::vector<std::vector<double> >& rColumns)
+{
+    boost::unordered_map<COMPONENT*, unsigned> old_indices;
+    for(unsigned idx=0; idx<rOldComponents.size(); idx++)
+    {
+        old_indices[rOldComponents[idx].get()] = idx;
+    }
+
+    // Position of each new component in the old columns, or the old size if it is new
+    std::vector<unsigned> sources(rNewComponents.size(), rOldComponents.size());
+    for(unsigned idx=0; idx<rNewComponents.size(); idx++)
+    {
+        typename boost::unordered_map<COMPONENT*, unsigned>::const_iterator it = old_indices.find(rNewComponents[idx].get());
+        if(it != old_indices.end())
+        {
+            sources[idx] = it->second;
+        }
+    }
+
+    for(unsigned idx=0; idx<rColumns.size(); idx++)
+    {
+        std::vector<double> reordered(rNewComponents.size(), 0.0);
+        if(rColumns[idx].size() == rOldComponents.size())
+        {
+            for(unsigned jdx=0; jdx<rNewComponents.size(); jdx++)
+            {
+                if(sources[jdx] < rOldComponents.size())
+                {
+                    reordered[jdx] = rColumns[idx][sources[jdx]];
+                }
+            }
+        }
+        rColumns[idx].swap(reordered);
+    }
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkAttributeTable<DIM>::AddNodeAttribute(const std::string& rName)
+{
+    return AddColumn(mNodeAttributeNames, mNodeAttributes, rName, mNodes.size());
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkAttributeTable<DIM>::AddSegmentAttribute(const std::string& rName)
+{
+    return AddColumn(mSegmentAttributeNames, mSegmentAttributes, rName, mSegments.size());
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkAttributeTable<DIM>::AddVesselAttribute(const std::string& rName)
+{
+    return AddColumn(mVesselAttributeNames, mVesselAttributes, rName, mVessels.size());
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkAttributeTable<DIM>::GetNodeAttributeIndex(const std::string& rName) const
+{
+    return FindColumn(mNodeAttributeNames, rName);
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkAttributeTable<DIM>::GetSegmentAttributeIndex(const std::string& rName) const
+{
+    return FindColumn(mSegmentAttributeNames, rName);
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkAttributeTable<DIM>::GetVesselAttributeIndex(const std::string& rName) const
+{
+    return FindColumn(mVesselAttributeNames, rName);
+}
+
+template<unsigned DIM>
+const std::vector<std::string>& VesselNetworkAttributeTable<DIM>::rGetNodeAttributeNames() const
+{
+    return mNodeAttributeNames;
+}
+
+template<unsigned DIM>
+const std::vector<std::string>& VesselNetworkAttributeTable<DIM>::rGetSegmentAttributeNames() const
+{
+    return mSegmentAttributeNames;
+}
+
+template<unsigned DIM>
+const std::vector<std::string>& VesselNetworkAttributeTable<DIM>::rGetVesselAttributeNames() const
+{
+    return mVesselAttributeNames;
+}
+
+template<unsigned DIM>
+std::vector<double>& VesselNetworkAttributeTable<DIM>::rGetNodeAttribute(unsigned index)
+{
+    if(index >= mNodeAttributes.size())
+    {
+        EXCEPTION("Requested node attribute index is out of range.");
+    }
+    return mNodeAttributes[index];
+}
+
+template<unsigned DIM>
+std::vector<double>& VesselNetworkAttributeTable<DIM>::rGetSegmentAttribute(unsigned index)
+{
+    if(index >= mSegmentAttributes.size())
+    {
+        EXCEPTION("Requested segment attribute index is out of range.");
+    }
+    return mSegmentAttributes[index];
+}
+
+template<unsigned DIM>
+std::vector<double>& VesselNetworkAttributeTable<DIM>::rGetVesselAttribute(unsigned index)
+{
+    if(index >= mVesselAttributes.size())
+    {
+        EXCEPTION("Requested vessel attribute index is out of range.");
+    }
+    return mVesselAttributes[index];
+}
+
+template<unsigned DIM>
+void VesselNetworkAttributeTable<DIM>::SetVesselNetwork(boost::shared_ptr<VesselNetwork<DIM> > pNetwork)
+{
+    if(pNetwork != mpNetwork)
+    {
+        mpNetwork = pNetwork;
+        mIsBuilt = false;
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkAttributeTable<DIM>::Update()
+{
+    if(!mpNetwork)
+    {
+        EXCEPTION("A vessel network is required before updating the attribute table.");
+    }
+
+    if(!mIsBuilt || mTopologyVersion != mpNetwork->GetTopologyVersion())
+    {
+        if(!mIsBuilt)
+        {
+            // Values belonging to a different network are dropped
+            mNodes.clear();
+            mSegments.clear();
+            mVessels.clear();
+        }
+        std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = mpNetwork->GetNodes();
+        std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = mpNetwork->GetVesselSegments();
+        std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = mpNetwork->GetVessels();
+        ReorderColumns(mNodes, nodes, mNodeAttributes);
+        ReorderColumns(mSegments, segments, mSegmentAttributes);
+        ReorderColumns(mVessels, vessels, mVesselAttributes);
+        mNodes.swap(nodes);
+        mSegments.swap(segments);
+        mVessels.swap(vessels);
+        mTopologyVersion = mpNetwork->GetTopologyVersion();
+        mIsBuilt = true;
+    }
+
+    for(unsigned idx=0; idx<mNodes.size(); idx++)
+    {
+        boost::shared_ptr<NodeFlowProperties<DIM> > p_properties = mNodes[idx]->GetFlowProperties();
+        mNodeAttributes[0][idx] = double(mNodes[idx]->GetId());
+        mNodeAttributes[1][idx] = mNodes[idx]->GetRadius() / unit::metres;
+        mNodeAttributes[2][idx] = double(mNodes[idx]->IsMigrating());
+        mNodeAttributes[3][idx] = p_properties->GetPressure() / unit::pascals;
+        mNodeAttributes[4][idx] = double(p_properties->IsInputNode());
+        mNodeAttributes[5][idx] = double(p_properties->IsOutputNode());
+    }
+
+    for(unsigned idx=0; idx<mSegments.size(); idx++)
+    {
+        boost::shared_ptr<SegmentFlowProperties<DIM> > p_properties = mSegments[idx]->GetFlowProperties();
+        mSegmentAttributes[0][idx] = double(mSegments[idx]->GetId());
+        mSegmentAttributes[1][idx] = mSegments[idx]->GetRadius() / unit::metres;
+        mSegmentAttributes[2][idx] = p_properties->GetHaematocrit();
+        mSegmentAttributes[3][idx] = p_properties->GetFlowRate() / unit::metre_cubed_per_second;
+        mSegmentAttributes[4][idx] = p_properties->GetImpedance() / unit::pascal_second_per_metre_cubed;
+        mSegmentAttributes[5][idx] = p_properties->GetViscosity() / unit::poiseuille;
+        mSegmentAttributes[6][idx] = p_properties->GetWallShearStress() / unit::pascals;
+        mSegmentAttributes[7][idx] = p_properties->GetGrowthStimulus() / unit::per_second;
+    }
+
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
+    {
+        boost::shared_ptr<VesselFlowProperties<DIM> > p_properties = mVessels[idx]->GetFlowProperties();
+        double flow_rate = p_properties->GetFlowRate() / unit::metre_cubed_per_second;
+        mVesselAttributes[0][idx] = double(mVessels[idx]->GetId());
+        mVesselAttributes[1][idx] = mVessels[idx]->GetRadius() / unit::metres;
+        mVesselAttributes[2][idx] = p_properties->GetImpedance() / unit::pascal_second_per_metre_cubed;
+        mVesselAttributes[3][idx] = p_properties->GetHaematocrit();
+        mVesselAttributes[4][idx] = flow_rate;
+        mVesselAttributes[5][idx] = fabs(flow_rate);
+        mVesselAttributes[6][idx] = p_properties->GetViscosity() / unit::poiseuille;
+        mVesselAttributes[7][idx] = p_properties->GetWallShearStress() / unit::pascals;
+        mVesselAttributes[8][idx] = p_properties->GetGrowthStimulus() / unit::per_second;
+        mVesselAttributes[9][idx] = p_properties->GetRegressionTime() / unit::seconds;
+    }
+}
+
+// Explicit instantiation
+template class VesselNetworkAttributeTable<2>;
+template class VesselNetworkAttributeTable<3>;
@@ -0,0 +1,255 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef VESSELNETWORKATTRIBUTETABLE_HPP_
+#define VESSELNETWORKATTRIBUTETABLE_HPP_
+
+#include <vector>
+#include <string>
+#include "SmartPointers.hpp"
+#include "VesselNetwork.hpp"
+#include "Vessel.hpp"
+#include "VesselSegment.hpp"
+#include "VesselNode.hpp"
+
+/**
+ * Per-attribute arrays of the node, segment and vessel data of a network, for writers and analysis.
+ *
+ * Each attribute is a column holding one value per component, indexed by the position of the component in
+ * VesselNetwork::GetNodes, GetVesselSegments or GetVessels. The first columns of each table are the data
+ * reported by the components' GetOutputData methods and are refreshed from the network on every Update.
+ * Further columns can be registered by the user and are filled in directly. When the network topology
+ * changes, user values follow their components to their new positions and new components get zero.
+ */
+template<unsigned DIM>
+class VesselNetworkAttributeTable
+{
+
+private:
+
+    /**
+     * The vessel network
+     */
+    boost::shared_ptr<VesselNetwork<DIM> > mpNetwork;
+
+    /**
+     * The network topology version the component lists were read from
+     */
+    unsigned mTopologyVersion;
+
+    /**
+     * Have the component lists been read
+     */
+    bool mIsBuilt;
+
+    /**
+     * The nodes, in network order
+     */
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > mNodes;
+
+    /**
+     * The segments, in network order
+     */
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > mSegments;
+
+    /**
+     * The vessels, in network order
+     */
+    std::vector<boost::shared_ptr<Vessel<DIM> > > mVessels;
+
+    /**
+     * The node attribute names
+     */
+    std::vector<std::string> mNodeAttributeNames;
+
+    /**
+     * The node attribute values, one column per attribute
+     */
+    std::vector<std::vector<double> > mNodeAttributes;
+
+    /**
+     * The segment attribute names
+     */
+    std::vector<std::string> mSegmentAttributeNames;
+
+    /**
+     * The segment attribute values, one column per attribute
+     */
+    std::vector<std::vector<double> > mSegmentAttributes;
+
+    /**
+     * The vessel attribute names
+     */
+    std::vector<std::string> mVesselAttributeNames;
+
+    /**
+     * The vessel attribute values, one column per attribute
+     */
+    std::vector<std::vector<double> > mVesselAttributes;
+
+    /**
+     * Add a column, or return the index of an existing one with the same name
+     * @param rNames the column names
+     * @param rColumns the columns
+     * @param rName the new column name
+     * @param size the number of values in the new column
+     * @return the column index
+     */
+    unsigned AddColumn(std::vector<std::string>& rNames, std::vector<std::vector<double> >& rColumns,
+                       const std::string& rName, unsigned size);
+
+    /**
+     * Return the index of a named column
+     * @param rNames the column names
+     * @param rName the column name
+     * @return the column index
+     */
+    unsigned FindColumn(const std::vector<std::string>& rNames, const std::string& rName) const;
+
+    /**
+     * Move the column values to the new positions of their components
+     * @param rOldComponents the components the columns are currently ordered by
+     * @param rNewComponents the new component order
+     * @param rColumns the columns
+     */
+    template<class COMPONENT>
+    void ReorderColumns(const std::vector<boost::shared_ptr<COMPONENT> >& rOldComponents,
+                        const std::vector<boost::shared_ptr<COMPONENT> >& rNewComponents,
+                        std::vector<std::vector<double> >& rColumns);
+
+public:
+
+    /**
+     * Constructor.
+     */
+    VesselNetworkAttributeTable();
+
+    /**
+     * Destructor.
+     */
+    ~VesselNetworkAttributeTable();
+
+    /**
+     * Factory constructor method
+     * @return a shared pointer to a new attribute table
+     */
+    static boost::shared_ptr<VesselNetworkAttributeTable<DIM> > Create();
+
+    /**
+     * Register a node attribute. Registering an existing name returns its index.
+     * @param rName the attribute name
+     * @return the index of the attribute column
+     */
+    unsigned AddNodeAttribute(const std::string& rName);
+
+    /**
+     * Register a segment attribute. Registering an existing name returns its index.
+     * @param rName the attribute name
+     * @return the index of the attribute column
+     */
+    unsigned AddSegmentAttribute(const std::string& rName);
+
+    /**
+     * Register a vessel attribute. Registering an existing name returns its index.
+     * @param rName the attribute name
+     * @return the index of the attribute column
+     */
+    unsigned AddVesselAttribute(const std::string& rName);
+
+    /**
+     * @param rName the attribute name
+     * @return the index of the node attribute column
+     */
+    unsigned GetNodeAttributeIndex(const std::string& rName) const;
+
+    /**
+     * @param rName the attribute name
+     * @return the index of the segment attribute column
+     */
+    unsigned GetSegmentAttributeIndex(const std::string& rName) const;
+
+    /**
+     * @param rName the attribute name
+     * @return the index of the vessel attribute column
+     */
+    unsigned GetVesselAttributeIndex(const std::string& rName) const;
+
+    /**
+     * @return the node attribute names, in column order
+     */
+    const std::vector<std::string>& rGetNodeAttributeNames() const;
+
+    /**
+     * @return the segment attribute names, in column order
+     */
+    const std::vector<std::string>& rGetSegmentAttributeNames() const;
+
+    /**
+     * @return the vessel attribute names, in column order
+     */
+    const std::vector<std::string>& rGetVesselAttributeNames() const;
+
+    /**
+     * @param index the index of the attribute column
+     * @return the node values of the attribute
+     */
+    std::vector<double>& rGetNodeAttribute(unsigned index);
+
+    /**
+     * @param index the index of the attribute column
+     * @return the segment values of the attribute
+     */
+    std::vector<double>& rGetSegmentAttribute(unsigned index);
+
+    /**
+     * @param index the index of the attribute column
+     * @return the vessel values of the attribute
+     */
+    std::vector<double>& rGetVesselAttribute(unsigned index);
+
+    /**
+     * Set the vessel network
+     * @param pNetwork the vessel network
+     */
+    void SetVesselNetwork(boost::shared_ptr<VesselNetwork<DIM> > pNetwork);
+
+    /**
+     * Refresh the built in columns from the network, moving the user columns if the topology has changed
+     */
+    void Update();
+};
+
+#endif /* VESSELNETWORKATTRIBUTETABLE_HPP_ */
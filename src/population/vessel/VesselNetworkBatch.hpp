@@ -0,0 +1,81 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef VESSELNETWORKBATCH_HPP_
+#define VESSELNETWORKBATCH_HPP_
+
+#include "SmartPointers.hpp"
+#include "VesselNetwork.hpp"
+
+/**
+ * Scoped batch of changes to a vessel network. A batch is started on construction and committed by Commit, or
+ * by the destructor if it is still open, so that the network is never left inside a batch when an exception is
+ * thrown part way through the changes.
+ */
+template<unsigned DIM>
+class VesselNetworkBatch
+{
+    /**
+     * The network, null if there is no batch open
+     */
+    boost::shared_ptr<VesselNetwork<DIM> > mpNetwork;
+
+    /**
+     * Whether to merge co-incident nodes when the batch is committed
+     */
+    bool mMerge;
+
+public:
+
+    /**
+     * Constructor. Start a batch of changes on the network.
+     * @param pNetwork the network, nothing is done if it is null
+     * @param merge whether to merge co-incident nodes when the batch is committed
+     */
+    VesselNetworkBatch(boost::shared_ptr<VesselNetwork<DIM> > pNetwork, bool merge=false);
+
+    /**
+     * Destructor. Commit the batch if it is still open, ignoring any error in updating the network as this
+     * only happens while another exception is being handled or on an early return.
+     */
+    ~VesselNetworkBatch();
+
+    /**
+     * Commit the batch, errors in updating the network are passed on.
+     */
+    void Commit();
+};
+
+#endif /* VESSELNETWORKBATCH_HPP_ */
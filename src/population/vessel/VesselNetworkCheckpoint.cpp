@@ -0,0 +1,171 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#include "Exception.hpp"
+#include "VesselNetworkCheckpoint.hpp"
+
+template<unsigned DIM>
+VesselNetworkCheckpoint<DIM>::VesselNetworkCheckpoint(boost::shared_ptr<VesselNetwork<DIM> > pNetwork) :
+    mpNetwork(pNetwork),
+    mTopologyVersion(0),
+    mNodes(),
+    mNodeLocations(),
+    mNodeRadii(),
+    mNodeIsMigrating(),
+    mNodeFlowProperties(),
+    mSegments(),
+    mSegmentRadii(),
+    mSegmentFlowProperties(),
+    mVessels(),
+    mVesselFlowProperties()
+{
+    if(!mpNetwork)
+    {
+        EXCEPTION("A vessel network is required to record a checkpoint.");
+    }
+    Record();
+}
+
+template<unsigned DIM>
+VesselNetworkCheckpoint<DIM>::~VesselNetworkCheckpoint()
+{
+
+}
+
+template<unsigned DIM>
+boost::shared_ptr<VesselNetworkCheckpoint<DIM> > VesselNetworkCheckpoint<DIM>::Create(boost::shared_ptr<VesselNetwork<DIM> > pNetwork)
+{
+    MAKE_PTR_ARGS(VesselNetworkCheckpoint<DIM>, pSelf, (pNetwork));
+    return pSelf;
+}
+
+template<unsigned DIM>
+bool VesselNetworkCheckpoint<DIM>::CanRestore() const
+{
+    return mTopologyVersion == mpNetwork->GetTopologyVersion();
+}
+
+template<unsigned DIM>
+boost::shared_ptr<VesselNetwork<DIM> > VesselNetworkCheckpoint<DIM>::GetNetwork() const
+{
+    return mpNetwork;
+}
+
+template<unsigned DIM>
+void VesselNetworkCheckpoint<DIM>::Record()
+{
+    mNodes = mpNetwork->rGetNodes();
+    mSegments = mpNetwork->rGetVesselSegments();
+    mVessels = mpNetwork->rGetVessels();
+    mTopologyVersion = mpNetwork->GetTopologyVersion();
+
+    mNodeLocations.clear();
+    mNodeRadii.clear();
+    mNodeIsMigrating.clear();
+    mNodeFlowProperties.clear();
+    mNodeLocations.reserve(mNodes.size());
+    mNodeRadii.reserve(mNodes.size());
+    mNodeIsMigrating.reserve(mNodes.size());
+    mNodeFlowProperties.reserve(mNodes.size());
+    for(unsigned idx=0; idx<mNodes.size(); idx++)
+    {
+        mNodeLocations.push_back(mNodes[idx]->rGetLocation());
+        mNodeRadii.push_back(mNodes[idx]->GetRadius());
+        mNodeIsMigrating.push_back(mNodes[idx]->IsMigrating());
+        mNodeFlowProperties.push_back(*(mNodes[idx]->GetFlowProperties()));
+    }
+
+    mSegmentRadii.clear();
+    mSegmentFlowProperties.clear();
+    mSegmentRadii.reserve(mSegments.size());
+    mSegmentFlowProperties.reserve(mSegments.size());
+    for(unsigned idx=0; idx<mSegments.size(); idx++)
+    {
+        mSegmentRadii.push_back(mSegments[idx]->GetRadius());
+        mSegmentFlowProperties.push_back(*(mSegments[idx]->GetFlowProperties()));
+    }
+
+    mVesselFlowProperties.clear();
+    mVesselFlowProperties.reserve(mVessels.size());
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
+    {
+        mVesselFlowProperties.push_back(*(mVessels[idx]->GetFlowProperties()));
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkCheckpoint<DIM>::Restore()
+{
+    if(!CanRestore())
+    {
+        EXCEPTION("The network topology has changed since the checkpoint was recorded.");
+    }
+
+    bool nodes_moved = false;
+    for(unsigned idx=0; idx<mNodes.size(); idx++)
+    {
+        if(!mNodes[idx]->rGetLocation().IsCoincident(mNodeLocations[idx]))
+        {
+            mNodes[idx]->SetLocation(mNodeLocations[idx]);
+            nodes_moved = true;
+        }
+        mNodes[idx]->SetRadius(mNodeRadii[idx]);
+        mNodes[idx]->SetIsMigrating(mNodeIsMigrating[idx]);
+        mNodes[idx]->SetFlowProperties(mNodeFlowProperties[idx]);
+    }
+
+    for(unsigned idx=0; idx<mSegments.size(); idx++)
+    {
+        mSegments[idx]->SetRadius(mSegmentRadii[idx]);
+        mSegments[idx]->SetFlowProperties(mSegmentFlowProperties[idx]);
+    }
+
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
+    {
+        mVessels[idx]->SetFlowProperties(mVesselFlowProperties[idx]);
+    }
+
+    // Moved nodes invalidate the network's spatial lookups. The update does not change the topology.
+    if(nodes_moved)
+    {
+        mpNetwork->UpdateAll();
+        mTopologyVersion = mpNetwork->GetTopologyVersion();
+    }
+}
+
+// Explicit instantiation
+template class VesselNetworkCheckpoint<2>;
+template class VesselNetworkCheckpoint<3>;
@@ -0,0 +1,170 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef VESSELNETWORKCHECKPOINT_HPP_
+#define VESSELNETWORKCHECKPOINT_HPP_
+
+#include <vector>
+#include "SmartPointers.hpp"
+#include "UnitCollection.hpp"
+#include "DimensionalChastePoint.hpp"
+#include "VesselNetwork.hpp"
+#include "Vessel.hpp"
+#include "VesselSegment.hpp"
+#include "VesselNode.hpp"
+#include "NodeFlowProperties.hpp"
+#include "SegmentFlowProperties.hpp"
+#include "VesselFlowProperties.hpp"
+
+/**
+ * A record of the node locations, radii and flow properties of a network, which can be written back to roll
+ * back a step that has failed, such as a structural adaptation iteration which does not converge.
+ *
+ * Only data is recorded, the components themselves are shared with the network. The checkpoint can be restored
+ * as long as the network topology has not changed since it was recorded. Use VesselNetwork::Create with an
+ * existing network to take an independent copy which survives topology changes, for example one per replicate.
+ */
+template<unsigned DIM>
+class VesselNetworkCheckpoint
+{
+
+private:
+
+    /**
+     * The vessel network
+     */
+    boost::shared_ptr<VesselNetwork<DIM> > mpNetwork;
+
+    /**
+     * The network topology version when the checkpoint was recorded
+     */
+    unsigned mTopologyVersion;
+
+    /**
+     * The nodes, in network order
+     */
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > mNodes;
+
+    /**
+     * The node locations
+     */
+    std::vector<DimensionalChastePoint<DIM> > mNodeLocations;
+
+    /**
+     * The node radii
+     */
+    std::vector<units::quantity<unit::length> > mNodeRadii;
+
+    /**
+     * Whether each node is migrating
+     */
+    std::vector<bool> mNodeIsMigrating;
+
+    /**
+     * The node flow properties
+     */
+    std::vector<NodeFlowProperties<DIM> > mNodeFlowProperties;
+
+    /**
+     * The segments, in network order
+     */
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > mSegments;
+
+    /**
+     * The segment radii
+     */
+    std::vector<units::quantity<unit::length> > mSegmentRadii;
+
+    /**
+     * The segment flow properties
+     */
+    std::vector<SegmentFlowProperties<DIM> > mSegmentFlowProperties;
+
+    /**
+     * The vessels, in network order
+     */
+    std::vector<boost::shared_ptr<Vessel<DIM> > > mVessels;
+
+    /**
+     * The vessel flow properties
+     */
+    std::vector<VesselFlowProperties<DIM> > mVesselFlowProperties;
+
+public:
+
+    /**
+     * Constructor
+     * @param pNetwork the network to record
+     */
+    VesselNetworkCheckpoint(boost::shared_ptr<VesselNetwork<DIM> > pNetwork);
+
+    /**
+     * Destructor
+     */
+    ~VesselNetworkCheckpoint();
+
+    /**
+     * Factory constructor method, records the current state of the network
+     * @param pNetwork the network to record
+     * @return a shared pointer to a new checkpoint
+     */
+    static boost::shared_ptr<VesselNetworkCheckpoint<DIM> > Create(boost::shared_ptr<VesselNetwork<DIM> > pNetwork);
+
+    /**
+     * Return whether the checkpoint can be restored, which requires the network topology to be unchanged
+     * @return whether the checkpoint can be restored
+     */
+    bool CanRestore() const;
+
+    /**
+     * Return the network
+     * @return the network
+     */
+    boost::shared_ptr<VesselNetwork<DIM> > GetNetwork() const;
+
+    /**
+     * Record the current state of the network, replacing any earlier record
+     */
+    void Record();
+
+    /**
+     * Write the recorded state back to the network. Node locations are only written, and the network caches
+     * updated, if a node has moved.
+     */
+    void Restore();
+};
+
+#endif /* VESSELNETWORKCHECKPOINT_HPP_ */
@@ -0,0 +1,371 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#include <algorithm>
+#include "Exception.hpp"
+#include "VesselSegment.hpp"
+#include "UnitCollection.hpp"
+#include "VesselNetworkSnapshot.hpp"
+
+template<unsigned DIM>
+VesselNetworkSnapshot<DIM>::VesselNetworkSnapshot() :
+    mpNetwork(),
+    mTopologyVersion(0),
+    mIsBuilt(false),
+    mVessels(),
+    mNodes(),
+    mVesselStartNodes(),
+    mVesselEndNodes(),
+    mNodeOffsets(),
+    mNodeVessels(),
+    mNodeNeighbours(),
+    mNodeComponents(),
+    mNumberOfComponents(0),
+    mRadii(),
+    mLengths(),
+    mImpedances(),
+    mFlowRates(),
+    mHaematocrits(),
+    mPressures()
+{
+
+}
+
+template<unsigned DIM>
+VesselNetworkSnapshot<DIM>::~VesselNetworkSnapshot()
+{
+
+}
+
+template<unsigned DIM>
+boost::shared_ptr<VesselNetworkSnapshot<DIM> > VesselNetworkSnapshot<DIM>::Create()
+{
+    MAKE_PTR(VesselNetworkSnapshot<DIM>, pSelf);
+    return pSelf;
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkSnapshot<DIM>::GetNumberOfNodes() const
+{
+    return mNodes.size();
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkSnapshot<DIM>::GetNumberOfVessels() const
+{
+    return mVessels.size();
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkSnapshot<DIM>::GetMaxBranchesOnNode() const
+{
+    unsigned max_branches = 0;
+    for(unsigned idx=0; idx<mNodes.size(); idx++)
+    {
+        max_branches = std::max(max_branches, mNodeOffsets[idx+1] - mNodeOffsets[idx]);
+    }
+    return max_branches;
+}
+
+template<unsigned DIM>
+const std::vector<boost::shared_ptr<Vessel<DIM> > >& VesselNetworkSnapshot<DIM>::rGetVessels() const
+{
+    return mVessels;
+}
+
+template<unsigned DIM>
+const std::vector<boost::shared_ptr<VesselNode<DIM> > >& VesselNetworkSnapshot<DIM>::rGetNodes() const
+{
+    return mNodes;
+}
+
+template<unsigned DIM>
+const std::vector<unsigned>& VesselNetworkSnapshot<DIM>::rGetVesselStartNodes() const
+{
+    return mVesselStartNodes;
+}
+
+template<unsigned DIM>
+const std::vector<unsigned>& VesselNetworkSnapshot<DIM>::rGetVesselEndNodes() const
+{
+    return mVesselEndNodes;
+}
+
+template<unsigned DIM>
+const std::vector<unsigned>& VesselNetworkSnapshot<DIM>::rGetNodeOffsets() const
+{
+    return mNodeOffsets;
+}
+
+template<unsigned DIM>
+const std::vector<unsigned>& VesselNetworkSnapshot<DIM>::rGetNodeVessels() const
+{
+    return mNodeVessels;
+}
+
+template<unsigned DIM>
+const std::vector<unsigned>& VesselNetworkSnapshot<DIM>::rGetNodeNeighbours() const
+{
+    return mNodeNeighbours;
+}
+
+template<unsigned DIM>
+const std::vector<unsigned>& VesselNetworkSnapshot<DIM>::rGetNodeComponents() const
+{
+    return mNodeComponents;
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkSnapshot<DIM>::GetNumberOfComponents() const
+{
+    return mNumberOfComponents;
+}
+
+template<unsigned DIM>
+std::vector<double>& VesselNetworkSnapshot<DIM>::rGetRadii()
+{
+    return mRadii;
+}
+
+template<unsigned DIM>
+std::vector<double>& VesselNetworkSnapshot<DIM>::rGetLengths()
+{
+    return mLengths;
+}
+
+template<unsigned DIM>
+std::vector<double>& VesselNetworkSnapshot<DIM>::rGetImpedances()
+{
+    return mImpedances;
+}
+
+template<unsigned DIM>
+std::vector<double>& VesselNetworkSnapshot<DIM>::rGetFlowRates()
+{
+    return mFlowRates;
+}
+
+template<unsigned DIM>
+std::vector<double>& VesselNetworkSnapshot<DIM>::rGetHaematocrits()
+{
+    return mHaematocrits;
+}
+
+template<unsigned DIM>
+std::vector<double>& VesselNetworkSnapshot<DIM>::rGetPressures()
+{
+    return mPressures;
+}
+
+template<unsigned DIM>
+bool VesselNetworkSnapshot<DIM>::IsUpToDate()
+{
+    return mpNetwork && mIsBuilt && mTopologyVersion == mpNetwork->GetTopologyVersion();
+}
+
+template<unsigned DIM>
+void VesselNetworkSnapshot<DIM>::SetVesselNetwork(boost::shared_ptr<VesselNetwork<DIM> > pNetwork)
+{
+    if(pNetwork != mpNetwork)
+    {
+        mpNetwork = pNetwork;
+        mIsBuilt = false;
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkSnapshot<DIM>::Update(bool rebuildConnectivity)
+{
+    if(!mpNetwork)
+    {
+        EXCEPTION("A vessel network is required before updating the snapshot.");
+    }
+
+    if(rebuildConnectivity || !IsUpToDate())
+    {
+        UpdateConnectivity();
+    }
+
+    unsigned num_vessels = mVessels.size();
+    mRadii.resize(num_vessels);
+    mLengths.resize(num_vessels);
+    mImpedances.resize(num_vessels);
+    mFlowRates.resize(num_vessels);
+    mHaematocrits.resize(num_vessels);
+    for(unsigned idx=0; idx<num_vessels; idx++)
+    {
+        boost::shared_ptr<VesselFlowProperties<DIM> > p_properties = mVessels[idx]->GetFlowProperties();
+        mRadii[idx] = mVessels[idx]->GetRadius()/unit::metres;
+        mLengths[idx] = mVessels[idx]->GetLength()/unit::metres;
+        mImpedances[idx] = p_properties->GetImpedance()/unit::pascal_second_per_metre_cubed;
+        mFlowRates[idx] = p_properties->GetFlowRate()/unit::metre_cubed_per_second;
+        mHaematocrits[idx] = p_properties->GetHaematocrit();
+    }
+
+    mPressures.resize(mNodes.size());
+    for(unsigned idx=0; idx<mNodes.size(); idx++)
+    {
+        mPressures[idx] = mNodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals;
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkSnapshot<DIM>::UpdateConnectivity()
+{
+    mVessels = mpNetwork->GetVessels();
+    mNodes = mpNetwork->GetVesselEndNodes();
+
+    unsigned num_vessels = mVessels.size();
+    mVesselStartNodes.resize(num_vessels);
+    mVesselEndNodes.resize(num_vessels);
+    for(unsigned idx=0; idx<num_vessels; idx++)
+    {
+        mVesselStartNodes[idx] = mpNetwork->GetVesselEndNodeIndex(mVessels[idx]->GetStartNode());
+        mVesselEndNodes[idx] = mpNetwork->GetVesselEndNodeIndex(mVessels[idx]->GetEndNode());
+    }
+
+    mNodeOffsets.resize(mNodes.size()+1);
+    mNodeVessels.clear();
+    mNodeNeighbours.clear();
+    mNodeVessels.reserve(2*num_vessels);
+    mNodeNeighbours.reserve(2*num_vessels);
+    for(unsigned node_index=0; node_index<mNodes.size(); node_index++)
+    {
+        mNodeOffsets[node_index] = mNodeVessels.size();
+        std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = mNodes[node_index]->GetSegments();
+        for(unsigned idx=0; idx<segments.size(); idx++)
+        {
+            unsigned vessel_index = mpNetwork->GetVesselIndex(segments[idx]->GetVessel());
+            mNodeVessels.push_back(vessel_index);
+            if(mVesselStartNodes[vessel_index] == node_index)
+            {
+                mNodeNeighbours.push_back(mVesselEndNodes[vessel_index]);
+            }
+            else
+            {
+                mNodeNeighbours.push_back(mVesselStartNodes[vessel_index]);
+            }
+        }
+    }
+    mNodeOffsets[mNodes.size()] = mNodeVessels.size();
+    UpdateComponents();
+
+    mTopologyVersion = mpNetwork->GetTopologyVersion();
+    mIsBuilt = true;
+}
+
+template<unsigned DIM>
+void VesselNetworkSnapshot<DIM>::UpdateComponents()
+{
+    // Join the end nodes of each vessel, halving the paths to the roots as they are walked
+    unsigned num_nodes = mNodes.size();
+    std::vector<unsigned> parents(num_nodes);
+    for(unsigned idx=0; idx<num_nodes; idx++)
+    {
+        parents[idx] = idx;
+    }
+    for(unsigned vessel_index=0; vessel_index<mVessels.size(); vessel_index++)
+    {
+        unsigned root1 = mVesselStartNodes[vessel_index];
+        while(parents[root1] != root1)
+        {
+            parents[root1] = parents[parents[root1]];
+            root1 = parents[root1];
+        }
+        unsigned root2 = mVesselEndNodes[vessel_index];
+        while(parents[root2] != root2)
+        {
+            parents[root2] = parents[parents[root2]];
+            root2 = parents[root2];
+        }
+        if(root1 < root2)
+        {
+            parents[root2] = root1;
+        }
+        else if(root2 < root1)
+        {
+            parents[root1] = root2;
+        }
+    }
+
+    // Nodes are only ever linked to a parent with a lower index, so a forward pass sees each parent before
+    // its children and numbers the components
+    mNodeComponents.resize(num_nodes);
+    mNumberOfComponents = 0;
+    for(unsigned idx=0; idx<num_nodes; idx++)
+    {
+        if(parents[idx] == idx)
+        {
+            mNodeComponents[idx] = mNumberOfComponents;
+            mNumberOfComponents++;
+        }
+        else
+        {
+            mNodeComponents[idx] = mNodeComponents[parents[idx]];
+        }
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkSnapshot<DIM>::WriteFlowRates()
+{
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
+    {
+        mVessels[idx]->GetFlowProperties()->SetFlowRate(mFlowRates[idx]*unit::metre_cubed_per_second);
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkSnapshot<DIM>::WriteHaematocrits()
+{
+    for(unsigned idx=0; idx<mVessels.size(); idx++)
+    {
+        mVessels[idx]->GetFlowProperties()->SetHaematocrit(mHaematocrits[idx]);
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkSnapshot<DIM>::WritePressures()
+{
+    for(unsigned idx=0; idx<mNodes.size(); idx++)
+    {
+        mNodes[idx]->GetFlowProperties()->SetPressure(mPressures[idx]*unit::pascals);
+    }
+}
+
+// Explicit instantiation
+template class VesselNetworkSnapshot<2>;
+template class VesselNetworkSnapshot<3>;
@@ -0,0 +1,309 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef VESSELNETWORKSNAPSHOT_HPP_
+#define VESSELNETWORKSNAPSHOT_HPP_
+
+#include <vector>
+#include "SmartPointers.hpp"
+#include "VesselNetwork.hpp"
+#include "Vessel.hpp"
+#include "VesselNode.hpp"
+
+/**
+ * A flat copy of the vessel level graph of a network and the vessel and node data used by the flow and
+ * haematocrit solvers, so they can work on contiguous arrays rather than walking the shared pointer graph.
+ *
+ * Nodes are the vessel end nodes of the network, in the same order as VesselNetwork::GetVesselEndNodes, and
+ * vessels are in network order. The vessels at each node are stored in compressed sparse row form: those at
+ * node i are entries rGetNodeOffsets()[i] to rGetNodeOffsets()[i+1]-1 of rGetNodeVessels(), with the node at the
+ * other end of each vessel in the same entry of rGetNodeNeighbours(). Within a node entries follow the order
+ * of the node's segments, as in VesselNetworkGraphCalculator::GetNodeVesselConnectivity.
+ *
+ * The vessel and node data are stored as plain numbers in SI units. They are read from the network on Update
+ * and are only written back when one of the Write methods is called. The connectivity is only rebuilt when the
+ * network topology version has changed since the last update.
+ */
+template<unsigned DIM>
+class VesselNetworkSnapshot
+{
+
+private:
+
+    /**
+     * The vessel network
+     */
+    boost::shared_ptr<VesselNetwork<DIM> > mpNetwork;
+
+    /**
+     * The network topology version the connectivity was built from
+     */
+    unsigned mTopologyVersion;
+
+    /**
+     * Has the connectivity been built
+     */
+    bool mIsBuilt;
+
+    /**
+     * The vessels, in network order
+     */
+    std::vector<boost::shared_ptr<Vessel<DIM> > > mVessels;
+
+    /**
+     * The vessel end nodes, in network order
+     */
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > mNodes;
+
+    /**
+     * The index of the start node of each vessel
+     */
+    std::vector<unsigned> mVesselStartNodes;
+
+    /**
+     * The index of the end node of each vessel
+     */
+    std::vector<unsigned> mVesselEndNodes;
+
+    /**
+     * The offset of the first entry for each node in mNodeVessels and mNodeNeighbours, with a final entry
+     * holding the total number of entries
+     */
+    std::vector<unsigned> mNodeOffsets;
+
+    /**
+     * The vessels at each node
+     */
+    std::vector<unsigned> mNodeVessels;
+
+    /**
+     * The node at the other end of each entry in mNodeVessels
+     */
+    std::vector<unsigned> mNodeNeighbours;
+
+    /**
+     * The connected component of each node, numbered in order of each component's first node
+     */
+    std::vector<unsigned> mNodeComponents;
+
+    /**
+     * The number of connected components
+     */
+    unsigned mNumberOfComponents;
+
+    /**
+     * Vessel radii in metres
+     */
+    std::vector<double> mRadii;
+
+    /**
+     * Vessel lengths in metres
+     */
+    std::vector<double> mLengths;
+
+    /**
+     * Vessel impedances in Pa.s/m^3
+     */
+    std::vector<double> mImpedances;
+
+    /**
+     * Vessel flow rates in m^3/s
+     */
+    std::vector<double> mFlowRates;
+
+    /**
+     * Vessel haematocrits
+     */
+    std::vector<double> mHaematocrits;
+
+    /**
+     * Node pressures in Pa
+     */
+    std::vector<double> mPressures;
+
+    /**
+     * Rebuild the connectivity from the network
+     */
+    void UpdateConnectivity();
+
+    /**
+     * Label the connected components with a single union-find pass over the vessels
+     */
+    void UpdateComponents();
+
+public:
+
+    /**
+     * Constructor.
+     */
+    VesselNetworkSnapshot();
+
+    /**
+     * Destructor.
+     */
+    ~VesselNetworkSnapshot();
+
+    /**
+     * Factory constructor method
+     * @return a shared pointer to a new snapshot
+     */
+    static boost::shared_ptr<VesselNetworkSnapshot<DIM> > Create();
+
+    /**
+     * @return the number of vessel end nodes
+     */
+    unsigned GetNumberOfNodes() const;
+
+    /**
+     * @return the number of vessels
+     */
+    unsigned GetNumberOfVessels() const;
+
+    /**
+     * @return the largest number of vessels at a node
+     */
+    unsigned GetMaxBranchesOnNode() const;
+
+    /**
+     * @return the vessels, in network order
+     */
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& rGetVessels() const;
+
+    /**
+     * @return the vessel end nodes, in network order
+     */
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& rGetNodes() const;
+
+    /**
+     * @return the index of the start node of each vessel
+     */
+    const std::vector<unsigned>& rGetVesselStartNodes() const;
+
+    /**
+     * @return the index of the end node of each vessel
+     */
+    const std::vector<unsigned>& rGetVesselEndNodes() const;
+
+    /**
+     * @return the offset of the first entry for each node in the node-vessel connectivity, with a final entry
+     * holding the total number of entries
+     */
+    const std::vector<unsigned>& rGetNodeOffsets() const;
+
+    /**
+     * @return the vessels at each node
+     */
+    const std::vector<unsigned>& rGetNodeVessels() const;
+
+    /**
+     * @return the node at the other end of each vessel in the node-vessel connectivity
+     */
+    const std::vector<unsigned>& rGetNodeNeighbours() const;
+
+    /**
+     * @return the connected component of each node
+     */
+    const std::vector<unsigned>& rGetNodeComponents() const;
+
+    /**
+     * @return the number of connected components
+     */
+    unsigned GetNumberOfComponents() const;
+
+    /**
+     * @return the vessel radii in metres
+     */
+    std::vector<double>& rGetRadii();
+
+    /**
+     * @return the vessel lengths in metres
+     */
+    std::vector<double>& rGetLengths();
+
+    /**
+     * @return the vessel impedances in Pa.s/m^3
+     */
+    std::vector<double>& rGetImpedances();
+
+    /**
+     * @return the vessel flow rates in m^3/s
+     */
+    std::vector<double>& rGetFlowRates();
+
+    /**
+     * @return the vessel haematocrits
+     */
+    std::vector<double>& rGetHaematocrits();
+
+    /**
+     * @return the node pressures in Pa
+     */
+    std::vector<double>& rGetPressures();
+
+    /**
+     * @return whether the connectivity was built from the current network topology
+     */
+    bool IsUpToDate();
+
+    /**
+     * Set the vessel network
+     * @param pNetwork the vessel network
+     */
+    void SetVesselNetwork(boost::shared_ptr<VesselNetwork<DIM> > pNetwork);
+
+    /**
+     * Rebuild the connectivity if the network topology has changed and read the vessel and node data
+     * @param rebuildConnectivity whether to rebuild the connectivity even if the topology is unchanged
+     */
+    void Update(bool rebuildConnectivity=false);
+
+    /**
+     * Write the vessel flow rates back to the network
+     */
+    void WriteFlowRates();
+
+    /**
+     * Write the vessel haematocrits back to the network
+     */
+    void WriteHaematocrits();
+
+    /**
+     * Write the node pressures back to the network
+     */
+    void WritePressures();
+};
+
+#endif /* VESSELNETWORKSNAPSHOT_HPP_ */
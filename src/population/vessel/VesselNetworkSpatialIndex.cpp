@@ -0,0 +1,1035 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+#include <boost/unordered_set.hpp>
+#include "Exception.hpp"
+#include "BaseUnits.hpp"
+#include "Vessel.hpp"
+#include "VesselNetworkSpatialIndex.hpp"
+
+template<unsigned DIM>
+VesselNetworkSpatialIndex<DIM>::VesselNetworkSpatialIndex() :
+    mNodeCells(),
+    mSegmentCells(),
+    mNodeRecords(),
+    mSegmentRecords(),
+    mReferenceLength(BaseUnits::Instance()->GetReferenceLengthScale()),
+    mCellWidth(1.0),
+    mFixedCellWidth(0.0*unit::metres),
+    mLowerOccupiedCell(zero_vector<int>(3)),
+    mUpperOccupiedCell(zero_vector<int>(3)),
+    mMaximumNodeLengthScale(0.0*unit::metres),
+    mNumberOfSegmentsAtBuild(0),
+    mLocationVersion(0),
+    mNodesVersion(0)
+{
+    Clear();
+}
+
+template<unsigned DIM>
+VesselNetworkSpatialIndex<DIM>::~VesselNetworkSpatialIndex()
+{
+
+}
+
+template <unsigned DIM>
+boost::shared_ptr<VesselNetworkSpatialIndex<DIM> > VesselNetworkSpatialIndex<DIM>::Create()
+{
+    MAKE_PTR(VesselNetworkSpatialIndex<DIM>, pSelf);
+    return pSelf;
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::Build(const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& rSegments)
+{
+    Clear();
+    mReferenceLength = BaseUnits::Instance()->GetReferenceLengthScale();
+
+    // Use the mean segment length as the cell width unless one has been set
+    if(mFixedCellWidth > 0.0*unit::metres)
+    {
+        mCellWidth = mFixedCellWidth/mReferenceLength;
+    }
+    else
+    {
+        double total_length = 0.0;
+        for(unsigned idx=0; idx<rSegments.size(); idx++)
+        {
+            total_length += rSegments[idx]->GetLength()/mReferenceLength;
+        }
+        mCellWidth = 1.0;
+        if(rSegments.size()>0 && total_length > 0.0)
+        {
+            mCellWidth = total_length/double(rSegments.size());
+        }
+    }
+
+    for(unsigned idx=0; idx<rSegments.size(); idx++)
+    {
+        InsertSegment(rSegments[idx]);
+    }
+    mNumberOfSegmentsAtBuild = mSegmentRecords.size();
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::Clear()
+{
+    mNodeCells.clear();
+    mSegmentCells.clear();
+    mNodeRecords.clear();
+    mSegmentRecords.clear();
+    for(unsigned idx=0; idx<3; idx++)
+    {
+        mLowerOccupiedCell[idx] = INT_MAX;
+        mUpperOccupiedCell[idx] = INT_MIN;
+    }
+    mMaximumNodeLengthScale = 0.0*unit::metres;
+    mNumberOfSegmentsAtBuild = 0;
+    mLocationVersion = VesselNode<DIM>::GetLatestLocationVersion();
+    mNodesVersion = VesselSegment<DIM>::GetLatestNodesVersion();
+}
+
+template<unsigned DIM>
+c_vector<double, DIM> VesselNetworkSpatialIndex<DIM>::GetScaledLocation(const DimensionalChastePoint<DIM>& rLocation) const
+{
+    double scale_factor = rLocation.GetReferenceLengthScale()/mReferenceLength;
+    return rLocation.rGetLocation()*scale_factor;
+}
+
+template<unsigned DIM>
+typename VesselNetworkSpatialIndex<DIM>::CellIndex VesselNetworkSpatialIndex<DIM>::GetCellIndex(const c_vector<double, DIM>& rScaledLocation) const
+{
+    // Clamp well inside the int range so that ring arithmetic can not overflow
+    double limit = double(1<<29);
+    CellIndex index = zero_vector<int>(3);
+    for(unsigned idx=0; idx<DIM; idx++)
+    {
+        double cell_coordinate = std::floor(rScaledLocation[idx]/mCellWidth);
+        index[idx] = int(std::max(-limit, std::min(limit, cell_coordinate)));
+    }
+    return index;
+}
+
+template<unsigned DIM>
+typename VesselNetworkSpatialIndex<DIM>::CellKey VesselNetworkSpatialIndex<DIM>::GetCellKey(const CellIndex& rIndex) const
+{
+    // Pack 21 bits per dimension. Cells which are far enough apart to alias share a bucket, which
+    // only adds candidates to a query and so does not affect results.
+    CellKey mask = (CellKey(1)<<21) - 1;
+    CellKey key = 0;
+    for(unsigned idx=0; idx<3; idx++)
+    {
+        key |= (CellKey(rIndex[idx] + (1<<20)) & mask) << (21*idx);
+    }
+    return key;
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::GetCellsInRing(const CellIndex& rLower, const CellIndex& rUpper, unsigned ring,
+                                                   std::vector<CellKey>& rKeys) const
+{
+    int offset = int(ring);
+    CellIndex lower = rLower;
+    CellIndex upper = rUpper;
+    for(unsigned idx=0; idx<DIM; idx++)
+    {
+        lower[idx] -= offset;
+        upper[idx] += offset;
+    }
+
+    CellIndex index = zero_vector<int>(3);
+    for(index[0]=lower[0]; index[0]<=upper[0]; index[0]++)
+    {
+        for(index[1]=lower[1]; index[1]<=upper[1]; index[1]++)
+        {
+            bool on_boundary = (ring == 0 || index[0] == lower[0] || index[0] == upper[0] ||
+                    index[1] == lower[1] || index[1] == upper[1]);
+            if(DIM == 2)
+            {
+                if(on_boundary)
+                {
+                    rKeys.push_back(GetCellKey(index));
+                }
+            }
+            else if(on_boundary)
+            {
+                for(index[2]=lower[2]; index[2]<=upper[2]; index[2]++)
+                {
+                    rKeys.push_back(GetCellKey(index));
+                }
+            }
+            else
+            {
+                // Inside the xy footprint only the top and bottom faces are in the ring
+                index[2] = lower[2];
+                rKeys.push_back(GetCellKey(index));
+                index[2] = upper[2];
+                rKeys.push_back(GetCellKey(index));
+            }
+        }
+    }
+}
+
+template<unsigned DIM>
+double VesselNetworkSpatialIndex<DIM>::GetNumberOfCellsInRing(const CellIndex& rLower, const CellIndex& rUpper, unsigned ring) const
+{
+    double outer = 1.0;
+    double inner = 1.0;
+    for(unsigned idx=0; idx<DIM; idx++)
+    {
+        double width = double(rUpper[idx] - rLower[idx] + 1);
+        outer *= width + 2.0*double(ring);
+        inner *= width + 2.0*double(ring) - 2.0;
+    }
+    return (ring == 0) ? outer : outer - inner;
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkSpatialIndex<DIM>::GetLastOccupiedRing(const CellIndex& rLower, const CellIndex& rUpper) const
+{
+    int last_ring = 0;
+    for(unsigned idx=0; idx<DIM; idx++)
+    {
+        last_ring = std::max(last_ring, rLower[idx] - mLowerOccupiedCell[idx]);
+        last_ring = std::max(last_ring, mUpperOccupiedCell[idx] - rUpper[idx]);
+    }
+    return unsigned(last_ring);
+}
+
+template<unsigned DIM>
+units::quantity<unit::length> VesselNetworkSpatialIndex<DIM>::GetCellWidth() const
+{
+    return mCellWidth*mReferenceLength;
+}
+
+template<unsigned DIM>
+units::quantity<unit::length> VesselNetworkSpatialIndex<DIM>::GetMaximumNodeLengthScale() const
+{
+    return mMaximumNodeLengthScale;
+}
+
+template<unsigned DIM>
+std::pair<std::vector<boost::shared_ptr<VesselNode<DIM> > >, units::quantity<unit::length> > VesselNetworkSpatialIndex<DIM>::GetNearestNodes(const DimensionalChastePoint<DIM>& rLocation,
+        boost::shared_ptr<VesselNode<DIM> > pExcludedNode) const
+{
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > nearest_nodes;
+    units::quantity<unit::length> min_distance = DBL_MAX*unit::metres;
+    if(mNodeRecords.empty())
+    {
+        return std::pair<std::vector<boost::shared_ptr<VesselNode<DIM> > >, units::quantity<unit::length> >(nearest_nodes, min_distance);
+    }
+
+    CellIndex cell = GetCellIndex(GetScaledLocation(rLocation));
+    unsigned last_ring = GetLastOccupiedRing(cell, cell);
+    std::vector<CellKey> keys;
+    for(unsigned ring=0; ring<=last_ring; ring++)
+    {
+        // If the ring is bigger than the occupied part of the grid just check every occupied cell
+        keys.clear();
+        bool visit_all = GetNumberOfCellsInRing(cell, cell, ring) > double(mNodeCells.size());
+        if(visit_all)
+        {
+            typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselNode<DIM> > > >::const_iterator cell_iter;
+            for(cell_iter = mNodeCells.begin(); cell_iter != mNodeCells.end(); cell_iter++)
+            {
+                keys.push_back(cell_iter->first);
+            }
+        }
+        else
+        {
+            GetCellsInRing(cell, cell, ring, keys);
+        }
+
+        for(unsigned idx=0; idx<keys.size(); idx++)
+        {
+            typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselNode<DIM> > > >::const_iterator cell_iter = mNodeCells.find(keys[idx]);
+            if(cell_iter == mNodeCells.end())
+            {
+                continue;
+            }
+            typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::const_iterator node_iter;
+            for(node_iter = cell_iter->second.begin(); node_iter != cell_iter->second.end(); node_iter++)
+            {
+                if((*node_iter) == pExcludedNode)
+                {
+                    continue;
+                }
+                units::quantity<unit::length> node_distance = (*node_iter)->GetDistance(rLocation);
+                if (node_distance < min_distance)
+                {
+                    min_distance = node_distance;
+                    nearest_nodes.clear();
+                    nearest_nodes.push_back(*node_iter);
+                }
+                else if(node_distance == min_distance &&
+                        std::find(nearest_nodes.begin(), nearest_nodes.end(), *node_iter) == nearest_nodes.end())
+                {
+                    nearest_nodes.push_back(*node_iter);
+                }
+            }
+        }
+
+        // Nodes outside this ring are at least 'ring' cell widths away
+        if(visit_all || (!nearest_nodes.empty() && min_distance < double(ring)*mCellWidth*mReferenceLength))
+        {
+            break;
+        }
+    }
+    return std::pair<std::vector<boost::shared_ptr<VesselNode<DIM> > >, units::quantity<unit::length> >(nearest_nodes, min_distance);
+}
+
+template<unsigned DIM>
+std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> > VesselNetworkSpatialIndex<DIM>::GetNearestSegments(const DimensionalChastePoint<DIM>& rLocation) const
+{
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > nearest_segments;
+    units::quantity<unit::length> min_distance = DBL_MAX*unit::metres;
+    if(mSegmentRecords.empty())
+    {
+        return std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> >(nearest_segments, min_distance);
+    }
+
+    CellIndex cell = GetCellIndex(GetScaledLocation(rLocation));
+    unsigned last_ring = GetLastOccupiedRing(cell, cell);
+    std::vector<CellKey> keys;
+    for(unsigned ring=0; ring<=last_ring; ring++)
+    {
+        keys.clear();
+        bool visit_all = GetNumberOfCellsInRing(cell, cell, ring) > double(mSegmentCells.size());
+        if(visit_all)
+        {
+            typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > >::const_iterator cell_iter;
+            for(cell_iter = mSegmentCells.begin(); cell_iter != mSegmentCells.end(); cell_iter++)
+            {
+                keys.push_back(cell_iter->first);
+            }
+        }
+        else
+        {
+            GetCellsInRing(cell, cell, ring, keys);
+        }
+
+        for(unsigned idx=0; idx<keys.size(); idx++)
+        {
+            typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > >::const_iterator cell_iter = mSegmentCells.find(keys[idx]);
+            if(cell_iter == mSegmentCells.end())
+            {
+                continue;
+            }
+            typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::const_iterator segment_iter;
+            for(segment_iter = cell_iter->second.begin(); segment_iter != cell_iter->second.end(); segment_iter++)
+            {
+                units::quantity<unit::length> segment_distance = (*segment_iter)->GetDistance(rLocation);
+                if (segment_distance < min_distance)
+                {
+                    min_distance = segment_distance;
+                    nearest_segments.clear();
+                    nearest_segments.push_back(*segment_iter);
+                }
+                else if(segment_distance == min_distance &&
+                        std::find(nearest_segments.begin(), nearest_segments.end(), *segment_iter) == nearest_segments.end())
+                {
+                    nearest_segments.push_back(*segment_iter);
+                }
+            }
+        }
+
+        // Segment sample points are at most a quarter of a cell width from any point on the segment
+        if(visit_all || (!nearest_segments.empty() && min_distance < (double(ring)-0.25)*mCellWidth*mReferenceLength))
+        {
+            break;
+        }
+    }
+    return std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> >(nearest_segments, min_distance);
+}
+
+template<unsigned DIM>
+std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> > VesselNetworkSpatialIndex<DIM>::GetNearestSegments(boost::shared_ptr<VesselNode<DIM> > pNode,
+                                                                                                                                    bool sameVessel) const
+{
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > nearest_segments;
+    units::quantity<unit::length> min_distance = DBL_MAX*unit::metres;
+    if(mSegmentRecords.empty())
+    {
+        return std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> >(nearest_segments, min_distance);
+    }
+
+    const DimensionalChastePoint<DIM>& r_location = pNode->rGetLocation();
+    CellIndex cell = GetCellIndex(GetScaledLocation(r_location));
+    unsigned last_ring = GetLastOccupiedRing(cell, cell);
+    std::vector<CellKey> keys;
+    for(unsigned ring=0; ring<=last_ring; ring++)
+    {
+        keys.clear();
+        bool visit_all = GetNumberOfCellsInRing(cell, cell, ring) > double(mSegmentCells.size());
+        if(visit_all)
+        {
+            typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > >::const_iterator cell_iter;
+            for(cell_iter = mSegmentCells.begin(); cell_iter != mSegmentCells.end(); cell_iter++)
+            {
+                keys.push_back(cell_iter->first);
+            }
+        }
+        else
+        {
+            GetCellsInRing(cell, cell, ring, keys);
+        }
+
+        for(unsigned idx=0; idx<keys.size(); idx++)
+        {
+            typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > >::const_iterator cell_iter = mSegmentCells.find(keys[idx]);
+            if(cell_iter == mSegmentCells.end())
+            {
+                continue;
+            }
+            typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::const_iterator segment_iter;
+            for(segment_iter = cell_iter->second.begin(); segment_iter != cell_iter->second.end(); segment_iter++)
+            {
+                if((*segment_iter)->GetNode(0) == pNode || (*segment_iter)->GetNode(1) == pNode)
+                {
+                    continue;
+                }
+
+                units::quantity<unit::length> segment_distance = (*segment_iter)->GetDistance(r_location);
+                if (segment_distance < min_distance || (segment_distance == min_distance &&
+                        std::find(nearest_segments.begin(), nearest_segments.end(), *segment_iter) == nearest_segments.end()))
+                {
+                    bool same_vessel = false;
+                    if(!sameVessel)
+                    {
+                        std::vector<boost::shared_ptr<VesselSegment<DIM> > > node_segs = pNode->GetSegments();
+                        for(unsigned jdx=0; jdx<node_segs.size(); jdx++)
+                        {
+                            if(node_segs[jdx]->GetVessel() == (*segment_iter)->GetVessel())
+                            {
+                                same_vessel = true;
+                            }
+                        }
+                    }
+                    if(!same_vessel)
+                    {
+                        if(segment_distance < min_distance)
+                        {
+                            nearest_segments.clear();
+                        }
+                        min_distance = segment_distance;
+                        nearest_segments.push_back(*segment_iter);
+                    }
+                }
+            }
+        }
+
+        if(visit_all || (!nearest_segments.empty() && min_distance < (double(ring)-0.25)*mCellWidth*mReferenceLength))
+        {
+            break;
+        }
+    }
+    return std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> >(nearest_segments, min_distance);
+}
+
+template<unsigned DIM>
+std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> > VesselNetworkSpatialIndex<DIM>::GetNearestSegments(boost::shared_ptr<VesselSegment<DIM> > pSegment) const
+{
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > nearest_segments;
+    units::quantity<unit::length> min_distance = DBL_MAX*unit::metres;
+    double min_scaled_distance = DBL_MAX;
+    if(mSegmentRecords.empty())
+    {
+        return std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> >(nearest_segments, min_distance);
+    }
+
+    // Search outwards from the box of cells around the segment
+    CellIndex start_cell = GetCellIndex(GetScaledLocation(pSegment->GetNode(0)->rGetLocation()));
+    CellIndex end_cell = GetCellIndex(GetScaledLocation(pSegment->GetNode(1)->rGetLocation()));
+    CellIndex lower = zero_vector<int>(3);
+    CellIndex upper = zero_vector<int>(3);
+    for(unsigned idx=0; idx<DIM; idx++)
+    {
+        lower[idx] = std::min(start_cell[idx], end_cell[idx]);
+        upper[idx] = std::max(start_cell[idx], end_cell[idx]);
+    }
+
+    unsigned last_ring = GetLastOccupiedRing(lower, upper);
+    std::vector<CellKey> keys;
+    for(unsigned ring=0; ring<=last_ring; ring++)
+    {
+        keys.clear();
+        bool visit_all = GetNumberOfCellsInRing(lower, upper, ring) > double(mSegmentCells.size());
+        if(visit_all)
+        {
+            typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > >::const_iterator cell_iter;
+            for(cell_iter = mSegmentCells.begin(); cell_iter != mSegmentCells.end(); cell_iter++)
+            {
+                keys.push_back(cell_iter->first);
+            }
+        }
+        else
+        {
+            GetCellsInRing(lower, upper, ring, keys);
+        }
+
+        for(unsigned idx=0; idx<keys.size(); idx++)
+        {
+            typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > >::const_iterator cell_iter = mSegmentCells.find(keys[idx]);
+            if(cell_iter == mSegmentCells.end())
+            {
+                continue;
+            }
+            typename std::vector<boost::shared_ptr<VesselSegment<DIM> > >::const_iterator segment_iter;
+            for(segment_iter = cell_iter->second.begin(); segment_iter != cell_iter->second.end(); segment_iter++)
+            {
+                if(pSegment->IsConnectedTo((*segment_iter)))
+                {
+                    continue;
+                }
+                // Compare the distances in the node length scale, as the dimensional value can round to a tie
+                double segment_distance = GetSegmentToSegmentDistance((*segment_iter), pSegment);
+                if (segment_distance < min_scaled_distance)
+                {
+                    min_scaled_distance = segment_distance;
+                    min_distance = segment_distance * (*segment_iter)->GetNode(0)->GetReferenceLengthScale();
+                    nearest_segments.clear();
+                    nearest_segments.push_back(*segment_iter);
+                }
+                else if(segment_distance == min_scaled_distance &&
+                        std::find(nearest_segments.begin(), nearest_segments.end(), *segment_iter) == nearest_segments.end())
+                {
+                    nearest_segments.push_back(*segment_iter);
+                }
+            }
+        }
+
+        if(visit_all || (!nearest_segments.empty() && min_distance < (double(ring)-0.25)*mCellWidth*mReferenceLength))
+        {
+            break;
+        }
+    }
+    return std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> >(nearest_segments, min_distance);
+}
+
+template<unsigned DIM>
+std::vector<boost::shared_ptr<VesselNode<DIM> > > VesselNetworkSpatialIndex<DIM>::GetNodesNearLocation(const DimensionalChastePoint<DIM>& rLocation,
+                                                                                                      units::quantity<unit::length> distance) const
+{
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes;
+    if(mNodeRecords.empty())
+    {
+        return nodes;
+    }
+
+    c_vector<double, DIM> scaled_location = GetScaledLocation(rLocation);
+    c_vector<double, DIM> offset = scalar_vector<double>(DIM, distance/mReferenceLength);
+    CellIndex lower = GetCellIndex(scaled_location - offset);
+    CellIndex upper = GetCellIndex(scaled_location + offset);
+
+    std::vector<CellKey> keys;
+    if(GetNumberOfCellsInRing(lower, upper, 0) > double(mNodeCells.size()))
+    {
+        typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselNode<DIM> > > >::const_iterator cell_iter;
+        for(cell_iter = mNodeCells.begin(); cell_iter != mNodeCells.end(); cell_iter++)
+        {
+            keys.push_back(cell_iter->first);
+        }
+    }
+    else
+    {
+        GetCellsInRing(lower, upper, 0, keys);
+    }
+
+    for(unsigned idx=0; idx<keys.size(); idx++)
+    {
+        typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselNode<DIM> > > >::const_iterator cell_iter = mNodeCells.find(keys[idx]);
+        if(cell_iter != mNodeCells.end())
+        {
+            nodes.insert(nodes.end(), cell_iter->second.begin(), cell_iter->second.end());
+        }
+    }
+    return nodes;
+}
+
+template<unsigned DIM>
+std::vector<boost::shared_ptr<VesselSegment<DIM> > > VesselNetworkSpatialIndex<DIM>::GetSegmentsNearLineSegment(const DimensionalChastePoint<DIM>& rStart,
+                                                                                                                const DimensionalChastePoint<DIM>& rEnd,
+                                                                                                                units::quantity<unit::length> distance) const
+{
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments;
+    if(mSegmentRecords.empty())
+    {
+        return segments;
+    }
+
+    // Segment sample points are at most a quarter of a cell width from any point on the segment, so
+    // pad the box around the line by that much on top of the search distance.
+    c_vector<double, DIM> scaled_start = GetScaledLocation(rStart);
+    c_vector<double, DIM> scaled_end = GetScaledLocation(rEnd);
+    double padding = distance/mReferenceLength + 0.25*mCellWidth;
+    c_vector<double, DIM> lower_location;
+    c_vector<double, DIM> upper_location;
+    for(unsigned idx=0; idx<DIM; idx++)
+    {
+        lower_location[idx] = std::min(scaled_start[idx], scaled_end[idx]) - padding;
+        upper_location[idx] = std::max(scaled_start[idx], scaled_end[idx]) + padding;
+    }
+    CellIndex lower = GetCellIndex(lower_location);
+    CellIndex upper = GetCellIndex(upper_location);
+
+    std::vector<CellKey> keys;
+    if(GetNumberOfCellsInRing(lower, upper, 0) > double(mSegmentCells.size()))
+    {
+        typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > >::const_iterator cell_iter;
+        for(cell_iter = mSegmentCells.begin(); cell_iter != mSegmentCells.end(); cell_iter++)
+        {
+            keys.push_back(cell_iter->first);
+        }
+    }
+    else
+    {
+        GetCellsInRing(lower, upper, 0, keys);
+    }
+
+    for(unsigned idx=0; idx<keys.size(); idx++)
+    {
+        typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > >::const_iterator cell_iter = mSegmentCells.find(keys[idx]);
+        if(cell_iter != mSegmentCells.end())
+        {
+            segments.insert(segments.end(), cell_iter->second.begin(), cell_iter->second.end());
+        }
+    }
+
+    // Segments spanning several cells are collected once per cell
+    std::sort(segments.begin(), segments.end());
+    segments.erase(std::unique(segments.begin(), segments.end()), segments.end());
+    return segments;
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkSpatialIndex<DIM>::GetNumberOfNodes() const
+{
+    return mNodeRecords.size();
+}
+
+template<unsigned DIM>
+unsigned VesselNetworkSpatialIndex<DIM>::GetNumberOfSegments() const
+{
+    return mSegmentRecords.size();
+}
+
+template<unsigned DIM>
+double VesselNetworkSpatialIndex<DIM>::GetSegmentToSegmentDistance(boost::shared_ptr<VesselSegment<DIM> > pSegment1,
+                                                                   boost::shared_ptr<VesselSegment<DIM> > pSegment2)
+{
+    return GetSegmentToSegmentDistance(pSegment1->GetNode(0)->rGetLocation().rGetLocation(), pSegment1->GetNode(1)->rGetLocation().rGetLocation(),
+                                       pSegment2->GetNode(0)->rGetLocation().rGetLocation(), pSegment2->GetNode(1)->rGetLocation().rGetLocation());
+}
+
+template<unsigned DIM>
+double VesselNetworkSpatialIndex<DIM>::GetSegmentToSegmentDistance(const c_vector<double, DIM>& rStart1, const c_vector<double, DIM>& rEnd1,
+                                                                   const c_vector<double, DIM>& rStart2, const c_vector<double, DIM>& rEnd2)
+{
+    c_vector<double, DIM> u = rEnd1 - rStart1;
+    c_vector<double, DIM> v = rEnd2 - rStart2;
+    c_vector<double, DIM> w = rStart1 - rStart2;
+
+    double a = inner_prod(u,u);
+    double b = inner_prod(u,v);
+    double c = inner_prod(v,v);
+    double d = inner_prod(u,w);
+    double e = inner_prod(v,w);
+
+    double dv = a * c - b * b;
+    double sc, sn, sd = dv;
+    double tc, tn ,td = dv;
+
+    if(dv < 1.e-12) // almost parallel segments
+    {
+        sn = 0.0;
+        sd = 1.0;
+        tn = e;
+        td = c;
+    }
+    else // get the closest point on the equivalent infinite lines
+    {
+        sn = (b*e - c*d);
+        tn = (a*e - b*d);
+        if ( sn < 0.0)
+        {
+            sn = 0.0;
+            tn = e;
+            td = c;
+        }
+        else if(sn > sd)
+        {
+            sn =sd;
+            tn = e+ b;
+            td = c;
+        }
+    }
+
+    if(tn < 0.0)
+    {
+        tn = 0.0;
+        if(-d < 0.0)
+        {
+            sn = 0.0;
+        }
+        else if(-d > a)
+        {
+            sn = sd;
+        }
+        else
+        {
+            sn = -d;
+            sd = a;
+        }
+    }
+    else if(tn > td)
+    {
+        tn = td;
+        if((-d + b) < 0.0)
+        {
+            sn = 0.0;
+        }
+        else if((-d + b) > a)
+        {
+            sn = sd;
+        }
+        else
+        {
+            sn = (-d + b);
+            sd = a;
+        }
+    }
+
+    sc = (std::abs(sn) < 1.e-12 ? 0.0 : sn/sd);
+    tc = (std::abs(tn) < 1.e-12 ? 0.0 : tn/td);
+    c_vector<double, DIM> dp = w + (sc * u) - (tc * v);
+    return norm_2(dp);
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::InsertNode(boost::shared_ptr<VesselNode<DIM> > pNode)
+{
+    typename boost::unordered_map<const VesselNode<DIM>*, NodeRecord>::iterator record_iter = mNodeRecords.find(pNode.get());
+    if(record_iter != mNodeRecords.end())
+    {
+        record_iter->second.mNumberOfSegments++;
+        return;
+    }
+
+    CellIndex index = GetCellIndex(GetScaledLocation(pNode->rGetLocation()));
+    NodeRecord record;
+    record.mKey = GetCellKey(index);
+    record.mNumberOfSegments = 1;
+    record.mLocationVersion = pNode->GetLocationVersion();
+    mNodeRecords[pNode.get()] = record;
+    mNodeCells[record.mKey].push_back(pNode);
+    UpdateOccupiedRange(index);
+    if(pNode->GetReferenceLengthScale() > mMaximumNodeLengthScale)
+    {
+        mMaximumNodeLengthScale = pNode->GetReferenceLengthScale();
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::InsertSegment(boost::shared_ptr<VesselSegment<DIM> > pSegment)
+{
+    if(mSegmentRecords.find(pSegment.get()) != mSegmentRecords.end())
+    {
+        return;
+    }
+
+    SegmentRecord record;
+    record.mNodes = std::pair<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM> > >(pSegment->GetNode(0), pSegment->GetNode(1));
+
+    // Store the segment in the cells of sample points spaced at most half a cell width apart
+    c_vector<double, DIM> start = GetScaledLocation(record.mNodes.first->rGetLocation());
+    c_vector<double, DIM> end = GetScaledLocation(record.mNodes.second->rGetLocation());
+    unsigned num_intervals = unsigned(std::ceil(norm_2(end - start)/(0.5*mCellWidth)));
+    num_intervals = std::max(num_intervals, 1u);
+    for(unsigned idx=0; idx<=num_intervals; idx++)
+    {
+        CellIndex index = GetCellIndex(start + (end - start)*(double(idx)/double(num_intervals)));
+        CellKey key = GetCellKey(index);
+        if(record.mKeys.empty() || record.mKeys.back() != key)
+        {
+            record.mKeys.push_back(key);
+            UpdateOccupiedRange(index);
+        }
+    }
+    std::sort(record.mKeys.begin(), record.mKeys.end());
+    record.mKeys.erase(std::unique(record.mKeys.begin(), record.mKeys.end()), record.mKeys.end());
+    for(unsigned idx=0; idx<record.mKeys.size(); idx++)
+    {
+        mSegmentCells[record.mKeys[idx]].push_back(pSegment);
+    }
+    mSegmentRecords[pSegment.get()] = record;
+
+    InsertNode(record.mNodes.first);
+    InsertNode(record.mNodes.second);
+}
+
+template<unsigned DIM>
+bool VesselNetworkSpatialIndex<DIM>::IsUnbalanced() const
+{
+    if(mFixedCellWidth > 0.0*unit::metres)
+    {
+        return false;
+    }
+    unsigned num_segments = mSegmentRecords.size();
+    unsigned reference_size = std::max(mNumberOfSegmentsAtBuild, 16u);
+    return (num_segments > 2*reference_size) || (4*num_segments < mNumberOfSegmentsAtBuild);
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::MoveNode(boost::shared_ptr<VesselNode<DIM> > pNode)
+{
+    NodeRecord& r_record = mNodeRecords[pNode.get()];
+    CellIndex index = GetCellIndex(GetScaledLocation(pNode->rGetLocation()));
+    CellKey key = GetCellKey(index);
+    if(key != r_record.mKey)
+    {
+        std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_old_cell = mNodeCells[r_record.mKey];
+        r_old_cell.erase(std::remove(r_old_cell.begin(), r_old_cell.end(), pNode), r_old_cell.end());
+        if(r_old_cell.empty())
+        {
+            mNodeCells.erase(r_record.mKey);
+        }
+        mNodeCells[key].push_back(pNode);
+        r_record.mKey = key;
+        UpdateOccupiedRange(index);
+    }
+    r_record.mLocationVersion = pNode->GetLocationVersion();
+    if(pNode->GetReferenceLengthScale() > mMaximumNodeLengthScale)
+    {
+        mMaximumNodeLengthScale = pNode->GetReferenceLengthScale();
+    }
+
+    // The record may be replaced when the segments are re-indexed, so it is not used after this
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = pNode->GetSegments();
+    for(unsigned idx=0; idx<segments.size(); idx++)
+    {
+        if(mSegmentRecords.find(segments[idx].get()) != mSegmentRecords.end())
+        {
+            RemoveSegment(segments[idx]);
+            InsertSegment(segments[idx]);
+        }
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::RemoveNode(boost::shared_ptr<VesselNode<DIM> > pNode)
+{
+    typename boost::unordered_map<const VesselNode<DIM>*, NodeRecord>::iterator record_iter = mNodeRecords.find(pNode.get());
+    if(record_iter == mNodeRecords.end())
+    {
+        return;
+    }
+
+    record_iter->second.mNumberOfSegments--;
+    if(record_iter->second.mNumberOfSegments == 0)
+    {
+        typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselNode<DIM> > > >::iterator cell_iter =
+                mNodeCells.find(record_iter->second.mKey);
+        if(cell_iter != mNodeCells.end())
+        {
+            cell_iter->second.erase(std::remove(cell_iter->second.begin(), cell_iter->second.end(), pNode), cell_iter->second.end());
+            if(cell_iter->second.empty())
+            {
+                mNodeCells.erase(cell_iter);
+            }
+        }
+        mNodeRecords.erase(record_iter);
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::RemoveSegment(boost::shared_ptr<VesselSegment<DIM> > pSegment)
+{
+    typename boost::unordered_map<const VesselSegment<DIM>*, SegmentRecord>::iterator record_iter = mSegmentRecords.find(pSegment.get());
+    if(record_iter == mSegmentRecords.end())
+    {
+        return;
+    }
+
+    const std::vector<CellKey>& r_keys = record_iter->second.mKeys;
+    for(unsigned idx=0; idx<r_keys.size(); idx++)
+    {
+        typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > >::iterator cell_iter = mSegmentCells.find(r_keys[idx]);
+        if(cell_iter != mSegmentCells.end())
+        {
+            cell_iter->second.erase(std::remove(cell_iter->second.begin(), cell_iter->second.end(), pSegment), cell_iter->second.end());
+            if(cell_iter->second.empty())
+            {
+                mSegmentCells.erase(cell_iter);
+            }
+        }
+    }
+
+    std::pair<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM> > > nodes = record_iter->second.mNodes;
+    mSegmentRecords.erase(record_iter);
+    RemoveNode(nodes.first);
+    RemoveNode(nodes.second);
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::SetCellWidth(units::quantity<unit::length> width)
+{
+    if(width < 0.0*unit::metres)
+    {
+        EXCEPTION("The spatial index cell width can not be negative.");
+    }
+    mFixedCellWidth = width;
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::UpdateMovedNodes()
+{
+    unsigned latest_version = VesselNode<DIM>::GetLatestLocationVersion();
+    if(latest_version == mLocationVersion)
+    {
+        return;
+    }
+
+    // Only the nodes moved since the last call are checked, unless the moves no longer go back that far. The
+    // logged nodes may no longer exist, so they are not used until they are found in the records.
+    std::vector<const VesselNode<DIM>*> candidates;
+    if(!VesselNode<DIM>::GetMovedNodes(mLocationVersion, candidates))
+    {
+        candidates.clear();
+        typename boost::unordered_map<const VesselNode<DIM>*, NodeRecord>::const_iterator all_iter;
+        for(all_iter = mNodeRecords.begin(); all_iter != mNodeRecords.end(); ++all_iter)
+        {
+            candidates.push_back(all_iter->first);
+        }
+    }
+    mLocationVersion = latest_version;
+
+    // Collect the moved nodes first, as moving them changes the records. A node moved more than once is only
+    // collected once, as its record is looked at before any node is moved.
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > moved_nodes;
+    boost::unordered_set<const VesselNode<DIM>*> collected;
+    for(unsigned jdx=0; jdx<candidates.size(); jdx++)
+    {
+        typename boost::unordered_map<const VesselNode<DIM>*, NodeRecord>::const_iterator record_iter =
+                mNodeRecords.find(candidates[jdx]);
+        if(record_iter != mNodeRecords.end() &&
+                record_iter->first->GetLocationVersion() != record_iter->second.mLocationVersion &&
+                collected.insert(record_iter->first).second)
+        {
+            typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselNode<DIM> > > >::const_iterator cell_iter =
+                    mNodeCells.find(record_iter->second.mKey);
+            for(unsigned idx=0; cell_iter != mNodeCells.end() && idx<cell_iter->second.size(); idx++)
+            {
+                if(cell_iter->second[idx].get() == record_iter->first)
+                {
+                    moved_nodes.push_back(cell_iter->second[idx]);
+                    break;
+                }
+            }
+        }
+    }
+    for(unsigned idx=0; idx<moved_nodes.size(); idx++)
+    {
+        MoveNode(moved_nodes[idx]);
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::UpdateReconnectedSegments()
+{
+    unsigned latest_version = VesselSegment<DIM>::GetLatestNodesVersion();
+    if(latest_version == mNodesVersion)
+    {
+        return;
+    }
+
+    // As for moved nodes, only the segments reconnected since the last call are checked if possible
+    std::vector<const VesselSegment<DIM>*> candidates;
+    if(!VesselSegment<DIM>::GetReconnectedSegments(mNodesVersion, candidates))
+    {
+        candidates.clear();
+        typename boost::unordered_map<const VesselSegment<DIM>*, SegmentRecord>::const_iterator all_iter;
+        for(all_iter = mSegmentRecords.begin(); all_iter != mSegmentRecords.end(); ++all_iter)
+        {
+            candidates.push_back(all_iter->first);
+        }
+    }
+    mNodesVersion = latest_version;
+
+    // Collect the reconnected segments first, as re-indexing them changes the records
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > reconnected_segments;
+    boost::unordered_set<const VesselSegment<DIM>*> collected;
+    for(unsigned jdx=0; jdx<candidates.size(); jdx++)
+    {
+        typename boost::unordered_map<const VesselSegment<DIM>*, SegmentRecord>::const_iterator record_iter =
+                mSegmentRecords.find(candidates[jdx]);
+        if(record_iter != mSegmentRecords.end() &&
+                record_iter->first->GetNodes() != record_iter->second.mNodes &&
+                collected.insert(record_iter->first).second)
+        {
+            typename boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > >::const_iterator cell_iter =
+                    mSegmentCells.find(record_iter->second.mKeys.front());
+            for(unsigned idx=0; cell_iter != mSegmentCells.end() && idx<cell_iter->second.size(); idx++)
+            {
+                if(cell_iter->second[idx].get() == record_iter->first)
+                {
+                    reconnected_segments.push_back(cell_iter->second[idx]);
+                    break;
+                }
+            }
+        }
+    }
+    for(unsigned idx=0; idx<reconnected_segments.size(); idx++)
+    {
+        RemoveSegment(reconnected_segments[idx]);
+        InsertSegment(reconnected_segments[idx]);
+    }
+}
+
+template<unsigned DIM>
+void VesselNetworkSpatialIndex<DIM>::UpdateOccupiedRange(const CellIndex& rIndex)
+{
+    for(unsigned idx=0; idx<DIM; idx++)
+    {
+        mLowerOccupiedCell[idx] = std::min(mLowerOccupiedCell[idx], rIndex[idx]);
+        mUpperOccupiedCell[idx] = std::max(mUpperOccupiedCell[idx], rIndex[idx]);
+    }
+}
+
+// Explicit instantiation
+template class VesselNetworkSpatialIndex<2>;
+template class VesselNetworkSpatialIndex<3>;
@@ -0,0 +1,426 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef VESSELNETWORKSPATIALINDEX_HPP_
+#define VESSELNETWORKSPATIALINDEX_HPP_
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include "SmartPointers.hpp"
+#include "UblasVectorInclude.hpp"
+#include "UnitCollection.hpp"
+#include "DimensionalChastePoint.hpp"
+#include "VesselNode.hpp"
+#include "VesselSegment.hpp"
+
+/**
+ * A uniform hash grid over the nodes and segments of a vessel network, used to accelerate
+ * nearest node and nearest segment queries.
+ *
+ * Nodes are stored in the grid cell containing them. Segments are stored in every cell
+ * containing one of a set of sample points spaced at half of the cell width along the segment.
+ * Queries visit rings of cells around the query point in order of increasing distance
+ * and stop once no unvisited cell can contain a closer candidate, so they only touch the local
+ * neighbourhood of the query rather than the whole network.
+ *
+ * The index is maintained incrementally as segments are inserted or removed. The node set is
+ * the set of nodes attached to indexed segments. Nodes which have been moved since they were indexed
+ * are found from the nodes moved since the last update and moved to their new cells, with their segments, by
+ * UpdateMovedNodes. Likewise segments which have had a node replaced are re-indexed by
+ * UpdateReconnectedSegments.
+ */
+template<unsigned DIM>
+class VesselNetworkSpatialIndex
+{
+
+private:
+
+    /**
+     * Integer key for a grid cell, formed by packing the cell indices.
+     */
+    typedef unsigned long long CellKey;
+
+    /**
+     * Integer indices for a grid cell. Unused dimensions are zero.
+     */
+    typedef c_vector<int, 3> CellIndex;
+
+    /**
+     * Book-keeping for an indexed node.
+     */
+    struct NodeRecord
+    {
+        /**
+         * The cell containing the node.
+         */
+        CellKey mKey;
+
+        /**
+         * The number of indexed segments attached to the node.
+         */
+        unsigned mNumberOfSegments;
+
+        /**
+         * The location stamp of the node when it was indexed.
+         */
+        unsigned mLocationVersion;
+    };
+
+    /**
+     * Book-keeping for an indexed segment.
+     */
+    struct SegmentRecord
+    {
+        /**
+         * The cells the segment is stored in.
+         */
+        std::vector<CellKey> mKeys;
+
+        /**
+         * The nodes the segment was attached to when it was indexed.
+         */
+        std::pair<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM> > > mNodes;
+    };
+
+    /**
+     * The nodes in each occupied cell.
+     */
+    boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselNode<DIM> > > > mNodeCells;
+
+    /**
+     * The segments in each occupied cell.
+     */
+    boost::unordered_map<CellKey, std::vector<boost::shared_ptr<VesselSegment<DIM> > > > mSegmentCells;
+
+    /**
+     * Records for indexed nodes.
+     */
+    boost::unordered_map<const VesselNode<DIM>*, NodeRecord> mNodeRecords;
+
+    /**
+     * Records for indexed segments.
+     */
+    boost::unordered_map<const VesselSegment<DIM>*, SegmentRecord> mSegmentRecords;
+
+    /**
+     * The length scale in which cell coordinates are expressed.
+     */
+    units::quantity<unit::length> mReferenceLength;
+
+    /**
+     * The cell width, in units of mReferenceLength.
+     */
+    double mCellWidth;
+
+    /**
+     * A user specified cell width, if zero the width is chosen from the mean segment length on each build.
+     */
+    units::quantity<unit::length> mFixedCellWidth;
+
+    /**
+     * The lower corner of the range of cells which have been occupied since the last build.
+     */
+    CellIndex mLowerOccupiedCell;
+
+    /**
+     * The upper corner of the range of cells which have been occupied since the last build.
+     */
+    CellIndex mUpperOccupiedCell;
+
+    /**
+     * The largest reference length scale of the indexed node locations.
+     */
+    units::quantity<unit::length> mMaximumNodeLengthScale;
+
+    /**
+     * The number of segments in the index when it was last built.
+     */
+    unsigned mNumberOfSegmentsAtBuild;
+
+    /**
+     * The latest node location stamp when moved nodes were last looked for.
+     */
+    unsigned mLocationVersion;
+
+    /**
+     * The latest segment node stamp when reconnected segments were last looked for.
+     */
+    unsigned mNodesVersion;
+
+    /**
+     * Return the cell containing a location
+     * @param rScaledLocation the location in units of mReferenceLength
+     * @return the cell index
+     */
+    CellIndex GetCellIndex(const c_vector<double, DIM>& rScaledLocation) const;
+
+    /**
+     * Return the coordinates of a location in units of mReferenceLength
+     * @param rLocation the location
+     * @return the scaled coordinates
+     */
+    c_vector<double, DIM> GetScaledLocation(const DimensionalChastePoint<DIM>& rLocation) const;
+
+    /**
+     * Return the key for a cell index
+     * @param rIndex the cell index
+     * @return the cell key
+     */
+    CellKey GetCellKey(const CellIndex& rIndex) const;
+
+    /**
+     * Return the cells in a ring of cells around a box of cells. Ring 0 is the box itself.
+     * @param rLower the lower corner of the box
+     * @param rUpper the upper corner of the box
+     * @param ring the ring number
+     * @param rKeys the keys of the cells in the ring are appended to this
+     */
+    void GetCellsInRing(const CellIndex& rLower, const CellIndex& rUpper, unsigned ring, std::vector<CellKey>& rKeys) const;
+
+    /**
+     * Return the number of cells in a ring around a box of cells.
+     * @param rLower the lower corner of the box
+     * @param rUpper the upper corner of the box
+     * @param ring the ring number
+     * @return the number of cells in the ring
+     */
+    double GetNumberOfCellsInRing(const CellIndex& rLower, const CellIndex& rUpper, unsigned ring) const;
+
+    /**
+     * Return the last ring around a box of cells which may contain occupied cells
+     * @param rLower the lower corner of the box
+     * @param rUpper the upper corner of the box
+     * @return the ring number
+     */
+    unsigned GetLastOccupiedRing(const CellIndex& rLower, const CellIndex& rUpper) const;
+
+    /**
+     * Return the shortest distance between two segments, in the reference length of their node locations.
+     * @param pSegment1 the first segment
+     * @param pSegment2 the second segment
+     * @return the distance
+     */
+    static double GetSegmentToSegmentDistance(boost::shared_ptr<VesselSegment<DIM> > pSegment1,
+                                              boost::shared_ptr<VesselSegment<DIM> > pSegment2);
+
+    /**
+     * Add a node to the index, or increment its segment count if it is already indexed.
+     * @param pNode the node
+     */
+    void InsertNode(boost::shared_ptr<VesselNode<DIM> > pNode);
+
+    /**
+     * Move an indexed node to the cell containing its current location and re-index its segments.
+     * @param pNode the node
+     */
+    void MoveNode(boost::shared_ptr<VesselNode<DIM> > pNode);
+
+    /**
+     * Decrement the segment count of a node, removing it from the index if it reaches zero.
+     * @param pNode the node
+     */
+    void RemoveNode(boost::shared_ptr<VesselNode<DIM> > pNode);
+
+    /**
+     * Extend the occupied cell range to include the cell
+     * @param rIndex the cell index
+     */
+    void UpdateOccupiedRange(const CellIndex& rIndex);
+
+public:
+
+    /**
+     * Constructor.
+     */
+    VesselNetworkSpatialIndex();
+
+    /**
+     * Destructor.
+     */
+    ~VesselNetworkSpatialIndex();
+
+    /**
+     * Construct a new instance of the class and return a shared pointer to it.
+     * @return a pointer to a new instance of the class
+     */
+    static boost::shared_ptr<VesselNetworkSpatialIndex<DIM> > Create();
+
+    /**
+     * Clear the index and add the segments, and their nodes, to it. If no cell width has been set it
+     * is taken as the mean segment length.
+     * @param rSegments the segments
+     */
+    void Build(const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& rSegments);
+
+    /**
+     * Remove all nodes and segments from the index.
+     */
+    void Clear();
+
+    /**
+     * Return the width of the grid cells
+     * @return the width of the grid cells
+     */
+    units::quantity<unit::length> GetCellWidth() const;
+
+    /**
+     * Return the largest reference length scale of the indexed node locations
+     * @return the largest reference length scale of the indexed node locations
+     */
+    units::quantity<unit::length> GetMaximumNodeLengthScale() const;
+
+    /**
+     * Return the nearest nodes to a location and the distance to them. More than one node is returned
+     * only if several are equally near, the collection is empty if there are no candidate nodes.
+     * @param rLocation the location
+     * @param pExcludedNode a node to ignore, such as the node at the query location
+     * @return the nearest nodes and the distance to them
+     */
+    std::pair<std::vector<boost::shared_ptr<VesselNode<DIM> > >, units::quantity<unit::length> > GetNearestNodes(const DimensionalChastePoint<DIM>& rLocation,
+            boost::shared_ptr<VesselNode<DIM> > pExcludedNode = boost::shared_ptr<VesselNode<DIM> >()) const;
+
+    /**
+     * Return the nearest segments to a location and the distance to them. More than one segment is returned
+     * only if several are equally near.
+     * @param rLocation the location
+     * @return the nearest segments and the distance to them
+     */
+    std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> > GetNearestSegments(const DimensionalChastePoint<DIM>& rLocation) const;
+
+    /**
+     * Return the nearest segments to a node, ignoring segments attached to the node, and the distance to them.
+     * @param pNode the node
+     * @param sameVessel whether segments on the same vessels as the node are candidates
+     * @return the nearest segments and the distance to them
+     */
+    std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> > GetNearestSegments(boost::shared_ptr<VesselNode<DIM> > pNode,
+                                                                                                                      bool sameVessel) const;
+
+    /**
+     * Return the nearest segments to a segment, ignoring segments connected to it, and the distance to them.
+     * @param pSegment the segment, which need not be in the index
+     * @return the nearest segments and the distance to them
+     */
+    std::pair<std::vector<boost::shared_ptr<VesselSegment<DIM> > >, units::quantity<unit::length> > GetNearestSegments(boost::shared_ptr<VesselSegment<DIM> > pSegment) const;
+
+    /**
+     * Return the nodes which may lie within a distance of a location. All nodes within the distance
+     * are returned, nodes slightly further away may also be returned.
+     * @param rLocation the location
+     * @param distance the search distance
+     * @return the candidate nodes
+     */
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > GetNodesNearLocation(const DimensionalChastePoint<DIM>& rLocation,
+                                                                          units::quantity<unit::length> distance) const;
+
+    /**
+     * Return the segments which may lie within a distance of a line segment. All segments within the distance
+     * are returned, segments slightly further away may also be returned.
+     * @param rStart the start of the line segment
+     * @param rEnd the end of the line segment
+     * @param distance the search distance
+     * @return the candidate segments
+     */
+    std::vector<boost::shared_ptr<VesselSegment<DIM> > > GetSegmentsNearLineSegment(const DimensionalChastePoint<DIM>& rStart,
+                                                                                    const DimensionalChastePoint<DIM>& rEnd,
+                                                                                    units::quantity<unit::length> distance) const;
+
+    /**
+     * Return the shortest distance between two line segments given by their end locations.
+     * See http://geomalgorithms.com/a07-_distance.html#dist3D_Segment_to_Segment()
+     * @param rStart1 the start of the first segment
+     * @param rEnd1 the end of the first segment
+     * @param rStart2 the start of the second segment
+     * @param rEnd2 the end of the second segment
+     * @return the distance, in the same length scale as the locations
+     */
+    static double GetSegmentToSegmentDistance(const c_vector<double, DIM>& rStart1, const c_vector<double, DIM>& rEnd1,
+                                              const c_vector<double, DIM>& rStart2, const c_vector<double, DIM>& rEnd2);
+
+    /**
+     * Return the number of nodes in the index
+     * @return the number of nodes in the index
+     */
+    unsigned GetNumberOfNodes() const;
+
+    /**
+     * Return the number of segments in the index
+     * @return the number of segments in the index
+     */
+    unsigned GetNumberOfSegments() const;
+
+    /**
+     * Add a segment and its nodes to the index. Segments which are already indexed are ignored.
+     * @param pSegment the segment
+     */
+    void InsertSegment(boost::shared_ptr<VesselSegment<DIM> > pSegment);
+
+    /**
+     * Return whether the number of segments has changed enough since the last build that
+     * the cell width should be recomputed.
+     * @return whether the index should be rebuilt
+     */
+    bool IsUnbalanced() const;
+
+    /**
+     * Remove a segment from the index, and any nodes which are no longer attached to indexed segments.
+     * Segments which are not indexed are ignored.
+     * @param pSegment the segment
+     */
+    void RemoveSegment(boost::shared_ptr<VesselSegment<DIM> > pSegment);
+
+    /**
+     * Move nodes whose location has changed since they were indexed to their new cells, along with their
+     * segments. Only the nodes moved since the last call are checked, unless so many nodes have been moved
+     * that they are no longer all known, in which case every indexed node is checked.
+     */
+    void UpdateMovedNodes();
+
+    /**
+     * Re-index segments whose nodes have been replaced since they were indexed, so that the nodes they were
+     * detached from are released. Only the segments reconnected since the last call are checked, unless they
+     * are no longer all known, in which case every indexed segment is checked.
+     */
+    void UpdateReconnectedSegments();
+
+    /**
+     * Set the width of the grid cells, takes effect on the next build. A zero width means the mean segment
+     * length is used.
+     * @param width the width of the grid cells
+     */
+    void SetCellWidth(units::quantity<unit::length> width);
+};
+
+#endif /* VESSELNETWORKSPATIALINDEX_HPP_ */
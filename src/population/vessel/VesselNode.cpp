@@ -34,6 +34,7 @@ Copyright (c) 2005-2016, University of Oxford.
  */
 
 #include <boost/weak_ptr.hpp>
+#include <boost/make_shared.hpp>
 #include "Exception.hpp"
 #include "VesselNode.hpp"
 
@@ -42,10 +43,11 @@ VesselNode<DIM>::VesselNode(double v1, double v2, double v3, units::quantity<uni
         mLocation(DimensionalChastePoint<DIM>(v1 ,v2, v3, referenceLength)),
         mSegments(std::vector<boost::weak_ptr<VesselSegment<DIM> > >()),
         mIsMigrating(false),
-        mpFlowProperties(boost::shared_ptr<NodeFlowProperties<DIM> >(new NodeFlowProperties<DIM>())),
-        mPtrComparisonId(0)
+        mpFlowProperties(boost::make_shared<NodeFlowProperties<DIM> >()),
+        mPtrComparisonId(0),
+        mLocationVersion(0)
 {
-    this->mpFlowProperties = boost::shared_ptr<NodeFlowProperties<DIM> >(new NodeFlowProperties<DIM>());
+    mNumberOfNodes++;
 }
 
 template<unsigned DIM>
@@ -53,10 +55,11 @@ VesselNode<DIM>::VesselNode(double v1, double v2, double v3) : AbstractVesselNet
         mLocation(DimensionalChastePoint<DIM>(v1 ,v2, v3)),
         mSegments(std::vector<boost::weak_ptr<VesselSegment<DIM> > >()),
         mIsMigrating(false),
-        mpFlowProperties(boost::shared_ptr<NodeFlowProperties<DIM> >(new NodeFlowProperties<DIM>())),
-        mPtrComparisonId(0)
+        mpFlowProperties(boost::make_shared<NodeFlowProperties<DIM> >()),
+        mPtrComparisonId(0),
+        mLocationVersion(0)
 {
-    this->mpFlowProperties = boost::shared_ptr<NodeFlowProperties<DIM> >(new NodeFlowProperties<DIM>());
+    mNumberOfNodes++;
 }
 
 template<unsigned DIM>
@@ -64,10 +67,11 @@ VesselNode<DIM>::VesselNode(const DimensionalChastePoint<DIM>& location) : Abstr
         mLocation(location),
         mSegments(std::vector<boost::weak_ptr<VesselSegment<DIM> > >()),
         mIsMigrating(false),
-        mpFlowProperties(boost::shared_ptr<NodeFlowProperties<DIM> >(new NodeFlowProperties<DIM>())),
-        mPtrComparisonId(0)
+        mpFlowProperties(boost::make_shared<NodeFlowProperties<DIM> >()),
+        mPtrComparisonId(0),
+        mLocationVersion(0)
 {
-    this->mpFlowProperties = boost::shared_ptr<NodeFlowProperties<DIM> >(new NodeFlowProperties<DIM>());
+    mNumberOfNodes++;
 }
 
 template<unsigned DIM>
@@ -76,44 +80,46 @@ VesselNode<DIM>::VesselNode(const VesselNode<DIM>& rExistingNode) :
         mLocation(rExistingNode.rGetLocation()),
         mSegments(std::vector<boost::weak_ptr<VesselSegment<DIM> > >()),
         mIsMigrating(false),
-        mpFlowProperties(boost::shared_ptr<NodeFlowProperties<DIM> >(new NodeFlowProperties<DIM>())),
-        mPtrComparisonId(0)
+        mpFlowProperties(boost::make_shared<NodeFlowProperties<DIM> >(*(rExistingNode.GetFlowProperties()))),
+        mPtrComparisonId(0),
+        mLocationVersion(0)
 {
-    SetFlowProperties(*(rExistingNode.GetFlowProperties()));
     mIsMigrating = rExistingNode.IsMigrating();
+    mNumberOfNodes++;
 }
 
 
 template<unsigned DIM>
 VesselNode<DIM>::~VesselNode()
 {
+    mNumberOfNodes--;
 }
 
 template<unsigned DIM>
 boost::shared_ptr<VesselNode<DIM> > VesselNode<DIM>::Create(double v1, double v2, double v3, units::quantity<unit::length> referenceLength)
 {
-    MAKE_PTR_ARGS(VesselNode<DIM>, pSelf, (v1, v2, v3, referenceLength));
+    boost::shared_ptr<VesselNode<DIM> > pSelf = boost::make_shared<VesselNode<DIM> >(v1, v2, v3, referenceLength);
     return pSelf;
 }
 
 template<unsigned DIM>
 boost::shared_ptr<VesselNode<DIM> > VesselNode<DIM>::Create(double v1, double v2, double v3)
 {
-    MAKE_PTR_ARGS(VesselNode<DIM>, pSelf, (v1, v2, v3));
+    boost::shared_ptr<VesselNode<DIM> > pSelf = boost::make_shared<VesselNode<DIM> >(v1, v2, v3);
     return pSelf;
 }
 
 template<unsigned DIM>
 boost::shared_ptr<VesselNode<DIM> > VesselNode<DIM>::Create(const DimensionalChastePoint<DIM>& location)
 {
-    MAKE_PTR_ARGS(VesselNode<DIM>, pSelf, (location));
+    boost::shared_ptr<VesselNode<DIM> > pSelf = boost::make_shared<VesselNode<DIM> >(location);
     return pSelf;
 }
 
 template<unsigned DIM>
 boost::shared_ptr<VesselNode<DIM> > VesselNode<DIM>::Create(const VesselNode<DIM>& rExistingNode)
 {
-    MAKE_PTR_ARGS(VesselNode<DIM>, pSelf, (rExistingNode));
+    boost::shared_ptr<VesselNode<DIM> > pSelf = boost::make_shared<VesselNode<DIM> >(rExistingNode);
     return pSelf;
 }
 
@@ -124,7 +130,7 @@ boost::shared_ptr<VesselNode<DIM> > VesselNode<DIM>::Create(boost::shared_ptr<Ve
     {
         EXCEPTION("A Null pointer cannot be used when copying nodes.");
     }
-    MAKE_PTR_ARGS(VesselNode<DIM>, pSelf, (*pExistingNode));
+    boost::shared_ptr<VesselNode<DIM> > pSelf = boost::make_shared<VesselNode<DIM> >(*pExistingNode);
     return pSelf;
 }
 
@@ -167,6 +173,30 @@ const DimensionalChastePoint<DIM>& VesselNode<DIM>::rGetLocation() const
     return mLocation;
 }
 
+template<unsigned DIM>
+unsigned VesselNode<DIM>::GetLocationVersion() const
+{
+    return mLocationVersion;
+}
+
+template<unsigned DIM>
+unsigned VesselNode<DIM>::GetLatestLocationVersion()
+{
+    return mLatestLocationVersion;
+}
+
+template<unsigned DIM>
+bool VesselNode<DIM>::GetMovedNodes(unsigned locationVersion, std::vector<const VesselNode<DIM>*>& rNodes)
+{
+    unsigned num_moves = mLatestLocationVersion - locationVersion;
+    if(num_moves > mMovedNodes.size())
+    {
+        return false;
+    }
+    rNodes.assign(mMovedNodes.end() - num_moves, mMovedNodes.end());
+    return true;
+}
+
 template<unsigned DIM>
 unsigned VesselNode<DIM>::GetNumberOfSegments() const
 {
@@ -256,22 +286,37 @@ void VesselNode<DIM>::SetComparisonId(unsigned id)
     mPtrComparisonId = id;
 }
 
+template<unsigned DIM>
+void VesselNode<DIM>::RecordMove()
+{
+    // Drop the older half of the moves once there are many more than nodes. Anything looking further back then
+    // checks all of its nodes, at a cost spread over the moves since it last looked.
+    if(mMovedNodes.size() > 2*mNumberOfNodes + 1024)
+    {
+        mMovedNodes.erase(mMovedNodes.begin(), mMovedNodes.begin() + mMovedNodes.size()/2);
+    }
+    mMovedNodes.push_back(this);
+    mLocationVersion = ++mLatestLocationVersion;
+}
+
 template<unsigned DIM>
 void VesselNode<DIM>::SetFlowProperties(const NodeFlowProperties<DIM>& rFlowProperties)
 {
-    this->mpFlowProperties = boost::shared_ptr<NodeFlowProperties<DIM> >(new NodeFlowProperties<DIM>(rFlowProperties));
+    *(this->mpFlowProperties) = rFlowProperties;
 }
 
 template<unsigned DIM>
 void VesselNode<DIM>::SetLocation(const DimensionalChastePoint<DIM>& location)
 {
     this->mLocation = DimensionalChastePoint<DIM>(location);
+    RecordMove();
 }
 
 template<unsigned DIM>
 void VesselNode<DIM>::SetLocation(double x, double y, double z, units::quantity<unit::length> referenceLength)
 {
     this->mLocation = DimensionalChastePoint<DIM>(x,y,z,referenceLength);
+    RecordMove();
 }
 
 template<unsigned DIM>
@@ -284,8 +329,18 @@ template<unsigned DIM>
 void VesselNode<DIM>::SetReferenceLengthScale(units::quantity<unit::length> lengthScale)
 {
     this->mLocation.SetReferenceLengthScale(lengthScale);
+    RecordMove();
 }
 
+template<unsigned DIM>
+unsigned VesselNode<DIM>::mLatestLocationVersion = 0;
+
+template<unsigned DIM>
+std::vector<const VesselNode<DIM>*> VesselNode<DIM>::mMovedNodes;
+
+template<unsigned DIM>
+unsigned VesselNode<DIM>::mNumberOfNodes = 0;
+
 // Explicit instantiation
 template class VesselNode<2>;
 template class VesselNode<3>;
@@ -112,6 +112,33 @@ private:
      */
     unsigned mPtrComparisonId;
 
+    /**
+     * A stamp which changes whenever the node is moved, so that spatial lookups can tell which nodes have moved
+     * since they were indexed. Stamps are taken from a counter shared by all nodes.
+     */
+    unsigned mLocationVersion;
+
+    /**
+     * The stamp given to the most recently moved node.
+     */
+    static unsigned mLatestLocationVersion;
+
+    /**
+     * The most recently moved nodes, one entry for each move up to the latest stamp. The nodes may since have been
+     * destroyed, so the entries are only compared with known nodes.
+     */
+    static std::vector<const VesselNode<DIM>*> mMovedNodes;
+
+    /**
+     * The number of nodes in existence, which bounds the length of mMovedNodes.
+     */
+    static unsigned mNumberOfNodes;
+
+    /**
+     * Give the node a new location stamp and add it to the moved nodes
+     */
+    void RecordMove();
+
 public:
 
     /**
@@ -226,6 +253,30 @@ public:
      */
     const DimensionalChastePoint<DIM>& rGetLocation() const;
 
+    /**
+     * Return a stamp which changes whenever the node is moved
+     *
+     * @return the location stamp of the node
+     */
+    unsigned GetLocationVersion() const;
+
+    /**
+     * Return the stamp given to the most recently moved node, which changes whenever any node is moved
+     *
+     * @return the latest location stamp
+     */
+    static unsigned GetLatestLocationVersion();
+
+    /**
+     * Get the nodes moved since a location stamp was taken, once for each move. The nodes may since have been
+     * destroyed, so they should only be compared with known nodes.
+     *
+     * @param locationVersion the latest location stamp when moved nodes were last looked for
+     * @param rNodes filled with the moved nodes
+     * @return false if the moved nodes no longer go back as far as the stamp, in which case any node may have moved
+     */
+    static bool GetMovedNodes(unsigned locationVersion, std::vector<const VesselNode<DIM>*>& rNodes);
+
     /**
      * Return the number of attached segments
      *
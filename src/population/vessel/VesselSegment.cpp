@@ -33,6 +33,7 @@ Copyright (c) 2005-2016, University of Oxford.
 
  */
 
+#include <boost/make_shared.hpp>
 #include "SmartPointers.hpp"
 #include "UblasIncludes.hpp"
 #include "VesselNode.hpp"
@@ -44,8 +45,10 @@ VesselSegment<DIM>::VesselSegment(boost::shared_ptr<VesselNode<DIM> > pNode1, bo
         AbstractVesselNetworkComponent<DIM>(),
         mNodes(std::pair<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM> > >(pNode1, pNode2)),
         mVessel(boost::weak_ptr<Vessel<DIM> >()),
-        mpFlowProperties(boost::shared_ptr<SegmentFlowProperties<DIM> >(new SegmentFlowProperties<DIM>()))
+        mpFlowProperties(boost::make_shared<SegmentFlowProperties<DIM> >()),
+        mNodesVersion(0)
 {
+    mNumberOfSegments++;
 }
 
 template<unsigned DIM>
@@ -53,9 +56,10 @@ VesselSegment<DIM>::VesselSegment(const VesselSegment<DIM>& rSegment) :
     boost::enable_shared_from_this<VesselSegment<DIM> >(), AbstractVesselNetworkComponent<DIM>(),
     mNodes(rSegment.GetNodes()),
     mVessel(boost::weak_ptr<Vessel<DIM> >()),
-    mpFlowProperties(boost::shared_ptr<SegmentFlowProperties<DIM> >(new SegmentFlowProperties<DIM>()))
+    mpFlowProperties(boost::make_shared<SegmentFlowProperties<DIM> >(*(rSegment.GetFlowProperties()))),
+    mNodesVersion(0)
 {
-    this->SetFlowProperties(*(rSegment.GetFlowProperties()));
+    mNumberOfSegments++;
 }
 
 template<unsigned DIM>
@@ -82,7 +86,7 @@ boost::shared_ptr<VesselSegment<DIM> > VesselSegment<DIM>::Create(boost::shared_
     {
         EXCEPTION("A Null pointer cannot be used when copying segments.");
     }
-    MAKE_PTR_ARGS(VesselSegment<DIM>, pSelf, (*pSegment));
+    boost::shared_ptr<VesselSegment<DIM> > pSelf = boost::make_shared<VesselSegment<DIM> >(*pSegment);
 
     // Add the segment to the nodes
     pSelf->GetNode(0)->AddSegment(pSelf->shared_from_this());
@@ -93,6 +97,7 @@ boost::shared_ptr<VesselSegment<DIM> > VesselSegment<DIM>::Create(boost::shared_
 template<unsigned DIM>
 VesselSegment<DIM>::~VesselSegment()
 {
+    mNumberOfSegments--;
 }
 
 template<unsigned DIM>
@@ -184,6 +189,30 @@ std::pair<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM>
     return mNodes;
 }
 
+template<unsigned DIM>
+unsigned VesselSegment<DIM>::GetNodesVersion() const
+{
+    return mNodesVersion;
+}
+
+template<unsigned DIM>
+unsigned VesselSegment<DIM>::GetLatestNodesVersion()
+{
+    return mLatestNodesVersion;
+}
+
+template<unsigned DIM>
+bool VesselSegment<DIM>::GetReconnectedSegments(unsigned nodesVersion, std::vector<const VesselSegment<DIM>*>& rSegments)
+{
+    unsigned num_reconnections = mLatestNodesVersion - nodesVersion;
+    if(num_reconnections > mReconnectedSegments.size())
+    {
+        return false;
+    }
+    rSegments.assign(mReconnectedSegments.end() - num_reconnections, mReconnectedSegments.end());
+    return true;
+}
+
 template<unsigned DIM>
 DimensionalChastePoint<DIM> VesselSegment<DIM>::GetPointProjection(const  DimensionalChastePoint<DIM>& location, bool projectToEnds) const
 {
@@ -262,16 +291,24 @@ void VesselSegment<DIM>::ReplaceNode(unsigned oldNodeIndex, boost::shared_ptr<Ve
         EXCEPTION("A node index other than 0 or 1 has been requested for a Vessel Segment.");
     }
 
+    // Drop the older half of the reconnections once there are many more than segments, as for moved nodes
+    if(mReconnectedSegments.size() > 2*mNumberOfSegments + 1024)
+    {
+        mReconnectedSegments.erase(mReconnectedSegments.begin(), mReconnectedSegments.begin() + mReconnectedSegments.size()/2);
+    }
+    mReconnectedSegments.push_back(this);
+    mNodesVersion = ++mLatestNodesVersion;
+
     if (mVessel.lock() != NULL)
     {
-        mVessel.lock()->UpdateNodes();
+        mVessel.lock()->SetNodesOutOfDate();
     }
 }
 
 template<unsigned DIM>
 void VesselSegment<DIM>::SetFlowProperties(const SegmentFlowProperties<DIM> & rFlowProperties)
 {
-    this->mpFlowProperties = boost::shared_ptr<SegmentFlowProperties<DIM> >(new SegmentFlowProperties<DIM> (rFlowProperties));
+    *(this->mpFlowProperties) = rFlowProperties;
 }
 
 template<unsigned DIM>
@@ -281,6 +318,15 @@ boost::shared_ptr<VesselSegment<DIM> > VesselSegment<DIM>::Shared()
     return pSegment;
 }
 
+template<unsigned DIM>
+unsigned VesselSegment<DIM>::mLatestNodesVersion = 0;
+
+template<unsigned DIM>
+std::vector<const VesselSegment<DIM>*> VesselSegment<DIM>::mReconnectedSegments;
+
+template<unsigned DIM>
+unsigned VesselSegment<DIM>::mNumberOfSegments = 0;
+
 // Explicit instantiation
 template class VesselSegment<2>;
 template class VesselSegment<3>;
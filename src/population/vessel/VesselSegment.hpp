@@ -87,6 +87,28 @@ private:
      */
     boost::shared_ptr<SegmentFlowProperties<DIM> > mpFlowProperties;
 
+    /**
+     * A stamp which changes whenever a node of the segment is replaced, so that cached collections can tell which
+     * segments have been reconnected. Stamps are taken from a counter shared by all segments.
+     */
+    unsigned mNodesVersion;
+
+    /**
+     * The stamp given to the most recently reconnected segment.
+     */
+    static unsigned mLatestNodesVersion;
+
+    /**
+     * The most recently reconnected segments, one entry for each reconnection up to the latest stamp. The segments
+     * may since have been destroyed, so the entries are only compared with known segments.
+     */
+    static std::vector<const VesselSegment<DIM>*> mReconnectedSegments;
+
+    /**
+     * The number of segments in existence, which bounds the length of mReconnectedSegments.
+     */
+    static unsigned mNumberOfSegments;
+
     /**
      * Constructor - This is private as instances of this class must be created with a corresponding shared pointer. This is
      * implemented using the static Create method.
@@ -197,6 +219,31 @@ public:
      */
     std::pair<boost::shared_ptr<VesselNode<DIM> >, boost::shared_ptr<VesselNode<DIM> > > GetNodes() const;
 
+    /**
+     * Return a stamp which changes whenever a node of the segment is replaced
+     *
+     * @return the node stamp of the segment
+     */
+    unsigned GetNodesVersion() const;
+
+    /**
+     * Return the stamp given to the most recently reconnected segment, which changes whenever any segment is reconnected
+     *
+     * @return the latest node stamp
+     */
+    static unsigned GetLatestNodesVersion();
+
+    /**
+     * Get the segments reconnected since a node stamp was taken, once for each reconnection. The segments may since
+     * have been destroyed, so they should only be compared with known segments.
+     *
+     * @param nodesVersion the latest node stamp when reconnected segments were last looked for
+     * @param rSegments filled with the reconnected segments
+     * @return false if the reconnected segments no longer go back as far as the stamp, in which case any segment may
+     * have been reconnected
+     */
+    static bool GetReconnectedSegments(unsigned nodesVersion, std::vector<const VesselSegment<DIM>*>& rSegments);
+
     /**
      * Return the projection of a point onto the segment. If the projection is outside the segment an
      * Exception is thrown.
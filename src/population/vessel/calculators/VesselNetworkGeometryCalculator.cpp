@@ -64,7 +64,7 @@ std::vector<units::quantity<unit::length> > VesselNetworkGeometryCalculator<DIM>
         EXCEPTION("Vessel network not set in geometry calculator");
     }
 
-    std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = mpVesselNetwork->GetVessels();
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = mpVesselNetwork->rGetVessels();
     std::vector<units::quantity<unit::length> > distances;
     for(unsigned idx=0; idx<vessels.size(); idx++)
     {
@@ -93,7 +93,7 @@ units::quantity<unit::length> VesselNetworkGeometryCalculator<DIM>::GetTotalLeng
         EXCEPTION("Vessel network not set in geometry calculator");
     }
 
-    std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = mpVesselNetwork->GetVessels();
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = mpVesselNetwork->rGetVessels();
     units::quantity<unit::length>  length = 0.0* unit::metres;
     for(unsigned idx=0; idx<vessels.size(); idx++)
     {
@@ -111,7 +111,7 @@ units::quantity<unit::volume> VesselNetworkGeometryCalculator<DIM>::GetTotalVolu
     }
 
     units::quantity<unit::volume> volume = 0.0*units::pow<3>(unit::metres);
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = mpVesselNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = mpVesselNetwork->rGetVesselSegments();
     for(unsigned idx=0; idx< segments.size(); idx++)
     {
         volume += segments[idx]->GetLength() * segments[idx]->GetRadius() * segments[idx]->GetRadius() * M_PI;
@@ -128,7 +128,7 @@ units::quantity<unit::area> VesselNetworkGeometryCalculator<DIM>::GetTotalSurfac
     }
 
     units::quantity<unit::area> area = 0.0*units::pow<2>(unit::metres);
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = mpVesselNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = mpVesselNetwork->rGetVesselSegments();
     for(unsigned idx=0; idx< segments.size(); idx++)
     {
         area += segments[idx]->GetLength() * 2.0 * segments[idx]->GetRadius() * M_PI;
@@ -144,7 +144,7 @@ units::quantity<unit::length>  VesselNetworkGeometryCalculator<DIM>::GetAverageI
         EXCEPTION("Vessel network not set in geometry calculator");
     }
 
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = mpVesselNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = mpVesselNetwork->rGetVesselSegments();
 
     // store segment midpoints
     std::vector<DimensionalChastePoint<DIM> > midpoints(segments.size());
@@ -196,7 +196,7 @@ std::vector<unsigned> VesselNetworkGeometryCalculator<DIM>::GetVesselLengthDistr
     std::vector<unsigned> bins(numberOfBins, 0);
 
     // populate the bins
-    std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = mpVesselNetwork->GetVessels();
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = mpVesselNetwork->rGetVessels();
     for(unsigned idx=0; idx<vessels.size(); idx++)
     {
         unsigned bin_label = std::floor(vessels[idx]->GetLength() / (binSpacing*unit::metres));
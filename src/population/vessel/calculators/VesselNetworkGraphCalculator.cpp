@@ -95,8 +95,8 @@ std::vector<std::vector<unsigned> > VesselNetworkGraphCalculator<DIM>::GetNodeNo
 		EXCEPTION("Vessel network not set in graph calculator");
 	}
 
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = mpVesselNetwork->GetVesselEndNodes();
-    std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = mpVesselNetwork->GetVessels();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = mpVesselNetwork->rGetVesselEndNodes();
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = mpVesselNetwork->rGetVessels();
     std::vector<std::vector<unsigned> > node_vessel_connectivity = GetNodeVesselConnectivity();
 
     std::vector<std::vector<unsigned> > connectivity;
@@ -111,9 +111,7 @@ std::vector<std::vector<unsigned> > VesselNetworkGraphCalculator<DIM>::GetNodeNo
 
             // Get the node at the other end of the vessel
             boost::shared_ptr<VesselNode<DIM> > p_other_node = p_vessel->GetNodeAtOppositeEnd(p_node);
-            typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator node_iter = std::find(nodes.begin(), nodes.end(), p_other_node);
-            unsigned other_node_index = std::distance(nodes.begin(), node_iter);
-            node_indexes.push_back(other_node_index);
+            node_indexes.push_back(mpVesselNetwork->GetVesselEndNodeIndex(p_other_node));
         }
         connectivity.push_back(node_indexes);
     }
@@ -128,24 +126,16 @@ std::vector<std::vector<unsigned> > VesselNetworkGraphCalculator<DIM>::GetNodeVe
 		EXCEPTION("Vessel network not set in graph calculator");
 	}
 
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = mpVesselNetwork->GetVesselEndNodes();
-    std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = mpVesselNetwork->GetVessels();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = mpVesselNetwork->rGetVesselEndNodes();
     unsigned num_nodes = nodes.size();
     std::vector<std::vector<unsigned> > connectivity;
     for (unsigned node_index = 0; node_index < num_nodes; node_index++)
     {
-        boost::shared_ptr<VesselNode<DIM> > p_node = nodes[node_index];
+        std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = nodes[node_index]->GetSegments();
         std::vector<unsigned> vessel_indexes;
-
-        unsigned num_segments_on_node = p_node->GetNumberOfSegments();
-        for (unsigned segment_index = 0; segment_index < num_segments_on_node; segment_index++)
+        for (unsigned segment_index = 0; segment_index < segments.size(); segment_index++)
         {
-            boost::shared_ptr<Vessel<DIM> > p_vessel = p_node->GetSegments()[segment_index]->GetVessel();
-
-            typename std::vector<boost::shared_ptr<Vessel<DIM> > >::iterator vessel_iter =
-                    std::find(vessels.begin(), vessels.end(), p_vessel);
-            unsigned vessel_index = std::distance(vessels.begin(), vessel_iter);
-            vessel_indexes.push_back(vessel_index);
+            vessel_indexes.push_back(mpVesselNetwork->GetVesselIndex(segments[segment_index]->GetVessel()));
         }
         connectivity.push_back(vessel_indexes);
     }
@@ -174,8 +164,8 @@ bool VesselNetworkGraphCalculator<DIM>::IsConnected(boost::shared_ptr<VesselNode
         return true;
     }
 
-    boost::shared_ptr<Vessel<DIM> > p_source_vessel = pSourceNode->GetSegments()[0]->GetVessel();
-    boost::shared_ptr<Vessel<DIM> > p_query_vessel = pQueryNode->GetSegments()[0]->GetVessel();
+    boost::shared_ptr<Vessel<DIM> > p_source_vessel = pSourceNode->GetSegment(0)->GetVessel();
+    boost::shared_ptr<Vessel<DIM> > p_query_vessel = pQueryNode->GetSegment(0)->GetVessel();
 
     if (p_source_vessel == p_query_vessel || p_source_vessel->IsConnectedTo(p_query_vessel))
     {
@@ -183,8 +173,8 @@ bool VesselNetworkGraphCalculator<DIM>::IsConnected(boost::shared_ptr<VesselNode
     }
 
     // Assign the vessel nodes unique IDs
-    std::vector<boost::shared_ptr<VesselNode<DIM> > >  vessel_nodes = mpVesselNetwork->GetVesselEndNodes();
-    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator node_iter;
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& vessel_nodes = mpVesselNetwork->rGetVesselEndNodes();
+    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::const_iterator node_iter;
     unsigned counter = 0;
     for(node_iter = vessel_nodes.begin(); node_iter != vessel_nodes.end(); node_iter++)
     {
@@ -201,7 +191,7 @@ bool VesselNetworkGraphCalculator<DIM>::IsConnected(boost::shared_ptr<VesselNode
 
     Graph G;
 
-    std::vector<boost::shared_ptr<Vessel<DIM> > >  vessels = mpVesselNetwork->GetVessels();
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = mpVesselNetwork->rGetVessels();
     for (unsigned i = 0; i < vessels.size(); i++)
     {
         add_edge(vessels[i]->GetStartNode()->GetId(), vessels[i]->GetEndNode()->GetId(), G);
@@ -235,9 +225,9 @@ std::vector<bool > VesselNetworkGraphCalculator<DIM>::IsConnected(std::vector<bo
 	}
 
     // Assign the vessel nodes unique IDs
-    std::vector<boost::shared_ptr<VesselNode<DIM> > >  vessel_nodes = mpVesselNetwork->GetVesselEndNodes();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& vessel_nodes = mpVesselNetwork->rGetVesselEndNodes();
 
-    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator node_iter;
+    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::const_iterator node_iter;
     unsigned counter = 0;
     for(node_iter = vessel_nodes.begin(); node_iter != vessel_nodes.end(); node_iter++)
     {
@@ -251,7 +241,7 @@ std::vector<bool > VesselNetworkGraphCalculator<DIM>::IsConnected(std::vector<bo
 
     Graph G;
 
-    std::vector<boost::shared_ptr<Vessel<DIM> > >  vessels = mpVesselNetwork->GetVessels();
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = mpVesselNetwork->rGetVessels();
     for (unsigned i = 0; i < vessels.size(); i++)
     {
         add_edge(vessels[i]->GetStartNode()->GetId(), vessels[i]->GetEndNode()->GetId(), G);
@@ -267,7 +257,7 @@ std::vector<bool > VesselNetworkGraphCalculator<DIM>::IsConnected(std::vector<bo
         }
 
         boost::shared_ptr<VesselNode<DIM> > pSourceNode = sourceNodes[i];
-        boost::shared_ptr<Vessel<DIM> > p_source_vessel = pSourceNode->GetSegments()[0]->GetVessel();
+        boost::shared_ptr<Vessel<DIM> > p_source_vessel = pSourceNode->GetSegment(0)->GetVessel();
         boost::shared_ptr<VesselNode<DIM> > pEquivalentSourceNode = p_source_vessel->GetStartNode();
 
         // a vector to hold the discover time property for each vertex
@@ -293,7 +283,7 @@ std::vector<bool > VesselNetworkGraphCalculator<DIM>::IsConnected(std::vector<bo
                 continue;
             }
 
-            boost::shared_ptr<Vessel<DIM> > p_query_vessel = pQueryNode->GetSegments()[0]->GetVessel();
+            boost::shared_ptr<Vessel<DIM> > p_query_vessel = pQueryNode->GetSegment(0)->GetVessel();
             if (p_source_vessel == p_query_vessel || p_source_vessel->IsConnectedTo(p_query_vessel))
             {
                 connected[j] = true;
@@ -322,23 +312,23 @@ void VesselNetworkGraphCalculator<DIM>::WriteConnectivity(const std::string& out
 
     // construct graph representation of vessel network
     boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS> G;
-    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::iterator node_iterator;
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = mpVesselNetwork->GetVesselEndNodes();
+    typename std::vector<boost::shared_ptr<VesselNode<DIM> > >::const_iterator node_iterator;
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = mpVesselNetwork->rGetVesselEndNodes();
 
     for (node_iterator = nodes.begin(); node_iterator != nodes.end(); node_iterator++)
     {
-        if ((*node_iterator)->GetSegments().size() > 1)
+        if ((*node_iterator)->GetNumberOfSegments() > 1)
         {
-            for (unsigned j = 1; j < (*node_iterator)->GetSegments().size(); j++)
+            for (unsigned j = 1; j < (*node_iterator)->GetNumberOfSegments(); j++)
             {
-                add_edge(mpVesselNetwork->GetVesselIndex((*node_iterator)->GetSegments()[0]->GetVessel()),
-                         mpVesselNetwork->GetVesselIndex((*node_iterator)->GetSegments()[j]->GetVessel()), G);
+                add_edge(mpVesselNetwork->GetVesselIndex((*node_iterator)->GetSegment(0)->GetVessel()),
+                         mpVesselNetwork->GetVesselIndex((*node_iterator)->GetSegment(j)->GetVessel()), G);
             }
         }
     }
 
-    std::vector<boost::shared_ptr<Vessel<DIM> > >  vessels = mpVesselNetwork->GetVessels();
-    typename std::vector<boost::shared_ptr<Vessel<DIM> > >::iterator vessel_iterator;
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = mpVesselNetwork->rGetVessels();
+    typename std::vector<boost::shared_ptr<Vessel<DIM> > >::const_iterator vessel_iterator;
     for (vessel_iterator = vessels.begin(); vessel_iterator != vessels.end(); vessel_iterator++)
     {
         if ((*vessel_iterator)->GetStartNode()->GetNumberOfSegments() == 1 && (*vessel_iterator)->GetEndNode()->GetNumberOfSegments() == 1)
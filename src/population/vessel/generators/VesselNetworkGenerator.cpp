@@ -134,7 +134,7 @@ boost::shared_ptr<VesselNetwork<DIM> > VesselNetworkGenerator<DIM>::GenerateOval
     p_network->AddVessel(p_vessel_4);
     p_network->MergeCoincidentNodes(1.e-6);
 
-    p_network->SetSegmentProperties(p_vessel_1->GetSegments()[0]);
+    p_network->SetSegmentProperties(p_vessel_1->GetSegment(0));
     p_vessel_1->GetStartNode()->GetFlowProperties()->SetIsInputNode(true);
     p_vessel_4->GetEndNode()->GetFlowProperties()->SetIsOutputNode(true);
     return p_network;
@@ -855,6 +855,7 @@ void VesselNetworkGenerator<DIM>::MapToSphere(boost::shared_ptr<VesselNetwork<DI
                                               mReferenceLength);
         nodes[idx]->SetLocation(new_position);
     }
+    pInputUnit->UpdateAll();
 }
 
 template<unsigned DIM>
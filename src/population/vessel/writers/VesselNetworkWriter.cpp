@@ -51,6 +51,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 template <unsigned DIM>
 VesselNetworkWriter<DIM>::VesselNetworkWriter() :
     mpVesselNetwork(),
+    mpAttributeTable(VesselNetworkAttributeTable<DIM>::Create()),
     mpVtkVesselNetwork(vtkSmartPointer<vtkPolyData>::New()),
     mIsVtkNetworkUpToDate(false),
     mFilename(),
@@ -72,6 +73,19 @@ boost::shared_ptr<VesselNetworkWriter<DIM> > VesselNetworkWriter<DIM>::Create()
     return pSelf;
 }
 
+template <unsigned DIM>
+boost::shared_ptr<VesselNetworkAttributeTable<DIM> > VesselNetworkWriter<DIM>::GetAttributeTable()
+{
+    return mpAttributeTable;
+}
+
+template <unsigned DIM>
+void VesselNetworkWriter<DIM>::SetAttributeTable(boost::shared_ptr<VesselNetworkAttributeTable<DIM> > pTable)
+{
+    mpAttributeTable = pTable;
+    mIsVtkNetworkUpToDate = false;
+}
+
 template <unsigned DIM>
 void VesselNetworkWriter<DIM>::SetVesselNetwork(boost::shared_ptr<VesselNetwork<DIM> > pNetwork)
 {
@@ -102,38 +116,11 @@ vtkSmartPointer<vtkPolyData> VesselNetworkWriter<DIM>::GetOutput()
 
     if(mpVesselNetwork->GetNumberOfVessels()>0)
     {
-        // Set up the vessel data arrays.
-    	std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = mpVesselNetwork->GetVessels();
-        std::vector<vtkSmartPointer<vtkDoubleArray> > pVesselInfoVector;
-        std::map<std::string, double>::iterator vessel_map_iterator;
-        std::map<std::string, double> vessel_data_map = vessels[0]->GetOutputData();
-        for(vessel_map_iterator = vessel_data_map.begin(); vessel_map_iterator != vessel_data_map.end(); vessel_map_iterator++)
-        {
-            vtkSmartPointer<vtkDoubleArray> pVesselInfo = vtkSmartPointer<vtkDoubleArray>::New();
-            pVesselInfo->SetNumberOfComponents(1);
-            pVesselInfo->SetNumberOfTuples(vessels.size());
-            pVesselInfo->SetName((*vessel_map_iterator).first.c_str());
-            pVesselInfoVector.push_back(pVesselInfo);
-        }
-
-        // Set up node data arrays
-        std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = mpVesselNetwork->GetNodes();
-        std::vector<vtkSmartPointer<vtkDoubleArray> > pNodeInfoVector;
-        std::map<std::string, double>::iterator vtk_node_map_iterator;
-        std::map<std::string, double> vtk_node_map = vessels[0]->GetStartNode()->GetOutputData();
-        for(vtk_node_map_iterator = vtk_node_map.begin(); vtk_node_map_iterator != vtk_node_map.end(); vtk_node_map_iterator++)
-        {
-            vtkSmartPointer<vtkDoubleArray> pNodeInfo = vtkSmartPointer<vtkDoubleArray>::New();
-            pNodeInfo->SetNumberOfComponents(1);
-            pNodeInfo->SetNumberOfTuples(nodes.size());
-            pNodeInfo->SetName((*vtk_node_map_iterator).first.c_str());
-            pNodeInfoVector.push_back(pNodeInfo);
-        }
-
         // Create the geometric data
+        const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = mpVesselNetwork->rGetVessels();
+        const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = mpVesselNetwork->rGetNodes();
         vtkSmartPointer<vtkPoints> pPoints= vtkSmartPointer<vtkPoints>::New();
         vtkSmartPointer<vtkCellArray> pLines = vtkSmartPointer<vtkCellArray>::New();
-        unsigned vessel_index=0;
         for(unsigned idx=0; idx<nodes.size(); idx++)
         {
             nodes[idx]->SetId(idx);
@@ -150,17 +137,6 @@ vtkSmartPointer<vtkPolyData> VesselNetworkWriter<DIM>::GetOutput()
                                          nodes[idx]->rGetLocation()[1]*scale_factor,
                                          nodes[idx]->rGetLocation()[2]*scale_factor);
             }
-
-            std::map<std::string, double> vtk_node_data = nodes[idx]->GetOutputData();
-            for(unsigned jdx=0; jdx < pNodeInfoVector.size(); jdx++)
-            {
-                std::string key = pNodeInfoVector[jdx]->GetName();
-                // check if the key exists in the data map, if yes populate the vtk node data array
-                if(vtk_node_data.count(key) == 1)
-                {
-                    pNodeInfoVector[jdx]->SetValue(idx, vtk_node_data[key]);
-                }
-            }
         }
 
         // Create the vessels
@@ -180,31 +156,42 @@ vtkSmartPointer<vtkPolyData> VesselNetworkWriter<DIM>::GetOutput()
                 }
             }
             pLines->InsertNextCell(pLine);
-
-            // Add the vessel data
-            std::map<std::string, double> vtk_vessel_data = (*it)->GetOutputData();
-            for(unsigned idx=0; idx < pVesselInfoVector.size(); idx++)
-            {
-                std::string key = pVesselInfoVector[idx]->GetName();
-                // If the key is in the vtk data use it
-                if(vtk_vessel_data.count(key) == 1)
-                {
-                    pVesselInfoVector[idx]->SetValue(vessel_index, vtk_vessel_data[key]);
-                }
-            }
-            vessel_index++;
         }
         mpVtkVesselNetwork->SetPoints(pPoints);
         mpVtkVesselNetwork->SetLines(pLines);
 
-        for (unsigned i = 0; i < pVesselInfoVector.size(); i++)
+        // Add the node and vessel data, after the node ids have been set
+        mpAttributeTable->SetVesselNetwork(mpVesselNetwork);
+        mpAttributeTable->Update();
+
+        const std::vector<std::string>& r_vessel_names = mpAttributeTable->rGetVesselAttributeNames();
+        for(unsigned idx=0; idx<r_vessel_names.size(); idx++)
         {
-        	mpVtkVesselNetwork->GetCellData()->AddArray(pVesselInfoVector[i]);
+            const std::vector<double>& r_values = mpAttributeTable->rGetVesselAttribute(idx);
+            vtkSmartPointer<vtkDoubleArray> pVesselInfo = vtkSmartPointer<vtkDoubleArray>::New();
+            pVesselInfo->SetNumberOfComponents(1);
+            pVesselInfo->SetNumberOfTuples(r_values.size());
+            pVesselInfo->SetName(r_vessel_names[idx].c_str());
+            for(unsigned jdx=0; jdx<r_values.size(); jdx++)
+            {
+                pVesselInfo->SetValue(jdx, r_values[jdx]);
+            }
+            mpVtkVesselNetwork->GetCellData()->AddArray(pVesselInfo);
         }
 
-        for (unsigned i = 0; i < pNodeInfoVector.size(); i++)
+        const std::vector<std::string>& r_node_names = mpAttributeTable->rGetNodeAttributeNames();
+        for(unsigned idx=0; idx<r_node_names.size(); idx++)
         {
-        	mpVtkVesselNetwork->GetPointData()->AddArray(pNodeInfoVector[i]);
+            const std::vector<double>& r_values = mpAttributeTable->rGetNodeAttribute(idx);
+            vtkSmartPointer<vtkDoubleArray> pNodeInfo = vtkSmartPointer<vtkDoubleArray>::New();
+            pNodeInfo->SetNumberOfComponents(1);
+            pNodeInfo->SetNumberOfTuples(r_values.size());
+            pNodeInfo->SetName(r_node_names[idx].c_str());
+            for(unsigned jdx=0; jdx<r_values.size(); jdx++)
+            {
+                pNodeInfo->SetValue(jdx, r_values[jdx]);
+            }
+            mpVtkVesselNetwork->GetPointData()->AddArray(pNodeInfo);
         }
     }
     mIsVtkNetworkUpToDate = true;
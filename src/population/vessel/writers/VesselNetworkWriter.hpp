@@ -43,6 +43,7 @@ Copyright (c) 2005-2016, University of Oxford.
 #include <vtkSmartPointer.h>
 #endif // CHASTE_VTK
 #include "VesselNetwork.hpp"
+#include "VesselNetworkAttributeTable.hpp"
 
 /**
  * This class converts a vessel network to a vtk polydata representation, which can be return or written to file.
@@ -58,6 +59,11 @@ private:
      */
     boost::shared_ptr<VesselNetwork<DIM> > mpVesselNetwork;
 
+    /**
+     * The node and vessel data to write
+     */
+    boost::shared_ptr<VesselNetworkAttributeTable<DIM> > mpAttributeTable;
+
     /**
      * A vtk representation of the network
      */
@@ -96,6 +102,19 @@ public:
      */
     ~VesselNetworkWriter();
 
+    /**
+     * Return the attribute table written with the network. User attributes added to it are written as extra
+     * node and vessel data arrays.
+     * @return the attribute table
+     */
+    boost::shared_ptr<VesselNetworkAttributeTable<DIM> > GetAttributeTable();
+
+    /**
+     * Set the attribute table written with the network
+     * @param pTable the attribute table
+     */
+    void SetAttributeTable(boost::shared_ptr<VesselNetworkAttributeTable<DIM> > pTable);
+
     /**
      * Set the vessel network
      * @param pNetwork the vessel network
@@ -39,6 +39,7 @@ Copyright (c) 2005-2016, University of Oxford.
 #include "VesselNode.hpp"
 #include "MicrovesselSolver.hpp"
 #include "VesselNetworkWriter.hpp"
+#include "VesselNetworkBatch.hpp"
 #include "SolutionDependentDiscreteSource.hpp"
 
 template<unsigned DIM>
@@ -150,6 +151,9 @@ void MicrovesselSolver<DIM>::Increment()
         }
     }
 
+    // Angiogenesis and regression changes are batched so the network is fully updated once per step
+    VesselNetworkBatch<DIM> batch(mpNetwork);
+
     // Do angiogenesis if the is a network and solver
     if(this->mpNetwork && mpAngiogenesisSolver)
     {
@@ -161,11 +165,11 @@ void MicrovesselSolver<DIM>::Increment()
     {
         mpRegressionSolver->Increment();
     }
+    batch.Commit();
 
     // Manage vessel network output
     if (this->mpNetwork)
     {
-        mpNetwork->UpdateAll();
         if (mOutputFrequency > 0 && num_steps % mOutputFrequency == 0)
         {
             boost::shared_ptr<VesselNetworkWriter<DIM> > p_network_writer = VesselNetworkWriter<DIM>::Create();
@@ -43,6 +43,7 @@
 #include "StalkCellMutationState.hpp"
 #include "TipCellMutationState.hpp"
 #include "VesselNetworkWriter.hpp"
+#include "VesselNetworkBatch.hpp"
 
 template<unsigned DIM>
 AngiogenesisSolver<DIM>::AngiogenesisSolver() :
@@ -131,7 +132,7 @@ template<unsigned DIM>
 void AngiogenesisSolver<DIM>::DoSprouting()
 {
     // Get the candidate sprouts and set them as migrating
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > candidate_sprouts = mpSproutingRule->GetSprouts(mpNetwork->GetNodes());
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > candidate_sprouts = mpSproutingRule->GetSprouts(mpNetwork->rGetNodes());
     for (unsigned idx = 0; idx < candidate_sprouts.size(); idx++)
     {
         candidate_sprouts[idx]->SetIsMigrating(true);
@@ -144,7 +145,7 @@ template<unsigned DIM>
 void AngiogenesisSolver<DIM>::UpdateNodalPositions(bool sprouting)
 {
     // Move any nodes marked as migrating, either new sprouts or tips
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = mpNetwork->GetNodes();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = mpNetwork->rGetNodes();
     std::vector<boost::shared_ptr<VesselNode<DIM> > > tips;
     for (unsigned idx = 0; idx < nodes.size(); idx++)
     {
@@ -184,7 +185,6 @@ void AngiogenesisSolver<DIM>::UpdateNodalPositions(bool sprouting)
                 {
                     mpNetwork->FormSprout(tips[idx]->rGetLocation(), mpVesselGrid->GetLocationOf1dIndex(indices[idx]));
                     tips[idx]->SetIsMigrating(false);
-                    mpNetwork->UpdateAll();
                 }
                 else
                 {
@@ -193,7 +193,6 @@ void AngiogenesisSolver<DIM>::UpdateNodalPositions(bool sprouting)
                     mpNetwork->ExtendVessel(tips[idx]->GetSegment(0)->GetVessel(), tips[idx], p_new_node);
                     tips[idx]->SetIsMigrating(false);
                     p_new_node->SetIsMigrating(true);
-                    mpNetwork->UpdateAll();
                 }
             }
             else
@@ -236,7 +235,6 @@ void AngiogenesisSolver<DIM>::UpdateNodalPositions(bool sprouting)
                     if (sprouting)
                     {
                         mpNetwork->FormSprout(tips[idx]->rGetLocation(), candidate_tip_locations[idx]);
-                        mpNetwork->UpdateAll();
                         tips[idx]->SetIsMigrating(false);
                     }
                     else
@@ -279,7 +277,7 @@ void AngiogenesisSolver<DIM>::DoAnastamosis()
         {
             if (mpVesselGrid)
             {
-                std::vector<std::vector<boost::shared_ptr<VesselNode<DIM> > > > point_node_map =
+                const std::vector<std::vector<boost::shared_ptr<VesselNode<DIM> > > >& point_node_map =
                         mpVesselGrid->GetPointNodeMap();
                 unsigned grid_index = mpVesselGrid->GetNearestGridIndex(nodes[idx]->rGetLocation());
 
@@ -397,6 +395,9 @@ void AngiogenesisSolver<DIM>::Increment()
         }
     }
 
+    // Batch the network changes so it is only fully updated once the tips have moved, sprouted and merged
+    VesselNetworkBatch<DIM> batch(mpNetwork);
+
     // Move any migrating nodes
     UpdateNodalPositions();
 
@@ -409,6 +410,7 @@ void AngiogenesisSolver<DIM>::Increment()
         DoSprouting();
         DoAnastamosis();
     }
+    batch.Commit();
 
     // If there is a cell population, update it.
     if (mpCellPopulation)
@@ -428,7 +430,7 @@ void AngiogenesisSolver<DIM>::Increment()
         }
 
         // Then create new tip cells corresponding to vessel tips
-        std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = mpNetwork->GetNodes();
+        const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = mpNetwork->rGetNodes();
         for (unsigned idx = 0; idx < nodes.size(); idx++)
         {
             if (nodes[idx]->IsMigrating())
@@ -153,7 +153,7 @@ std::vector<int> LatticeBasedMigrationRule<DIM>::GetIndices(const std::vector<bo
     std::vector<int> indices(rNodes.size(), -1);
 
     // Get the point-node map from the regular grid
-    std::vector<std::vector<boost::shared_ptr<VesselNode<DIM> > > > point_node_map = this->mpGrid->GetPointNodeMap();
+    const std::vector<std::vector<boost::shared_ptr<VesselNode<DIM> > > >& point_node_map = this->mpGrid->GetPointNodeMap();
 
     // Get the neighbour data from the regular grid
     std::vector<std::vector<unsigned> > neighbour_indices = this->mpGrid->GetNeighbourData();
@@ -143,7 +143,7 @@ std::vector<c_vector<double, DIM> > OffLatticeMigrationRule<DIM>::GetDirections(
                 angle_z = RandomNumberGenerator::Instance()->NormalRandomDeviate(mMeanAngles[2], mSdvAngles[2]);
             }
             c_vector<double, DIM> currentDirection  =
-                    -rNodes[idx]->GetSegments()[0]->GetOppositeNode(rNodes[idx])->rGetLocation().rGetLocation() + rNodes[idx]->rGetLocation().rGetLocation();
+                    -rNodes[idx]->GetSegment(0)->GetOppositeNode(rNodes[idx])->rGetLocation().rGetLocation() + rNodes[idx]->rGetLocation().rGetLocation();
             currentDirection /= norm_2(currentDirection);
 
             c_vector<double, DIM> new_direction_z = RotateAboutAxis<DIM>(currentDirection, mGlobalZ, angle_z);
@@ -206,7 +206,7 @@ std::vector<c_vector<double, DIM> > OffLatticeMigrationRule<DIM>::GetDirections(
             new_direction /= norm_2(new_direction);
 
             // Get the closest node in the search cone
-            std::vector<boost::shared_ptr<VesselNode<DIM> > > nodes = this->mpVesselNetwork->GetNodes();
+            const std::vector<boost::shared_ptr<VesselNode<DIM> > >& nodes = this->mpVesselNetwork->rGetNodes();
 
             double min_distance = 1.e12;
             c_vector<double, DIM> min_direction = zero_vector<double>(DIM);
@@ -249,8 +249,8 @@ std::vector<c_vector<double, DIM> > OffLatticeMigrationRule<DIM>::GetDirectionsF
     for(unsigned idx = 0; idx < rNodes.size(); idx++)
     {
         c_vector<double, DIM> sprout_direction;
-        c_vector<double, DIM> cross_product = VectorProduct(rNodes[idx]->GetSegments()[0]->GetUnitTangent(),
-                                                            rNodes[idx]->GetSegments()[1]->GetUnitTangent());
+        c_vector<double, DIM> cross_product = VectorProduct(rNodes[idx]->GetSegment(0)->GetUnitTangent(),
+                                                            rNodes[idx]->GetSegment(1)->GetUnitTangent());
 
         double sum = 0.0;
         for(unsigned jdx=0; jdx<DIM; jdx++)
@@ -261,7 +261,7 @@ std::vector<c_vector<double, DIM> > OffLatticeMigrationRule<DIM>::GetDirectionsF
         {
             // more or less parallel segments, chose any normal to the first tangent
             c_vector<double, DIM> normal;
-            c_vector<double, DIM> tangent = rNodes[idx]->GetSegments()[0]->GetUnitTangent();
+            c_vector<double, DIM> tangent = rNodes[idx]->GetSegment(0)->GetUnitTangent();
             if(DIM==2 or tangent[2]==0.0)
             {
                 if(tangent[1] == 0.0)
@@ -312,7 +312,7 @@ std::vector<c_vector<double, DIM> > OffLatticeMigrationRule<DIM>::GetDirectionsF
         }
 
         double angle = RandomNumberGenerator::Instance()->NormalRandomDeviate(mMeanAngles[0], mSdvAngles[0]);
-        c_vector<double, DIM> new_direction = RotateAboutAxis<DIM>(sprout_direction, rNodes[idx]->GetSegments()[0]->GetUnitTangent(), angle);
+        c_vector<double, DIM> new_direction = RotateAboutAxis<DIM>(sprout_direction, rNodes[idx]->GetSegment(0)->GetUnitTangent(), angle);
         new_direction /= norm_2(new_direction);
         movement_vectors[idx] = new_direction * double(mVelocity * (BaseUnits::Instance()->GetReferenceTimeScale()/BaseUnits::Instance()->GetReferenceLengthScale()));
     }
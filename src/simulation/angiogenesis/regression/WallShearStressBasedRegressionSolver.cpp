@@ -35,6 +35,7 @@ Copyright (c) 2005-2016, University of Oxford.
 
 #include "WallShearStressBasedRegressionSolver.hpp"
 #include "Owen11Parameters.hpp"
+#include "VesselNetworkBatch.hpp"
 #include <vector>
 
 template<unsigned DIM>
@@ -99,13 +100,17 @@ void WallShearStressBasedRegressionSolver<DIM>::Increment()
     }
 
     // iterate through all vessels and if regression flag is true then remove from the network
+    VesselNetworkBatch<DIM> batch(this->mpNetwork);
+    std::set<boost::shared_ptr<Vessel<DIM> > > regressed_vessels;
     for(unsigned idx=0;idx<vessels.size(); idx++)
     {
         if (vessels[idx]->GetFlowProperties()->HasVesselRegressed(this->mReferenceTime))
         {
-            this->mpNetwork->RemoveVessel(vessels[idx], true);
+            regressed_vessels.insert(vessels[idx]);
         }
     }
+    this->mpNetwork->RemoveVessels(regressed_vessels, true);
+    batch.Commit();
 }
 
 // Explicit instantiation
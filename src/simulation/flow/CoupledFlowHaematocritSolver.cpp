@@ -0,0 +1,297 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include "Exception.hpp"
+#include "VesselSegment.hpp"
+#include "ViscosityCalculator.hpp"
+#include "VesselImpedanceCalculator.hpp"
+#include "TopologicalHaematocritSolver.hpp"
+#include "SmallDenseLinearSolver.hpp"
+#include "CoupledFlowHaematocritSolver.hpp"
+
+template<unsigned DIM>
+CoupledFlowHaematocritSolver<DIM>::CoupledFlowHaematocritSolver()
+    :   mpVesselNetwork(),
+        mpFlowSolver(FlowSolver<DIM>::Create()),
+        mpHaematocritSolver(TopologicalHaematocritSolver<DIM>::Create()),
+        mpViscosityCalculator(ViscosityCalculator<DIM>::Create()),
+        mpImpedanceCalculator(VesselImpedanceCalculator<DIM>::Create()),
+        mTolerance(1.e-6),
+        mMaxIterations(1000),
+        mAccelerationDepth(5),
+        mResiduals()
+{
+
+}
+
+template<unsigned DIM>
+CoupledFlowHaematocritSolver<DIM>::~CoupledFlowHaematocritSolver()
+{
+
+}
+
+template <unsigned DIM>
+boost::shared_ptr<CoupledFlowHaematocritSolver<DIM> > CoupledFlowHaematocritSolver<DIM>::Create()
+{
+    MAKE_PTR(CoupledFlowHaematocritSolver<DIM>, pSelf);
+    return pSelf;
+}
+
+template<unsigned DIM>
+boost::shared_ptr<FlowSolver<DIM> > CoupledFlowHaematocritSolver<DIM>::GetFlowSolver()
+{
+    return mpFlowSolver;
+}
+
+template<unsigned DIM>
+unsigned CoupledFlowHaematocritSolver<DIM>::GetNumberOfIterations() const
+{
+    return mResiduals.size();
+}
+
+template<unsigned DIM>
+const std::vector<double>& CoupledFlowHaematocritSolver<DIM>::rGetResiduals() const
+{
+    return mResiduals;
+}
+
+template<unsigned DIM>
+void CoupledFlowHaematocritSolver<DIM>::SetAccelerationDepth(unsigned accelerationDepth)
+{
+    mAccelerationDepth = accelerationDepth;
+}
+
+template<unsigned DIM>
+void CoupledFlowHaematocritSolver<DIM>::SetFlowSolver(boost::shared_ptr<FlowSolver<DIM> > pSolver)
+{
+    mpFlowSolver = pSolver;
+}
+
+template<unsigned DIM>
+void CoupledFlowHaematocritSolver<DIM>::SetHaematocritSolver(boost::shared_ptr<AbstractHaematocritSolver<DIM> > pSolver)
+{
+    mpHaematocritSolver = pSolver;
+}
+
+template<unsigned DIM>
+void CoupledFlowHaematocritSolver<DIM>::SetImpedanceCalculator(boost::shared_ptr<AbstractVesselNetworkCalculator<DIM> > pCalculator)
+{
+    mpImpedanceCalculator = pCalculator;
+}
+
+template<unsigned DIM>
+void CoupledFlowHaematocritSolver<DIM>::SetMaxIterations(unsigned maxIterations)
+{
+    mMaxIterations = maxIterations;
+}
+
+template<unsigned DIM>
+void CoupledFlowHaematocritSolver<DIM>::SetTolerance(double tolerance)
+{
+    mTolerance = tolerance;
+}
+
+template<unsigned DIM>
+void CoupledFlowHaematocritSolver<DIM>::SetVesselNetwork(boost::shared_ptr<VesselNetwork<DIM> > pNetwork)
+{
+    mpVesselNetwork = pNetwork;
+}
+
+template<unsigned DIM>
+void CoupledFlowHaematocritSolver<DIM>::SetViscosityCalculator(boost::shared_ptr<AbstractVesselNetworkCalculator<DIM> > pCalculator)
+{
+    mpViscosityCalculator = pCalculator;
+}
+
+template<unsigned DIM>
+void CoupledFlowHaematocritSolver<DIM>::GetAcceleratedHaematocrits(const std::vector<std::vector<double> >& rResidualChanges,
+        const std::vector<std::vector<double> >& rUpdateChanges, const std::vector<double>& rResidual,
+        const std::vector<double>& rUpdate, std::vector<double>& rHaematocrits)
+{
+    // Find the combination of previous residual changes closest to the current residual from the normal
+    // equations, then take the same combination of the update changes off the current update
+    unsigned depth = rResidualChanges.size();
+    std::vector<std::vector<double> > normal_matrix(depth, std::vector<double>(depth + 1, 0.0));
+    for (unsigned row = 0; row < depth; row++)
+    {
+        for (unsigned col = 0; col < depth; col++)
+        {
+            for (unsigned idx = 0; idx < rResidual.size(); idx++)
+            {
+                normal_matrix[row][col] += rResidualChanges[row][idx] * rResidualChanges[col][idx];
+            }
+        }
+        for (unsigned idx = 0; idx < rResidual.size(); idx++)
+        {
+            normal_matrix[row][depth] += rResidualChanges[row][idx] * rResidual[idx];
+        }
+    }
+
+    // A Picard step is taken if the changes are close to linearly dependent
+    rHaematocrits = rUpdate;
+    std::vector<double> weights;
+    if (!SmallDenseLinearSolver::Solve(normal_matrix, weights))
+    {
+        return;
+    }
+
+    for (unsigned idx = 0; idx < rUpdate.size(); idx++)
+    {
+        double haematocrit = rUpdate[idx];
+        for (unsigned jdx = 0; jdx < depth; jdx++)
+        {
+            haematocrit -= weights[jdx] * rUpdateChanges[jdx][idx];
+        }
+
+        // Keep the Picard value where the extrapolation leaves the physical range
+        if (haematocrit >= 0.0 and haematocrit < 1.0)
+        {
+            rHaematocrits[idx] = haematocrit;
+        }
+    }
+}
+
+template<unsigned DIM>
+void CoupledFlowHaematocritSolver<DIM>::Solve()
+{
+    if(!mpVesselNetwork)
+    {
+        EXCEPTION("A vessel network is required before calling Solve");
+    }
+    if(!mpFlowSolver or !mpHaematocritSolver)
+    {
+        EXCEPTION("A flow solver and a haematocrit solver are required before calling Solve");
+    }
+
+    mpFlowSolver->SetVesselNetwork(mpVesselNetwork);
+    mpHaematocritSolver->SetVesselNetwork(mpVesselNetwork);
+    if(mpViscosityCalculator)
+    {
+        mpViscosityCalculator->SetVesselNetwork(mpVesselNetwork);
+    }
+    if(mpImpedanceCalculator)
+    {
+        mpImpedanceCalculator->SetVesselNetwork(mpVesselNetwork);
+    }
+
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& r_segments = mpVesselNetwork->rGetVesselSegments();
+    unsigned num_segments = r_segments.size();
+    std::vector<double> haematocrits(num_segments);
+    for (unsigned idx = 0; idx < num_segments; idx++)
+    {
+        haematocrits[idx] = r_segments[idx]->GetFlowProperties()->GetHaematocrit();
+    }
+
+    mResiduals.clear();
+    std::vector<double> update(num_segments);
+    std::vector<double> residual(num_segments);
+    std::vector<double> previous_update;
+    std::vector<double> previous_residual;
+    std::vector<std::vector<double> > update_changes;
+    std::vector<std::vector<double> > residual_changes;
+    while (true)
+    {
+        // One Picard step: viscosity, impedance, flow and then haematocrit
+        for (unsigned idx = 0; idx < num_segments; idx++)
+        {
+            r_segments[idx]->GetFlowProperties()->SetHaematocrit(haematocrits[idx]);
+        }
+        if(mpViscosityCalculator)
+        {
+            mpViscosityCalculator->Calculate();
+        }
+        if(mpImpedanceCalculator)
+        {
+            mpImpedanceCalculator->Calculate();
+        }
+        mpFlowSolver->Update();
+        mpFlowSolver->Solve();
+        mpHaematocritSolver->Calculate();
+
+        double max_residual = 0.0;
+        for (unsigned idx = 0; idx < num_segments; idx++)
+        {
+            update[idx] = r_segments[idx]->GetFlowProperties()->GetHaematocrit();
+            residual[idx] = update[idx] - haematocrits[idx];
+            max_residual = std::max(max_residual, std::fabs(residual[idx]));
+        }
+        mResiduals.push_back(max_residual);
+        if (max_residual <= mTolerance)
+        {
+            break;
+        }
+        if (mResiduals.size() >= mMaxIterations)
+        {
+            EXCEPTION("Coupled flow and haematocrit calculation failed to converge.");
+        }
+
+        // Store the changes since the previous iteration, keeping the most recent ones
+        if (mAccelerationDepth > 0 and !previous_update.empty())
+        {
+            std::vector<double> update_change(num_segments);
+            std::vector<double> residual_change(num_segments);
+            for (unsigned idx = 0; idx < num_segments; idx++)
+            {
+                update_change[idx] = update[idx] - previous_update[idx];
+                residual_change[idx] = residual[idx] - previous_residual[idx];
+            }
+            update_changes.push_back(update_change);
+            residual_changes.push_back(residual_change);
+            if (update_changes.size() > mAccelerationDepth)
+            {
+                update_changes.erase(update_changes.begin());
+                residual_changes.erase(residual_changes.begin());
+            }
+        }
+        previous_update = update;
+        previous_residual = residual;
+
+        if (residual_changes.empty())
+        {
+            haematocrits = update;
+        }
+        else
+        {
+            GetAcceleratedHaematocrits(residual_changes, update_changes, residual, update, haematocrits);
+        }
+    }
+}
+
+// Explicit instantiation
+template class CoupledFlowHaematocritSolver<2> ;
+template class CoupledFlowHaematocritSolver<3> ;
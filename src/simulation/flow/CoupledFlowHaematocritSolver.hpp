@@ -0,0 +1,207 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef COUPLEDFLOWHAEMATOCRITSOLVER_HPP_
+#define COUPLEDFLOWHAEMATOCRITSOLVER_HPP_
+
+#include <vector>
+#include "SmartPointers.hpp"
+#include "VesselNetwork.hpp"
+#include "FlowSolver.hpp"
+#include "AbstractHaematocritSolver.hpp"
+#include "AbstractVesselNetworkCalculator.hpp"
+
+/**
+ * This solver finds flow rates and haematocrits that are consistent with each other when the blood viscosity,
+ * and so the vessel impedances, depend on haematocrit. Each iteration updates the viscosity and impedance of
+ * each vessel from the current haematocrits, solves for the flow and then calculates new haematocrits. Rather
+ * than using the new haematocrits directly, as in a Picard iteration, the next iterate is found by Anderson
+ * acceleration over the last few iterations, which usually converges in far fewer iterations.
+ */
+template<unsigned DIM>
+class CoupledFlowHaematocritSolver
+{
+
+private:
+
+    /**
+     * The vessel network
+     */
+    boost::shared_ptr<VesselNetwork<DIM> > mpVesselNetwork;
+
+    /**
+     * The flow solver
+     */
+    boost::shared_ptr<FlowSolver<DIM> > mpFlowSolver;
+
+    /**
+     * The haematocrit solver
+     */
+    boost::shared_ptr<AbstractHaematocritSolver<DIM> > mpHaematocritSolver;
+
+    /**
+     * Calculates the viscosity of each vessel from its haematocrit
+     */
+    boost::shared_ptr<AbstractVesselNetworkCalculator<DIM> > mpViscosityCalculator;
+
+    /**
+     * Calculates the impedance of each vessel from its viscosity
+     */
+    boost::shared_ptr<AbstractVesselNetworkCalculator<DIM> > mpImpedanceCalculator;
+
+    /**
+     * The tolerance on the maximum change in haematocrit between iterations
+     */
+    double mTolerance;
+
+    /**
+     * The maximum number of iterations
+     */
+    unsigned mMaxIterations;
+
+    /**
+     * The number of previous iterations used in Anderson acceleration, 0 for a Picard iteration
+     */
+    unsigned mAccelerationDepth;
+
+    /**
+     * The residual, the maximum change in haematocrit, in each iteration of the last solve
+     */
+    std::vector<double> mResiduals;
+
+    /**
+     * Get the next haematocrits from the Anderson acceleration least squares problem. Falls back to a
+     * Picard step if the problem is singular.
+     * @param rResidualChanges the changes in the residual over the stored iterations
+     * @param rUpdateChanges the changes in the calculated haematocrits over the stored iterations
+     * @param rResidual the current residual
+     * @param rUpdate the current calculated haematocrits
+     * @param rHaematocrits the next haematocrits
+     */
+    void GetAcceleratedHaematocrits(const std::vector<std::vector<double> >& rResidualChanges,
+            const std::vector<std::vector<double> >& rUpdateChanges, const std::vector<double>& rResidual,
+            const std::vector<double>& rUpdate, std::vector<double>& rHaematocrits);
+
+public:
+
+    /**
+     * Constructor.
+     */
+    CoupledFlowHaematocritSolver();
+
+    /**
+     * Destructor.
+     */
+    ~CoupledFlowHaematocritSolver();
+
+    /**
+     * Factor constructor. Construct a new instance of the class and return a shared pointer to it.
+     * @return a pointer to a new instance of the class.
+     */
+    static boost::shared_ptr<CoupledFlowHaematocritSolver<DIM> > Create();
+
+    /**
+     * @return the flow solver
+     */
+    boost::shared_ptr<FlowSolver<DIM> > GetFlowSolver();
+
+    /**
+     * @return the number of iterations in the last solve
+     */
+    unsigned GetNumberOfIterations() const;
+
+    /**
+     * @return the residual, the maximum change in haematocrit, in each iteration of the last solve
+     */
+    const std::vector<double>& rGetResiduals() const;
+
+    /**
+     * Set the number of previous iterations used in Anderson acceleration, default 5. A value of 0 gives
+     * a Picard iteration.
+     * @param accelerationDepth the number of previous iterations
+     */
+    void SetAccelerationDepth(unsigned accelerationDepth);
+
+    /**
+     * Set the flow solver
+     * @param pSolver the flow solver
+     */
+    void SetFlowSolver(boost::shared_ptr<FlowSolver<DIM> > pSolver);
+
+    /**
+     * Set the haematocrit solver, default a TopologicalHaematocritSolver
+     * @param pSolver the haematocrit solver
+     */
+    void SetHaematocritSolver(boost::shared_ptr<AbstractHaematocritSolver<DIM> > pSolver);
+
+    /**
+     * Set the impedance calculator, default a VesselImpedanceCalculator
+     * @param pCalculator the impedance calculator
+     */
+    void SetImpedanceCalculator(boost::shared_ptr<AbstractVesselNetworkCalculator<DIM> > pCalculator);
+
+    /**
+     * Set the maximum number of iterations, default 1000
+     * @param maxIterations the maximum number of iterations
+     */
+    void SetMaxIterations(unsigned maxIterations);
+
+    /**
+     * Set the tolerance on the maximum change in haematocrit between iterations, default 1e-6
+     * @param tolerance the tolerance
+     */
+    void SetTolerance(double tolerance);
+
+    /**
+     * Set the vessel network
+     * @param pNetwork the vessel network
+     */
+    void SetVesselNetwork(boost::shared_ptr<VesselNetwork<DIM> > pNetwork);
+
+    /**
+     * Set the viscosity calculator, default a ViscosityCalculator
+     * @param pCalculator the viscosity calculator
+     */
+    void SetViscosityCalculator(boost::shared_ptr<AbstractVesselNetworkCalculator<DIM> > pCalculator);
+
+    /**
+     * Iterate until the haematocrits stop changing and update the flow, pressure, viscosity and haematocrit
+     * data in the network
+     */
+    void Solve();
+};
+
+#endif /* COUPLEDFLOWHAEMATOCRITSOLVER_HPP_ */
@@ -34,25 +34,60 @@
  */
 
 #include <algorithm>
+#include <climits>
+#include <cmath>
 #include "Exception.hpp"
 #include "ReplicatableVector.hpp"
 #include "PetscTools.hpp"
 #include "VesselSegment.hpp"
 #include "FlowSolver.hpp"
+#include "SmallDenseLinearSolver.hpp"
 #include "UnitCollection.hpp"
-#include "VesselNetworkGraphCalculator.hpp"
 
 template<unsigned DIM>
 FlowSolver<DIM>::FlowSolver()
-    :   mNodes(),
-        mVessels(),
-        mpVesselNetwork(),
-        mNodeVesselConnectivity(),
-        mNodeNodeConnectivity(),
+    :   mpVesselNetwork(),
+        mpSnapshot(VesselNetworkSnapshot<DIM>::Create()),
         mBoundaryConditionNodeIndices(),
-        mUnconnectedNodeIndices(),
+        mIsFixedPressureNode(),
+        mVesselEdges(),
+        mNumberOfEdges(0),
+        mEliminatedNodes(),
+        mEliminationNeighbours(),
+        mEliminationEdges(),
+        mEliminationWeights(),
+        mEdgeConductances(),
+        mSystemNodes(),
+        mNodeRows(),
+        mRowOffsets(),
+        mColumnIndices(),
+        mEntryEdges(),
+        mFixedNeighbourOffsets(),
+        mFixedNeighbours(),
+        mFixedNeighbourEdges(),
+        mMatrixValues(),
+        mIsVelocityBoundaryNode(),
+        mSystemEdges(),
+        mSystemEdgeRows(),
+        mFactorisedNodes(),
+        mFactorisedRowIsBalance(),
+        mFactorisedRowHasColumn(),
+        mFactorisedEdgeRows(),
+        mFactorisedConductances(),
+        mExtendedRows(),
+        mBorderRows(),
+        mConductanceScale(1.0),
+        mRhsValues(),
+        mMaxLowRankUpdates(0),
+        mLowRankRows(),
+        mLowRankCoefficients(),
+        mLowRankChanges(),
+        mMatrixIsChanged(true),
         mpLinearSystem(),
+        mLinearSystemMatchesPattern(false),
         mUseDirectSolver(true),
+        mSolveIsIterative(false),
+        mEliminateTreesAndChains(true),
         mIsSetUp(false)
 {
 
@@ -78,87 +113,450 @@ void FlowSolver<DIM>::SetUp()
     {
         EXCEPTION("A vessel network is required before calling SetUp");
     }
-    mVessels = mpVesselNetwork->GetVessels();
-    mNodes = mpVesselNetwork->GetVesselEndNodes();
 
-    unsigned num_nodes = mNodes.size();
-    unsigned max_branches = mpVesselNetwork->GetMaxBranchesOnNode();
+    // Get the node-vessel and node-node connectivity. It is always rebuilt here, so an explicit set up picks up
+    // changes made to the vessels directly rather than through the network.
+    mpSnapshot->Update(true);
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = mpSnapshot->rGetNodes();
+    const std::vector<unsigned>& r_node_offsets = mpSnapshot->rGetNodeOffsets();
+    const std::vector<unsigned>& r_node_neighbours = mpSnapshot->rGetNodeNeighbours();
+    const std::vector<unsigned>& r_start_nodes = mpSnapshot->rGetVesselStartNodes();
+    const std::vector<unsigned>& r_end_nodes = mpSnapshot->rGetVesselEndNodes();
+    unsigned num_nodes = r_nodes.size();
 
-    // Set up the system
-    mpLinearSystem = boost::shared_ptr<LinearSystem>(new LinearSystem(num_nodes, max_branches + 1));
+    // Get the boundary condition nodes
+    mBoundaryConditionNodeIndices.clear();
+    mIsFixedPressureNode.assign(num_nodes, false);
+    const std::vector<unsigned>& r_node_components = mpSnapshot->rGetNodeComponents();
+    std::vector<bool> component_has_boundary_condition(mpSnapshot->GetNumberOfComponents(), false);
+    for (unsigned node_index = 0; node_index < num_nodes; node_index++)
+    {
+        if (r_nodes[node_index]->GetFlowProperties()->IsInputNode()
+                || r_nodes[node_index]->GetFlowProperties()->IsOutputNode())
+        {
+            mBoundaryConditionNodeIndices.push_back(node_index);
+            mIsFixedPressureNode[node_index] = true;
+            component_has_boundary_condition[r_node_components[node_index]] = true;
+        }
+    }
+
+    // Components without a boundary condition have no defined pressure, so their rows are fixed too rather
+    // than leaving a singular block in the system
+    for (unsigned node_index = 0; node_index < num_nodes; node_index++)
+    {
+        if (!component_has_boundary_condition[r_node_components[node_index]])
+        {
+            mIsFixedPressureNode[node_index] = true;
+        }
+    }
+
+    // Merge parallel vessels between the same pair of nodes into a single edge
+    std::vector<std::map<unsigned, unsigned> > adjacency(num_nodes);
+    mVesselEdges.resize(r_start_nodes.size());
+    mNumberOfEdges = 0;
+    for (unsigned vessel_index = 0; vessel_index < r_start_nodes.size(); vessel_index++)
+    {
+        unsigned start_node = r_start_nodes[vessel_index];
+        unsigned end_node = r_end_nodes[vessel_index];
+        if (start_node == end_node)
+        {
+            mVesselEdges[vessel_index] = UINT_MAX;
+            continue;
+        }
+        std::map<unsigned, unsigned>::iterator it = adjacency[start_node].find(end_node);
+        if (it == adjacency[start_node].end())
+        {
+            adjacency[start_node][end_node] = mNumberOfEdges;
+            adjacency[end_node][start_node] = mNumberOfEdges;
+            mVesselEdges[vessel_index] = mNumberOfEdges;
+            mNumberOfEdges++;
+        }
+        else
+        {
+            mVesselEdges[vessel_index] = it->second;
+        }
+    }
+
+    // Fixed nodes stay in the system, as do the nodes that velocity boundary conditions refer to
+    std::vector<bool> is_kept = mIsFixedPressureNode;
+    mIsVelocityBoundaryNode.assign(num_nodes, false);
+    for (unsigned bc_index = 0; bc_index < mBoundaryConditionNodeIndices.size(); bc_index++)
+    {
+        unsigned node_index = mBoundaryConditionNodeIndices[bc_index];
+        if (r_nodes[node_index]->GetFlowProperties()->UseVelocityBoundaryCondition())
+        {
+            mIsVelocityBoundaryNode[node_index] = true;
+            is_kept[r_node_neighbours[r_node_offsets[node_index]]] = true;
+        }
+    }
+    std::vector<bool> is_eliminated(num_nodes, false);
+    if (mEliminateTreesAndChains)
+    {
+        EliminateTreesAndChains(adjacency, is_kept, is_eliminated);
+    }
+    else
+    {
+        mEliminatedNodes.clear();
+        mEliminationNeighbours.clear();
+        mEliminationEdges.clear();
+    }
+
+    // Number the remaining nodes and build the sparsity pattern of the reduced system. The diagonal is
+    // the first entry in each row. Pressure boundary nodes only have a diagonal entry and their columns
+    // are moved to the right hand side in the mass balance rows, which keeps the matrix symmetric unless
+    // there are velocity boundary conditions.
+    mSystemNodes.clear();
+    mNodeRows.assign(num_nodes, UINT_MAX);
+    for (unsigned node_index = 0; node_index < num_nodes; node_index++)
+    {
+        if (!is_eliminated[node_index])
+        {
+            mNodeRows[node_index] = mSystemNodes.size();
+            mSystemNodes.push_back(node_index);
+        }
+    }
+    unsigned num_rows = mSystemNodes.size();
+    std::vector<unsigned> row_offsets(num_rows + 1);
+    std::vector<unsigned> column_indices;
+    mEntryEdges.clear();
+    mFixedNeighbourOffsets.resize(num_rows + 1);
+    mFixedNeighbours.clear();
+    mFixedNeighbourEdges.clear();
+    for (unsigned row = 0; row < num_rows; row++)
+    {
+        unsigned node_index = mSystemNodes[row];
+        row_offsets[row] = column_indices.size();
+        mFixedNeighbourOffsets[row] = mFixedNeighbours.size();
+        column_indices.push_back(row);
+        mEntryEdges.push_back(UINT_MAX);
+        if (!mIsFixedPressureNode[node_index] || mIsVelocityBoundaryNode[node_index])
+        {
+            const std::map<unsigned, unsigned>& r_neighbours = adjacency[node_index];
+            for (std::map<unsigned, unsigned>::const_iterator it = r_neighbours.begin(); it != r_neighbours.end(); ++it)
+            {
+                if (!mIsFixedPressureNode[node_index] && mIsFixedPressureNode[it->first] && !mIsVelocityBoundaryNode[it->first])
+                {
+                    mFixedNeighbours.push_back(it->first);
+                    mFixedNeighbourEdges.push_back(it->second);
+                }
+                else
+                {
+                    column_indices.push_back(mNodeRows[it->first]);
+                    mEntryEdges.push_back(it->second);
+                }
+            }
+        }
+    }
+    row_offsets[num_rows] = column_indices.size();
+    mFixedNeighbourOffsets[num_rows] = mFixedNeighbours.size();
+    mMatrixValues.resize(column_indices.size());
+
+    // Get the edges whose conductance appears in the matrix, those next to at least one mass balance row
+    mSystemEdges.clear();
+    mSystemEdgeRows.clear();
+    for (unsigned row = 0; row < num_rows; row++)
+    {
+        const std::map<unsigned, unsigned>& r_neighbours = adjacency[mSystemNodes[row]];
+        for (std::map<unsigned, unsigned>::const_iterator it = r_neighbours.begin(); it != r_neighbours.end(); ++it)
+        {
+            unsigned neighbour_row = mNodeRows[it->first];
+            if (neighbour_row > row && (!mIsFixedPressureNode[mSystemNodes[row]] || !mIsFixedPressureNode[it->first]))
+            {
+                mSystemEdges.push_back(it->second);
+                mSystemEdgeRows.push_back(row);
+                mSystemEdgeRows.push_back(neighbour_row);
+            }
+        }
+    }
+    bool is_pattern_changed = (row_offsets != mRowOffsets || column_indices != mColumnIndices);
+    mRowOffsets.swap(row_offsets);
+    mColumnIndices.swap(column_indices);
+
+    // Keep the factorised matrix if the new system can be written as low-rank changes to it, such as after a
+    // vessel has been removed or an anastamosis has formed. Otherwise set up the system. An existing system is
+    // kept if the sparsity pattern is unchanged, in which case the solver re-uses its symbolic factorisation
+    // or preconditioner set up on the next solve.
+    if (MapToFactorisedSystem())
+    {
+        mLinearSystemMatchesPattern = mLinearSystemMatchesPattern && !is_pattern_changed;
+    }
+    else if (!mpLinearSystem or !mLinearSystemMatchesPattern or is_pattern_changed)
+    {
+        CreateLinearSystem();
+    }
+
+    mIsSetUp = true;
+    Update(false);
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::CreateLinearSystem()
+{
+    unsigned num_rows = mSystemNodes.size();
+    unsigned max_row_size = 0;
+    bool is_symmetric = true;
+    for (unsigned row = 0; row < num_rows; row++)
+    {
+        max_row_size = std::max(max_row_size, mRowOffsets[row+1] - mRowOffsets[row]);
+        if (mIsVelocityBoundaryNode[mSystemNodes[row]])
+        {
+            is_symmetric = false;
+        }
+    }
+    mpLinearSystem = boost::shared_ptr<LinearSystem>(new LinearSystem(num_rows, max_row_size));
+    mLinearSystemMatchesPattern = true;
+    ClearFactorisedSystem();
 
     // If the network is small the preconditioner is turned off in LinearSystem,
     // so an iterative solver is used instead.
-    if (num_nodes >= 6 && mUseDirectSolver)
+    mSolveIsIterative = !(num_rows >= 6 && mUseDirectSolver);
+    if (!mSolveIsIterative)
     {
         mpLinearSystem->SetPcType("lu");
         mpLinearSystem->SetKspType("preonly");
     }
+    else if (!mUseDirectSolver && is_symmetric)
+    {
+        // Without velocity boundary conditions the system is symmetric positive definite, so use
+        // conjugate gradients with algebraic multigrid
+        mpLinearSystem->SetMatrixIsSymmetric(true);
+        mpLinearSystem->SetKspType("cg");
+#if defined(PETSC_HAVE_HYPRE)
+        mpLinearSystem->SetPcType("hypre");
+#elif (PETSC_VERSION_MAJOR == 3 && PETSC_VERSION_MINOR >= 3) // PETSc 3.3 or later
+        mpLinearSystem->SetPcType("gamg");
+#endif
+    }
+}
 
-    // Get the node-vessel and node-node connectivity
-    boost::shared_ptr<VesselNetworkGraphCalculator<DIM> > p_graph_calculator = VesselNetworkGraphCalculator<DIM>::Create();
-    p_graph_calculator->SetVesselNetwork(mpVesselNetwork);
-    mNodeVesselConnectivity = p_graph_calculator->GetNodeVesselConnectivity();
-    mNodeNodeConnectivity = p_graph_calculator->GetNodeNodeConnectivity();
+template<unsigned DIM>
+void FlowSolver<DIM>::ClearFactorisedSystem()
+{
+    mFactorisedNodes.clear();
+    mFactorisedRowIsBalance.clear();
+    mFactorisedRowHasColumn.clear();
+    mFactorisedEdgeRows.clear();
+    mFactorisedConductances.clear();
+    mExtendedRows.clear();
+    mBorderRows.clear();
+}
 
-    // Get the boundary condition nodes
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > boundary_condition_nodes;
-    for (unsigned node_index = 0; node_index < num_nodes; node_index++)
+template<unsigned DIM>
+bool FlowSolver<DIM>::MapToFactorisedSystem()
+{
+    mExtendedRows.clear();
+    mBorderRows.clear();
+
+    // Rows with velocity boundary conditions refer to the column of their neighbour, which is not followed
+    // when rows are renumbered
+    bool can_map = (mpLinearSystem && !mSolveIsIterative && mMaxLowRankUpdates > 0 && !mFactorisedNodes.empty());
+    for (unsigned row = 0; can_map && row < mSystemNodes.size(); row++)
+    {
+        can_map = !mIsVelocityBoundaryNode[mSystemNodes[row]];
+    }
+    if (!can_map)
+    {
+        ClearFactorisedSystem();
+        return false;
+    }
+
+    // Rows are matched by their nodes, rows of nodes which were not in the factorised system are bordered onto it
+    boost::unordered_map<const VesselNode<DIM>*, unsigned> factorised_rows;
+    for (unsigned row = 0; row < mFactorisedNodes.size(); row++)
+    {
+        factorised_rows[mFactorisedNodes[row].get()] = row;
+    }
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = mpSnapshot->rGetNodes();
+    bool is_same_rows = (mSystemNodes.size() == mFactorisedNodes.size());
+    mExtendedRows.resize(mSystemNodes.size());
+    for (unsigned row = 0; row < mSystemNodes.size(); row++)
     {
-        if (mNodes[node_index]->GetFlowProperties()->IsInputNode()
-                || mNodes[node_index]->GetFlowProperties()->IsOutputNode())
+        bool is_balance = !mIsFixedPressureNode[mSystemNodes[row]];
+        typename boost::unordered_map<const VesselNode<DIM>*, unsigned>::const_iterator it =
+                factorised_rows.find(r_nodes[mSystemNodes[row]].get());
+        if (it == factorised_rows.end())
         {
-            boundary_condition_nodes.push_back(mNodes[node_index]);
-            mBoundaryConditionNodeIndices.push_back(node_index);
+            mExtendedRows[row] = mFactorisedNodes.size() + mBorderRows.size();
+            mBorderRows.push_back(row);
+            is_same_rows = false;
+        }
+        else if (mFactorisedRowIsBalance[it->second] != is_balance || mFactorisedRowHasColumn[it->second] != is_balance)
+        {
+            // The row has changed type, such as a node becoming a boundary node
+            ClearFactorisedSystem();
+            return false;
+        }
+        else
+        {
+            mExtendedRows[row] = it->second;
+            is_same_rows = is_same_rows && (it->second == row);
         }
     }
+    if (is_same_rows && mSystemEdgeRows == mFactorisedEdgeRows)
+    {
+        mExtendedRows.clear();
+    }
+    return true;
+}
 
-    // Get the nodes that correspond to segments that are not connected to the rest of the network
-    std::vector<bool> connected = p_graph_calculator->IsConnected(boundary_condition_nodes, mNodes);
-    std::vector<unsigned> mUnconnectedNodeIndices;
-    for (unsigned node_index = 0; node_index < num_nodes; node_index++)
+template<unsigned DIM>
+void FlowSolver<DIM>::EliminateTreesAndChains(std::vector<std::map<unsigned, unsigned> >& rAdjacency,
+        const std::vector<bool>& rIsKept, std::vector<bool>& rIsEliminated)
+{
+    mEliminatedNodes.clear();
+    mEliminationNeighbours.clear();
+    mEliminationEdges.clear();
+
+    std::vector<unsigned> candidates;
+    for (unsigned node_index = 0; node_index < rAdjacency.size(); node_index++)
     {
-        if (!connected[node_index])
+        if (!rIsKept[node_index] && rAdjacency[node_index].size() <= 2)
         {
-            mUnconnectedNodeIndices.push_back(node_index);
+            candidates.push_back(node_index);
         }
     }
 
-    mIsSetUp = true;
-    Update(false);
+    while (!candidates.empty())
+    {
+        unsigned node_index = candidates.back();
+        candidates.pop_back();
+        std::map<unsigned, unsigned>& r_neighbours = rAdjacency[node_index];
+        if (rIsEliminated[node_index] || r_neighbours.empty() || r_neighbours.size() > 2)
+        {
+            continue;
+        }
+
+        std::map<unsigned, unsigned>::iterator it = r_neighbours.begin();
+        unsigned neighbour1 = it->first;
+        unsigned edge1 = it->second;
+        unsigned neighbour2 = UINT_MAX;
+        unsigned edge2 = UINT_MAX;
+        unsigned joining_edge = UINT_MAX;
+        rAdjacency[neighbour1].erase(node_index);
+        if (r_neighbours.size() == 2)
+        {
+            // A node in series: its neighbours are joined by the series combination of its two edges,
+            // added to any edge already between them
+            ++it;
+            neighbour2 = it->first;
+            edge2 = it->second;
+            rAdjacency[neighbour2].erase(node_index);
+            std::map<unsigned, unsigned>::iterator joining_it = rAdjacency[neighbour1].find(neighbour2);
+            if (joining_it == rAdjacency[neighbour1].end())
+            {
+                joining_edge = mNumberOfEdges;
+                rAdjacency[neighbour1][neighbour2] = joining_edge;
+                rAdjacency[neighbour2][neighbour1] = joining_edge;
+                mNumberOfEdges++;
+            }
+            else
+            {
+                joining_edge = joining_it->second;
+            }
+        }
+        // Otherwise a leaf, which carries no flow and takes the pressure of its neighbour
+
+        r_neighbours.clear();
+        rIsEliminated[node_index] = true;
+        mEliminatedNodes.push_back(node_index);
+        mEliminationNeighbours.push_back(neighbour1);
+        mEliminationNeighbours.push_back(neighbour2);
+        mEliminationEdges.push_back(edge1);
+        mEliminationEdges.push_back(edge2);
+        mEliminationEdges.push_back(joining_edge);
+
+        if (!rIsKept[neighbour1] && rAdjacency[neighbour1].size() <= 2)
+        {
+            candidates.push_back(neighbour1);
+        }
+        if (neighbour2 != UINT_MAX && !rIsKept[neighbour2] && rAdjacency[neighbour2].size() <= 2)
+        {
+            candidates.push_back(neighbour2);
+        }
+    }
+}
+
+template<unsigned DIM>
+std::vector<boost::shared_ptr<VesselNode<DIM> > > FlowSolver<DIM>::GetBoundaryConditionNodes()
+{
+    if (!mIsSetUp)
+    {
+        SetUp();
+    }
+
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > boundary_nodes;
+    for (unsigned bc_index = 0; bc_index < mBoundaryConditionNodeIndices.size(); bc_index++)
+    {
+        boundary_nodes.push_back(mpSnapshot->rGetNodes()[mBoundaryConditionNodeIndices[bc_index]]);
+    }
+    return boundary_nodes;
+}
+
+template<unsigned DIM>
+unsigned FlowSolver<DIM>::GetNumberOfSystemNodes() const
+{
+    return mSystemNodes.size();
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::SetEliminateTreesAndChains(bool eliminateTreesAndChains)
+{
+    if(eliminateTreesAndChains != mEliminateTreesAndChains)
+    {
+        mIsSetUp = false;
+    }
+    mEliminateTreesAndChains = eliminateTreesAndChains;
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::SetMaxLowRankUpdates(unsigned maxLowRankUpdates)
+{
+    mMaxLowRankUpdates = maxLowRankUpdates;
 }
 
 template<unsigned DIM>
 void FlowSolver<DIM>::SetUseDirectSolver(bool useDirectSolver)
 {
+    if(useDirectSolver != mUseDirectSolver)
+    {
+        mpLinearSystem.reset();
+        mIsSetUp = false;
+    }
     mUseDirectSolver = useDirectSolver;
 }
 
 template<unsigned DIM>
 void FlowSolver<DIM>::SetVesselNetwork(boost::shared_ptr<VesselNetwork<DIM> > pVesselNetwork)
 {
+    if(pVesselNetwork != mpVesselNetwork)
+    {
+        mpLinearSystem.reset();
+    }
     mpVesselNetwork = pVesselNetwork;
+    mpSnapshot->SetVesselNetwork(pVesselNetwork);
+    mIsSetUp = false;
 }
 
 template<unsigned DIM>
 void FlowSolver<DIM>::Update(bool runSetup)
 {
-    if(!mIsSetUp or runSetup)
+    if(!mIsSetUp or runSetup or !mpSnapshot->IsUpToDate())
     {
         SetUp();
+        return;
     }
 
-    mpLinearSystem->SwitchWriteModeLhsMatrix();
-    mpLinearSystem->ZeroLhsMatrix();
+    mpSnapshot->Update();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = mpSnapshot->rGetNodes();
+    const std::vector<double>& r_impedances = mpSnapshot->rGetImpedances();
 
     // Get the impedances, scale them by the maximum impedance to remove small values from the system matrix
-    std::vector<units::quantity<unit::flow_impedance> > scaled_impedances;
-    units::quantity<unit::flow_impedance> max_impedance = 0.0 * unit::pascal_second_per_metre_cubed;
-    units::quantity<unit::flow_impedance> min_impedance = DBL_MAX * unit::pascal_second_per_metre_cubed;
-    for (unsigned vessel_index = 0; vessel_index < mVessels.size(); vessel_index++)
+    double max_impedance = 0.0;
+    double min_impedance = DBL_MAX;
+    for (unsigned vessel_index = 0; vessel_index < r_impedances.size(); vessel_index++)
     {
-        units::quantity<unit::flow_impedance> impedance = mVessels[vessel_index]->GetFlowProperties()->GetImpedance();
-        if (impedance <= 0.0 * unit::pascal_second_per_metre_cubed)
+        double impedance = r_impedances[vessel_index];
+        if (impedance <= 0.0)
         {
             EXCEPTION("Impedance should be a positive number.");
         }
@@ -170,107 +568,591 @@ void FlowSolver<DIM>::Update(bool runSetup)
         {
             min_impedance = impedance;
         }
-        scaled_impedances.push_back(impedance);
     }
-    units::quantity<unit::flow_impedance> multipler = (max_impedance + min_impedance) / 2.0; //scale impedances to avoid floating point problems in PETSC solvers.
+    double multipler = (max_impedance + min_impedance) / 2.0; //scale impedances to avoid floating point problems in PETSC solvers.
 
-    // Set up the system matrix
-    for (unsigned node_index = 0; node_index < mNodes.size(); node_index++)
+    // Low-rank corrections to the factorised matrix are possible if it was built with the same boundary
+    // conditions. Its scaling is kept so that unchanged vessels keep exactly the same conductance.
+    bool use_low_rank = (mMaxLowRankUpdates > 0 && !mSolveIsIterative && !mFactorisedNodes.empty());
+    for (unsigned bc_index = 0; bc_index < mBoundaryConditionNodeIndices.size(); bc_index++)
+    {
+        unsigned node_index = mBoundaryConditionNodeIndices[bc_index];
+        if (r_nodes[node_index]->GetFlowProperties()->UseVelocityBoundaryCondition() != mIsVelocityBoundaryNode[node_index])
+        {
+            use_low_rank = false;
+        }
+    }
+    mLowRankRows.clear();
+    mLowRankCoefficients.clear();
+    mLowRankChanges.clear();
+    if (use_low_rank)
     {
-        bool is_bc_node = (std::find(mBoundaryConditionNodeIndices.begin(), mBoundaryConditionNodeIndices.end(),
-                                     node_index) != mBoundaryConditionNodeIndices.end());
-        bool is_unconnected_node = (std::find(mUnconnectedNodeIndices.begin(), mUnconnectedNodeIndices.end(),
-                                              node_index) != mUnconnectedNodeIndices.end());
+        UpdateConductances(mConductanceScale);
+        if (mExtendedRows.empty())
+        {
+            for (unsigned idx = 0; idx < mSystemEdges.size(); idx++)
+            {
+                double change = mEdgeConductances[mSystemEdges[idx]] - mFactorisedConductances[idx];
+                if (change != 0.0)
+                {
+                    AddLowRankChange(mSystemEdgeRows[2*idx], mSystemEdgeRows[2*idx+1], change);
+                }
+            }
+        }
+        else
+        {
+            AddLowRankTopologyChanges();
+        }
+        use_low_rank = (mLowRankChanges.size() <= mMaxLowRankUpdates);
+    }
+    if (!use_low_rank)
+    {
+        mLowRankChanges.clear();
+        if (!mLinearSystemMatchesPattern)
+        {
+            CreateLinearSystem();
+        }
+        mConductanceScale = multipler;
+        UpdateConductances(mConductanceScale);
+        AssembleMatrix();
+    }
+
+    AssembleRhs(mpSnapshot->rGetPressures());
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::AssembleRhs(const std::vector<double>& rBoundaryPressures)
+{
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = mpSnapshot->rGetNodes();
+    const std::vector<unsigned>& r_node_offsets = mpSnapshot->rGetNodeOffsets();
+    const std::vector<unsigned>& r_node_vessels = mpSnapshot->rGetNodeVessels();
+    const std::vector<double>& r_impedances = mpSnapshot->rGetImpedances();
 
-        if (is_bc_node or is_unconnected_node)
+    // Mass balance rows are negated so that the diagonal is positive
+    mRhsValues.assign(mSystemNodes.size(), 0.0);
+    for (unsigned row = 0; row < mSystemNodes.size(); row++)
+    {
+        unsigned node_index = mSystemNodes[row];
+        if (mIsFixedPressureNode[node_index])
         {
-            mpLinearSystem->AddToMatrixElement(node_index, node_index, 1.0);
-            if(mNodes[node_index]->GetFlowProperties()->UseVelocityBoundaryCondition())
+            if(r_nodes[node_index]->GetFlowProperties()->UseVelocityBoundaryCondition())
             {
-                // Velocity BC: Assumes only single vessel at inlets
-                mpLinearSystem->AddToMatrixElement(node_index, mNodeNodeConnectivity[node_index][0], -1.0);
+                unsigned vessel_index = r_node_vessels[r_node_offsets[node_index]];
+                mRhsValues[row] = std::fabs(mpSnapshot->rGetFlowRates()[vessel_index]) * r_impedances[vessel_index];
+            }
+            else if (r_nodes[node_index]->GetFlowProperties()->IsInputNode()
+                    || r_nodes[node_index]->GetFlowProperties()->IsOutputNode())
+            {
+                mRhsValues[row] = rBoundaryPressures[node_index];
             }
+        }
+        else
+        {
+            for (unsigned entry = mFixedNeighbourOffsets[row]; entry < mFixedNeighbourOffsets[row+1]; entry++)
+            {
+                mRhsValues[row] += mEdgeConductances[mFixedNeighbourEdges[entry]] * rBoundaryPressures[mFixedNeighbours[entry]];
+            }
+        }
+    }
 
+    // Otherwise the right hand side is mapped onto the factorised system when solving
+    if (mLinearSystemMatchesPattern)
+    {
+        for (unsigned row = 0; row < mSystemNodes.size(); row++)
+        {
+            mpLinearSystem->SetRhsVectorElement(row, mRhsValues[row]);
+        }
+    }
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::UpdateConductances(double scale)
+{
+    // Sum the conductances of parallel vessels, then replay the eliminations to get the conductances
+    // of the reduced system
+    const std::vector<double>& r_impedances = mpSnapshot->rGetImpedances();
+    mEdgeConductances.assign(mNumberOfEdges, 0.0);
+    for (unsigned vessel_index = 0; vessel_index < r_impedances.size(); vessel_index++)
+    {
+        if (mVesselEdges[vessel_index] != UINT_MAX)
+        {
+            mEdgeConductances[mVesselEdges[vessel_index]] += scale / r_impedances[vessel_index];
+        }
+    }
+    mEliminationWeights.resize(mEliminatedNodes.size());
+    for (unsigned idx = 0; idx < mEliminatedNodes.size(); idx++)
+    {
+        if (mEliminationNeighbours[2*idx+1] == UINT_MAX)
+        {
+            mEliminationWeights[idx] = 1.0;
         }
         else
         {
-            for (unsigned vessel_index = 0; vessel_index < mNodeVesselConnectivity[node_index].size(); vessel_index++)
+            double conductance1 = mEdgeConductances[mEliminationEdges[3*idx]];
+            double conductance2 = mEdgeConductances[mEliminationEdges[3*idx+1]];
+            mEliminationWeights[idx] = conductance1 / (conductance1 + conductance2);
+            mEdgeConductances[mEliminationEdges[3*idx+2]] += conductance1 * conductance2 / (conductance1 + conductance2);
+        }
+    }
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::AddLowRankChange(unsigned row1, unsigned row2, double change)
+{
+    // A change in the conductance between two mass balance rows adds change*(e1-e2)(e1-e2)^T. If only
+    // one row is a mass balance row only that row changes, and the other node's column is only there if
+    // it is not a pressure boundary node. Rows are those of the factorised matrix, followed by any
+    // bordered rows.
+    unsigned num_factorised_rows = mFactorisedNodes.size();
+    bool is_balance1 = (row1 < num_factorised_rows) ? bool(mFactorisedRowIsBalance[row1]) :
+            !mIsFixedPressureNode[mSystemNodes[mBorderRows[row1 - num_factorised_rows]]];
+    bool is_balance2 = (row2 < num_factorised_rows) ? bool(mFactorisedRowIsBalance[row2]) :
+            !mIsFixedPressureNode[mSystemNodes[mBorderRows[row2 - num_factorised_rows]]];
+    if (!is_balance1)
+    {
+        std::swap(row1, row2);
+        std::swap(is_balance1, is_balance2);
+    }
+    bool has_column2 = (row2 < num_factorised_rows) ? bool(mFactorisedRowHasColumn[row2]) : is_balance2;
+
+    mLowRankRows.push_back(row1);
+    mLowRankRows.push_back(is_balance2 ? row2 : UINT_MAX);
+    mLowRankRows.push_back(row1);
+    mLowRankRows.push_back(has_column2 ? row2 : UINT_MAX);
+    mLowRankCoefficients.push_back(1.0);
+    mLowRankCoefficients.push_back(-1.0);
+    mLowRankCoefficients.push_back(1.0);
+    mLowRankCoefficients.push_back(-1.0);
+    mLowRankChanges.push_back(change);
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::AddLowRankDiagonalChange(unsigned row, double change)
+{
+    mLowRankRows.push_back(row);
+    mLowRankRows.push_back(UINT_MAX);
+    mLowRankRows.push_back(row);
+    mLowRankRows.push_back(UINT_MAX);
+    mLowRankCoefficients.push_back(1.0);
+    mLowRankCoefficients.push_back(0.0);
+    mLowRankCoefficients.push_back(1.0);
+    mLowRankCoefficients.push_back(0.0);
+    mLowRankChanges.push_back(change);
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::AddLowRankTopologyChanges()
+{
+    // Get the current conductance between each pair of rows of the bordered matrix
+    std::map<std::pair<unsigned, unsigned>, double> conductances;
+    for (unsigned idx = 0; idx < mSystemEdges.size(); idx++)
+    {
+        unsigned row1 = mExtendedRows[mSystemEdgeRows[2*idx]];
+        unsigned row2 = mExtendedRows[mSystemEdgeRows[2*idx+1]];
+        conductances[std::make_pair(std::min(row1, row2), std::max(row1, row2))] = mEdgeConductances[mSystemEdges[idx]];
+    }
+
+    // Change the edges of the factorised matrix, removed edges have no conductance
+    for (unsigned idx = 0; idx < mFactorisedConductances.size(); idx++)
+    {
+        unsigned row1 = mFactorisedEdgeRows[2*idx];
+        unsigned row2 = mFactorisedEdgeRows[2*idx+1];
+        double conductance = 0.0;
+        std::map<std::pair<unsigned, unsigned>, double>::iterator it =
+                conductances.find(std::make_pair(std::min(row1, row2), std::max(row1, row2)));
+        if (it != conductances.end())
+        {
+            conductance = it->second;
+            conductances.erase(it);
+        }
+        if (conductance != mFactorisedConductances[idx])
+        {
+            AddLowRankChange(row1, row2, conductance - mFactorisedConductances[idx]);
+        }
+    }
+
+    // Add the new edges
+    for (std::map<std::pair<unsigned, unsigned>, double>::iterator it = conductances.begin(); it != conductances.end(); ++it)
+    {
+        AddLowRankChange(it->first.first, it->first.second, it->second);
+    }
+
+    // Mass balance rows which have left the system keep a unit diagonal so that the matrix stays
+    // non-singular, while those bordered onto it lose the unit diagonal of the identity block
+    unsigned num_factorised_rows = mFactorisedNodes.size();
+    std::vector<bool> is_kept(num_factorised_rows, false);
+    for (unsigned row = 0; row < mExtendedRows.size(); row++)
+    {
+        if (mExtendedRows[row] < num_factorised_rows)
+        {
+            is_kept[mExtendedRows[row]] = true;
+        }
+    }
+    for (unsigned row = 0; row < num_factorised_rows; row++)
+    {
+        if (!is_kept[row] && mFactorisedRowIsBalance[row])
+        {
+            AddLowRankDiagonalChange(row, 1.0);
+        }
+    }
+    for (unsigned idx = 0; idx < mBorderRows.size(); idx++)
+    {
+        if (!mIsFixedPressureNode[mSystemNodes[mBorderRows[idx]]])
+        {
+            AddLowRankDiagonalChange(num_factorised_rows + idx, -1.0);
+        }
+    }
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::AssembleMatrix()
+{
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = mpSnapshot->rGetNodes();
+    const std::vector<unsigned>& r_node_offsets = mpSnapshot->rGetNodeOffsets();
+    const std::vector<unsigned>& r_node_neighbours = mpSnapshot->rGetNodeNeighbours();
+
+    mpLinearSystem->SwitchWriteModeLhsMatrix();
+
+    // Fill the matrix values row by row. Every entry in the sparsity pattern is written, so the matrix
+    // does not need to be zeroed first. Mass balance rows are negated so that the diagonal is positive.
+    std::fill(mMatrixValues.begin(), mMatrixValues.end(), 0.0);
+    for (unsigned row = 0; row < mSystemNodes.size(); row++)
+    {
+        unsigned node_index = mSystemNodes[row];
+        unsigned diagonal = mRowOffsets[row];
+        if (mIsFixedPressureNode[node_index])
+        {
+            mMatrixValues[diagonal] = 1.0;
+            if(r_nodes[node_index]->GetFlowProperties()->UseVelocityBoundaryCondition())
+            {
+                // Velocity BC: Assumes only single vessel at inlets
+                unsigned position = diagonal;
+                unsigned reference_row = mNodeRows[r_node_neighbours[r_node_offsets[node_index]]];
+                while (position < mRowOffsets[row+1] && mColumnIndices[position] != reference_row)
+                {
+                    position++;
+                }
+                if (position == mRowOffsets[row+1])
+                {
+                    EXCEPTION("Velocity boundary conditions have changed since the flow solver was set up.");
+                }
+                mMatrixValues[position] -= 1.0;
+            }
+        }
+        else
+        {
+            for (unsigned position = diagonal + 1; position < mRowOffsets[row+1]; position++)
             {
-                units::quantity<unit::flow_impedance> impedance = scaled_impedances[mNodeVesselConnectivity[node_index][vessel_index]];
                 // Add the inverse impedances to the linear system
-                mpLinearSystem->AddToMatrixElement(node_index, node_index, -multipler / impedance); // Aii
-                mpLinearSystem->AddToMatrixElement(node_index, mNodeNodeConnectivity[node_index][vessel_index], multipler / impedance); // Aij
+                double conductance = mEdgeConductances[mEntryEdges[position]];
+                mMatrixValues[diagonal] += conductance; // Aii
+                mMatrixValues[position] -= conductance; // Aij
+            }
+            for (unsigned entry = mFixedNeighbourOffsets[row]; entry < mFixedNeighbourOffsets[row+1]; entry++)
+            {
+                mMatrixValues[diagonal] += mEdgeConductances[mFixedNeighbourEdges[entry]];
             }
         }
-    }
 
+        for (unsigned position = diagonal; position < mRowOffsets[row+1]; position++)
+        {
+            mpLinearSystem->SetMatrixElement(row, mColumnIndices[position], mMatrixValues[position]);
+        }
+    }
     mpLinearSystem->AssembleIntermediateLinearSystem();
-    // Update the RHS
-    for (unsigned bc_index = 0; bc_index < mBoundaryConditionNodeIndices.size(); bc_index++)
+
+    // Record the factorised system for low-rank updates
+    ClearFactorisedSystem();
+    if (mMaxLowRankUpdates > 0 && !mSolveIsIterative)
     {
-        if(mNodes[mBoundaryConditionNodeIndices[bc_index]]->GetFlowProperties()->UseVelocityBoundaryCondition())
+        mFactorisedNodes.resize(mSystemNodes.size());
+        mFactorisedRowIsBalance.resize(mSystemNodes.size());
+        mFactorisedRowHasColumn.resize(mSystemNodes.size());
+        for (unsigned row = 0; row < mSystemNodes.size(); row++)
         {
-            boost::shared_ptr<Vessel<DIM> > p_vessel = mNodes[mBoundaryConditionNodeIndices[bc_index]]->GetSegment(0)->GetVessel();
-            units::quantity<unit::flow_rate> flow_rate = boost::units::fabs(p_vessel->GetFlowProperties()->GetFlowRate());
-            units::quantity<unit::flow_impedance> impedance = p_vessel->GetFlowProperties()->GetImpedance();
-            double pressure_drop = flow_rate * impedance/ unit::pascals;
-            mpLinearSystem->SetRhsVectorElement(mBoundaryConditionNodeIndices[bc_index], pressure_drop);
+            unsigned node_index = mSystemNodes[row];
+            mFactorisedNodes[row] = r_nodes[node_index];
+            mFactorisedRowIsBalance[row] = !mIsFixedPressureNode[node_index];
+            mFactorisedRowHasColumn[row] = !mIsFixedPressureNode[node_index] || mIsVelocityBoundaryNode[node_index];
         }
-        else
+        mFactorisedEdgeRows = mSystemEdgeRows;
+        mFactorisedConductances.resize(mSystemEdges.size());
+        for (unsigned idx = 0; idx < mSystemEdges.size(); idx++)
         {
-            mpLinearSystem->SetRhsVectorElement(
-                    mBoundaryConditionNodeIndices[bc_index],
-                    mNodes[mBoundaryConditionNodeIndices[bc_index]]->GetFlowProperties()->GetPressure()/unit::pascals);
+            mFactorisedConductances[idx] = mEdgeConductances[mSystemEdges[idx]];
         }
     }
+    mMatrixIsChanged = true;
 }
 
 template<unsigned DIM>
-void FlowSolver<DIM>::Solve()
+void FlowSolver<DIM>::SolveLinearSystem(std::vector<double>& rSolution)
+{
+    Vec solution;
+    if (mSolveIsIterative)
+    {
+        // Start from the current pressures, which only change a little between steps in most simulations
+        const std::vector<double>& r_pressures = mpSnapshot->rGetPressures();
+        std::vector<double> guess(mSystemNodes.size());
+        for (unsigned row = 0; row < mSystemNodes.size(); row++)
+        {
+            guess[row] = r_pressures[mSystemNodes[row]];
+        }
+        Vec initial_guess = PetscTools::CreateVec(guess);
+        solution = mpLinearSystem->Solve(initial_guess);
+        PetscTools::Destroy(initial_guess);
+    }
+    else
+    {
+        // Only refactorise if the matrix has been written since the last solve
+        mpLinearSystem->SetMatrixIsConstant(!mMatrixIsChanged);
+        solution = mpLinearSystem->Solve();
+    }
+    mMatrixIsChanged = false;
+
+    ReplicatableVector solution_repl(solution);
+    rSolution.resize(mpLinearSystem->GetSize());
+    for (unsigned row = 0; row < rSolution.size(); row++)
+    {
+        rSolution[row] = solution_repl[row];
+    }
+    PetscTools::Destroy(solution);
+}
+
+template<unsigned DIM>
+bool FlowSolver<DIM>::SolveWithLowRankCorrections(std::vector<double>& rSolution)
+{
+    // Woodbury identity: with the changed matrix A + U C V^T, where column k of U and V are the row and
+    // column vectors of change k and C holds the changes, x = y - Z (I + C V^T Z)^-1 C V^T y for y = A^-1 b
+    // and Z = A^-1 U. All solves re-use the existing factorisation of A. After a change in topology A is
+    // the factorised matrix bordered by an identity block for the rows of new nodes.
+    unsigned num_changes = mLowRankChanges.size();
+    unsigned num_rows = mpLinearSystem->GetSize() + mBorderRows.size();
+    std::vector<double> rhs(num_rows, 0.0);
+    for (unsigned row = 0; row < mSystemNodes.size(); row++)
+    {
+        rhs[mExtendedRows.empty() ? row : mExtendedRows[row]] = mRhsValues[row];
+    }
+    std::vector<double> y;
+    SolveWithFactorisedSystem(rhs, y);
+
+    std::vector<std::vector<double> > z(num_changes);
+    for (unsigned idx = 0; idx < num_changes; idx++)
+    {
+        std::fill(rhs.begin(), rhs.end(), 0.0);
+        for (unsigned entry = 4*idx; entry < 4*idx + 2; entry++)
+        {
+            if (mLowRankRows[entry] != UINT_MAX)
+            {
+                rhs[mLowRankRows[entry]] = mLowRankCoefficients[entry];
+            }
+        }
+        SolveWithFactorisedSystem(rhs, z[idx]);
+    }
+
+    // Restore the right hand side
+    if (mLinearSystemMatchesPattern)
+    {
+        for (unsigned row = 0; row < mSystemNodes.size(); row++)
+        {
+            mpLinearSystem->SetRhsVectorElement(row, mRhsValues[row]);
+        }
+        mpLinearSystem->AssembleRhsVector();
+    }
+
+    // Form the small capacitance system, M = I + C V^T Z and w = C V^T y
+    std::vector<std::vector<double> > capacitance(num_changes, std::vector<double>(num_changes + 1, 0.0));
+    for (unsigned row_index = 0; row_index < num_changes; row_index++)
+    {
+        capacitance[row_index][row_index] = 1.0;
+        for (unsigned entry = 4*row_index + 2; entry < 4*row_index + 4; entry++)
+        {
+            unsigned row = mLowRankRows[entry];
+            if (row != UINT_MAX)
+            {
+                double coefficient = mLowRankChanges[row_index] * mLowRankCoefficients[entry];
+                for (unsigned col_index = 0; col_index < num_changes; col_index++)
+                {
+                    capacitance[row_index][col_index] += coefficient * z[col_index][row];
+                }
+                capacitance[row_index][num_changes] += coefficient * y[row];
+            }
+        }
+    }
+
+    std::vector<double> weights;
+    if (!SmallDenseLinearSolver::Solve(capacitance, weights))
+    {
+        // The changed matrix is singular or close to it
+        return false;
+    }
+
+    for (unsigned idx = 0; idx < num_changes; idx++)
+    {
+        for (unsigned row = 0; row < num_rows; row++)
+        {
+            y[row] -= weights[idx] * z[idx][row];
+        }
+    }
+    rSolution.resize(mSystemNodes.size());
+    for (unsigned row = 0; row < mSystemNodes.size(); row++)
+    {
+        rSolution[row] = y[mExtendedRows.empty() ? row : mExtendedRows[row]];
+    }
+    return true;
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::SolveWithFactorisedSystem(const std::vector<double>& rRhs, std::vector<double>& rSolution)
+{
+    unsigned num_factorised_rows = mpLinearSystem->GetSize();
+    mpLinearSystem->ZeroRhsVector();
+    for (unsigned row = 0; row < num_factorised_rows; row++)
+    {
+        if (rRhs[row] != 0.0)
+        {
+            mpLinearSystem->SetRhsVectorElement(row, rRhs[row]);
+        }
+    }
+    mpLinearSystem->AssembleRhsVector();
+    SolveLinearSystem(rSolution);
+    rSolution.insert(rSolution.end(), rRhs.begin() + num_factorised_rows, rRhs.end());
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::SolveForNodePressures(std::vector<double>& rPressures)
+{
+    // Assemble and solve the final system
+    if (mMatrixIsChanged)
+    {
+        mpLinearSystem->AssembleFinalLinearSystem();
+    }
+    else
+    {
+        mpLinearSystem->AssembleRhsVector();
+    }
+    // Renumbered rows need the bordered solve even if there are no changes to the factorised matrix
+    std::vector<double> system_pressures;
+    bool use_low_rank = (!mLowRankChanges.empty() || !mExtendedRows.empty());
+    if (!use_low_rank || !SolveWithLowRankCorrections(system_pressures))
+    {
+        if (use_low_rank)
+        {
+            mLowRankChanges.clear();
+            if (!mLinearSystemMatchesPattern)
+            {
+                CreateLinearSystem();
+                for (unsigned row = 0; row < mSystemNodes.size(); row++)
+                {
+                    mpLinearSystem->SetRhsVectorElement(row, mRhsValues[row]);
+                }
+            }
+            AssembleMatrix();
+            mpLinearSystem->AssembleFinalLinearSystem();
+        }
+        SolveLinearSystem(system_pressures);
+    }
+
+    // Recover the pressure of the vessel nodes, back-substituting the eliminated ones in reverse order
+    rPressures.resize(mNodeRows.size());
+    for (unsigned row = 0; row < mSystemNodes.size(); row++)
+    {
+        rPressures[mSystemNodes[row]] = system_pressures[row];
+    }
+    for (unsigned idx = mEliminatedNodes.size(); idx-- > 0; )
+    {
+        double pressure = mEliminationWeights[idx] * rPressures[mEliminationNeighbours[2*idx]];
+        if (mEliminationNeighbours[2*idx+1] != UINT_MAX)
+        {
+            pressure += (1.0 - mEliminationWeights[idx]) * rPressures[mEliminationNeighbours[2*idx+1]];
+        }
+        rPressures[mEliminatedNodes[idx]] = pressure;
+    }
+}
+
+template<unsigned DIM>
+void FlowSolver<DIM>::SolveForBoundaryPressures(const std::vector<std::vector<double> >& rBoundaryPressures,
+        std::vector<std::vector<double> >& rPressures, std::vector<std::vector<double> >& rFlowRates)
 {
     if (!mIsSetUp)
     {
         SetUp();
     }
 
-    // Assemble and solve the final system
-    mpLinearSystem->AssembleFinalLinearSystem();
-    Vec solution = PetscTools::CreateVec(mNodes.size());
-    solution = mpLinearSystem->Solve();
+    // The matrix is factorised on the first solve and only the right hand side changes after that
+    const std::vector<unsigned>& r_start_nodes = mpSnapshot->rGetVesselStartNodes();
+    const std::vector<unsigned>& r_end_nodes = mpSnapshot->rGetVesselEndNodes();
+    const std::vector<double>& r_impedances = mpSnapshot->rGetImpedances();
+    std::vector<double> boundary_pressures = mpSnapshot->rGetPressures();
+    rPressures.resize(rBoundaryPressures.size());
+    rFlowRates.resize(rBoundaryPressures.size());
+    for (unsigned scenario = 0; scenario < rBoundaryPressures.size(); scenario++)
+    {
+        if (rBoundaryPressures[scenario].size() != mBoundaryConditionNodeIndices.size())
+        {
+            EXCEPTION("A pressure is needed for each boundary condition node in each scenario.");
+        }
+        for (unsigned bc_index = 0; bc_index < mBoundaryConditionNodeIndices.size(); bc_index++)
+        {
+            boundary_pressures[mBoundaryConditionNodeIndices[bc_index]] = rBoundaryPressures[scenario][bc_index];
+        }
+        AssembleRhs(boundary_pressures);
+        SolveForNodePressures(rPressures[scenario]);
+
+        rFlowRates[scenario].resize(r_impedances.size());
+        for (unsigned vessel_index = 0; vessel_index < r_impedances.size(); vessel_index++)
+        {
+            double flow_rate = (rPressures[scenario][r_start_nodes[vessel_index]] - rPressures[scenario][r_end_nodes[vessel_index]]) / r_impedances[vessel_index];
+            if (std::fabs(flow_rate) < pow(10, -20))
+            {
+                flow_rate = 0.0;
+            }
+            rFlowRates[scenario][vessel_index] = flow_rate;
+        }
+    }
+
+    // Restore the network's own boundary conditions for the next solve
+    AssembleRhs(mpSnapshot->rGetPressures());
+}
 
-    // Recover the pressure of the vessel nodes
-    ReplicatableVector a(solution);
-    for (unsigned node_index = 0; node_index < mNodes.size(); node_index++)
+template<unsigned DIM>
+void FlowSolver<DIM>::Solve()
+{
+    if (!mIsSetUp)
     {
-        mNodes[node_index]->GetFlowProperties()->SetPressure(a[node_index] * unit::pascals);
+        SetUp();
     }
 
-    // Set the segment flow rates and nodal pressures
-    for (unsigned vessel_index = 0; vessel_index < mVessels.size(); vessel_index++)
+    std::vector<double>& r_pressures = mpSnapshot->rGetPressures();
+    SolveForNodePressures(r_pressures);
+    mpSnapshot->WritePressures();
+
+    // Set the vessel flow rates and the pressures at nodes inside vessels
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& r_vessels = mpSnapshot->rGetVessels();
+    const std::vector<unsigned>& r_start_nodes = mpSnapshot->rGetVesselStartNodes();
+    const std::vector<unsigned>& r_end_nodes = mpSnapshot->rGetVesselEndNodes();
+    const std::vector<double>& r_impedances = mpSnapshot->rGetImpedances();
+    std::vector<double>& r_flow_rates = mpSnapshot->rGetFlowRates();
+    for (unsigned vessel_index = 0; vessel_index < r_vessels.size(); vessel_index++)
     {
-        units::quantity<unit::pressure> start_node_pressure = mVessels[vessel_index]->GetStartNode()->GetFlowProperties()->GetPressure();
-        units::quantity<unit::pressure> end_node_pressure = mVessels[vessel_index]->GetEndNode()->GetFlowProperties()->GetPressure();
-        units::quantity<unit::flow_rate> flow_rate = (start_node_pressure - end_node_pressure) / mVessels[vessel_index]->GetFlowProperties()->GetImpedance();
+        double flow_rate = (r_pressures[r_start_nodes[vessel_index]] - r_pressures[r_end_nodes[vessel_index]]) / r_impedances[vessel_index];
 
         // Clean up small values as some structural adaptation calculators are sensitive to them.
-        if (fabs(flow_rate) < pow(10, -20)*unit::metre_cubed_per_second)
+        if (std::fabs(flow_rate) < pow(10, -20))
         {
-            flow_rate = 0.0 * unit::metre_cubed_per_second;
+            flow_rate = 0.0;
         }
+        r_flow_rates[vessel_index] = flow_rate;
 
-        std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = mVessels[vessel_index]->GetSegments();
-        units::quantity<unit::pressure> pressure = start_node_pressure;
+        std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = r_vessels[vessel_index]->GetSegments();
+        units::quantity<unit::pressure> pressure = r_pressures[r_start_nodes[vessel_index]] * unit::pascals;
         for (unsigned segment_index = 0; segment_index < segments.size() - 1; segment_index++)
         {
-            pressure -= segments[segment_index]->GetFlowProperties()->GetImpedance() * flow_rate;
+            pressure -= segments[segment_index]->GetFlowProperties()->GetImpedance() * flow_rate * unit::metre_cubed_per_second;
             segments[segment_index]->GetNode(1)->GetFlowProperties()->SetPressure(pressure);
-            segments[segment_index]->GetFlowProperties()->SetFlowRate(flow_rate);
         }
-        segments[segments.size() - 1]->GetFlowProperties()->SetFlowRate(flow_rate);
     }
-
-    // Clean up
-    PetscTools::Destroy(solution);
+    mpSnapshot->WriteFlowRates();
 }
 
 // Explicit instantiation
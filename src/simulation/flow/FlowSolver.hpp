@@ -37,8 +37,11 @@
 #define FLOWSOLVER_HPP_
 
 #include <vector>
+#include <map>
+#include <boost/unordered_map.hpp>
 #include "SmartPointers.hpp"
 #include "VesselNetwork.hpp"
+#include "VesselNetworkSnapshot.hpp"
 #include "Vessel.hpp"
 #include "VesselNode.hpp"
 #include "LinearSystem.hpp"
@@ -47,6 +50,10 @@
  * This solver calculates the pressures at nodes in a vessel network and flow rates in
  * vessels by assuming mass conservation over inflows and outflows at nodes and based
  * on prescribed pressures at inlet and outlet nodes.
+ *
+ * By default, tree-like parts of the network and unbranched chains of vessels are eliminated analytically
+ * before the remaining nodes are solved for, which greatly shrinks the linear system for mostly
+ * tree-like networks.
  */
 template<unsigned DIM>
 class FlowSolver
@@ -55,57 +62,326 @@ class FlowSolver
 private:
 
     /**
-     * Nodes in the vessel network. Stored in the flow solver to avoid
-     * recalculation by the vessel network class.
+     * The vessel network
      */
-    std::vector<boost::shared_ptr<VesselNode<DIM> > > mNodes;
+    boost::shared_ptr<VesselNetwork<DIM> > mpVesselNetwork;
 
     /**
-     * Vessels in the vessel network. Stored in the flow solver to avoid
-     * recalculation by the vessel network class.
+     * Flat copy of the network connectivity and flow data used to assemble the system. Stored in
+     * the flow solver to avoid walking the network graph on every update.
      */
-    std::vector<boost::shared_ptr<Vessel<DIM> > > mVessels;
+    boost::shared_ptr<VesselNetworkSnapshot<DIM> > mpSnapshot;
 
     /**
-     * The vessel network
+     * Indices of nodes on the network boundary
      */
-    boost::shared_ptr<VesselNetwork<DIM> > mpVesselNetwork;
+    std::vector<unsigned> mBoundaryConditionNodeIndices;
 
     /**
-     * A node-vessel connectivity map
+     * Whether the row for each node fixes its pressure, true for boundary condition nodes and nodes in
+     * connected components without a boundary condition, rather than balancing the flows into it
      */
-    std::vector<std::vector<unsigned> > mNodeVesselConnectivity;
+    std::vector<bool> mIsFixedPressureNode;
 
     /**
-     * A node-node connectivity map
+     * The edge that each vessel adds its conductance to. Parallel vessels between the same pair of nodes
+     * share an edge and vessels that start and end at the same node have none, marked by UINT_MAX.
      */
-    std::vector<std::vector<unsigned> > mNodeNodeConnectivity;
+    std::vector<unsigned> mVesselEdges;
 
     /**
-     * Indices of nodes on the network boundary
+     * The number of edges, including those joining the neighbours of nodes eliminated in series
      */
-    std::vector<unsigned> mBoundaryConditionNodeIndices;
+    unsigned mNumberOfEdges;
+
+    /**
+     * Nodes eliminated from the linear system, in the order they were removed
+     */
+    std::vector<unsigned> mEliminatedNodes;
+
+    /**
+     * The two neighbours of each eliminated node at the time it was removed, the second is UINT_MAX
+     * for a leaf node
+     */
+    std::vector<unsigned> mEliminationNeighbours;
+
+    /**
+     * For each eliminated node, the edges to its two neighbours followed by the edge between them that
+     * takes their series conductance, UINT_MAX where unused
+     */
+    std::vector<unsigned> mEliminationEdges;
+
+    /**
+     * The weight of the first neighbour's pressure in the pressure of each eliminated node
+     */
+    std::vector<double> mEliminationWeights;
+
+    /**
+     * Scaled conductances of the edges
+     */
+    std::vector<double> mEdgeConductances;
+
+    /**
+     * The node for each row of the reduced linear system
+     */
+    std::vector<unsigned> mSystemNodes;
+
+    /**
+     * The row of each node in the reduced linear system, UINT_MAX for eliminated nodes
+     */
+    std::vector<unsigned> mNodeRows;
+
+    /**
+     * Offsets of each row in the compressed sparse row pattern of the system matrix
+     */
+    std::vector<unsigned> mRowOffsets;
+
+    /**
+     * Column indices of the system matrix pattern, the diagonal comes first in each row
+     */
+    std::vector<unsigned> mColumnIndices;
+
+    /**
+     * The edge for each entry of the matrix pattern, UINT_MAX on the diagonal
+     */
+    std::vector<unsigned> mEntryEdges;
+
+    /**
+     * Offsets of each row's entries in mFixedNeighbours and mFixedNeighbourEdges
+     */
+    std::vector<unsigned> mFixedNeighbourOffsets;
+
+    /**
+     * Pressure boundary nodes next to each mass balance row, whose terms go on the right hand side
+     */
+    std::vector<unsigned> mFixedNeighbours;
+
+    /**
+     * The edge to each entry of mFixedNeighbours
+     */
+    std::vector<unsigned> mFixedNeighbourEdges;
+
+    /**
+     * Values of the system matrix, stored in the same order as the pattern
+     */
+    std::vector<double> mMatrixValues;
+
+    /**
+     * Whether each node had a velocity boundary condition when the solver was set up
+     */
+    std::vector<bool> mIsVelocityBoundaryNode;
+
+    /**
+     * Edges whose conductance appears in the system matrix, those next to at least one mass balance row
+     */
+    std::vector<unsigned> mSystemEdges;
+
+    /**
+     * The two rows joined by each entry of mSystemEdges
+     */
+    std::vector<unsigned> mSystemEdgeRows;
+
+    /**
+     * The node of each row of the most recently assembled matrix, empty if there is none
+     */
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > mFactorisedNodes;
+
+    /**
+     * Whether each row of the most recently assembled matrix is a mass balance row
+     */
+    std::vector<bool> mFactorisedRowIsBalance;
+
+    /**
+     * Whether the column of each row of the most recently assembled matrix has off-diagonal entries
+     */
+    std::vector<bool> mFactorisedRowHasColumn;
+
+    /**
+     * The two rows joined by each edge in the most recently assembled matrix
+     */
+    std::vector<unsigned> mFactorisedEdgeRows;
+
+    /**
+     * The conductance of each edge in the most recently assembled matrix
+     */
+    std::vector<double> mFactorisedConductances;
+
+    /**
+     * The row of each system row in the assembled matrix bordered by the rows which are new since it was
+     * assembled. Empty if the rows and edges are unchanged.
+     */
+    std::vector<unsigned> mExtendedRows;
+
+    /**
+     * The system rows bordered onto the assembled matrix
+     */
+    std::vector<unsigned> mBorderRows;
+
+    /**
+     * The scaling applied to the conductances in the most recently assembled matrix
+     */
+    double mConductanceScale;
+
+    /**
+     * The right hand side of the system
+     */
+    std::vector<double> mRhsValues;
 
     /**
-     * Indices of nodes that are not connected to the rest of the network
+     * The maximum number of conductance changes applied as low-rank corrections to the assembled matrix
+     * before it is assembled and factorised again
      */
-    std::vector<unsigned> mUnconnectedNodeIndices;
+    unsigned mMaxLowRankUpdates;
 
     /**
-     * The linear system to be solved for the nodal pressures
+     * For each pending low-rank change, the two rows of its row vector followed by the two columns of
+     * its column vector, UINT_MAX where unused
+     */
+    std::vector<unsigned> mLowRankRows;
+
+    /**
+     * The coefficients for each entry of mLowRankRows
+     */
+    std::vector<double> mLowRankCoefficients;
+
+    /**
+     * The conductance change of each pending low-rank change
+     */
+    std::vector<double> mLowRankChanges;
+
+    /**
+     * Whether the matrix has been written since the last solve, so needs factorising again
+     */
+    bool mMatrixIsChanged;
+
+    /**
+     * The linear system to be solved for the nodal pressures. It is kept between set ups while its sparsity
+     * pattern is unchanged, so that its matrix storage and solver factorisation can be reused.
      */
     boost::shared_ptr<LinearSystem> mpLinearSystem;
 
+    /**
+     * Whether the linear system has the rows and sparsity pattern of the current system, rather than of an
+     * earlier system which is still factorised
+     */
+    bool mLinearSystemMatchesPattern;
+
     /**
      * Whether to use a direct or iterative solver, the former is recommended.
      */
     bool mUseDirectSolver;
 
+    /**
+     * Whether the current linear system is solved iteratively, in which case the previous pressures are
+     * used as the initial guess.
+     */
+    bool mSolveIsIterative;
+
+    /**
+     * Whether to eliminate trees and chains of vessels before solving.
+     */
+    bool mEliminateTreesAndChains;
+
     /**
      * Has the solver been set up.
      */
     bool mIsSetUp;
 
+    /**
+     * Eliminate free nodes with one or two neighbours until none are left. Leaves take the pressure of their
+     * neighbour and nodes in series are replaced by an edge between their neighbours with the series
+     * conductance, so pendant trees and unbranched chains are removed from the linear system.
+     * @param rAdjacency the edge to each neighbour of each node, updated as nodes are removed
+     * @param rIsKept whether each node must stay in the system
+     * @param rIsEliminated set true for each eliminated node
+     */
+    void EliminateTreesAndChains(std::vector<std::map<unsigned, unsigned> >& rAdjacency,
+            const std::vector<bool>& rIsKept, std::vector<bool>& rIsEliminated);
+
+    /**
+     * Create the linear system for the current sparsity pattern
+     */
+    void CreateLinearSystem();
+
+    /**
+     * Forget the most recently assembled matrix
+     */
+    void ClearFactorisedSystem();
+
+    /**
+     * Match the rows of the current system to those of the most recently assembled matrix, so that changes
+     * in topology can be applied as low-rank corrections. Rows of new nodes are bordered onto the matrix.
+     * @return false if the systems can not be matched, in which case the assembled matrix is forgotten
+     */
+    bool MapToFactorisedSystem();
+
+    /**
+     * Set the edge conductances from the current impedances and replay the eliminations
+     * @param scale the scaling applied to the conductances
+     */
+    void UpdateConductances(double scale);
+
+    /**
+     * Record a low-rank change to the assembled matrix for a change in the conductance between two rows
+     * @param row1 the first row
+     * @param row2 the second row
+     * @param change the change in conductance
+     */
+    void AddLowRankChange(unsigned row1, unsigned row2, double change);
+
+    /**
+     * Record a low-rank change to a diagonal entry of the assembled matrix
+     * @param row the row
+     * @param change the change in the entry
+     */
+    void AddLowRankDiagonalChange(unsigned row, double change);
+
+    /**
+     * Record the low-rank changes taking the assembled matrix, bordered by the rows of new nodes, to the
+     * current system. Removed edges have their conductance taken away, rows which have left the system are
+     * decoupled with a unit diagonal and new rows replace their unit diagonal with their edges.
+     */
+    void AddLowRankTopologyChanges();
+
+    /**
+     * Solve with the assembled matrix bordered by an identity block for the rows of new nodes
+     * @param rRhs the right hand side
+     * @param rSolution the solution
+     */
+    void SolveWithFactorisedSystem(const std::vector<double>& rRhs, std::vector<double>& rSolution);
+
+    /**
+     * Write the right hand side of the system
+     * @param rBoundaryPressures the pressure of each node, only used at pressure boundary nodes
+     */
+    void AssembleRhs(const std::vector<double>& rBoundaryPressures);
+
+    /**
+     * Write the matrix from the current edge conductances
+     */
+    void AssembleMatrix();
+
+    /**
+     * Solve the linear system with its current right hand side
+     * @param rSolution the solution
+     */
+    void SolveLinearSystem(std::vector<double>& rSolution);
+
+    /**
+     * Solve the system with its current right hand side, applying any pending low-rank changes, and
+     * back-substitute the pressures of the eliminated nodes
+     * @param rPressures the pressure of each node
+     */
+    void SolveForNodePressures(std::vector<double>& rPressures);
+
+    /**
+     * Solve the system with the pending low-rank changes applied to the assembled matrix, using the
+     * Sherman-Morrison-Woodbury identity
+     * @param rSolution the solution
+     * @return false if the changed matrix is close to singular, in which case there is no solution
+     */
+    bool SolveWithLowRankCorrections(std::vector<double>& rSolution);
+
 public:
 
     /**
@@ -125,13 +401,48 @@ public:
     static boost::shared_ptr<FlowSolver<DIM> > Create();
 
     /**
-     * Set whether to use a direct solver, an iterative one is used if false (not recommended).
+     * @return the nodes with boundary conditions, in the order used by SolveForBoundaryPressures
+     */
+    std::vector<boost::shared_ptr<VesselNode<DIM> > > GetBoundaryConditionNodes();
+
+    /**
+     * @return the number of nodes in the linear system after trees and chains have been eliminated
+     */
+    unsigned GetNumberOfSystemNodes() const;
+
+    /**
+     * Set whether to eliminate trees and chains of vessels before solving, default true. Only the
+     * remaining nodes are solved for, the pressures of the others follow by back-substitution.
+     * @param eliminateTreesAndChains whether to eliminate trees and chains
+     */
+    void SetEliminateTreesAndChains(bool eliminateTreesAndChains);
+
+    /**
+     * Set the maximum number of vessel conductance changes that are applied as low-rank corrections to
+     * the factorised matrix in Update, default 0. Each correction costs one extra solve with the existing
+     * factorisation, so a few changes between solves, such as a vessel being pruned or occluded, avoid a
+     * new factorisation. Changes in topology are applied the same way: a removed vessel is a conductance
+     * change to zero and the nodes of a new vessel, such as after an anastamosis, are bordered onto the
+     * factorised matrix. The matrix is assembled and factorised again when there are more changes. Only
+     * used with the direct solver and without velocity boundary conditions.
+     * @param maxLowRankUpdates the maximum number of changes
+     */
+    void SetMaxLowRankUpdates(unsigned maxLowRankUpdates);
+
+    /**
+     * Set whether to use a direct solver, an iterative one is used if false. Without velocity boundary
+     * conditions the iterative solver is conjugate gradients with algebraic multigrid preconditioning, using
+     * hypre BoomerAMG or PETSc GAMG when available, which needs much less memory than a direct solve on large
+     * networks. The previous pressures are used as the initial guess.
      * @param useDirectSolver whether to use a direct solver
      */
     void SetUseDirectSolver(bool useDirectSolver);
 
     /**
-     * Set up the flow solver. Called the first time the solver is run.
+     * Set up the flow solver. Called the first time the solver is run and whenever the network topology has changed.
+     * The linear system is only rebuilt if its sparsity pattern has changed, so calling this after changing
+     * boundary conditions usually keeps the existing matrix and factorisation structure. With low-rank updates
+     * the factorised matrix is kept even if the pattern has changed, see SetMaxLowRankUpdates.
      */
     void SetUp();
 
@@ -147,9 +458,23 @@ public:
     void Solve();
 
     /**
-     * Update the solver prior to each run.
-     * @param runSetup whether to do a full SetUp or just update the impedances. The former is needed for
-     * angiogenesis simulations.
+     * Solve the network for several sets of boundary pressures, factorising the matrix once and re-using it
+     * for each set. The network is not changed and velocity boundary conditions keep their current values.
+     * @param rBoundaryPressures for each scenario, the pressure in Pa at each node in GetBoundaryConditionNodes
+     * @param rPressures for each scenario, the pressure in Pa at each vessel end node, in the order of the
+     * network's GetVesselEndNodes
+     * @param rFlowRates for each scenario, the flow rate in m^3/s of each vessel, in the order of the
+     * network's GetVessels
+     */
+    void SolveForBoundaryPressures(const std::vector<std::vector<double> >& rBoundaryPressures,
+            std::vector<std::vector<double> >& rPressures, std::vector<std::vector<double> >& rFlowRates);
+
+    /**
+     * Update the solver prior to each run. The eliminations are replayed with the current impedances and the
+     * matrix values are overwritten in place, unless few enough conductances have changed to apply them as
+     * low-rank corrections.
+     * @param runSetup whether to do a full SetUp or just update the impedances. A full SetUp is also done if
+     * the network topology has changed since the last one.
      */
     void Update(bool runSetup=false);
 };
@@ -0,0 +1,90 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include "SmallDenseLinearSolver.hpp"
+
+bool SmallDenseLinearSolver::Solve(std::vector<std::vector<double> >& rAugmentedMatrix, std::vector<double>& rSolution,
+                                   double relativeTolerance)
+{
+    unsigned size = rAugmentedMatrix.size();
+    double max_entry = 0.0;
+    for (unsigned row = 0; row < size; row++)
+    {
+        for (unsigned col = 0; col < size; col++)
+        {
+            max_entry = std::max(max_entry, std::fabs(rAugmentedMatrix[row][col]));
+        }
+    }
+
+    for (unsigned pivot = 0; pivot < size; pivot++)
+    {
+        unsigned best = pivot;
+        for (unsigned row = pivot + 1; row < size; row++)
+        {
+            if (std::fabs(rAugmentedMatrix[row][pivot]) > std::fabs(rAugmentedMatrix[best][pivot]))
+            {
+                best = row;
+            }
+        }
+        if (std::fabs(rAugmentedMatrix[best][pivot]) <= relativeTolerance * max_entry)
+        {
+            return false;
+        }
+        std::swap(rAugmentedMatrix[pivot], rAugmentedMatrix[best]);
+        for (unsigned row = pivot + 1; row < size; row++)
+        {
+            double factor = rAugmentedMatrix[row][pivot] / rAugmentedMatrix[pivot][pivot];
+            for (unsigned col = pivot; col <= size; col++)
+            {
+                rAugmentedMatrix[row][col] -= factor * rAugmentedMatrix[pivot][col];
+            }
+        }
+    }
+
+    rSolution.resize(size);
+    for (unsigned row = size; row-- > 0; )
+    {
+        double value = rAugmentedMatrix[row][size];
+        for (unsigned col = row + 1; col < size; col++)
+        {
+            value -= rAugmentedMatrix[row][col] * rSolution[col];
+        }
+        rSolution[row] = value / rAugmentedMatrix[row][row];
+    }
+    return true;
+}
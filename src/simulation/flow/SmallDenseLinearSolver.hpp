@@ -0,0 +1,63 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef SMALLDENSELINEARSOLVER_HPP_
+#define SMALLDENSELINEARSOLVER_HPP_
+
+#include <vector>
+
+/**
+ * Solves small dense linear systems, such as those built from a handful of correction vectors, by Gaussian
+ * elimination with partial pivoting. A system is treated as singular if a pivot is small relative to the largest
+ * entry of the matrix, so the test does not depend on the units the entries are expressed in.
+ */
+class SmallDenseLinearSolver
+{
+
+public:
+
+    /**
+     * Solve a system held as an augmented matrix, with the right hand side in the last column of each row
+     * @param rAugmentedMatrix the rows of the matrix and right hand side, these are overwritten by the elimination
+     * @param rSolution the solution
+     * @param relativeTolerance the smallest pivot accepted, relative to the largest matrix entry
+     * @return false if the matrix is singular or close to it, in which case the solution is not set
+     */
+    static bool Solve(std::vector<std::vector<double> >& rAugmentedMatrix, std::vector<double>& rSolution,
+                      double relativeTolerance = 1.e-12);
+};
+
+#endif /* SMALLDENSELINEARSOLVER_HPP_ */
@@ -85,7 +85,7 @@ void MechanicalStimulusCalculator<DIM>::SetTauP(units::quantity<unit::pressure>
 template<unsigned DIM>
 void MechanicalStimulusCalculator<DIM>::Calculate()
 {
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = this->mpNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = this->mpNetwork->rGetVesselSegments();
 
     for (unsigned idx = 0; idx < segments.size(); idx++)
     {
@@ -98,7 +98,7 @@ void MetabolicStimulusCalculator<DIM>::SetMaxStimulus(units::quantity<unit::rate
 template<unsigned DIM>
 void MetabolicStimulusCalculator<DIM>::Calculate()
 {
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = this->mpNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = this->mpNetwork->rGetVesselSegments();
     for (unsigned idx = 0; idx < segments.size(); idx++)
     {
         units::quantity<unit::rate> metabolic_stimulus;
@@ -71,7 +71,7 @@ void ShrinkingStimulusCalculator<DIM>::SetStimulus(units::quantity<unit::rate> s
 template<unsigned DIM>
 void ShrinkingStimulusCalculator<DIM>::Calculate()
 {
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = this->mpNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = this->mpNetwork->rGetVesselSegments();
     for (unsigned segment_index = 0; segment_index < segments.size(); segment_index++)
     {
         segments[segment_index]->GetFlowProperties()->SetGrowthStimulus(segments[segment_index]->GetFlowProperties()->GetGrowthStimulus() - mDefaultStimulus);
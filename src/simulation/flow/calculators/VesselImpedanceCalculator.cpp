@@ -59,7 +59,7 @@ boost::shared_ptr<VesselImpedanceCalculator<DIM> > VesselImpedanceCalculator<DIM
 template<unsigned DIM>
 void VesselImpedanceCalculator<DIM>::Calculate()
 {
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = this->mpNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = this->mpNetwork->rGetVesselSegments();
     for (unsigned idx = 0; idx < segments.size(); idx++)
     {
         units::quantity<unit::dynamic_viscosity> viscosity = segments[idx]->GetFlowProperties()->GetViscosity();
@@ -66,7 +66,7 @@ void ViscosityCalculator<DIM>::SetPlasmaViscosity(units::quantity<unit::dynamic_
 template<unsigned DIM>
 void ViscosityCalculator<DIM>::Calculate()
 {
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = this->mpNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = this->mpNetwork->rGetVesselSegments();
     for (unsigned segment_index = 0; segment_index < segments.size(); segment_index++)
     {
         units::quantity<unit::length> radius = segments[segment_index]->GetRadius();
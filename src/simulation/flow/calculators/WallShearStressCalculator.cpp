@@ -58,7 +58,7 @@ boost::shared_ptr<WallShearStressCalculator<DIM> > WallShearStressCalculator<DIM
 template<unsigned DIM>
 void WallShearStressCalculator<DIM>::Calculate()
 {
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = this->mpNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = this->mpNetwork->rGetVesselSegments();
     for (unsigned segment_index = 0; segment_index < segments.size(); segment_index++)
     {
         units::quantity<unit::flow_rate> flow_rate = units::fabs(segments[segment_index]->GetFlowProperties()->GetFlowRate());
@@ -57,7 +57,7 @@ template<unsigned DIM>
 void AlarconHaematocritSolver<DIM>::Calculate()
 {
     // Give the vessels unique Ids
-    std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = this->mpNetwork->GetVessels();
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& vessels = this->mpNetwork->rGetVessels();
     for(unsigned idx=0; idx<vessels.size(); idx++)
     {
         vessels[idx]->SetId(idx);
@@ -122,7 +122,7 @@ void AlarconHaematocritSolver<DIM>::Calculate()
             {
                 std::vector<boost::shared_ptr<Vessel<DIM> > > parent_vessels;
                 std::vector<boost::shared_ptr<Vessel<DIM> > > competitor_vessels;
-                for(unsigned jdx=0; jdx<p_inflow_node->GetSegments().size(); jdx++)
+                for(unsigned jdx=0; jdx<p_inflow_node->GetNumberOfSegments(); jdx++)
                 {
                     // if not this vessel
                     if(p_inflow_node->GetSegment(jdx)->GetVessel()!=vessels[idx])
@@ -221,7 +221,7 @@ void AlarconHaematocritSolver<DIM>::Calculate()
     {
         for (unsigned jdx = 0; jdx < vessels[idx]->GetNumberOfSegments(); jdx++)
         {
-            vessels[idx]->GetSegments()[jdx]->GetFlowProperties()->SetHaematocrit(a[idx]);
+            vessels[idx]->GetSegment(jdx)->GetFlowProperties()->SetHaematocrit(a[idx]);
         }
     }
 
@@ -42,7 +42,8 @@ template<unsigned DIM>
 BetteridgeHaematocritSolver<DIM>::BetteridgeHaematocritSolver() : AbstractHaematocritSolver<DIM>(),
     mTHR(2.5),
     mAlpha(0.5),
-    mHaematocrit(0.45)
+    mHaematocrit(0.45),
+    mpSnapshot(VesselNetworkSnapshot<DIM>::Create())
 {
 
 }
@@ -74,17 +75,27 @@ void BetteridgeHaematocritSolver<DIM>::SetHaematocrit(units::quantity<unit::dime
 template<unsigned DIM>
 void BetteridgeHaematocritSolver<DIM>::Calculate()
 {
+    mpSnapshot->SetVesselNetwork(this->mpNetwork);
+    mpSnapshot->Update();
+    const std::vector<boost::shared_ptr<Vessel<DIM> > >& r_vessels = mpSnapshot->rGetVessels();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = mpSnapshot->rGetNodes();
+    const std::vector<unsigned>& r_start_nodes = mpSnapshot->rGetVesselStartNodes();
+    const std::vector<unsigned>& r_end_nodes = mpSnapshot->rGetVesselEndNodes();
+    const std::vector<unsigned>& r_node_offsets = mpSnapshot->rGetNodeOffsets();
+    const std::vector<unsigned>& r_node_vessels = mpSnapshot->rGetNodeVessels();
+    const std::vector<double>& r_flow_rates = mpSnapshot->rGetFlowRates();
+    std::vector<double>& r_haematocrits = mpSnapshot->rGetHaematocrits();
+
     // Give the vessels unique Ids
-    std::vector<boost::shared_ptr<Vessel<DIM> > > vessels = this->mpNetwork->GetVessels();
-    for(unsigned idx=0; idx<vessels.size(); idx++)
+    for(unsigned idx=0; idx<r_vessels.size(); idx++)
     {
-        vessels[idx]->SetId(idx);
+        r_vessels[idx]->SetId(idx);
     }
 
     // Set up the linear system
-    PetscInt lhsVectorSize = vessels.size();
+    PetscInt lhsVectorSize = r_vessels.size();
     unsigned max_vessels_per_branch = 5;
-    if(vessels.size() < max_vessels_per_branch)
+    if(r_vessels.size() < max_vessels_per_branch)
     {
         max_vessels_per_branch  = unsigned(lhsVectorSize);
     }
@@ -99,75 +110,68 @@ void BetteridgeHaematocritSolver<DIM>::Calculate()
     }
 
     std::vector<std::vector<unsigned> > update_indices;
-    for(unsigned idx=0; idx<vessels.size(); idx++)
+    for(unsigned idx=0; idx<r_vessels.size(); idx++)
     {
         // Always have a diagonal entry for system, this sets zero haematocrit by default
         linearSystem.SetMatrixElement(idx, idx, 1);
-        if(vessels[idx]->GetStartNode()->GetFlowProperties()->IsInputNode() or vessels[idx]->GetEndNode()->GetFlowProperties()->IsInputNode())
+        if(r_nodes[r_start_nodes[idx]]->GetFlowProperties()->IsInputNode() or r_nodes[r_end_nodes[idx]]->GetFlowProperties()->IsInputNode())
         {
             linearSystem.SetRhsVectorElement(idx, mHaematocrit);
         }
         // Set rhs to zero, it should already be zero but this explicitly captures the no flow case
-        else if(vessels[idx]->GetFlowProperties()->GetFlowRate()==0.0*unit::metre_cubed_per_second)
+        else if(r_flow_rates[idx]==0.0)
         {
             linearSystem.SetRhsVectorElement(idx, 0.0);
         }
         else
         {
             // Identify inflow node
-            boost::shared_ptr<VesselNode<DIM> > p_inflow_node;
-            units::quantity<unit::flow_rate> flow_rate= vessels[idx]->GetFlowProperties()->GetFlowRate();
-            if(flow_rate >0 * unit::metre_cubed_per_second)
-            {
-                p_inflow_node = vessels[idx]->GetStartNode();
-            }
-            else
-            {
-                p_inflow_node = vessels[idx]->GetEndNode();
-            }
+            double flow_rate = r_flow_rates[idx];
+            unsigned inflow_node = (flow_rate > 0.0) ? r_start_nodes[idx] : r_end_nodes[idx];
 
             // Identify number of inflow and outflow vessels
-            if(p_inflow_node->GetNumberOfSegments()>1)
+            if(r_node_offsets[inflow_node+1] - r_node_offsets[inflow_node] > 1)
             {
-                std::vector<boost::shared_ptr<Vessel<DIM> > > parent_vessels;
-                std::vector<boost::shared_ptr<Vessel<DIM> > > competitor_vessels;
-                for(unsigned jdx=0; jdx<p_inflow_node->GetSegments().size(); jdx++)
+                std::vector<unsigned> parent_vessels;
+                std::vector<unsigned> competitor_vessels;
+                for(unsigned entry=r_node_offsets[inflow_node]; entry<r_node_offsets[inflow_node+1]; entry++)
                 {
                     // if not this vessel
-                    if(p_inflow_node->GetSegment(jdx)->GetVessel()!=vessels[idx])
+                    unsigned other_vessel = r_node_vessels[entry];
+                    if(other_vessel != idx)
                     {
-                        units::quantity<unit::flow_rate> inflow_rate = p_inflow_node->GetSegment(jdx)->GetVessel()->GetFlowProperties()->GetFlowRate();
-                        if(p_inflow_node->GetSegment(jdx)->GetVessel()->GetEndNode()==p_inflow_node)
+                        double inflow_rate = r_flow_rates[other_vessel];
+                        if(r_end_nodes[other_vessel] == inflow_node)
                         {
-                            if(inflow_rate>0.0 * unit::metre_cubed_per_second)
+                            if(inflow_rate>0.0)
                             {
-                                parent_vessels.push_back(p_inflow_node->GetSegment(jdx)->GetVessel());
+                                parent_vessels.push_back(other_vessel);
                             }
-                            else if(inflow_rate<0.0 * unit::metre_cubed_per_second)
+                            else if(inflow_rate<0.0)
                             {
-                                competitor_vessels.push_back(p_inflow_node->GetSegment(jdx)->GetVessel());
+                                competitor_vessels.push_back(other_vessel);
                             }
                         }
-                        if(p_inflow_node->GetSegment(jdx)->GetVessel()->GetStartNode()==p_inflow_node)
+                        if(r_start_nodes[other_vessel] == inflow_node)
                         {
-                            if(inflow_rate>0.0 * unit::metre_cubed_per_second)
+                            if(inflow_rate>0.0)
                             {
-                                competitor_vessels.push_back(p_inflow_node->GetSegment(jdx)->GetVessel());
+                                competitor_vessels.push_back(other_vessel);
                             }
-                            else if(inflow_rate<0.0 * unit::metre_cubed_per_second)
+                            else if(inflow_rate<0.0)
                             {
-                                parent_vessels.push_back(p_inflow_node->GetSegment(jdx)->GetVessel());
+                                parent_vessels.push_back(other_vessel);
                             }
                         }
                     }
                 }
 
                 // If there are no competitor vessels the haematocrit is just the sum of the parent values
-                if(competitor_vessels.size()==0 or units::fabs(competitor_vessels[0]->GetFlowProperties()->GetFlowRate()) == 0.0 * unit::metre_cubed_per_second)
+                if(competitor_vessels.size()==0 or std::fabs(r_flow_rates[competitor_vessels[0]]) == 0.0)
                 {
                     for(unsigned jdx=0; jdx<parent_vessels.size();jdx++)
                     {
-                        linearSystem.SetMatrixElement(idx, parent_vessels[jdx]->GetId(), -fabs(parent_vessels[jdx]->GetFlowProperties()->GetFlowRate()/flow_rate));
+                        linearSystem.SetMatrixElement(idx, parent_vessels[jdx], -std::fabs(r_flow_rates[parent_vessels[jdx]]/flow_rate));
                     }
                 }
                 else
@@ -176,39 +180,16 @@ void BetteridgeHaematocritSolver<DIM>::Calculate()
                     {
                         EXCEPTION("This solver can only work with branches with connectivity 3");
                     }
-                    units::quantity<unit::flow_rate> competitor0_flow_rate = competitor_vessels[0]->GetFlowProperties()->GetFlowRate();
-                    units::quantity<unit::flow_rate> parent0_flow_rate = parent_vessels[0]->GetFlowProperties()->GetFlowRate();
 
                     // There is a bifurcation, apply a haematocrit splitting rule
-                    units::quantity<unit::length> my_radius = vessels[idx]->GetRadius();
-                    units::quantity<unit::length> competitor_radius = competitor_vessels[0]->GetRadius();
-                    units::quantity<unit::velocity> my_velocity = units::fabs(flow_rate)/(M_PI * my_radius * my_radius);
-                    units::quantity<unit::velocity> competitor_velocity = fabs(competitor0_flow_rate)/(M_PI * competitor_radius * competitor_radius);
-
-                    units::quantity<unit::dimensionless> alpha = 1.0 - parent_vessels[0]->GetFlowProperties()->GetHaematocrit();
-                    units::quantity<unit::dimensionless> flow_ratio_pm = fabs(parent0_flow_rate)/fabs(flow_rate);
-                    units::quantity<unit::dimensionless> flow_ratio_cm = fabs(competitor0_flow_rate)/fabs(flow_rate);
-                    double numer = flow_ratio_pm;
-
-                    // Apply fungs rule to faster vessel
-                    if(my_velocity >= competitor_velocity)
-                    {
-                        units::quantity<unit::dimensionless> term = alpha * (my_velocity/competitor_velocity-1.0);
-                        double denom = 1.0+flow_ratio_cm*(1.0/(1.0+term));
-                        linearSystem.SetMatrixElement(idx, parent_vessels[0]->GetId(), -numer/denom);
-                    }
-                    else
-                    {
-                        units::quantity<unit::dimensionless> term = alpha * (competitor_velocity/my_velocity-1.0);
-                        double denom = 1.0+flow_ratio_cm*(1.0+term);
-                        linearSystem.SetMatrixElement(idx, parent_vessels[0]->GetId(), -numer/denom);
-                    }
+                    linearSystem.SetMatrixElement(idx, parent_vessels[0],
+                            -GetSplittingCoefficient(idx, parent_vessels[0], competitor_vessels[0]));
 
                     // Save the indices for later updating
                     std::vector<unsigned> local_update_indics = std::vector<unsigned>(3);
                     local_update_indics[0] = idx;
-                    local_update_indics[1] = parent_vessels[0]->GetId();
-                    local_update_indics[2] = competitor_vessels[0]->GetId();
+                    local_update_indics[1] = parent_vessels[0];
+                    local_update_indics[2] = competitor_vessels[0];
                     update_indices.push_back(local_update_indics);
                 }
             }
@@ -229,69 +210,74 @@ void BetteridgeHaematocritSolver<DIM>::Calculate()
             linearSystem.SwitchWriteModeLhsMatrix();
             for(unsigned idx=0; idx<update_indices.size();idx++)
             {
-                units::quantity<unit::flow_rate> self_flow_rate = vessels[update_indices[idx][0]]->GetFlowProperties()->GetFlowRate();
-                units::quantity<unit::flow_rate> competitor0_flow_rate = vessels[update_indices[idx][2]]->GetFlowProperties()->GetFlowRate();
-                units::quantity<unit::flow_rate> parent0_flow_rate = vessels[update_indices[idx][1]]->GetFlowProperties()->GetFlowRate();
-
-                units::quantity<unit::length> my_radius = vessels[update_indices[idx][0]]->GetRadius();
-                units::quantity<unit::length> competitor_radius = vessels[update_indices[idx][2]]->GetRadius();
-                units::quantity<unit::velocity> my_velocity = fabs(self_flow_rate)/(M_PI * my_radius * my_radius);
-                units::quantity<unit::velocity> competitor_velocity = fabs(competitor0_flow_rate)/(M_PI * competitor_radius * competitor_radius);
-                units::quantity<unit::dimensionless> alpha = 1.0 - vessels[update_indices[idx][1]]->GetFlowProperties()->GetHaematocrit();
-
-                double flow_ratio_pm = fabs(parent0_flow_rate/self_flow_rate);
-                double flow_ratio_cm = fabs(competitor0_flow_rate/self_flow_rate);
-                double numer = flow_ratio_pm;
-
-                // Apply fungs rule to faster vessel
-                if(my_velocity >= competitor_velocity)
-                {
-                    double term = alpha * (my_velocity/competitor_velocity-1.0);
-                    double denom = 1.0+flow_ratio_cm*(1.0/(1.0+term));
-                    linearSystem.SetMatrixElement(update_indices[idx][0], update_indices[idx][1], -numer/denom);
-                }
-                else
-                {
-                    double term = alpha * (competitor_velocity/my_velocity-1.0);
-                    double denom = 1.0+flow_ratio_cm*(1.0+term);
-                    linearSystem.SetMatrixElement(update_indices[idx][0], update_indices[idx][1], -numer/denom);
-                }
+                linearSystem.SetMatrixElement(update_indices[idx][0], update_indices[idx][1],
+                        -GetSplittingCoefficient(update_indices[idx][0], update_indices[idx][1], update_indices[idx][2]));
             }
         }
 
-        Vec solution = PetscTools::CreateVec(vessels.size());
+        Vec solution = PetscTools::CreateVec(r_vessels.size());
         linearSystem.AssembleFinalLinearSystem();
         solution = linearSystem.Solve();
         ReplicatableVector a(solution);
 
-        // Get the residual
+        // Get the residual and update the haematocrit levels
         residual = 0.0;
-        for (unsigned i = 0; i < vessels.size(); i++)
+        for (unsigned i = 0; i < r_vessels.size(); i++)
         {
-            if(fabs(vessels[i]->GetFlowProperties()->GetHaematocrit() - a[i]) > residual)
+            if(std::fabs(r_haematocrits[i] - a[i]) > residual)
             {
-                residual = fabs(vessels[i]->GetFlowProperties()->GetHaematocrit() - a[i]);
-            }
-        }
-
-        // assign haematocrit levels to vessels
-        for (unsigned idx = 0; idx < vessels.size(); idx++)
-        {
-            for (unsigned jdx = 0; jdx < vessels[idx]->GetNumberOfSegments(); jdx++)
-            {
-                vessels[idx]->GetSegments()[jdx]->GetFlowProperties()->SetHaematocrit(a[idx]);
+                residual = std::fabs(r_haematocrits[i] - a[i]);
             }
+            r_haematocrits[i] = a[i];
         }
+        PetscTools::Destroy(solution);
 
         iterations++;
         if(iterations == max_iterations)
         {
+            mpSnapshot->WriteHaematocrits();
             EXCEPTION("Haematocrit calculation failed to converge.");
         }
+    }
 
-        PetscTools::Destroy(solution);
+    // assign haematocrit levels to vessels
+    mpSnapshot->WriteHaematocrits();
+}
+
+template<unsigned DIM>
+double BetteridgeHaematocritSolver<DIM>::GetSplittingCoefficient(unsigned vesselIndex, unsigned parentIndex, unsigned competitorIndex)
+{
+    const std::vector<double>& r_flow_rates = mpSnapshot->rGetFlowRates();
+    const std::vector<double>& r_radii = mpSnapshot->rGetRadii();
+    double self_flow_rate = r_flow_rates[vesselIndex];
+    double competitor_flow_rate = r_flow_rates[competitorIndex];
+    double parent_flow_rate = r_flow_rates[parentIndex];
+
+    double my_radius = r_radii[vesselIndex];
+    double competitor_radius = r_radii[competitorIndex];
+    double my_velocity = std::fabs(self_flow_rate)/(M_PI * my_radius * my_radius);
+    double competitor_velocity = std::fabs(competitor_flow_rate)/(M_PI * competitor_radius * competitor_radius);
+    double alpha = 1.0 - mpSnapshot->rGetHaematocrits()[parentIndex];
+
+    double flow_ratio_pm = std::fabs(parent_flow_rate/self_flow_rate);
+    double flow_ratio_cm = std::fabs(competitor_flow_rate/self_flow_rate);
+    double numer = flow_ratio_pm;
+
+    // Apply fungs rule to faster vessel
+    if(my_velocity >= competitor_velocity)
+    {
+        double term = alpha * (my_velocity/competitor_velocity-1.0);
+        double denom = 1.0+flow_ratio_cm*(1.0/(1.0+term));
+        return numer/denom;
+    }
+    else
+    {
+        double term = alpha * (competitor_velocity/my_velocity-1.0);
+        double denom = 1.0+flow_ratio_cm*(1.0+term);
+        return numer/denom;
     }
 }
+
 // Explicit instantiation
 template class BetteridgeHaematocritSolver<2>;
 template class BetteridgeHaematocritSolver<3>;
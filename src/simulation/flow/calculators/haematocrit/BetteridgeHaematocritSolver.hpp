@@ -39,6 +39,7 @@
 #include "SmartPointers.hpp"
 #include "AbstractHaematocritSolver.hpp"
 #include "UnitCollection.hpp"
+#include "VesselNetworkSnapshot.hpp"
 
 /**
  * This solver calculates the distribution of haematocrit in branching vessel networks according to:
@@ -48,7 +49,7 @@ template<unsigned DIM>
 class BetteridgeHaematocritSolver : public AbstractHaematocritSolver<DIM>
 {
 
-private:
+protected:
 
     /**
      * The threshold velocity ratio at which all haematocrit goes into the faster vessel
@@ -65,6 +66,21 @@ private:
      */
     units::quantity<unit::dimensionless> mHaematocrit;
 
+    /**
+     * Flat copy of the network connectivity, flow rates, radii and haematocrits used in the solve
+     */
+    boost::shared_ptr<VesselNetworkSnapshot<DIM> > mpSnapshot;
+
+    /**
+     * Return the fraction of the parent vessel's haematocrit flux taken by a vessel at a bifurcation,
+     * using the current flow rates and haematocrits in the snapshot
+     * @param vesselIndex the vessel
+     * @param parentIndex the parent vessel
+     * @param competitorIndex the competitor vessel
+     * @return the splitting coefficient
+     */
+    double GetSplittingCoefficient(unsigned vesselIndex, unsigned parentIndex, unsigned competitorIndex);
+
 public:
 
     /**
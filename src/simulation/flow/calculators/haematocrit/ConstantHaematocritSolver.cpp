@@ -65,7 +65,7 @@ void ConstantHaematocritSolver<DIM>::SetHaematocrit(units::quantity<unit::dimens
 template<unsigned DIM>
 void ConstantHaematocritSolver<DIM>::Calculate()
 {
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = this->mpNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = this->mpNetwork->rGetVesselSegments();
 
     for (unsigned segment_index = 0; segment_index < segments.size(); segment_index++)
     {
@@ -0,0 +1,267 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#include <climits>
+#include <cmath>
+#include <deque>
+#include <algorithm>
+#include "PhaseSeparationHaematocritSolver.hpp"
+#include "Exception.hpp"
+
+template<unsigned DIM>
+PhaseSeparationHaematocritSolver<DIM>::PhaseSeparationHaematocritSolver() : AbstractHaematocritSolver<DIM>(),
+    mHaematocrit(0.45),
+    mTolerance(1.e-6),
+    mMaxIterations(1000),
+    mNumberOfNodeUpdates(0),
+    mpSnapshot(VesselNetworkSnapshot<DIM>::Create())
+{
+
+}
+
+template<unsigned DIM>
+PhaseSeparationHaematocritSolver<DIM>::~PhaseSeparationHaematocritSolver()
+{
+
+}
+
+template <unsigned DIM>
+boost::shared_ptr<PhaseSeparationHaematocritSolver<DIM> > PhaseSeparationHaematocritSolver<DIM>::Create()
+{
+    MAKE_PTR(PhaseSeparationHaematocritSolver<DIM>, pSelf);
+    return pSelf;
+}
+
+template<unsigned DIM>
+void PhaseSeparationHaematocritSolver<DIM>::Calculate()
+{
+    mpSnapshot->SetVesselNetwork(this->mpNetwork);
+    mpSnapshot->Update();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = mpSnapshot->rGetNodes();
+    const std::vector<unsigned>& r_start_nodes = mpSnapshot->rGetVesselStartNodes();
+    const std::vector<unsigned>& r_end_nodes = mpSnapshot->rGetVesselEndNodes();
+    const std::vector<unsigned>& r_node_offsets = mpSnapshot->rGetNodeOffsets();
+    const std::vector<unsigned>& r_node_vessels = mpSnapshot->rGetNodeVessels();
+    const std::vector<double>& r_flow_rates = mpSnapshot->rGetFlowRates();
+    const std::vector<double>& r_radii = mpSnapshot->rGetRadii();
+    std::vector<double>& r_haematocrits = mpSnapshot->rGetHaematocrits();
+    unsigned num_vessels = r_flow_rates.size();
+    unsigned num_nodes = r_nodes.size();
+
+    // Get the inflow and outflow node of each vessel, UINT_MAX if there is no flow. Vessels at inlets take
+    // the arterial haematocrit and those without flow have none. The others start from their current values.
+    std::vector<unsigned> inflow_nodes(num_vessels, UINT_MAX);
+    std::vector<unsigned> outflow_nodes(num_vessels, UINT_MAX);
+    std::vector<bool> is_fixed(num_vessels, false);
+    for (unsigned idx = 0; idx < num_vessels; idx++)
+    {
+        if (r_flow_rates[idx] > 0.0)
+        {
+            inflow_nodes[idx] = r_start_nodes[idx];
+            outflow_nodes[idx] = r_end_nodes[idx];
+        }
+        else if (r_flow_rates[idx] < 0.0)
+        {
+            inflow_nodes[idx] = r_end_nodes[idx];
+            outflow_nodes[idx] = r_start_nodes[idx];
+        }
+
+        if (r_nodes[r_start_nodes[idx]]->GetFlowProperties()->IsInputNode()
+                or r_nodes[r_end_nodes[idx]]->GetFlowProperties()->IsInputNode())
+        {
+            is_fixed[idx] = true;
+            r_haematocrits[idx] = this->mHaematocrit;
+        }
+        else if (inflow_nodes[idx] == UINT_MAX)
+        {
+            is_fixed[idx] = true;
+            r_haematocrits[idx] = 0.0;
+        }
+        else
+        {
+            r_haematocrits[idx] = std::max(0.0, r_haematocrits[idx]);
+        }
+    }
+
+    // Order the nodes by the flow, nodes on cycles are added at the end in index order
+    std::vector<unsigned> num_waiting_inflows(num_nodes, 0);
+    for (unsigned idx = 0; idx < num_vessels; idx++)
+    {
+        if (outflow_nodes[idx] != UINT_MAX and outflow_nodes[idx] != inflow_nodes[idx])
+        {
+            num_waiting_inflows[outflow_nodes[idx]]++;
+        }
+    }
+    std::vector<unsigned> node_order;
+    std::vector<bool> is_ordered(num_nodes, false);
+    for (unsigned node_index = 0; node_index < num_nodes; node_index++)
+    {
+        if (num_waiting_inflows[node_index] == 0)
+        {
+            node_order.push_back(node_index);
+            is_ordered[node_index] = true;
+        }
+    }
+    for (unsigned position = 0; position < node_order.size(); position++)
+    {
+        unsigned node_index = node_order[position];
+        for (unsigned entry = r_node_offsets[node_index]; entry < r_node_offsets[node_index+1]; entry++)
+        {
+            unsigned vessel_index = r_node_vessels[entry];
+            unsigned next_node = outflow_nodes[vessel_index];
+            if (inflow_nodes[vessel_index] == node_index and next_node != node_index and !is_ordered[next_node])
+            {
+                num_waiting_inflows[next_node]--;
+                if (num_waiting_inflows[next_node] == 0)
+                {
+                    node_order.push_back(next_node);
+                    is_ordered[next_node] = true;
+                }
+            }
+        }
+    }
+    for (unsigned node_index = 0; node_index < num_nodes; node_index++)
+    {
+        if (!is_ordered[node_index])
+        {
+            node_order.push_back(node_index);
+        }
+    }
+
+    // Visit the active nodes, adding the nodes downstream of any vessel whose haematocrit changes
+    std::deque<unsigned> active_nodes(node_order.begin(), node_order.end());
+    std::vector<bool> is_active(num_nodes, true);
+    std::vector<unsigned> num_visits(num_nodes, 0);
+    std::vector<unsigned> outflow_vessels;
+    std::vector<double> weights;
+    mNumberOfNodeUpdates = 0;
+    while (!active_nodes.empty())
+    {
+        unsigned node_index = active_nodes.front();
+        active_nodes.pop_front();
+        is_active[node_index] = false;
+
+        // Get the red cell flux in and the vessels sharing it
+        double inflow_rate = 0.0;
+        double red_cell_inflow_rate = 0.0;
+        outflow_vessels.clear();
+        for (unsigned entry = r_node_offsets[node_index]; entry < r_node_offsets[node_index+1]; entry++)
+        {
+            unsigned vessel_index = r_node_vessels[entry];
+            if (outflow_nodes[vessel_index] == node_index and inflow_nodes[vessel_index] != node_index)
+            {
+                inflow_rate += std::fabs(r_flow_rates[vessel_index]);
+                red_cell_inflow_rate += std::fabs(r_flow_rates[vessel_index]) * r_haematocrits[vessel_index];
+            }
+            else if (inflow_nodes[vessel_index] == node_index and !is_fixed[vessel_index])
+            {
+                outflow_vessels.push_back(vessel_index);
+            }
+        }
+        if (outflow_vessels.empty())
+        {
+            continue;
+        }
+        mNumberOfNodeUpdates++;
+        num_visits[node_index]++;
+        if (num_visits[node_index] > mMaxIterations)
+        {
+            mpSnapshot->WriteHaematocrits();
+            EXCEPTION("Haematocrit calculation failed to converge.");
+        }
+
+        // Weight the outflow vessels relative to the fastest one
+        double alpha = (inflow_rate > 0.0) ? 1.0 - red_cell_inflow_rate / inflow_rate : 1.0;
+        double max_velocity = 0.0;
+        weights.resize(outflow_vessels.size());
+        for (unsigned idx = 0; idx < outflow_vessels.size(); idx++)
+        {
+            unsigned vessel_index = outflow_vessels[idx];
+            weights[idx] = std::fabs(r_flow_rates[vessel_index]) / (M_PI * r_radii[vessel_index] * r_radii[vessel_index]);
+            max_velocity = std::max(max_velocity, weights[idx]);
+        }
+        double weighted_flow_rate = 0.0;
+        for (unsigned idx = 0; idx < outflow_vessels.size(); idx++)
+        {
+            weights[idx] = 1.0 / (1.0 + alpha * (max_velocity / weights[idx] - 1.0));
+            weighted_flow_rate += weights[idx] * std::fabs(r_flow_rates[outflow_vessels[idx]]);
+        }
+
+        for (unsigned idx = 0; idx < outflow_vessels.size(); idx++)
+        {
+            unsigned vessel_index = outflow_vessels[idx];
+            double haematocrit = weights[idx] * red_cell_inflow_rate / weighted_flow_rate;
+            double change = std::fabs(haematocrit - r_haematocrits[vessel_index]);
+            r_haematocrits[vessel_index] = haematocrit;
+            unsigned next_node = outflow_nodes[vessel_index];
+            if (change > mTolerance and !is_active[next_node])
+            {
+                active_nodes.push_back(next_node);
+                is_active[next_node] = true;
+            }
+        }
+    }
+
+    mpSnapshot->WriteHaematocrits();
+}
+
+template<unsigned DIM>
+unsigned PhaseSeparationHaematocritSolver<DIM>::GetNumberOfNodeUpdates() const
+{
+    return mNumberOfNodeUpdates;
+}
+
+template<unsigned DIM>
+void PhaseSeparationHaematocritSolver<DIM>::SetHaematocrit(units::quantity<unit::dimensionless> haematocrit)
+{
+    mHaematocrit = haematocrit;
+}
+
+template<unsigned DIM>
+void PhaseSeparationHaematocritSolver<DIM>::SetMaxIterations(unsigned maxIterations)
+{
+    mMaxIterations = maxIterations;
+}
+
+template<unsigned DIM>
+void PhaseSeparationHaematocritSolver<DIM>::SetTolerance(double tolerance)
+{
+    mTolerance = tolerance;
+}
+
+// Explicit instantiation
+template class PhaseSeparationHaematocritSolver<2>;
+template class PhaseSeparationHaematocritSolver<3>;
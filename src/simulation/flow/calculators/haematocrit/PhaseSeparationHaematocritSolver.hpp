@@ -0,0 +1,138 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef _PhaseSeparationHaematocritSolver_hpp
+#define _PhaseSeparationHaematocritSolver_hpp
+
+#include <vector>
+#include "SmartPointers.hpp"
+#include "AbstractHaematocritSolver.hpp"
+#include "UnitCollection.hpp"
+#include "VesselNetworkSnapshot.hpp"
+
+/**
+ * This solver calculates the distribution of haematocrit in networks with branches of any connectivity. At each
+ * node the red cell flux from the vessels flowing in is shared between the vessels flowing out. Each outflow
+ * vessel gets a weight relative to the fastest one, 1/(1 + a(v_max/v - 1)) with a one minus the inflow
+ * haematocrit and v the mean velocity, and the haematocrits are proportional to the weights. With two outflow
+ * vessels this is the splitting rule of Betteridge et al. (2006).
+ *
+ * Nodes are visited in order of the flow, so flows without cycles are done in a single pass. A node is visited
+ * again only if the haematocrit of a vessel flowing into it has changed by more than the tolerance, so if there
+ * are cycles only the part of the network downstream of the changes is updated on each pass.
+ */
+template<unsigned DIM>
+class PhaseSeparationHaematocritSolver : public AbstractHaematocritSolver<DIM>
+{
+
+private:
+
+    /**
+     * The arterial haematocrit level
+     */
+    units::quantity<unit::dimensionless> mHaematocrit;
+
+    /**
+     * The tolerance on the change in vessel haematocrit for a node downstream to be updated again
+     */
+    double mTolerance;
+
+    /**
+     * The maximum number of visits to each node
+     */
+    unsigned mMaxIterations;
+
+    /**
+     * The number of node updates in the last calculation
+     */
+    unsigned mNumberOfNodeUpdates;
+
+    /**
+     * Flat copy of the network connectivity, flow rates, radii and haematocrits used in the solve
+     */
+    boost::shared_ptr<VesselNetworkSnapshot<DIM> > mpSnapshot;
+
+public:
+
+    /**
+     * Constructor.
+     */
+    PhaseSeparationHaematocritSolver();
+
+    /**
+     * Destructor.
+     */
+    ~PhaseSeparationHaematocritSolver();
+
+    /**
+     * Construct a new instance of the class and return a shared pointer to it.
+     * @return a pointer to a new class instance
+     */
+    static boost::shared_ptr<PhaseSeparationHaematocritSolver<DIM> > Create();
+
+    /**
+     * Do the solve
+     */
+    void Calculate();
+
+    /**
+     * @return the number of node updates in the last calculation, the number of nodes with vessels flowing
+     * out if there are no cycles
+     */
+    unsigned GetNumberOfNodeUpdates() const;
+
+    /**
+     * Set the arterial haematocrit
+     * @param haematocrit the arterial haematocrit
+     */
+    void SetHaematocrit(units::quantity<unit::dimensionless> haematocrit);
+
+    /**
+     * Set the maximum number of visits to each node, default 1000
+     * @param maxIterations the maximum number of visits to each node
+     */
+    void SetMaxIterations(unsigned maxIterations);
+
+    /**
+     * Set the tolerance on the change in vessel haematocrit for a node downstream to be updated again,
+     * default 1e-6
+     * @param tolerance the tolerance
+     */
+    void SetTolerance(double tolerance);
+
+};
+
+#endif
@@ -0,0 +1,225 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#include <climits>
+#include <cmath>
+#include "TopologicalHaematocritSolver.hpp"
+#include "Exception.hpp"
+
+template<unsigned DIM>
+TopologicalHaematocritSolver<DIM>::TopologicalHaematocritSolver() : BetteridgeHaematocritSolver<DIM>(),
+    mUsedLinearSystem(false)
+{
+
+}
+
+template<unsigned DIM>
+TopologicalHaematocritSolver<DIM>::~TopologicalHaematocritSolver()
+{
+
+}
+
+template <unsigned DIM>
+boost::shared_ptr<TopologicalHaematocritSolver<DIM> > TopologicalHaematocritSolver<DIM>::Create()
+{
+    MAKE_PTR(TopologicalHaematocritSolver<DIM>, pSelf);
+    return pSelf;
+}
+
+template<unsigned DIM>
+void TopologicalHaematocritSolver<DIM>::Calculate()
+{
+    this->mpSnapshot->SetVesselNetwork(this->mpNetwork);
+    this->mpSnapshot->Update();
+    const std::vector<boost::shared_ptr<VesselNode<DIM> > >& r_nodes = this->mpSnapshot->rGetNodes();
+    const std::vector<unsigned>& r_start_nodes = this->mpSnapshot->rGetVesselStartNodes();
+    const std::vector<unsigned>& r_end_nodes = this->mpSnapshot->rGetVesselEndNodes();
+    const std::vector<unsigned>& r_node_offsets = this->mpSnapshot->rGetNodeOffsets();
+    const std::vector<unsigned>& r_node_vessels = this->mpSnapshot->rGetNodeVessels();
+    const std::vector<double>& r_flow_rates = this->mpSnapshot->rGetFlowRates();
+    std::vector<double>& r_haematocrits = this->mpSnapshot->rGetHaematocrits();
+    unsigned num_vessels = r_flow_rates.size();
+
+    // Get the inflow and outflow node of each vessel, UINT_MAX if there is no flow
+    std::vector<unsigned> inflow_nodes(num_vessels, UINT_MAX);
+    std::vector<unsigned> outflow_nodes(num_vessels, UINT_MAX);
+    std::vector<bool> is_input_vessel(num_vessels, false);
+    bool has_cycle = false;
+    for (unsigned idx = 0; idx < num_vessels; idx++)
+    {
+        is_input_vessel[idx] = r_nodes[r_start_nodes[idx]]->GetFlowProperties()->IsInputNode()
+                or r_nodes[r_end_nodes[idx]]->GetFlowProperties()->IsInputNode();
+        if (r_flow_rates[idx] > 0.0)
+        {
+            inflow_nodes[idx] = r_start_nodes[idx];
+            outflow_nodes[idx] = r_end_nodes[idx];
+        }
+        else if (r_flow_rates[idx] < 0.0)
+        {
+            inflow_nodes[idx] = r_end_nodes[idx];
+            outflow_nodes[idx] = r_start_nodes[idx];
+        }
+        if (inflow_nodes[idx] != UINT_MAX and inflow_nodes[idx] == outflow_nodes[idx])
+        {
+            has_cycle = true;
+        }
+    }
+
+    // Count the parent vessels that each vessel waits for. Vessels at inlets, without flow or without other
+    // vessels at their inflow node do not depend on any others, so they start the sweep.
+    std::vector<unsigned> num_waiting_parents(num_vessels, 0);
+    std::vector<unsigned> ready_vessels;
+    for (unsigned idx = 0; idx < num_vessels; idx++)
+    {
+        unsigned inflow_node = inflow_nodes[idx];
+        if (!is_input_vessel[idx] and inflow_node != UINT_MAX)
+        {
+            for (unsigned entry = r_node_offsets[inflow_node]; entry < r_node_offsets[inflow_node+1]; entry++)
+            {
+                unsigned other_vessel = r_node_vessels[entry];
+                if (other_vessel != idx and outflow_nodes[other_vessel] == inflow_node)
+                {
+                    num_waiting_parents[idx]++;
+                }
+            }
+        }
+        if (num_waiting_parents[idx] == 0)
+        {
+            ready_vessels.push_back(idx);
+        }
+    }
+
+    // Sweep in order of the flow, each vessel is set once all its parents are
+    unsigned num_calculated = 0;
+    while (!has_cycle and !ready_vessels.empty())
+    {
+        unsigned idx = ready_vessels.back();
+        ready_vessels.pop_back();
+        num_calculated++;
+
+        unsigned inflow_node = inflow_nodes[idx];
+        if (is_input_vessel[idx])
+        {
+            r_haematocrits[idx] = this->mHaematocrit;
+        }
+        else if (inflow_node == UINT_MAX or r_node_offsets[inflow_node+1] - r_node_offsets[inflow_node] <= 1)
+        {
+            r_haematocrits[idx] = 0.0;
+        }
+        else
+        {
+            std::vector<unsigned> parent_vessels;
+            std::vector<unsigned> competitor_vessels;
+            for (unsigned entry = r_node_offsets[inflow_node]; entry < r_node_offsets[inflow_node+1]; entry++)
+            {
+                unsigned other_vessel = r_node_vessels[entry];
+                if (other_vessel != idx)
+                {
+                    if (outflow_nodes[other_vessel] == inflow_node)
+                    {
+                        parent_vessels.push_back(other_vessel);
+                    }
+                    else if (inflow_nodes[other_vessel] == inflow_node)
+                    {
+                        competitor_vessels.push_back(other_vessel);
+                    }
+                }
+            }
+
+            // If there are no competitor vessels the haematocrit flux is the sum of the parent fluxes,
+            // otherwise there is a bifurcation and the splitting rule is applied
+            if (competitor_vessels.size() == 0)
+            {
+                r_haematocrits[idx] = 0.0;
+                for (unsigned jdx = 0; jdx < parent_vessels.size(); jdx++)
+                {
+                    r_haematocrits[idx] += std::fabs(r_flow_rates[parent_vessels[jdx]]/r_flow_rates[idx]) *
+                            r_haematocrits[parent_vessels[jdx]];
+                }
+            }
+            else
+            {
+                if (competitor_vessels.size() > 1 or parent_vessels.size() > 1)
+                {
+                    EXCEPTION("This solver can only work with branches with connectivity 3");
+                }
+                r_haematocrits[idx] = 0.0;
+                if (parent_vessels.size() == 1)
+                {
+                    r_haematocrits[idx] = this->GetSplittingCoefficient(idx, parent_vessels[0], competitor_vessels[0]) *
+                            r_haematocrits[parent_vessels[0]];
+                }
+            }
+        }
+
+        // Release the vessels this one flows into
+        unsigned outflow_node = outflow_nodes[idx];
+        if (outflow_node != UINT_MAX)
+        {
+            for (unsigned entry = r_node_offsets[outflow_node]; entry < r_node_offsets[outflow_node+1]; entry++)
+            {
+                unsigned child_vessel = r_node_vessels[entry];
+                if (child_vessel != idx and inflow_nodes[child_vessel] == outflow_node and num_waiting_parents[child_vessel] > 0)
+                {
+                    num_waiting_parents[child_vessel]--;
+                    if (num_waiting_parents[child_vessel] == 0)
+                    {
+                        ready_vessels.push_back(child_vessel);
+                    }
+                }
+            }
+        }
+    }
+
+    // Vessels left over are on a cycle in the flow, so solve the coupled system instead
+    mUsedLinearSystem = (has_cycle or num_calculated < num_vessels);
+    if (mUsedLinearSystem)
+    {
+        BetteridgeHaematocritSolver<DIM>::Calculate();
+        return;
+    }
+    this->mpSnapshot->WriteHaematocrits();
+}
+
+template<unsigned DIM>
+bool TopologicalHaematocritSolver<DIM>::UsedLinearSystem() const
+{
+    return mUsedLinearSystem;
+}
+
+// Explicit instantiation
+template class TopologicalHaematocritSolver<2>;
+template class TopologicalHaematocritSolver<3>;
@@ -0,0 +1,93 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef _TopologicalHaematocritSolver_hpp
+#define _TopologicalHaematocritSolver_hpp
+
+#include <vector>
+#include "SmartPointers.hpp"
+#include "BetteridgeHaematocritSolver.hpp"
+
+/**
+ * Calculates the distribution of haematocrit with the Betteridge et al. (2006) splitting rule, but without
+ * assembling a linear system. If the flow directions have no cycles, such as after a pressure solve, each
+ * vessel only depends on the vessels flowing into it, so the haematocrits can be found exactly in a single
+ * sweep over the vessels in order of the flow. The splitting rule is applied locally at each bifurcation once
+ * its parent vessel is known. If there is a cycle, for example from flow reversals while iterating, the
+ * linear system of BetteridgeHaematocritSolver is solved instead.
+ */
+template<unsigned DIM>
+class TopologicalHaematocritSolver : public BetteridgeHaematocritSolver<DIM>
+{
+
+private:
+
+    /**
+     * Whether the last calculation needed the linear system because the flow has a cycle
+     */
+    bool mUsedLinearSystem;
+
+public:
+
+    /**
+     * Constructor.
+     */
+    TopologicalHaematocritSolver();
+
+    /**
+     * Destructor.
+     */
+    ~TopologicalHaematocritSolver();
+
+    /**
+     * Factory constructor method
+     * @return a shared pointer to a new solver
+     */
+    static boost::shared_ptr<TopologicalHaematocritSolver<DIM> > Create();
+
+    /**
+     * Do the solve
+     */
+    void Calculate();
+
+    /**
+     * @return whether the last calculation fell back to the linear system because the flow has a cycle
+     */
+    bool UsedLinearSystem() const;
+
+};
+
+#endif
@@ -128,7 +128,7 @@ void AbstractStructuralAdaptationSolver<DIM>::Solve()
         out << "#Iteration   Maximum relative change in radius in network\n\n";
     }
 
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = mpVesselNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = mpVesselNetwork->rGetVesselSegments();
     std::vector<units::quantity<unit::length> > previous_radii(segments.size());
     for (unsigned segment_index = 0; segment_index < segments.size(); segment_index++)
     {
@@ -132,7 +132,7 @@ void StructuralAdaptationSolver<DIM>::Iterate()
     mpFlowSolver->Update(false);
     mpFlowSolver->Solve();
 
-    std::vector<boost::shared_ptr<VesselSegment<DIM> > > segments = this->mpVesselNetwork->GetVesselSegments();
+    const std::vector<boost::shared_ptr<VesselSegment<DIM> > >& segments = this->mpVesselNetwork->rGetVesselSegments();
     for (unsigned idx = 0; idx < segments.size(); idx++)
     {
         segments[idx]->GetFlowProperties()->SetGrowthStimulus(0.0*(1.0/(unit::seconds)));
@@ -81,6 +81,42 @@ public:
         TS_ASSERT_DELTA(point4.rGetLocation()[0], 3.0/10.0, 1.e-6);
     }
 
+    void TestGeometryWithMatchingAndMixedLengthScales() throw (Exception)
+    {
+        units::quantity<unit::length> reference_scale1(1.0 * unit::metres);
+        units::quantity<unit::length> reference_scale2(10.0 * unit::metres);
+
+        DimensionalChastePoint<3> start(0.0, 0.0, 0.0, reference_scale1);
+        DimensionalChastePoint<3> end(10.0, 0.0, 0.0, reference_scale1);
+        DimensionalChastePoint<3> probe(5.0, 3.0, 0.0, reference_scale1);
+        DimensionalChastePoint<3> scaled_end(1.0, 0.0, 0.0, reference_scale2);
+        DimensionalChastePoint<3> scaled_probe(0.5, 0.3, 0.0, reference_scale2);
+
+        TS_ASSERT(start.HasSameReferenceLengthScale(end));
+        TS_ASSERT(!start.HasSameReferenceLengthScale(scaled_end));
+
+        // Matching length scales
+        TS_ASSERT_DELTA(start.GetDistance(probe)/unit::metres, std::sqrt(34.0), 1.e-6);
+        TS_ASSERT_DELTA(DimensionalChastePoint<3>::GetDistance(start, end, probe)/unit::metres, 3.0, 1.e-6);
+        TS_ASSERT_DELTA(start.GetMidPoint(end).rGetLocation()[0], 5.0, 1.e-6);
+        TS_ASSERT_DELTA(start.GetUnitTangent(end)[0], 1.0, 1.e-6);
+        TS_ASSERT_DELTA(DimensionalChastePoint<3>::GetPointProjection(start, end, probe).rGetLocation()[0], 5.0, 1.e-6);
+
+        // Mixed length scales give the same results in the first point's scale
+        TS_ASSERT_DELTA(start.GetDistance(scaled_probe)/unit::metres, std::sqrt(34.0), 1.e-6);
+        TS_ASSERT_DELTA(DimensionalChastePoint<3>::GetDistance(start, scaled_end, scaled_probe)/unit::metres, 3.0, 1.e-6);
+        TS_ASSERT_DELTA(start.GetMidPoint(scaled_end).rGetLocation()[0], 5.0, 1.e-6);
+        TS_ASSERT_DELTA(start.GetUnitTangent(scaled_end)[0], 1.0, 1.e-6);
+        TS_ASSERT_DELTA(DimensionalChastePoint<3>::GetPointProjection(start, scaled_end, scaled_probe).rGetLocation()[0], 5.0, 1.e-6);
+        TS_ASSERT(start.GetMidPoint(scaled_end).IsCoincident(DimensionalChastePoint<3>(0.5, 0.0, 0.0, reference_scale2)));
+
+        // Probes beyond the segment ends
+        DimensionalChastePoint<3> before(-4.0, 0.0, 0.0, reference_scale1);
+        DimensionalChastePoint<3> after(1.4, 0.0, 0.0, reference_scale2);
+        TS_ASSERT_DELTA(DimensionalChastePoint<3>::GetDistance(start, scaled_end, before)/unit::metres, 4.0, 1.e-6);
+        TS_ASSERT_DELTA(DimensionalChastePoint<3>::GetDistance(start, scaled_end, after)/unit::metres, 4.0, 1.e-6);
+    }
+
     void TestArchiving() throw (Exception)
     {
         // Test Archiving
@@ -42,6 +42,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ChastePoint.hpp"
 #include "VesselSegment.hpp"
 #include "VesselNetwork.hpp"
+#include "VesselNetworkBatch.hpp"
 #include "OutputFileHandler.hpp"
 #include "UblasIncludes.hpp"
 #include "VesselNetworkGenerator.hpp"
@@ -146,6 +147,56 @@ public:
         TS_ASSERT_DELTA(vessel_network.GetVessels()[3]->GetSegments()[0]->GetNode(1)->rGetLocation()[2], 3.0, 1.e-6);
     }
 
+    void TestCopyConstructNetwork() throw(Exception)
+    {
+        // A branching network with a two segment vessel
+        std::vector<boost::shared_ptr<VesselNode<3> > > nodes;
+        for(unsigned idx=0; idx < 4; idx++)
+        {
+            nodes.push_back(VesselNode<3>::Create(double(idx), 0.0, 0.0));
+        }
+        boost::shared_ptr<VesselNode<3> > p_branch_node = VesselNode<3>::Create(1.0, 1.0, 0.0);
+        std::vector<boost::shared_ptr<VesselSegment<3> > > segments;
+        segments.push_back(VesselSegment<3>::Create(nodes[1], nodes[2]));
+        segments.push_back(VesselSegment<3>::Create(nodes[2], nodes[3]));
+        boost::shared_ptr<Vessel<3> > p_vessel1 = Vessel<3>::Create(VesselSegment<3>::Create(nodes[0], nodes[1]));
+        boost::shared_ptr<Vessel<3> > p_vessel2 = Vessel<3>::Create(segments);
+        boost::shared_ptr<Vessel<3> > p_vessel3 = Vessel<3>::Create(VesselSegment<3>::Create(nodes[1], p_branch_node));
+
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessel(p_vessel1);
+        p_network->AddVessel(p_vessel2);
+        p_network->AddVessel(p_vessel3);
+        p_vessel2->SetRadius(7.e-6*unit::metres);
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->SetRadius(3.e-6*unit::metres);
+        segments[1]->GetFlowProperties()->SetHaematocrit(0.3);
+
+        boost::shared_ptr<VesselNetwork<3> > p_copy = VesselNetwork<3>::Create(p_network);
+        TS_ASSERT_EQUALS(p_copy->GetNumberOfVessels(), 3u);
+        TS_ASSERT_EQUALS(p_copy->GetNumberOfNodes(), p_network->GetNumberOfNodes());
+        TS_ASSERT_EQUALS(p_copy->GetNumberOfVesselNodes(), p_network->GetNumberOfVesselNodes());
+        TS_ASSERT_EQUALS(p_copy->GetVesselSegments().size(), 4u);
+
+        // Shared nodes stay shared, data is copied and the copy is independent
+        boost::shared_ptr<Vessel<3> > p_copy_vessel2 = p_copy->GetVessels()[1];
+        TS_ASSERT_EQUALS(p_copy_vessel2->GetNumberOfSegments(), 2u);
+        TS_ASSERT(p_copy_vessel2->GetStartNode() == p_copy->GetVessels()[0]->GetEndNode());
+        TS_ASSERT(p_copy_vessel2->GetStartNode() == p_copy->GetVessels()[2]->GetStartNode());
+        TS_ASSERT_EQUALS(p_copy_vessel2->GetStartNode()->GetNumberOfSegments(), 3u);
+        TS_ASSERT(p_copy_vessel2->GetStartNode() != nodes[1]);
+        TS_ASSERT_DELTA(p_copy_vessel2->GetRadius()/(1.e-6*unit::metres), 7.0, 1.e-6);
+        TS_ASSERT_DELTA(p_copy_vessel2->GetSegment(1)->GetFlowProperties()->GetHaematocrit(), 0.3, 1.e-6);
+        boost::shared_ptr<VesselNode<3> > p_copy_inlet = p_copy->GetVessels()[0]->GetStartNode();
+        TS_ASSERT(p_copy_inlet->GetFlowProperties()->IsInputNode());
+        TS_ASSERT_DELTA(p_copy_inlet->GetRadius()/(1.e-6*unit::metres), 3.0, 1.e-6);
+
+        p_copy_inlet->SetLocation(DimensionalChastePoint<3>(-5.0, 0.0, 0.0));
+        p_copy_vessel2->SetRadius(2.e-6*unit::metres);
+        TS_ASSERT_DELTA(nodes[0]->rGetLocation()[0], 0.0, 1.e-6);
+        TS_ASSERT_DELTA(p_vessel2->GetRadius()/(1.e-6*unit::metres), 7.0, 1.e-6);
+    }
+
     void TestRemoveVessel() throw(Exception)
     {
         // Make some nodes
@@ -154,10 +205,11 @@ public:
         nodes.push_back(VesselNode<3>::Create(20.0, 0.0, 0.0));
         nodes.push_back(VesselNode<3>::Create(30.0, 0.0, 0.0));
         nodes.push_back(VesselNode<3>::Create(50.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(70.0, 0.0, 0.0));
 
         // Make some vessels
         std::vector<boost::shared_ptr<Vessel<3> > > vessels;
-        for(unsigned idx=0; idx < 3; idx++)
+        for(unsigned idx=0; idx < 4; idx++)
         {
             vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[idx], nodes[idx+1])));
         }
@@ -166,7 +218,63 @@ public:
         vessel_network.AddVessels(vessels);
 
         vessel_network.RemoveShortVessels(15.0e-6 * unit::metres, false);
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfVessels(), 3u);
+
+        // The remaining vessels keep their order
+        TS_ASSERT_EQUALS(vessel_network.GetVessels()[1], vessels[2]);
+        TS_ASSERT_EQUALS(vessel_network.GetVessels()[2], vessels[3]);
+        vessel_network.RemoveVessel(vessels[0]);
         TS_ASSERT_EQUALS(vessel_network.GetNumberOfVessels(), 2u);
+        TS_ASSERT_EQUALS(vessel_network.GetVessels()[0], vessels[2]);
+        TS_ASSERT_EQUALS(vessel_network.GetVessels()[1], vessels[3]);
+        TS_ASSERT_EQUALS(vessel_network.GetVesselIndex(vessels[2]), 0u);
+        TS_ASSERT_EQUALS(vessel_network.GetVesselIndex(vessels[3]), 1u);
+
+        // Removing a vessel that is not in the network leaves it unchanged
+        unsigned version = vessel_network.GetTopologyVersion();
+        TS_ASSERT_THROWS_THIS(vessel_network.RemoveVessel(vessels[0]), "Vessel is not contained inside network.");
+        TS_ASSERT_EQUALS(vessel_network.GetTopologyVersion(), version);
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfVessels(), 2u);
+    }
+
+    void TestRemoveVessels() throw(Exception)
+    {
+        // Make a chain of vessels
+        std::vector<boost::shared_ptr<VesselNode<3> > > nodes;
+        for(unsigned idx=0; idx < 6; idx++)
+        {
+            nodes.push_back(VesselNode<3>::Create(10.0 * double(idx)));
+        }
+        std::vector<boost::shared_ptr<Vessel<3> > > vessels;
+        for(unsigned idx=0; idx < 5; idx++)
+        {
+            vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[idx], nodes[idx+1])));
+        }
+
+        VesselNetwork<3> vessel_network;
+        vessel_network.AddVessels(vessels);
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfNodes(), 6u);
+
+        // Remove the two end vessels
+        std::set<boost::shared_ptr<Vessel<3> > > vessels_to_remove;
+        vessels_to_remove.insert(vessels[0]);
+        vessels_to_remove.insert(vessels[4]);
+        vessel_network.RemoveVessels(vessels_to_remove, true);
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfVessels(), 3u);
+        TS_ASSERT_EQUALS(vessel_network.GetVessels()[0], vessels[1]);
+        TS_ASSERT_EQUALS(vessel_network.GetVessels()[2], vessels[3]);
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfNodes(), 4u);
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfVesselNodes(), 4u);
+        TS_ASSERT_EQUALS(vessel_network.GetVesselSegments().size(), 3u);
+        TS_ASSERT(!vessel_network.NodeIsInNetwork(nodes[0]));
+        TS_ASSERT_EQUALS(nodes[1]->GetNumberOfSegments(), 1u);
+
+        // Removing a vessel that is not in the network leaves it unchanged
+        vessels_to_remove.clear();
+        vessels_to_remove.insert(vessels[2]);
+        vessels_to_remove.insert(vessels[0]);
+        TS_ASSERT_THROWS_THIS(vessel_network.RemoveVessels(vessels_to_remove), "Vessel is not contained inside network.");
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfVessels(), 3u);
     }
 
     void TestDivideVessel() throw(Exception)
@@ -231,6 +339,8 @@ public:
         c_vector<double, 3> location2 = zero_vector<double>(3);
         location2[0] = 4.5;
         TS_ASSERT_THROWS_ANYTHING(p_vascular_network.DivideVessel(p_vascular_network.GetVessel(0), location2));
+        TS_ASSERT_EQUALS(p_vascular_network.GetNumberOfVessels(), 2u);
+        TS_ASSERT_EQUALS(p_vascular_network.GetVesselIndex(p_vascular_network.GetVessel(1)), 1u);
 
         // Do the divide
         p_vascular_network.DivideVessel(p_vascular_network.GetVessel(1), location2);
@@ -322,6 +432,443 @@ public:
         TS_ASSERT_DELTA(vessels[2]->GetStartNode()->rGetLocation()[0], 20.0, 1.e-6);
     }
 
+    void TestMergeShortVesselChains() throw(Exception)
+    {
+        // A long vessel, a chain of two short ones and two long branches off the chain
+        std::vector<boost::shared_ptr<VesselNode<3> > > nodes;
+        nodes.push_back(VesselNode<3>::Create(0.0));
+        nodes.push_back(VesselNode<3>::Create(20.0));
+        nodes.push_back(VesselNode<3>::Create(25.0));
+        nodes.push_back(VesselNode<3>::Create(28.0));
+        nodes.push_back(VesselNode<3>::Create(50.0));
+        nodes.push_back(VesselNode<3>::Create(25.0, 30.0));
+
+        std::vector<boost::shared_ptr<Vessel<3> > > vessels;
+        for(unsigned idx=0; idx < 4; idx++)
+        {
+            vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[idx], nodes[idx+1])));
+        }
+        vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[2], nodes[5])));
+
+        VesselNetwork<3> vessel_network;
+        vessel_network.AddVessels(vessels);
+        vessel_network.MergeShortVessels(10.0e-6 * unit::metres);
+
+        // Both short vessels collapse onto the start of the chain
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfVessels(), 3u);
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfNodes(), 4u);
+        TS_ASSERT(vessels[0]->GetEndNode() == nodes[1]);
+        TS_ASSERT(vessels[3]->GetStartNode() == nodes[1]);
+        TS_ASSERT(vessels[4]->GetStartNode() == nodes[1]);
+        TS_ASSERT_EQUALS(nodes[1]->GetNumberOfSegments(), 3u);
+        TS_ASSERT_EQUALS(nodes[3]->GetNumberOfSegments(), 0u);
+    }
+
+    void TestMergeVesselsAtDegreeTwoNodes() throw(Exception)
+    {
+        // A bent chain of single segment vessels with a branch at its middle node
+        std::vector<boost::shared_ptr<VesselNode<2> > > nodes;
+        nodes.push_back(VesselNode<2>::Create(0.0, 0.0));
+        nodes.push_back(VesselNode<2>::Create(10.0, 0.0));
+        nodes.push_back(VesselNode<2>::Create(20.0, 0.0));
+        nodes.push_back(VesselNode<2>::Create(30.0, 0.0));
+        nodes.push_back(VesselNode<2>::Create(30.0, 10.0));
+        nodes.push_back(VesselNode<2>::Create(20.0, -10.0));
+        std::vector<boost::shared_ptr<Vessel<2> > > vessels;
+        for(unsigned idx=0; idx < 4; idx++)
+        {
+            vessels.push_back(Vessel<2>::Create(VesselSegment<2>::Create(nodes[idx], nodes[idx+1])));
+        }
+        vessels.push_back(Vessel<2>::Create(VesselSegment<2>::Create(nodes[5], nodes[2])));
+
+        // A closed ring of vessels keeps one joint
+        std::vector<boost::shared_ptr<VesselNode<2> > > ring_nodes;
+        ring_nodes.push_back(VesselNode<2>::Create(100.0, 0.0));
+        ring_nodes.push_back(VesselNode<2>::Create(110.0, 0.0));
+        ring_nodes.push_back(VesselNode<2>::Create(110.0, 10.0));
+        for(unsigned idx=0; idx < 3; idx++)
+        {
+            vessels.push_back(Vessel<2>::Create(VesselSegment<2>::Create(ring_nodes[idx], ring_nodes[(idx+1)%3])));
+        }
+        vessels[1]->SetRadius(5.e-6*unit::metres);
+
+        boost::shared_ptr<VesselNetwork<2> > p_network = VesselNetwork<2>::Create();
+        p_network->AddVessels(vessels);
+        boost::shared_ptr<VesselNetwork<2> > p_copy = VesselNetwork<2>::Create(p_network);
+
+        // Only joints without a sharp turn
+        p_copy->MergeVesselsAtDegreeTwoNodes(0.25*M_PI);
+        TS_ASSERT_EQUALS(p_copy->GetNumberOfVessels(), 7u);
+
+        p_network->MergeVesselsAtDegreeTwoNodes();
+        TS_ASSERT_EQUALS(p_network->GetNumberOfVessels(), 5u);
+        TS_ASSERT_EQUALS(p_network->GetNumberOfNodes(), 9u);
+        TS_ASSERT_EQUALS(p_network->GetNumberOfVesselNodes(), 6u);
+        TS_ASSERT_EQUALS(p_network->GetVesselSegments().size(), 8u);
+        TS_ASSERT_EQUALS(nodes[1]->GetSegment(0)->GetVessel(), nodes[1]->GetSegment(1)->GetVessel());
+        boost::shared_ptr<Vessel<2> > p_joined = nodes[3]->GetSegment(0)->GetVessel();
+        TS_ASSERT_EQUALS(p_joined->GetNumberOfSegments(), 2u);
+        TS_ASSERT_DELTA(p_joined->GetRadius()/(1.e-6*unit::metres), 10.0, 1.e-6);
+        TS_ASSERT_EQUALS(p_joined, nodes[4]->GetSegment(0)->GetVessel());
+        TS_ASSERT_DELTA(nodes[1]->GetSegment(0)->GetVessel()->GetRadius()/(1.e-6*unit::metres), 7.5, 1.e-6);
+        TS_ASSERT_EQUALS(ring_nodes[0]->GetSegment(0)->GetVessel()->GetNumberOfSegments() +
+                         ring_nodes[0]->GetSegment(1)->GetVessel()->GetNumberOfSegments(), 3u);
+
+        // The combined cleanup
+        p_copy->Simplify(0.0*unit::metres);
+        TS_ASSERT_EQUALS(p_copy->GetNumberOfVessels(), 5u);
+    }
+
+    void TestMergeCoincidentNodes() throw(Exception)
+    {
+        // Make a lattice of single segment vessels, each with its own end nodes
+        unsigned num_points = 10;
+        std::vector<boost::shared_ptr<Vessel<3> > > vessels;
+        for(unsigned idx=0; idx<num_points; idx++)
+        {
+            for(unsigned jdx=0; jdx<num_points-1; jdx++)
+            {
+                vessels.push_back(Vessel<3>::Create(VesselNode<3>::Create(double(jdx)*10.0, double(idx)*10.0),
+                        VesselNode<3>::Create(double(jdx+1)*10.0, double(idx)*10.0)));
+                vessels.push_back(Vessel<3>::Create(VesselNode<3>::Create(double(idx)*10.0, double(jdx)*10.0),
+                        VesselNode<3>::Create(double(idx)*10.0, double(jdx+1)*10.0)));
+            }
+        }
+        VesselNetwork<3> vessel_network;
+        vessel_network.AddVessels(vessels);
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfNodes(), 4u*num_points*(num_points-1));
+
+        vessel_network.MergeCoincidentNodes();
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfNodes(), num_points*num_points);
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfVessels(), 2u*num_points*(num_points-1));
+
+        // Nodes in a different reference length are merged at the same location
+        boost::shared_ptr<VesselNode<3> > p_scaled_node = VesselNode<3>::Create(DimensionalChastePoint<3>(5.0, 0.0, 0.0,
+                2.e-6*unit::metres));
+        vessel_network.AddVessel(Vessel<3>::Create(VesselNode<3>::Create(10.0, -10.0), p_scaled_node));
+        vessel_network.MergeCoincidentNodes();
+        TS_ASSERT_EQUALS(vessel_network.GetNumberOfNodes(), num_points*num_points + 1u);
+
+        // With a tolerance nearby nodes are merged, with the node later in the list kept
+        std::vector<boost::shared_ptr<VesselNode<3> > > nodes;
+        nodes.push_back(VesselNode<3>::Create(0.0));
+        nodes.push_back(VesselNode<3>::Create(10.0));
+        nodes.push_back(VesselNode<3>::Create(10.5));
+        nodes.push_back(VesselNode<3>::Create(20.0));
+        VesselNetwork<3> tolerance_network;
+        tolerance_network.AddVessel(Vessel<3>::Create(nodes[0], nodes[1]));
+        tolerance_network.AddVessel(Vessel<3>::Create(nodes[2], nodes[3]));
+        tolerance_network.MergeCoincidentNodes(0.1);
+        TS_ASSERT_EQUALS(tolerance_network.GetNumberOfNodes(), 4u);
+        tolerance_network.MergeCoincidentNodes(1.0);
+        TS_ASSERT_EQUALS(tolerance_network.GetNumberOfNodes(), 3u);
+        TS_ASSERT(tolerance_network.GetVessels()[0]->GetEndNode() == nodes[2]);
+        TS_ASSERT(tolerance_network.GetVessels()[1]->GetStartNode() == nodes[2]);
+    }
+
+    void TestIndexLookups() throw(Exception)
+    {
+        // Make a ladder of vessels with multi-segment rungs
+        std::vector<boost::shared_ptr<Vessel<3> > > vessels;
+        std::vector<boost::shared_ptr<VesselNode<3> > > bottom_nodes;
+        std::vector<boost::shared_ptr<VesselNode<3> > > top_nodes;
+        for(unsigned idx=0; idx<6; idx++)
+        {
+            bottom_nodes.push_back(VesselNode<3>::Create(double(idx)*10.0, 0.0));
+            top_nodes.push_back(VesselNode<3>::Create(double(idx)*10.0, 20.0));
+        }
+        for(unsigned idx=0; idx<5; idx++)
+        {
+            vessels.push_back(Vessel<3>::Create(bottom_nodes[idx], bottom_nodes[idx+1]));
+            vessels.push_back(Vessel<3>::Create(top_nodes[idx], top_nodes[idx+1]));
+        }
+        for(unsigned idx=0; idx<6; idx++)
+        {
+            std::vector<boost::shared_ptr<VesselNode<3> > > rung_nodes;
+            rung_nodes.push_back(bottom_nodes[idx]);
+            rung_nodes.push_back(VesselNode<3>::Create(double(idx)*10.0, 10.0));
+            rung_nodes.push_back(top_nodes[idx]);
+            vessels.push_back(Vessel<3>::Create(rung_nodes));
+        }
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessels(vessels);
+
+        for(unsigned round=0; round<2; round++)
+        {
+            std::vector<boost::shared_ptr<VesselNode<3> > > nodes = p_network->GetNodes();
+            for(unsigned idx=0; idx<nodes.size(); idx++)
+            {
+                TS_ASSERT_EQUALS(p_network->GetNodeIndex(nodes[idx]), idx);
+                TS_ASSERT(p_network->NodeIsInNetwork(nodes[idx]));
+            }
+            std::vector<boost::shared_ptr<VesselNode<3> > > end_nodes = p_network->GetVesselEndNodes();
+            for(unsigned idx=0; idx<end_nodes.size(); idx++)
+            {
+                TS_ASSERT_EQUALS(p_network->GetVesselEndNodeIndex(end_nodes[idx]), idx);
+            }
+            std::vector<boost::shared_ptr<VesselSegment<3> > > segments = p_network->GetVesselSegments();
+            for(unsigned idx=0; idx<segments.size(); idx++)
+            {
+                TS_ASSERT_EQUALS(p_network->GetVesselSegmentIndex(segments[idx]), idx);
+                TS_ASSERT(p_network->GetVesselSegment(idx) == segments[idx]);
+            }
+            std::vector<boost::shared_ptr<Vessel<3> > > network_vessels = p_network->GetVessels();
+            for(unsigned idx=0; idx<network_vessels.size(); idx++)
+            {
+                TS_ASSERT_EQUALS(p_network->GetVesselIndex(network_vessels[idx]), idx);
+            }
+
+            // Indices follow changes to the network
+            p_network->RemoveVessel(vessels[2+round], true);
+            p_network->AddVessel(Vessel<3>::Create(top_nodes[5], VesselNode<3>::Create(60.0, 30.0)));
+            p_network->UpdateAll();
+        }
+
+        boost::shared_ptr<VesselNode<3> > p_outside_node = VesselNode<3>::Create(100.0, 100.0);
+        boost::shared_ptr<Vessel<3> > p_outside_vessel = Vessel<3>::Create(p_outside_node, VesselNode<3>::Create(110.0, 100.0));
+        TS_ASSERT(!p_network->NodeIsInNetwork(p_outside_node));
+        TS_ASSERT_THROWS_THIS(p_network->GetNodeIndex(p_outside_node), "Node is not in the network.");
+        TS_ASSERT_THROWS_THIS(p_network->GetVesselEndNodeIndex(vessels[12]->GetNode(1)), "Node is not at the end of a vessel in the network.");
+        TS_ASSERT_THROWS_THIS(p_network->GetVesselIndex(p_outside_vessel), "Input vessel is not in the network.");
+        TS_ASSERT_THROWS_THIS(p_network->GetVesselSegment(100), "Requested segment index out of range");
+    }
+
+    void TestCachesFollowChanges() throw(Exception)
+    {
+        // Make a multi-segment vessel and read the caches so they are kept up to date
+        std::vector<boost::shared_ptr<VesselNode<3> > > nodes;
+        for(unsigned idx=0; idx<6; idx++)
+        {
+            nodes.push_back(VesselNode<3>::Create(double(idx)*10.0, 0.0));
+        }
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessel(Vessel<3>::Create(nodes));
+        TS_ASSERT_EQUALS(p_network->GetNumberOfNodes(), 6u);
+        TS_ASSERT_EQUALS(p_network->GetNumberOfVesselNodes(), 2u);
+        TS_ASSERT_EQUALS(p_network->GetVesselSegments().size(), 5u);
+
+        // Sprout from the middle of a segment and from a node, extend the sprout and remove a vessel
+        boost::shared_ptr<Vessel<3> > p_sprout1 = p_network->FormSprout(DimensionalChastePoint<3>(15.0, 0.0),
+                                                                          DimensionalChastePoint<3>(15.0, 10.0));
+        boost::shared_ptr<Vessel<3> > p_sprout2 = p_network->FormSprout(DimensionalChastePoint<3>(40.0, 0.0),
+                                                                          DimensionalChastePoint<3>(40.0, 10.0));
+        p_network->ExtendVessel(p_sprout1, p_sprout1->GetEndNode(), VesselNode<3>::Create(15.0, 20.0));
+        p_network->RemoveVessel(p_sprout2, true);
+
+        // Compare with the caches of a fully updated network
+        unsigned num_nodes = p_network->GetNumberOfNodes();
+        unsigned num_vessel_nodes = p_network->GetNumberOfVesselNodes();
+        std::vector<boost::shared_ptr<VesselNode<3> > > patched_nodes = p_network->GetNodes();
+        std::vector<boost::shared_ptr<VesselSegment<3> > > patched_segments = p_network->GetVesselSegments();
+        for(unsigned idx=0; idx<patched_nodes.size(); idx++)
+        {
+            TS_ASSERT_EQUALS(p_network->GetNodeIndex(patched_nodes[idx]), idx);
+        }
+        for(unsigned idx=0; idx<patched_segments.size(); idx++)
+        {
+            TS_ASSERT_EQUALS(p_network->GetVesselSegmentIndex(patched_segments[idx]), idx);
+        }
+
+        p_network->UpdateAll();
+        TS_ASSERT_EQUALS(num_nodes, 9u);
+        TS_ASSERT_EQUALS(p_network->GetNumberOfNodes(), num_nodes);
+        TS_ASSERT_EQUALS(p_network->GetNumberOfVesselNodes(), num_vessel_nodes);
+        TS_ASSERT_EQUALS(p_network->GetVesselSegments().size(), patched_segments.size());
+        for(unsigned idx=0; idx<patched_nodes.size(); idx++)
+        {
+            TS_ASSERT(p_network->NodeIsInNetwork(patched_nodes[idx]));
+        }
+        for(unsigned idx=0; idx<patched_segments.size(); idx++)
+        {
+            TS_ASSERT_THROWS_NOTHING(p_network->GetVesselSegmentIndex(patched_segments[idx]));
+        }
+    }
+
+    void TestBatchChanges() throw(Exception)
+    {
+        std::vector<boost::shared_ptr<VesselNode<3> > > nodes;
+        for(unsigned idx=0; idx<6; idx++)
+        {
+            nodes.push_back(VesselNode<3>::Create(double(idx)*10.0, 0.0));
+        }
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessel(Vessel<3>::Create(nodes));
+        TS_ASSERT_THROWS_THIS(p_network->CommitBatch(), "No batch of changes has been started on the network.");
+
+        // Make changes in nested batches, including a deferred merge
+        p_network->BeginBatch();
+        p_network->BeginBatch();
+        TS_ASSERT(p_network->IsInBatch());
+        boost::shared_ptr<Vessel<3> > p_sprout = p_network->FormSprout(DimensionalChastePoint<3>(15.0, 0.0),
+                                                                         DimensionalChastePoint<3>(15.0, 10.0));
+        p_network->ExtendVessel(p_sprout, p_sprout->GetEndNode(), VesselNode<3>::Create(15.0, 20.0));
+        p_network->AddVessel(Vessel<3>::Create(VesselNode<3>::Create(15.0, 20.0), VesselNode<3>::Create(25.0, 20.0)));
+        p_network->UpdateAll(true);
+        p_network->CommitBatch();
+        TS_ASSERT(p_network->IsInBatch());
+
+        // Queries inside the batch see the changes, but nodes are not merged until the outermost commit
+        TS_ASSERT_EQUALS(p_network->GetNumberOfNodes(), 11u);
+        TS_ASSERT_DELTA(p_network->GetNearestNode(DimensionalChastePoint<3>(15.0, 19.0))->rGetLocation()[1], 20.0, 1.e-6);
+        p_network->RemoveVessel(p_network->GetVessels()[0], true);
+        p_network->CommitBatch();
+        TS_ASSERT(!p_network->IsInBatch());
+
+        TS_ASSERT_EQUALS(p_network->GetNumberOfVessels(), 3u);
+        TS_ASSERT_EQUALS(p_network->GetNumberOfNodes(), 8u);
+        std::vector<boost::shared_ptr<Vessel<3> > > vessels = p_network->GetVessels();
+        for(unsigned idx=0; idx<vessels.size(); idx++)
+        {
+            TS_ASSERT_EQUALS(p_network->GetVesselIndex(vessels[idx]), idx);
+            TS_ASSERT_EQUALS(vessels[idx]->GetId(), idx);
+        }
+
+        // A scoped batch is committed when it is left by an exception
+        try
+        {
+            VesselNetworkBatch<3> batch(p_network);
+            p_network->RemoveVessel(p_network->GetVessels()[0], true);
+            TS_ASSERT(p_network->IsInBatch());
+            EXCEPTION("Interrupted batch");
+        }
+        catch(Exception&)
+        {
+        }
+        TS_ASSERT(!p_network->IsInBatch());
+        TS_ASSERT_EQUALS(p_network->GetNumberOfVessels(), 2u);
+        TS_ASSERT_EQUALS(p_network->GetVessels()[1]->GetId(), 1u);
+
+        // and when it is committed explicitly, after which the destructor does nothing
+        {
+            VesselNetworkBatch<3> batch(p_network, true);
+            p_network->AddVessel(Vessel<3>::Create(VesselNode<3>::Create(25.0, 20.0), VesselNode<3>::Create(35.0, 20.0)));
+            batch.Commit();
+            TS_ASSERT(!p_network->IsInBatch());
+        }
+        TS_ASSERT_EQUALS(p_network->GetNumberOfVessels(), 3u);
+        TS_ASSERT_THROWS_THIS(p_network->CommitBatch(), "No batch of changes has been started on the network.");
+    }
+
+    void TestTopologyAndGeometryVersions() throw(Exception)
+    {
+        std::vector<boost::shared_ptr<VesselNode<3> > > nodes;
+        for(unsigned idx=0; idx<4; idx++)
+        {
+            nodes.push_back(VesselNode<3>::Create(double(idx)*10.0, 0.0));
+        }
+        boost::shared_ptr<Vessel<3> > p_vessel1 = Vessel<3>::Create(nodes[0], nodes[1]);
+        boost::shared_ptr<Vessel<3> > p_vessel2 = Vessel<3>::Create(nodes[1], nodes[2]);
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessel(p_vessel1);
+        p_network->AddVessel(p_vessel2);
+        p_network->UpdateAll();
+        unsigned topology_version = p_network->GetTopologyVersion();
+        unsigned geometry_version = p_network->GetGeometryVersion();
+
+        // Moving nodes and updating, or committing a batch without structural changes, only changes the geometry
+        nodes[2]->SetLocation(DimensionalChastePoint<3>(20.0, 5.0));
+        p_network->UpdateAll(true);
+        p_network->BeginBatch();
+        p_network->UpdateAll();
+        p_network->CommitBatch();
+        p_network->Translate(DimensionalChastePoint<3>(1.0, 0.0));
+        TS_ASSERT_EQUALS(p_network->GetTopologyVersion(), topology_version);
+        TS_ASSERT(p_network->GetGeometryVersion() != geometry_version);
+
+        // Structural changes through the network change the topology
+        p_network->BeginBatch();
+        p_network->AddVessel(Vessel<3>::Create(nodes[2], nodes[3]));
+        p_network->CommitBatch();
+        TS_ASSERT(p_network->GetTopologyVersion() != topology_version);
+
+        // Reconnecting a segment directly is found by the next update
+        topology_version = p_network->GetTopologyVersion();
+        p_vessel2->GetSegments()[0]->ReplaceNode(0, nodes[0]);
+        p_network->UpdateAll();
+        TS_ASSERT(p_network->GetTopologyVersion() != topology_version);
+
+        // Merging coincident nodes only changes the topology if any are merged
+        topology_version = p_network->GetTopologyVersion();
+        p_network->MergeCoincidentNodes();
+        TS_ASSERT_EQUALS(p_network->GetTopologyVersion(), topology_version);
+    }
+
+    void TestReferenceAccessors() throw(Exception)
+    {
+        std::vector<boost::shared_ptr<VesselNode<3> > > nodes;
+        for(unsigned idx=0; idx<4; idx++)
+        {
+            nodes.push_back(VesselNode<3>::Create(double(idx)*10.0, 0.0));
+        }
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessel(Vessel<3>::Create(nodes));
+        p_network->FormSprout(DimensionalChastePoint<3>(10.0, 0.0), DimensionalChastePoint<3>(10.0, 10.0));
+
+        // The references see the same, current, contents as the copies
+        TS_ASSERT(p_network->rGetNodes() == p_network->GetNodes());
+        TS_ASSERT(p_network->rGetVesselSegments() == p_network->GetVesselSegments());
+        TS_ASSERT(p_network->rGetVessels() == p_network->GetVessels());
+        TS_ASSERT(p_network->rGetVesselEndNodes() == p_network->GetVesselEndNodes());
+        TS_ASSERT_EQUALS(p_network->rGetNodes().size(), 5u);
+        TS_ASSERT_EQUALS(p_network->rGetVesselEndNodes().size(), 4u);
+        TS_ASSERT(p_network->GetVessel(0)->rGetSegments() == p_network->GetVessel(0)->GetSegments());
+    }
+
+    void TestReorder() throw(Exception)
+    {
+        // A chain of vessels added in a scrambled order
+        unsigned num_vessels = 20;
+        std::vector<boost::shared_ptr<VesselNode<2> > > nodes;
+        for(unsigned idx=0; idx<num_vessels+1; idx++)
+        {
+            nodes.push_back(VesselNode<2>::Create(double(idx)*10.0, 0.0));
+        }
+        boost::shared_ptr<VesselNetwork<2> > p_network = VesselNetwork<2>::Create();
+        for(unsigned idx=0; idx<num_vessels; idx++)
+        {
+            unsigned position = (idx*7) % num_vessels;
+            p_network->AddVessel(Vessel<2>::Create(nodes[position], nodes[position+1]));
+        }
+
+        NetworkOrdering::Value orderings[2] = {NetworkOrdering::REVERSE_CUTHILL_MCKEE, NetworkOrdering::MORTON};
+        for(unsigned kdx=0; kdx<2; kdx++)
+        {
+            unsigned version = p_network->GetTopologyVersion();
+            p_network->Reorder(orderings[kdx]);
+            TS_ASSERT(p_network->GetTopologyVersion() != version);
+            TS_ASSERT_EQUALS(p_network->GetNumberOfVessels(), num_vessels);
+            TS_ASSERT_EQUALS(p_network->GetNumberOfNodes(), num_vessels+1);
+            TS_ASSERT_EQUALS(p_network->GetNumberOfVesselNodes(), num_vessels+1);
+
+            // A chain has bandwidth one in either ordering
+            unsigned bandwidth = 0;
+            std::vector<boost::shared_ptr<Vessel<2> > > vessels = p_network->GetVessels();
+            for(unsigned idx=0; idx<vessels.size(); idx++)
+            {
+                unsigned start_index = p_network->GetVesselEndNodeIndex(vessels[idx]->GetStartNode());
+                unsigned end_index = p_network->GetVesselEndNodeIndex(vessels[idx]->GetEndNode());
+                bandwidth = std::max(bandwidth, std::max(start_index, end_index) - std::min(start_index, end_index));
+                TS_ASSERT_EQUALS(p_network->GetVesselIndex(vessels[idx]), idx);
+                TS_ASSERT_EQUALS(vessels[idx]->GetId(), idx);
+                TS_ASSERT(p_network->GetVesselEndNodes()[start_index] == vessels[idx]->GetStartNode());
+            }
+            TS_ASSERT_EQUALS(bandwidth, 1u);
+
+            std::vector<boost::shared_ptr<VesselNode<2> > > all_nodes = p_network->GetNodes();
+            for(unsigned idx=0; idx<all_nodes.size(); idx++)
+            {
+                TS_ASSERT_EQUALS(p_network->GetNodeIndex(all_nodes[idx]), idx);
+            }
+        }
+
+        // Morton ordering follows the chain along x
+        std::vector<boost::shared_ptr<VesselNode<2> > > end_nodes = p_network->GetVesselEndNodes();
+        for(unsigned idx=0; idx<end_nodes.size(); idx++)
+        {
+            TS_ASSERT_DELTA(end_nodes[idx]->rGetLocation()[0], double(idx)*10.0, 1.e-6);
+        }
+    }
+
     void TestMultipleSprouts() throw(Exception)
     {
         // Make a network
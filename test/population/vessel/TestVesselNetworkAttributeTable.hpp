@@ -0,0 +1,181 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef TESTVESSELNETWORKATTRIBUTETABLE_HPP_
+#define TESTVESSELNETWORKATTRIBUTETABLE_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <map>
+#include <string>
+#include "SmartPointers.hpp"
+#include "VesselNode.hpp"
+#include "VesselSegment.hpp"
+#include "Vessel.hpp"
+#include "VesselNetwork.hpp"
+#include "VesselNetworkAttributeTable.hpp"
+#include "UnitCollection.hpp"
+
+#include "PetscSetupAndFinalize.hpp"
+
+class TestVesselNetworkAttributeTable : public CxxTest::TestSuite
+{
+
+public:
+
+    void TestBuiltInAttributesMatchOutputData() throw(Exception)
+    {
+        boost::shared_ptr<VesselNode<3> > p_node1 = VesselNode<3>::Create(0.0, 0.0, 0.0);
+        boost::shared_ptr<VesselNode<3> > p_node2 = VesselNode<3>::Create(100.0, 0.0, 0.0);
+        boost::shared_ptr<VesselNode<3> > p_node3 = VesselNode<3>::Create(200.0, 50.0, 0.0);
+        boost::shared_ptr<Vessel<3> > p_vessel1 = Vessel<3>::Create(p_node1, p_node2);
+        boost::shared_ptr<Vessel<3> > p_vessel2 = Vessel<3>::Create(p_node2, p_node3);
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessel(p_vessel1);
+        p_network->AddVessel(p_vessel2);
+
+        p_node1->GetFlowProperties()->SetPressure(20.0*unit::pascals);
+        p_node1->GetFlowProperties()->SetIsInputNode(true);
+        p_node3->SetIsMigrating(true);
+        p_vessel1->GetFlowProperties()->SetFlowRate(-3.0*unit::metre_cubed_per_second);
+        p_vessel2->GetFlowProperties()->SetHaematocrit(0.4);
+        p_vessel2->SetRadius(15.e-6*unit::metres);
+        p_node2->SetId(4);
+        p_vessel2->SetId(3);
+
+        boost::shared_ptr<VesselNetworkAttributeTable<3> > p_table = VesselNetworkAttributeTable<3>::Create();
+        TS_ASSERT_THROWS_THIS(p_table->Update(), "A vessel network is required before updating the attribute table.");
+        p_table->SetVesselNetwork(p_network);
+        p_table->Update();
+
+        std::vector<boost::shared_ptr<VesselNode<3> > > nodes = p_network->GetNodes();
+        const std::vector<std::string>& r_node_names = p_table->rGetNodeAttributeNames();
+        for(unsigned idx=0; idx<nodes.size(); idx++)
+        {
+            std::map<std::string, double> data = nodes[idx]->GetOutputData();
+            TS_ASSERT_EQUALS(data.size(), r_node_names.size());
+            for(unsigned jdx=0; jdx<r_node_names.size(); jdx++)
+            {
+                TS_ASSERT_EQUALS(data.count(r_node_names[jdx]), 1u);
+                TS_ASSERT_DELTA(p_table->rGetNodeAttribute(jdx)[idx], data[r_node_names[jdx]], 1.e-12);
+            }
+        }
+
+        std::vector<boost::shared_ptr<VesselSegment<3> > > segments = p_network->GetVesselSegments();
+        const std::vector<std::string>& r_segment_names = p_table->rGetSegmentAttributeNames();
+        for(unsigned idx=0; idx<segments.size(); idx++)
+        {
+            std::map<std::string, double> data = segments[idx]->GetOutputData();
+            TS_ASSERT_EQUALS(data.size(), r_segment_names.size());
+            for(unsigned jdx=0; jdx<r_segment_names.size(); jdx++)
+            {
+                TS_ASSERT_EQUALS(data.count(r_segment_names[jdx]), 1u);
+                TS_ASSERT_DELTA(p_table->rGetSegmentAttribute(jdx)[idx], data[r_segment_names[jdx]], 1.e-12);
+            }
+        }
+
+        std::vector<boost::shared_ptr<Vessel<3> > > vessels = p_network->GetVessels();
+        const std::vector<std::string>& r_vessel_names = p_table->rGetVesselAttributeNames();
+        for(unsigned idx=0; idx<vessels.size(); idx++)
+        {
+            std::map<std::string, double> data = vessels[idx]->GetOutputData();
+            TS_ASSERT_EQUALS(data.size(), r_vessel_names.size());
+            for(unsigned jdx=0; jdx<r_vessel_names.size(); jdx++)
+            {
+                TS_ASSERT_EQUALS(data.count(r_vessel_names[jdx]), 1u);
+                TS_ASSERT_DELTA(p_table->rGetVesselAttribute(jdx)[idx], data[r_vessel_names[jdx]], 1.e-12);
+            }
+        }
+
+        // Built in values are refreshed on update
+        unsigned pressure_index = p_table->GetNodeAttributeIndex("Node Pressure Pa");
+        p_node1->GetFlowProperties()->SetPressure(5.0*unit::pascals);
+        p_table->Update();
+        TS_ASSERT_DELTA(p_table->rGetNodeAttribute(pressure_index)[p_network->GetNodeIndex(p_node1)], 5.0, 1.e-12);
+        TS_ASSERT_THROWS_THIS(p_table->GetNodeAttributeIndex("Missing"),
+                "Requested attribute 'Missing' has not been added to the table.");
+    }
+
+    void TestUserAttributesFollowComponents() throw(Exception)
+    {
+        boost::shared_ptr<VesselNode<2> > p_node1 = VesselNode<2>::Create(0.0, 0.0);
+        boost::shared_ptr<VesselNode<2> > p_node2 = VesselNode<2>::Create(100.0, 0.0);
+        boost::shared_ptr<VesselNode<2> > p_node3 = VesselNode<2>::Create(200.0, 0.0);
+        boost::shared_ptr<VesselNode<2> > p_node4 = VesselNode<2>::Create(300.0, 0.0);
+        boost::shared_ptr<Vessel<2> > p_vessel1 = Vessel<2>::Create(p_node1, p_node2);
+        boost::shared_ptr<Vessel<2> > p_vessel2 = Vessel<2>::Create(p_node2, p_node3);
+        boost::shared_ptr<Vessel<2> > p_vessel3 = Vessel<2>::Create(p_node3, p_node4);
+        boost::shared_ptr<VesselNetwork<2> > p_network = VesselNetwork<2>::Create();
+        p_network->AddVessel(p_vessel1);
+        p_network->AddVessel(p_vessel2);
+
+        boost::shared_ptr<VesselNetworkAttributeTable<2> > p_table = VesselNetworkAttributeTable<2>::Create();
+        p_table->SetVesselNetwork(p_network);
+        p_table->Update();
+
+        unsigned label_index = p_table->AddVesselAttribute("Label");
+        TS_ASSERT_EQUALS(p_table->AddVesselAttribute("Label"), label_index);
+        TS_ASSERT_EQUALS(p_table->GetVesselAttributeIndex("Label"), label_index);
+        TS_ASSERT_EQUALS(p_table->rGetVesselAttribute(label_index).size(), 2u);
+        p_table->rGetVesselAttribute(label_index)[p_network->GetVesselIndex(p_vessel1)] = 1.0;
+        p_table->rGetVesselAttribute(label_index)[p_network->GetVesselIndex(p_vessel2)] = 2.0;
+
+        unsigned tag_index = p_table->AddNodeAttribute("Tag");
+        p_table->rGetNodeAttribute(tag_index)[p_network->GetNodeIndex(p_node2)] = 7.0;
+
+        // Values stay with their components when the network changes
+        p_network->AddVessel(p_vessel3);
+        p_network->RemoveVessel(p_vessel1);
+        p_table->Update();
+        std::vector<double>& r_labels = p_table->rGetVesselAttribute(label_index);
+        TS_ASSERT_EQUALS(r_labels.size(), 2u);
+        TS_ASSERT_DELTA(r_labels[p_network->GetVesselIndex(p_vessel2)], 2.0, 1.e-12);
+        TS_ASSERT_DELTA(r_labels[p_network->GetVesselIndex(p_vessel3)], 0.0, 1.e-12);
+        std::vector<double>& r_tags = p_table->rGetNodeAttribute(tag_index);
+        TS_ASSERT_EQUALS(r_tags.size(), 3u);
+        TS_ASSERT_DELTA(r_tags[p_network->GetNodeIndex(p_node2)], 7.0, 1.e-12);
+        TS_ASSERT_DELTA(r_tags[p_network->GetNodeIndex(p_node4)], 0.0, 1.e-12);
+
+        // A different network starts from zero
+        boost::shared_ptr<VesselNetwork<2> > p_other_network = VesselNetwork<2>::Create();
+        p_other_network->AddVessel(p_vessel2);
+        p_table->SetVesselNetwork(p_other_network);
+        p_table->Update();
+        TS_ASSERT_DELTA(p_table->rGetVesselAttribute(label_index)[0], 0.0, 1.e-12);
+        TS_ASSERT_THROWS_THIS(p_table->rGetVesselAttribute(100), "Requested vessel attribute index is out of range.");
+    }
+};
+
+#endif /*TESTVESSELNETWORKATTRIBUTETABLE_HPP_*/
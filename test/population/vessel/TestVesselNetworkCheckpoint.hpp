@@ -0,0 +1,106 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef TESTVESSELNETWORKCHECKPOINT_HPP_
+#define TESTVESSELNETWORKCHECKPOINT_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "SmartPointers.hpp"
+#include "VesselNode.hpp"
+#include "VesselSegment.hpp"
+#include "Vessel.hpp"
+#include "VesselNetwork.hpp"
+#include "VesselNetworkCheckpoint.hpp"
+#include "UnitCollection.hpp"
+
+#include "PetscSetupAndFinalize.hpp"
+
+class TestVesselNetworkCheckpoint : public CxxTest::TestSuite
+{
+
+public:
+
+    void TestRestoreData() throw(Exception)
+    {
+        // A chain of three vessels
+        std::vector<boost::shared_ptr<VesselNode<3> > > nodes;
+        for(unsigned idx=0; idx < 4; idx++)
+        {
+            nodes.push_back(VesselNode<3>::Create(10.0*double(idx), 0.0, 0.0));
+        }
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        for(unsigned idx=0; idx < 3; idx++)
+        {
+            p_network->AddVessel(Vessel<3>::Create(VesselSegment<3>::Create(nodes[idx], nodes[idx+1])));
+        }
+        p_network->SetSegmentRadii(10.e-6*unit::metres);
+        nodes[0]->GetFlowProperties()->SetPressure(100.0*unit::pascals);
+        boost::shared_ptr<VesselNetworkCheckpoint<3> > p_checkpoint = VesselNetworkCheckpoint<3>::Create(p_network);
+        TS_ASSERT(p_checkpoint->CanRestore());
+        TS_ASSERT(p_checkpoint->GetNetwork() == p_network);
+
+        // Change radii, flow properties and a location, as a failed adaptation step might
+        std::vector<boost::shared_ptr<Vessel<3> > > vessels = p_network->GetVessels();
+        vessels[1]->SetRadius(20.e-6*unit::metres);
+        vessels[1]->GetSegment(0)->GetFlowProperties()->SetHaematocrit(0.6);
+        vessels[2]->GetFlowProperties()->SetRegressionTime(5.0*unit::seconds);
+        nodes[0]->GetFlowProperties()->SetPressure(50.0*unit::pascals);
+        nodes[3]->SetLocation(DimensionalChastePoint<3>(40.0, 0.0, 0.0));
+
+        p_checkpoint->Restore();
+        TS_ASSERT(p_checkpoint->CanRestore());
+        TS_ASSERT_DELTA(vessels[1]->GetRadius()/(1.e-6*unit::metres), 10.0, 1.e-6);
+        TS_ASSERT_DELTA(vessels[1]->GetSegment(0)->GetFlowProperties()->GetHaematocrit(), 0.0, 1.e-6);
+        TS_ASSERT(vessels[2]->GetFlowProperties()->GetRegressionTime() > 1.e6*unit::seconds);
+        TS_ASSERT_DELTA(nodes[0]->GetFlowProperties()->GetPressure()/unit::pascals, 100.0, 1.e-6);
+        TS_ASSERT_DELTA(nodes[3]->rGetLocation()[0], 30.0, 1.e-6);
+        TS_ASSERT(p_network->GetNearestNode(DimensionalChastePoint<3>(31.0, 0.0, 0.0)) == nodes[3]);
+
+        // Vessel flow properties still see the vessel's segments
+        vessels[1]->GetSegment(0)->GetFlowProperties()->SetHaematocrit(0.4);
+        TS_ASSERT_DELTA(vessels[1]->GetFlowProperties()->GetHaematocrit(), 0.4, 1.e-6);
+
+        // Topology changes prevent a restore
+        p_network->RemoveVessel(vessels[2], true);
+        TS_ASSERT(!p_checkpoint->CanRestore());
+        TS_ASSERT_THROWS_THIS(p_checkpoint->Restore(), "The network topology has changed since the checkpoint was recorded.");
+        p_checkpoint->Record();
+        TS_ASSERT(p_checkpoint->CanRestore());
+        p_checkpoint->Restore();
+    }
+};
+
+#endif /*TESTVESSELNETWORKCHECKPOINT_HPP_*/
@@ -0,0 +1,193 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef TESTVESSELNETWORKSNAPSHOT_HPP_
+#define TESTVESSELNETWORKSNAPSHOT_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "SmartPointers.hpp"
+#include "VesselNode.hpp"
+#include "VesselSegment.hpp"
+#include "Vessel.hpp"
+#include "VesselNetwork.hpp"
+#include "VesselNetworkSnapshot.hpp"
+#include "VesselNetworkGraphCalculator.hpp"
+#include "UnitCollection.hpp"
+
+#include "PetscSetupAndFinalize.hpp"
+
+class TestVesselNetworkSnapshot : public CxxTest::TestSuite
+{
+
+    /**
+     * Check the snapshot connectivity against the graph calculator
+     */
+    void CheckConnectivity(boost::shared_ptr<VesselNetwork<2> > pNetwork, boost::shared_ptr<VesselNetworkSnapshot<2> > pSnapshot)
+    {
+        boost::shared_ptr<VesselNetworkGraphCalculator<2> > p_calculator = VesselNetworkGraphCalculator<2>::Create();
+        p_calculator->SetVesselNetwork(pNetwork);
+        std::vector<std::vector<unsigned> > node_vessels = p_calculator->GetNodeVesselConnectivity();
+        std::vector<std::vector<unsigned> > node_nodes = p_calculator->GetNodeNodeConnectivity();
+
+        TS_ASSERT_EQUALS(pSnapshot->GetNumberOfNodes(), node_vessels.size());
+        TS_ASSERT_EQUALS(pSnapshot->GetNumberOfVessels(), pNetwork->GetNumberOfVessels());
+        TS_ASSERT_EQUALS(pSnapshot->GetMaxBranchesOnNode(), pNetwork->GetMaxBranchesOnNode());
+        for(unsigned idx=0; idx<node_vessels.size(); idx++)
+        {
+            unsigned offset = pSnapshot->rGetNodeOffsets()[idx];
+            TS_ASSERT_EQUALS(pSnapshot->rGetNodeOffsets()[idx+1] - offset, node_vessels[idx].size());
+            for(unsigned jdx=0; jdx<node_vessels[idx].size(); jdx++)
+            {
+                TS_ASSERT_EQUALS(pSnapshot->rGetNodeVessels()[offset+jdx], node_vessels[idx][jdx]);
+                TS_ASSERT_EQUALS(pSnapshot->rGetNodeNeighbours()[offset+jdx], node_nodes[idx][jdx]);
+            }
+        }
+        std::vector<boost::shared_ptr<Vessel<2> > > vessels = pNetwork->GetVessels();
+        for(unsigned idx=0; idx<vessels.size(); idx++)
+        {
+            TS_ASSERT(pSnapshot->rGetNodes()[pSnapshot->rGetVesselStartNodes()[idx]] == vessels[idx]->GetStartNode());
+            TS_ASSERT(pSnapshot->rGetNodes()[pSnapshot->rGetVesselEndNodes()[idx]] == vessels[idx]->GetEndNode());
+        }
+    }
+
+public:
+
+    void TestConnectivityAndData() throw(Exception)
+    {
+        // Make a bifurcation with a multi-segment parent vessel
+        std::vector<boost::shared_ptr<VesselNode<2> > > parent_nodes;
+        parent_nodes.push_back(VesselNode<2>::Create(0.0, 0.0));
+        parent_nodes.push_back(VesselNode<2>::Create(50.0, 0.0));
+        parent_nodes.push_back(VesselNode<2>::Create(100.0, 0.0));
+        boost::shared_ptr<VesselNode<2> > p_node1 = VesselNode<2>::Create(200.0, 100.0);
+        boost::shared_ptr<VesselNode<2> > p_node2 = VesselNode<2>::Create(200.0, -100.0);
+        boost::shared_ptr<Vessel<2> > p_parent = Vessel<2>::Create(parent_nodes);
+        boost::shared_ptr<Vessel<2> > p_daughter1 = Vessel<2>::Create(parent_nodes[2], p_node1);
+        boost::shared_ptr<Vessel<2> > p_daughter2 = Vessel<2>::Create(p_node2, parent_nodes[2]);
+        boost::shared_ptr<VesselNetwork<2> > p_network = VesselNetwork<2>::Create();
+        p_network->AddVessel(p_parent);
+        p_network->AddVessel(p_daughter1);
+        p_network->AddVessel(p_daughter2);
+
+        p_parent->GetFlowProperties()->SetImpedance(4.0*unit::pascal_second_per_metre_cubed);
+        p_parent->GetFlowProperties()->SetFlowRate(2.0*unit::metre_cubed_per_second);
+        p_parent->GetFlowProperties()->SetHaematocrit(0.45);
+        p_daughter1->SetRadius(5.0*unit::metres);
+        p_node1->GetFlowProperties()->SetPressure(10.0*unit::pascals);
+
+        boost::shared_ptr<VesselNetworkSnapshot<2> > p_snapshot = VesselNetworkSnapshot<2>::Create();
+        TS_ASSERT_THROWS_THIS(p_snapshot->Update(), "A vessel network is required before updating the snapshot.");
+        p_snapshot->SetVesselNetwork(p_network);
+        TS_ASSERT(!p_snapshot->IsUpToDate());
+        p_snapshot->Update();
+        TS_ASSERT(p_snapshot->IsUpToDate());
+        CheckConnectivity(p_network, p_snapshot);
+
+        TS_ASSERT_DELTA(p_snapshot->rGetImpedances()[0], 4.0, 1.e-6);
+        TS_ASSERT_DELTA(p_snapshot->rGetFlowRates()[0], 2.0, 1.e-6);
+        TS_ASSERT_DELTA(p_snapshot->rGetHaematocrits()[0], 0.45, 1.e-6);
+        TS_ASSERT_DELTA(p_snapshot->rGetRadii()[1], 5.0, 1.e-6);
+        TS_ASSERT_DELTA(p_snapshot->rGetLengths()[0], p_parent->GetLength()/unit::metres, 1.e-6);
+        TS_ASSERT_DELTA(p_snapshot->rGetPressures()[p_network->GetVesselEndNodeIndex(p_node1)], 10.0, 1.e-6);
+
+        // Data is only written back on request
+        p_snapshot->rGetFlowRates()[1] = 3.0;
+        p_snapshot->rGetHaematocrits()[2] = 0.2;
+        p_snapshot->rGetPressures()[p_network->GetVesselEndNodeIndex(p_node2)] = 7.0;
+        TS_ASSERT_DELTA(p_daughter1->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, 0.0, 1.e-6);
+        p_snapshot->WriteFlowRates();
+        p_snapshot->WriteHaematocrits();
+        p_snapshot->WritePressures();
+        TS_ASSERT_DELTA(p_daughter1->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, 3.0, 1.e-6);
+        TS_ASSERT_DELTA(p_daughter2->GetFlowProperties()->GetHaematocrit(), 0.2, 1.e-6);
+        TS_ASSERT_DELTA(p_node2->GetFlowProperties()->GetPressure()/unit::pascals, 7.0, 1.e-6);
+
+        // Changes to the network make the snapshot stale until it is updated
+        p_network->FormSprout(DimensionalChastePoint<2>(50.0, 0.0), DimensionalChastePoint<2>(50.0, 50.0));
+        TS_ASSERT(!p_snapshot->IsUpToDate());
+        p_snapshot->Update();
+        TS_ASSERT(p_snapshot->IsUpToDate());
+        TS_ASSERT_EQUALS(p_snapshot->GetNumberOfVessels(), 5u);
+        CheckConnectivity(p_network, p_snapshot);
+
+        // Reconnecting a vessel directly leaves the topology version alone, but a forced update still picks it up
+        unsigned version = p_network->GetTopologyVersion();
+        p_daughter2->GetSegments()[0]->ReplaceNode(1, p_node1);
+        TS_ASSERT_EQUALS(p_network->GetTopologyVersion(), version);
+        p_snapshot->Update(true);
+        TS_ASSERT(p_snapshot->rGetNodes()[p_snapshot->rGetVesselEndNodes()[p_network->GetVesselIndex(p_daughter2)]] == p_node1);
+        CheckConnectivity(p_network, p_snapshot);
+    }
+
+    void TestConnectedComponents() throw(Exception)
+    {
+        // Three separate pieces, added so that the last vessel joins the first two
+        std::vector<boost::shared_ptr<VesselNode<2> > > nodes;
+        for(unsigned idx=0; idx<8; idx++)
+        {
+            nodes.push_back(VesselNode<2>::Create(double(idx)*10.0, 0.0));
+        }
+        boost::shared_ptr<VesselNetwork<2> > p_network = VesselNetwork<2>::Create();
+        p_network->AddVessel(Vessel<2>::Create(nodes[0], nodes[1]));
+        p_network->AddVessel(Vessel<2>::Create(nodes[3], nodes[4]));
+        p_network->AddVessel(Vessel<2>::Create(nodes[6], nodes[7]));
+        p_network->AddVessel(Vessel<2>::Create(nodes[4], nodes[5]));
+
+        boost::shared_ptr<VesselNetworkSnapshot<2> > p_snapshot = VesselNetworkSnapshot<2>::Create();
+        p_snapshot->SetVesselNetwork(p_network);
+        p_snapshot->Update();
+        TS_ASSERT_EQUALS(p_snapshot->GetNumberOfComponents(), 3u);
+        const std::vector<unsigned>& r_components = p_snapshot->rGetNodeComponents();
+        TS_ASSERT_EQUALS(r_components.size(), 7u);
+        TS_ASSERT_EQUALS(r_components[p_network->GetVesselEndNodeIndex(nodes[0])],
+                         r_components[p_network->GetVesselEndNodeIndex(nodes[1])]);
+        TS_ASSERT_EQUALS(r_components[p_network->GetVesselEndNodeIndex(nodes[3])],
+                         r_components[p_network->GetVesselEndNodeIndex(nodes[5])]);
+        TS_ASSERT_DIFFERS(r_components[p_network->GetVesselEndNodeIndex(nodes[3])],
+                          r_components[p_network->GetVesselEndNodeIndex(nodes[6])]);
+        TS_ASSERT_DIFFERS(r_components[p_network->GetVesselEndNodeIndex(nodes[0])],
+                          r_components[p_network->GetVesselEndNodeIndex(nodes[6])]);
+
+        // Joining two pieces merges their components
+        p_network->AddVessel(Vessel<2>::Create(nodes[1], nodes[6]));
+        p_snapshot->Update();
+        TS_ASSERT_EQUALS(p_snapshot->GetNumberOfComponents(), 2u);
+        TS_ASSERT_EQUALS(p_snapshot->rGetNodeComponents()[p_network->GetVesselEndNodeIndex(nodes[0])],
+                         p_snapshot->rGetNodeComponents()[p_network->GetVesselEndNodeIndex(nodes[7])]);
+    }
+};
+
+#endif /*TESTVESSELNETWORKSNAPSHOT_HPP_*/
@@ -0,0 +1,377 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef TESTVESSELNETWORKSPATIALINDEX_HPP_
+#define TESTVESSELNETWORKSPATIALINDEX_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <algorithm>
+#include "SmartPointers.hpp"
+#include "VesselNode.hpp"
+#include "VesselSegment.hpp"
+#include "VesselNetwork.hpp"
+#include "VesselNetworkSpatialIndex.hpp"
+#include "VesselNetworkGenerator.hpp"
+#include "UnitCollection.hpp"
+
+#include "PetscSetupAndFinalize.hpp"
+
+class TestVesselNetworkSpatialIndex : public CxxTest::TestSuite
+{
+
+    /**
+     * Check the network nearest queries against a linear search at a set of locations
+     */
+    void CheckAgainstLinearSearch(boost::shared_ptr<VesselNetwork<2> > pNetwork)
+    {
+        std::vector<boost::shared_ptr<VesselNode<2> > > nodes = pNetwork->GetNodes();
+        std::vector<boost::shared_ptr<VesselSegment<2> > > segments = pNetwork->GetVesselSegments();
+
+        for(unsigned idx=0; idx<200; idx++)
+        {
+            // Include locations on nodes and outside the network
+            DimensionalChastePoint<2> location(double((idx*37)%700) - 50.0, double((idx*53)%900) - 50.0);
+            if(idx%5 == 0)
+            {
+                location = nodes[(idx*7)%nodes.size()]->rGetLocation();
+            }
+
+            boost::shared_ptr<VesselNode<2> > p_nearest_node;
+            units::quantity<unit::length> min_node_distance = DBL_MAX*unit::metres;
+            unsigned num_near_nodes = 0;
+            for(unsigned jdx=0; jdx<nodes.size(); jdx++)
+            {
+                units::quantity<unit::length> distance = nodes[jdx]->GetDistance(location);
+                if(distance < min_node_distance)
+                {
+                    min_node_distance = distance;
+                    p_nearest_node = nodes[jdx];
+                }
+                if(distance/nodes[jdx]->GetReferenceLengthScale() <= 60.0 + 1.e-6)
+                {
+                    num_near_nodes++;
+                }
+            }
+
+            boost::shared_ptr<VesselSegment<2> > p_nearest_segment;
+            units::quantity<unit::length> min_segment_distance = DBL_MAX*unit::metres;
+            for(unsigned jdx=0; jdx<segments.size(); jdx++)
+            {
+                units::quantity<unit::length> distance = segments[jdx]->GetDistance(location);
+                if(distance < min_segment_distance)
+                {
+                    min_segment_distance = distance;
+                    p_nearest_segment = segments[jdx];
+                }
+            }
+
+            TS_ASSERT(pNetwork->GetNearestNode(location) == p_nearest_node);
+            TS_ASSERT_DELTA(pNetwork->GetDistanceToNearestNode(location)/(1.e-6*unit::metres), min_node_distance/(1.e-6*unit::metres), 1.e-6);
+            TS_ASSERT(pNetwork->GetNearestSegment(location).first == p_nearest_segment);
+            TS_ASSERT_DELTA(pNetwork->GetNearestSegment(location).second/(1.e-6*unit::metres), min_segment_distance/(1.e-6*unit::metres), 1.e-6);
+            TS_ASSERT_EQUALS(pNetwork->NumberOfNodesNearLocation(location, 60.0), num_near_nodes);
+        }
+    }
+
+public:
+
+    void TestIndexInsertionAndRemoval() throw(Exception)
+    {
+        boost::shared_ptr<VesselNode<2> > p_node1 = VesselNode<2>::Create(0.0, 0.0);
+        boost::shared_ptr<VesselNode<2> > p_node2 = VesselNode<2>::Create(100.0, 0.0);
+        boost::shared_ptr<VesselNode<2> > p_node3 = VesselNode<2>::Create(100.0, 100.0);
+        boost::shared_ptr<VesselSegment<2> > p_segment1 = VesselSegment<2>::Create(p_node1, p_node2);
+        boost::shared_ptr<VesselSegment<2> > p_segment2 = VesselSegment<2>::Create(p_node2, p_node3);
+
+        boost::shared_ptr<VesselNetworkSpatialIndex<2> > p_index = VesselNetworkSpatialIndex<2>::Create();
+        p_index->SetCellWidth(10.0*1.e-6*unit::metres);
+        std::vector<boost::shared_ptr<VesselSegment<2> > > segments;
+        segments.push_back(p_segment1);
+        p_index->Build(segments);
+        TS_ASSERT_EQUALS(p_index->GetNumberOfSegments(), 1u);
+        TS_ASSERT_EQUALS(p_index->GetNumberOfNodes(), 2u);
+        TS_ASSERT_DELTA(p_index->GetCellWidth()/(1.e-6*unit::metres), 10.0, 1.e-6);
+
+        // Shared nodes are only indexed once
+        p_index->InsertSegment(p_segment2);
+        p_index->InsertSegment(p_segment2);
+        TS_ASSERT_EQUALS(p_index->GetNumberOfSegments(), 2u);
+        TS_ASSERT_EQUALS(p_index->GetNumberOfNodes(), 3u);
+
+        // Both segments meet at node 2, so are equally near it
+        std::pair<std::vector<boost::shared_ptr<VesselSegment<2> > >, units::quantity<unit::length> > nearest_segments =
+                p_index->GetNearestSegments(DimensionalChastePoint<2>(105.0, -5.0));
+        TS_ASSERT_EQUALS(nearest_segments.first.size(), 2u);
+        TS_ASSERT_DELTA(nearest_segments.second/(1.e-6*unit::metres), std::sqrt(50.0), 1.e-6);
+
+        std::pair<std::vector<boost::shared_ptr<VesselNode<2> > >, units::quantity<unit::length> > nearest_nodes =
+                p_index->GetNearestNodes(DimensionalChastePoint<2>(90.0, 80.0));
+        TS_ASSERT_EQUALS(nearest_nodes.first.size(), 1u);
+        TS_ASSERT(nearest_nodes.first[0] == p_node3);
+        TS_ASSERT(p_index->GetNearestNodes(p_node3->rGetLocation(), p_node3).first[0] == p_node2);
+
+        // Node 3 is dropped with the last segment attached to it
+        p_index->RemoveSegment(p_segment2);
+        TS_ASSERT_EQUALS(p_index->GetNumberOfSegments(), 1u);
+        TS_ASSERT_EQUALS(p_index->GetNumberOfNodes(), 2u);
+        TS_ASSERT(p_index->GetNearestNodes(DimensionalChastePoint<2>(90.0, 80.0)).first[0] == p_node2);
+        TS_ASSERT(p_index->GetNearestSegments(DimensionalChastePoint<2>(105.0, 50.0)).first[0] == p_segment1);
+
+        // Reconnected segments are re-indexed, releasing the node they were detached from
+        boost::shared_ptr<VesselNode<2> > p_node4 = VesselNode<2>::Create(0.0, 50.0);
+        p_segment1->ReplaceNode(0, p_node4);
+        p_index->UpdateReconnectedSegments();
+        TS_ASSERT_EQUALS(p_index->GetNumberOfSegments(), 1u);
+        TS_ASSERT_EQUALS(p_index->GetNumberOfNodes(), 2u);
+        TS_ASSERT(p_index->GetNearestNodes(DimensionalChastePoint<2>(0.0, 5.0)).first[0] == p_node4);
+        TS_ASSERT(p_index->GetNearestSegments(DimensionalChastePoint<2>(0.0, 5.0)).first[0] == p_segment1);
+
+        p_index->Clear();
+        TS_ASSERT_EQUALS(p_index->GetNumberOfSegments(), 0u);
+        TS_ASSERT(p_index->GetNearestNodes(DimensionalChastePoint<2>(90.0, 80.0)).first.empty());
+        TS_ASSERT_THROWS_THIS(p_index->SetCellWidth(-1.0*unit::metres), "The spatial index cell width can not be negative.");
+    }
+
+    void TestNearestQueriesMatchLinearSearch() throw(Exception)
+    {
+        VesselNetworkGenerator<2> network_generator;
+        boost::shared_ptr<VesselNetwork<2> > p_network = network_generator.GenerateHexagonalNetwork(600.0*1.e-6*unit::metres,
+                                                                                                   800.0*1.e-6*unit::metres,
+                                                                                                   40.0*1.e-6*unit::metres);
+        CheckAgainstLinearSearch(p_network);
+
+        // Small cells mean many rings of cells are searched, large ones mean few
+        p_network->SetSpatialIndexCellWidth(3.0*1.e-6*unit::metres);
+        CheckAgainstLinearSearch(p_network);
+        p_network->SetSpatialIndexCellWidth(500.0*1.e-6*unit::metres);
+        CheckAgainstLinearSearch(p_network);
+    }
+
+    void TestIndexFollowsNetworkChanges() throw(Exception)
+    {
+        VesselNetworkGenerator<2> network_generator;
+        boost::shared_ptr<VesselNetwork<2> > p_network = network_generator.GenerateHexagonalNetwork(600.0*1.e-6*unit::metres,
+                                                                                                   800.0*1.e-6*unit::metres,
+                                                                                                   40.0*1.e-6*unit::metres);
+        CheckAgainstLinearSearch(p_network);
+
+        // Sprout from some nodes, extend the sprouts and remove some vessels
+        std::vector<boost::shared_ptr<VesselNode<2> > > nodes = p_network->GetNodes();
+        std::vector<boost::shared_ptr<Vessel<2> > > sprouts;
+        for(unsigned idx=0; idx<nodes.size(); idx+=7)
+        {
+            DimensionalChastePoint<2> tip_location(nodes[idx]->rGetLocation()[0] + 5.0, nodes[idx]->rGetLocation()[1] + 12.0);
+            sprouts.push_back(p_network->FormSprout(nodes[idx]->rGetLocation(), tip_location));
+        }
+        for(unsigned idx=0; idx<sprouts.size(); idx++)
+        {
+            boost::shared_ptr<VesselNode<2> > p_tip = sprouts[idx]->GetEndNode();
+            p_network->ExtendVessel(sprouts[idx], p_tip, VesselNode<2>::Create(p_tip->rGetLocation()[0] + 8.0, p_tip->rGetLocation()[1] + 3.0));
+        }
+        CheckAgainstLinearSearch(p_network);
+
+        for(unsigned idx=0; idx<sprouts.size(); idx+=2)
+        {
+            p_network->RemoveVessel(sprouts[idx], true);
+        }
+        CheckAgainstLinearSearch(p_network);
+
+        // Nodes moved directly, as migrating tips are, are picked up without an update
+        for(unsigned idx=1; idx<sprouts.size(); idx+=2)
+        {
+            boost::shared_ptr<VesselNode<2> > p_tip = sprouts[idx]->GetEndNode();
+            p_tip->SetLocation(DimensionalChastePoint<2>(p_tip->rGetLocation()[0] + 150.0, p_tip->rGetLocation()[1] - 70.0));
+        }
+        nodes[0]->SetLocation(DimensionalChastePoint<2>(-40.0, -30.0));
+        CheckAgainstLinearSearch(p_network);
+        boost::shared_ptr<VesselNode<2> > p_moved_tip = sprouts[1]->GetEndNode();
+        TS_ASSERT(p_network->GetNearestNode(p_moved_tip->rGetLocation()) == p_moved_tip);
+        TS_ASSERT(p_network->GetNearestSegment(p_moved_tip->rGetLocation()).first->GetVessel() == sprouts[1]);
+
+        // Only the moved nodes are looked at, once each however often they have moved
+        for(unsigned idx=0; idx<50; idx++)
+        {
+            p_moved_tip->SetLocation(DimensionalChastePoint<2>(p_moved_tip->rGetLocation()[0] + 1.0, p_moved_tip->rGetLocation()[1]));
+        }
+        CheckAgainstLinearSearch(p_network);
+        TS_ASSERT(p_network->GetNearestNode(p_moved_tip->rGetLocation()) == p_moved_tip);
+
+        unsigned location_version = VesselNode<2>::GetLatestLocationVersion();
+        nodes[1]->SetLocation(DimensionalChastePoint<2>(-60.0, 900.0));
+        std::vector<const VesselNode<2>*> moved_nodes;
+        TS_ASSERT(VesselNode<2>::GetMovedNodes(location_version, moved_nodes));
+        TS_ASSERT_EQUALS(moved_nodes.size(), 1u);
+        TS_ASSERT(moved_nodes[0] == nodes[1].get());
+
+        // Once enough other nodes have moved that the earlier moves are no longer known every node is checked
+        boost::shared_ptr<VesselNode<2> > p_free_node = VesselNode<2>::Create(0.0, 0.0);
+        for(unsigned idx=0; idx<10000 + 4*nodes.size(); idx++)
+        {
+            p_free_node->SetLocation(DimensionalChastePoint<2>(double(idx%100), 0.0));
+        }
+        TS_ASSERT(!VesselNode<2>::GetMovedNodes(location_version, moved_nodes));
+        CheckAgainstLinearSearch(p_network);
+        TS_ASSERT(p_network->GetNearestNode(DimensionalChastePoint<2>(-60.0, 900.0)) == nodes[1]);
+
+        // Moved nodes are picked up after an update
+        p_network->Translate(DimensionalChastePoint<2>(1000.0, 0.0));
+        p_network->UpdateAll();
+        CheckAgainstLinearSearch(p_network);
+    }
+
+    void TestIndexPatchedInsideBatch() throw(Exception)
+    {
+        VesselNetworkGenerator<2> network_generator;
+        boost::shared_ptr<VesselNetwork<2> > p_network = network_generator.GenerateHexagonalNetwork(600.0*1.e-6*unit::metres,
+                                                                                                   800.0*1.e-6*unit::metres,
+                                                                                                   40.0*1.e-6*unit::metres);
+        CheckAgainstLinearSearch(p_network);
+
+        // Sprout and then join the sprout tips onto other vessels, as in anastamosis, updating after each join
+        p_network->BeginBatch();
+        std::vector<boost::shared_ptr<VesselNode<2> > > nodes = p_network->GetNodes();
+        std::vector<boost::shared_ptr<Vessel<2> > > sprouts;
+        for(unsigned idx=0; idx<nodes.size(); idx+=11)
+        {
+            DimensionalChastePoint<2> tip_location(nodes[idx]->rGetLocation()[0] + 5.0, nodes[idx]->rGetLocation()[1] + 12.0);
+            sprouts.push_back(p_network->FormSprout(nodes[idx]->rGetLocation(), tip_location));
+        }
+        p_network->UpdateAll();
+        CheckAgainstLinearSearch(p_network);
+
+        std::vector<boost::shared_ptr<Vessel<2> > > vessels = p_network->GetVessels();
+        std::vector<DimensionalChastePoint<2> > old_tip_locations;
+        for(unsigned idx=0; idx<sprouts.size(); idx++)
+        {
+            boost::shared_ptr<Vessel<2> > p_target = vessels[(idx*13 + 5)%vessels.size()];
+            if(std::find(sprouts.begin(), sprouts.end(), p_target) != sprouts.end())
+            {
+                continue;
+            }
+            old_tip_locations.push_back(sprouts[idx]->GetEndNode()->rGetLocation());
+            boost::shared_ptr<VesselNode<2> > p_merge_node = p_network->DivideVessel(p_target,
+                    p_target->GetSegments()[0]->GetMidPoint());
+            sprouts[idx]->GetSegments()[0]->ReplaceNode(1, p_merge_node);
+            p_network->UpdateAll();
+            vessels = p_network->GetVessels();
+        }
+        TS_ASSERT(!old_tip_locations.empty());
+        CheckAgainstLinearSearch(p_network);
+
+        // The detached tips are no longer in the network
+        for(unsigned idx=0; idx<old_tip_locations.size(); idx++)
+        {
+            TS_ASSERT(p_network->GetNearestNode(old_tip_locations[idx])->GetNumberOfSegments() > 0);
+        }
+        p_network->CommitBatch();
+        CheckAgainstLinearSearch(p_network);
+    }
+
+    void TestBatchedQueries() throw(Exception)
+    {
+        VesselNetworkGenerator<2> network_generator;
+        boost::shared_ptr<VesselNetwork<2> > p_network = network_generator.GenerateHexagonalNetwork(600.0*1.e-6*unit::metres,
+                                                                                                   800.0*1.e-6*unit::metres,
+                                                                                                   40.0*1.e-6*unit::metres);
+        std::vector<DimensionalChastePoint<2> > locations;
+        for(unsigned idx=0; idx<50; idx++)
+        {
+            locations.push_back(DimensionalChastePoint<2>(double(idx)*11.0, double(idx)*13.0));
+        }
+
+        std::vector<boost::shared_ptr<VesselNode<2> > > nearest_nodes = p_network->GetNearestNodes(locations);
+        std::vector<std::pair<boost::shared_ptr<VesselSegment<2> >, units::quantity<unit::length> > > nearest_segments =
+                p_network->GetNearestSegments(locations);
+        TS_ASSERT_EQUALS(nearest_nodes.size(), locations.size());
+        TS_ASSERT_EQUALS(nearest_segments.size(), locations.size());
+        for(unsigned idx=0; idx<locations.size(); idx++)
+        {
+            TS_ASSERT(nearest_nodes[idx] == p_network->GetNearestNode(locations[idx]));
+            TS_ASSERT(nearest_segments[idx].first == p_network->GetNearestSegment(locations[idx]).first);
+        }
+    }
+
+    void TestLineSegmentCrossing() throw(Exception)
+    {
+        VesselNetworkGenerator<2> network_generator;
+        boost::shared_ptr<VesselNetwork<2> > p_network = network_generator.GenerateHexagonalNetwork(600.0*1.e-6*unit::metres,
+                                                                                                   800.0*1.e-6*unit::metres,
+                                                                                                   40.0*1.e-6*unit::metres);
+        std::vector<boost::shared_ptr<VesselSegment<2> > > segments = p_network->GetVesselSegments();
+        std::vector<std::pair<DimensionalChastePoint<2>, DimensionalChastePoint<2> > > lines;
+        unsigned num_crossing = 0;
+        for(unsigned idx=0; idx<200; idx++)
+        {
+            // Short moves like sprout tip extensions, some starting on nodes
+            DimensionalChastePoint<2> start(double((idx*37)%700) - 50.0, double((idx*53)%900) - 50.0);
+            if(idx%5 == 0)
+            {
+                start = p_network->GetNodes()[(idx*7)%p_network->GetNumberOfNodes()]->rGetLocation();
+            }
+            DimensionalChastePoint<2> end(start[0] + double(idx%11) - 5.0, start[1] + double(idx%13) - 6.0);
+            lines.push_back(std::pair<DimensionalChastePoint<2>, DimensionalChastePoint<2> >(start, end));
+
+            // Linear search over all segments
+            bool crosses = false;
+            for(unsigned jdx=0; jdx<segments.size(); jdx++)
+            {
+                double distance = VesselNetworkSpatialIndex<2>::GetSegmentToSegmentDistance(segments[jdx]->GetNode(0)->rGetLocation().rGetLocation(),
+                        segments[jdx]->GetNode(1)->rGetLocation().rGetLocation(), start.rGetLocation(), end.rGetLocation());
+                double start_distance = segments[jdx]->GetDistance(start)/start.GetReferenceLengthScale();
+                double end_distance = segments[jdx]->GetDistance(end)/start.GetReferenceLengthScale();
+                if(distance <= 1.e-6 && start_distance > 1.e-6 && end_distance > 1.e-6)
+                {
+                    crosses = true;
+                }
+            }
+            if(crosses)
+            {
+                num_crossing++;
+            }
+            TS_ASSERT_EQUALS(p_network->VesselCrossesLineSegment(start, end), crosses);
+        }
+        TS_ASSERT(num_crossing > 0u);
+
+        // The batched query gives the same answers
+        std::vector<bool> batched_crosses = p_network->VesselsCrossLineSegments(lines);
+        TS_ASSERT_EQUALS(batched_crosses.size(), lines.size());
+        for(unsigned idx=0; idx<lines.size(); idx++)
+        {
+            TS_ASSERT_EQUALS(batched_crosses[idx], p_network->VesselCrossesLineSegment(lines[idx].first, lines[idx].second));
+        }
+    }
+};
+
+#endif /*TESTVESSELNETWORKSPATIALINDEX_HPP_*/
@@ -99,6 +99,14 @@ public:
         NodeFlowProperties<3> node_flow_properties;
         node_flow_properties.SetPressure(12.0 * unit::pascals);
         p_node->SetFlowProperties(node_flow_properties);
+        TS_ASSERT_DELTA(p_node->GetFlowProperties()->GetPressure() / unit::pascals, 12.0 , 1.e-6);
+        TS_ASSERT(!p_node->GetFlowProperties()->IsInputNode());
+
+        // Copies get their own properties
+        boost::shared_ptr<VesselNode<3> > p_copy = VesselNode<3>::Create(p_node);
+        TS_ASSERT_DELTA(p_copy->GetFlowProperties()->GetPressure() / unit::pascals, 12.0 , 1.e-6);
+        p_copy->GetFlowProperties()->SetPressure(3.0 * unit::pascals);
+        TS_ASSERT_DELTA(p_node->GetFlowProperties()->GetPressure() / unit::pascals, 12.0 , 1.e-6);
     }
 
     void TestDistanceAndConincidentMethods() throw (Exception)
@@ -0,0 +1,133 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef TESTCOUPLEDFLOWHAEMATOCRITSOLVER_HPP
+#define TESTCOUPLEDFLOWHAEMATOCRITSOLVER_HPP
+
+#include <cxxtest/TestSuite.h>
+#include "SmartPointers.hpp"
+#include "VesselNetwork.hpp"
+#include "CoupledFlowHaematocritSolver.hpp"
+#include "BetteridgeHaematocritSolver.hpp"
+#include "UnitCollection.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestCoupledFlowHaematocritSolver : public CxxTest::TestSuite
+{
+
+    boost::shared_ptr<VesselNetwork<2> > GetBridgeNetwork()
+    {
+        // Two bifurcations joined by a bridge, so that the flow split depends on the viscosity
+        std::vector<boost::shared_ptr<VesselNode<2> > > nodes;
+        nodes.push_back(VesselNode<2>::Create(0.0, 0.0));
+        nodes.push_back(VesselNode<2>::Create(100.0, 0.0));
+        nodes.push_back(VesselNode<2>::Create(200.0, 100.0));
+        nodes.push_back(VesselNode<2>::Create(200.0, -100.0));
+        nodes.push_back(VesselNode<2>::Create(300.0, 0.0));
+        nodes.push_back(VesselNode<2>::Create(400.0, 0.0));
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->GetFlowProperties()->SetPressure(3000.0*unit::pascals);
+        nodes[5]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[5]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+
+        unsigned connections[7][2] = {{0,1}, {1,2}, {1,3}, {2,3}, {2,4}, {3,4}, {4,5}};
+        double radii[7] = {12.0, 9.0, 5.0, 4.0, 6.0, 10.0, 12.0};
+        std::vector<boost::shared_ptr<Vessel<2> > > vessels;
+        for(unsigned idx=0; idx<7; idx++)
+        {
+            boost::shared_ptr<VesselSegment<2> > p_segment = VesselSegment<2>::Create(nodes[connections[idx][0]], nodes[connections[idx][1]]);
+            p_segment->SetRadius(radii[idx]*1.e-6*unit::metres);
+            p_segment->GetFlowProperties()->SetHaematocrit(0.45);
+            vessels.push_back(Vessel<2>::Create(p_segment));
+        }
+        boost::shared_ptr<VesselNetwork<2> > p_network = VesselNetwork<2>::Create();
+        p_network->AddVessels(vessels);
+        return p_network;
+    }
+
+public:
+
+    void TestAcceleratedIterationMatchesPicard() throw(Exception)
+    {
+        // Plain Picard iteration
+        boost::shared_ptr<VesselNetwork<2> > p_network = GetBridgeNetwork();
+        boost::shared_ptr<CoupledFlowHaematocritSolver<2> > p_solver = CoupledFlowHaematocritSolver<2>::Create();
+        p_solver->SetVesselNetwork(p_network);
+        p_solver->SetAccelerationDepth(0);
+        p_solver->SetTolerance(1.e-10);
+        p_solver->Solve();
+        unsigned picard_iterations = p_solver->GetNumberOfIterations();
+        TS_ASSERT(picard_iterations > 1u);
+        TS_ASSERT(p_solver->rGetResiduals().back() <= 1.e-10);
+        std::vector<double> haematocrits;
+        std::vector<double> flow_rates;
+        std::vector<boost::shared_ptr<VesselSegment<2> > > segments = p_network->GetVesselSegments();
+        for(unsigned idx=0; idx<segments.size(); idx++)
+        {
+            haematocrits.push_back(segments[idx]->GetFlowProperties()->GetHaematocrit());
+            flow_rates.push_back(segments[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second);
+            segments[idx]->GetFlowProperties()->SetHaematocrit(0.45);
+        }
+
+        // Anderson acceleration reaches the same solution in far fewer iterations
+        p_solver->SetAccelerationDepth(5);
+        p_solver->Solve();
+        TS_ASSERT(p_solver->GetNumberOfIterations() < picard_iterations/2);
+        TS_ASSERT_EQUALS(p_solver->rGetResiduals().size(), p_solver->GetNumberOfIterations());
+        for(unsigned idx=0; idx<segments.size(); idx++)
+        {
+            TS_ASSERT_DELTA(segments[idx]->GetFlowProperties()->GetHaematocrit(), haematocrits[idx], 1.e-8);
+            TS_ASSERT_DELTA(segments[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second,
+                    flow_rates[idx], 1.e-8*std::fabs(flow_rates[idx]));
+        }
+
+    }
+
+    void TestNonConvergence() throw(Exception)
+    {
+        boost::shared_ptr<CoupledFlowHaematocritSolver<2> > p_solver = CoupledFlowHaematocritSolver<2>::Create();
+        TS_ASSERT_THROWS_THIS(p_solver->Solve(), "A vessel network is required before calling Solve");
+
+        p_solver->SetVesselNetwork(GetBridgeNetwork());
+        p_solver->SetHaematocritSolver(boost::shared_ptr<BetteridgeHaematocritSolver<2> >(new BetteridgeHaematocritSolver<2>()));
+        p_solver->SetAccelerationDepth(0);
+        p_solver->SetTolerance(1.e-14);
+        p_solver->SetMaxIterations(2);
+        TS_ASSERT_THROWS_THIS(p_solver->Solve(), "Coupled flow and haematocrit calculation failed to converge.");
+    }
+};
+
+#endif // TESTCOUPLEDFLOWHAEMATOCRITSOLVER_HPP
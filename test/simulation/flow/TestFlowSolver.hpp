@@ -352,6 +352,650 @@ public:
 
     }
 
+    void TestFlowThroughParallelVessels() throw (Exception)
+    {
+        // Two vessels joining the same pair of nodes share an entry in the system matrix
+        std::vector<NodePtr3> nodes;
+        nodes.push_back(VesselNode<3>::Create(0.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(1.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(2.0, 1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(2.0, -1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(3.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(4.0, 0.0, 0.0));
+
+        std::vector<VesselPtr3> vessels;
+        vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[0], nodes[1])));
+        std::vector<NodePtr3> upper_nodes;
+        upper_nodes.push_back(nodes[1]);
+        upper_nodes.push_back(nodes[2]);
+        upper_nodes.push_back(nodes[4]);
+        vessels.push_back(Vessel<3>::Create(upper_nodes));
+        std::vector<NodePtr3> lower_nodes;
+        lower_nodes.push_back(nodes[1]);
+        lower_nodes.push_back(nodes[3]);
+        lower_nodes.push_back(nodes[4]);
+        vessels.push_back(Vessel<3>::Create(lower_nodes));
+        vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[4], nodes[5])));
+
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessels(vessels);
+        std::vector<SegmentPtr3> segments = p_network->GetVesselSegments();
+        for(unsigned idx=0; idx<segments.size(); idx++)
+        {
+            segments[idx]->GetFlowProperties()->SetImpedance(1.e14*unit::pascal_second_per_metre_cubed);
+        }
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->GetFlowProperties()->SetPressure(3000.0*unit::pascals);
+        nodes[5]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[5]->GetFlowProperties()->SetPressure(0.0*unit::pascals);
+
+        FlowSolver<3> solver;
+        solver.SetVesselNetwork(p_network);
+        solver.SetUp();
+        solver.Solve();
+
+        TS_ASSERT_DELTA(nodes[1]->GetFlowProperties()->GetPressure()/unit::pascals, 2000.0, 1.e-6);
+        TS_ASSERT_DELTA(nodes[4]->GetFlowProperties()->GetPressure()/unit::pascals, 1000.0, 1.e-6);
+        TS_ASSERT_DELTA(nodes[2]->GetFlowProperties()->GetPressure()/unit::pascals, 1500.0, 1.e-6);
+        TS_ASSERT_DELTA(vessels[1]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, 5.e-12, 1.e-18);
+        TS_ASSERT_DELTA(vessels[2]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, 5.e-12, 1.e-18);
+    }
+
+    void TestFlowThroughDisconnectedComponents() throw (Exception)
+    {
+        // Two separate chains with their own boundary conditions and an isolated vessel without any
+        std::vector<NodePtr3> nodes;
+        for(unsigned idx=0; idx<8; idx++)
+        {
+            nodes.push_back(VesselNode<3>::Create(double(idx), 0.0, 0.0));
+        }
+        std::vector<VesselPtr3> vessels;
+        vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[0], nodes[1])));
+        vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[1], nodes[2])));
+        vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[3], nodes[4])));
+        vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[4], nodes[5])));
+        vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[6], nodes[7])));
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessels(vessels);
+        std::vector<SegmentPtr3> segments = p_network->GetVesselSegments();
+        for(unsigned idx=0; idx<segments.size(); idx++)
+        {
+            segments[idx]->GetFlowProperties()->SetImpedance(1.e14*unit::pascal_second_per_metre_cubed);
+        }
+
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->GetFlowProperties()->SetPressure(3000.0*unit::pascals);
+        nodes[2]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[2]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+        nodes[3]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[3]->GetFlowProperties()->SetPressure(500.0*unit::pascals);
+        nodes[5]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[5]->GetFlowProperties()->SetPressure(100.0*unit::pascals);
+        nodes[6]->GetFlowProperties()->SetPressure(50.0*unit::pascals);
+
+        FlowSolver<3> solver;
+        solver.SetVesselNetwork(p_network);
+        solver.SetUp();
+        solver.Solve();
+
+        TS_ASSERT_DELTA(nodes[1]->GetFlowProperties()->GetPressure()/unit::pascals, 2000.0, 1.e-6);
+        TS_ASSERT_DELTA(nodes[4]->GetFlowProperties()->GetPressure()/unit::pascals, 300.0, 1.e-6);
+        TS_ASSERT_DELTA(vessels[3]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, 2.e-12, 1.e-18);
+
+        // The isolated vessel has no pressure difference and no flow
+        TS_ASSERT_DELTA(nodes[6]->GetFlowProperties()->GetPressure()/unit::pascals, 0.0, 1.e-6);
+        TS_ASSERT_DELTA(nodes[7]->GetFlowProperties()->GetPressure()/unit::pascals, 0.0, 1.e-6);
+        TS_ASSERT_DELTA(vessels[4]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, 0.0, 1.e-18);
+    }
+
+    void TestEliminateTreesAndChains() throw (Exception)
+    {
+        // A bridge between two chains, with a dead end tree hanging off it
+        std::vector<NodePtr3> nodes;
+        nodes.push_back(VesselNode<3>::Create(0.0, 0.0, 0.0)); // inlet
+        nodes.push_back(VesselNode<3>::Create(1.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(2.0, 0.0, 0.0)); // bridge
+        nodes.push_back(VesselNode<3>::Create(3.0, 1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(3.0, -1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(4.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(5.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(6.0, 0.0, 0.0)); // outlet
+        nodes.push_back(VesselNode<3>::Create(3.0, 2.0, 0.0)); // dead end tree
+        nodes.push_back(VesselNode<3>::Create(3.0, 3.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(4.0, 2.0, 0.0));
+
+        unsigned connections[11][2] = {{0,1}, {1,2}, {2,3}, {2,4}, {3,4}, {3,5}, {4,5}, {5,6}, {6,7}, {3,8}, {8,9}};
+        std::vector<VesselPtr3> vessels;
+        for(unsigned idx=0; idx<11; idx++)
+        {
+            SegmentPtr3 p_segment = VesselSegment<3>::Create(nodes[connections[idx][0]], nodes[connections[idx][1]]);
+            p_segment->GetFlowProperties()->SetImpedance(double(idx%4 + 1)*1.e14*unit::pascal_second_per_metre_cubed);
+            vessels.push_back(Vessel<3>::Create(p_segment));
+        }
+        vessels.push_back(Vessel<3>::Create(VesselSegment<3>::Create(nodes[8], nodes[10])));
+        vessels[11]->GetSegments()[0]->GetFlowProperties()->SetImpedance(1.e14*unit::pascal_second_per_metre_cubed);
+
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessels(vessels);
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->GetFlowProperties()->SetPressure(3000.0*unit::pascals);
+        nodes[7]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[7]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+
+        // Solve the full system first
+        FlowSolver<3> solver;
+        solver.SetVesselNetwork(p_network);
+        solver.SetEliminateTreesAndChains(false);
+        solver.SetUp();
+        TS_ASSERT_EQUALS(solver.GetNumberOfSystemNodes(), 11u);
+        solver.Solve();
+        std::vector<double> pressures;
+        for(unsigned idx=0; idx<nodes.size(); idx++)
+        {
+            pressures.push_back(nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals);
+        }
+        std::vector<double> flow_rates;
+        for(unsigned idx=0; idx<vessels.size(); idx++)
+        {
+            flow_rates.push_back(vessels[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second);
+        }
+
+        // Only the bridge and the boundary nodes are left after elimination
+        solver.SetEliminateTreesAndChains(true);
+        solver.SetUp();
+        TS_ASSERT_EQUALS(solver.GetNumberOfSystemNodes(), 6u);
+        solver.Solve();
+        for(unsigned idx=0; idx<nodes.size(); idx++)
+        {
+            TS_ASSERT_DELTA(nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals, pressures[idx], 1.e-6);
+        }
+        for(unsigned idx=0; idx<vessels.size(); idx++)
+        {
+            TS_ASSERT_DELTA(vessels[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, flow_rates[idx], 1.e-18);
+        }
+        TS_ASSERT_DELTA(nodes[9]->GetFlowProperties()->GetPressure()/unit::pascals, pressures[3], 1.e-6);
+        TS_ASSERT_DELTA(flow_rates[0], flow_rates[8], 1.e-18);
+        TS_ASSERT(flow_rates[0] > 0.0);
+
+        // The iterative solver, started from the previous pressures, gives the same result
+        vessels[4]->GetSegments()[0]->GetFlowProperties()->SetImpedance(0.5e14*unit::pascal_second_per_metre_cubed);
+        solver.Update();
+        solver.Solve();
+        for(unsigned idx=0; idx<nodes.size(); idx++)
+        {
+            pressures[idx] = nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals;
+        }
+        FlowSolver<3> iterative_solver;
+        iterative_solver.SetVesselNetwork(p_network);
+        iterative_solver.SetUseDirectSolver(false);
+        iterative_solver.SetUp();
+        iterative_solver.Solve();
+        for(unsigned idx=0; idx<nodes.size(); idx++)
+        {
+            TS_ASSERT_DELTA(nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals, pressures[idx], 1.e-6);
+        }
+    }
+
+    void TestLowRankUpdates() throw (Exception)
+    {
+        // A bridge network with a dead end tree, solved without elimination so the direct solver is used
+        std::vector<NodePtr3> nodes;
+        nodes.push_back(VesselNode<3>::Create(0.0, 0.0, 0.0)); // inlet
+        nodes.push_back(VesselNode<3>::Create(1.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(2.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(3.0, 1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(3.0, -1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(4.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(5.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(6.0, 0.0, 0.0)); // outlet
+        nodes.push_back(VesselNode<3>::Create(3.0, 2.0, 0.0));
+
+        unsigned connections[10][2] = {{0,1}, {1,2}, {2,3}, {2,4}, {3,4}, {3,5}, {4,5}, {5,6}, {6,7}, {3,8}};
+        std::vector<VesselPtr3> vessels;
+        for(unsigned idx=0; idx<10; idx++)
+        {
+            SegmentPtr3 p_segment = VesselSegment<3>::Create(nodes[connections[idx][0]], nodes[connections[idx][1]]);
+            p_segment->GetFlowProperties()->SetImpedance(double(idx%4 + 1)*1.e14*unit::pascal_second_per_metre_cubed);
+            vessels.push_back(Vessel<3>::Create(p_segment));
+        }
+
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessels(vessels);
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->GetFlowProperties()->SetPressure(3000.0*unit::pascals);
+        nodes[7]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[7]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+
+        FlowSolver<3> solver;
+        solver.SetVesselNetwork(p_network);
+        solver.SetEliminateTreesAndChains(false);
+        solver.SetMaxLowRankUpdates(2);
+        solver.SetUp();
+        solver.Solve();
+
+        FlowSolver<3> reference_solver;
+        reference_solver.SetVesselNetwork(p_network);
+        reference_solver.SetEliminateTreesAndChains(false);
+
+        // Change one internal vessel and one next to the inlet, which are applied as corrections. Then
+        // change three, which is more than the limit so the matrix is assembled again. Finally nearly occlude
+        // a vessel.
+        std::vector<std::vector<unsigned> > changed_vessels(3);
+        changed_vessels[0].push_back(4);
+        changed_vessels[0].push_back(0);
+        changed_vessels[1].push_back(1);
+        changed_vessels[1].push_back(6);
+        changed_vessels[1].push_back(9);
+        changed_vessels[2].push_back(5);
+        for(unsigned step=0; step<changed_vessels.size(); step++)
+        {
+            for(unsigned idx=0; idx<changed_vessels[step].size(); idx++)
+            {
+                double factor = (step == 2) ? 1.e6 : 0.5 + double(idx);
+                SegmentPtr3 p_segment = vessels[changed_vessels[step][idx]]->GetSegments()[0];
+                p_segment->GetFlowProperties()->SetImpedance(factor * p_segment->GetFlowProperties()->GetImpedance());
+            }
+
+            reference_solver.Update();
+            reference_solver.Solve();
+            std::vector<double> pressures;
+            for(unsigned idx=0; idx<nodes.size(); idx++)
+            {
+                pressures.push_back(nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals);
+            }
+            std::vector<double> flow_rates;
+            for(unsigned idx=0; idx<vessels.size(); idx++)
+            {
+                flow_rates.push_back(vessels[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second);
+            }
+
+            solver.Update();
+            solver.Solve();
+            for(unsigned idx=0; idx<nodes.size(); idx++)
+            {
+                TS_ASSERT_DELTA(nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals, pressures[idx], 1.e-6);
+            }
+            for(unsigned idx=0; idx<vessels.size(); idx++)
+            {
+                TS_ASSERT_DELTA(vessels[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, flow_rates[idx], 1.e-18);
+            }
+        }
+        TS_ASSERT(nodes[3]->GetFlowProperties()->GetPressure() > nodes[5]->GetFlowProperties()->GetPressure());
+    }
+
+    void TestLowRankTopologyChanges() throw (Exception)
+    {
+        // The bridge network with a dead end tree, solved without elimination so that new nodes add rows
+        std::vector<NodePtr3> nodes;
+        nodes.push_back(VesselNode<3>::Create(0.0, 0.0, 0.0)); // inlet
+        nodes.push_back(VesselNode<3>::Create(1.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(2.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(3.0, 1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(3.0, -1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(4.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(5.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(6.0, 0.0, 0.0)); // outlet
+        nodes.push_back(VesselNode<3>::Create(3.0, 2.0, 0.0));
+
+        unsigned connections[10][2] = {{0,1}, {1,2}, {2,3}, {2,4}, {3,4}, {3,5}, {4,5}, {5,6}, {6,7}, {3,8}};
+        std::vector<VesselPtr3> vessels;
+        for(unsigned idx=0; idx<10; idx++)
+        {
+            SegmentPtr3 p_segment = VesselSegment<3>::Create(nodes[connections[idx][0]], nodes[connections[idx][1]]);
+            p_segment->GetFlowProperties()->SetImpedance(double(idx%4 + 1)*1.e14*unit::pascal_second_per_metre_cubed);
+            vessels.push_back(Vessel<3>::Create(p_segment));
+        }
+
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessels(vessels);
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->GetFlowProperties()->SetPressure(3000.0*unit::pascals);
+        nodes[7]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[7]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+
+        FlowSolver<3> solver;
+        solver.SetVesselNetwork(p_network);
+        solver.SetEliminateTreesAndChains(false);
+        solver.SetMaxLowRankUpdates(12);
+        solver.SetUp();
+        solver.Solve();
+
+        FlowSolver<3> reference_solver;
+        reference_solver.SetVesselNetwork(p_network);
+        reference_solver.SetEliminateTreesAndChains(false);
+
+        // An anastamosis between two divided vessels borders two new rows onto the factorised matrix. The
+        // dead end then regresses, which decouples its row. Finally two more vessels regress, which is more
+        // changes than the limit so the matrix is assembled again.
+        for(unsigned step=0; step<3; step++)
+        {
+            if(step == 0)
+            {
+                NodePtr3 p_node1 = p_network->DivideVessel(vessels[5], DimensionalChastePoint<3>(3.5, 0.5, 0.0));
+                NodePtr3 p_node2 = p_network->DivideVessel(vessels[3], DimensionalChastePoint<3>(2.5, -0.5, 0.0));
+                SegmentPtr3 p_segment = VesselSegment<3>::Create(p_node1, p_node2);
+                p_segment->GetFlowProperties()->SetImpedance(2.e14*unit::pascal_second_per_metre_cubed);
+                p_network->AddVessel(Vessel<3>::Create(p_segment));
+            }
+            else if(step == 1)
+            {
+                p_network->RemoveVessel(vessels[9], true);
+            }
+            else
+            {
+                p_network->RemoveVessel(vessels[4], true);
+                p_network->RemoveVessel(vessels[6], true);
+            }
+
+            reference_solver.Update();
+            reference_solver.Solve();
+            std::vector<NodePtr3> network_nodes = p_network->GetNodes();
+            std::vector<VesselPtr3> network_vessels = p_network->GetVessels();
+            std::vector<double> pressures;
+            for(unsigned idx=0; idx<network_nodes.size(); idx++)
+            {
+                pressures.push_back(network_nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals);
+            }
+            std::vector<double> flow_rates;
+            for(unsigned idx=0; idx<network_vessels.size(); idx++)
+            {
+                flow_rates.push_back(network_vessels[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second);
+            }
+
+            solver.Update();
+            solver.Solve();
+            for(unsigned idx=0; idx<network_nodes.size(); idx++)
+            {
+                TS_ASSERT_DELTA(network_nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals, pressures[idx], 1.e-6);
+            }
+            for(unsigned idx=0; idx<network_vessels.size(); idx++)
+            {
+                TS_ASSERT_DELTA(network_vessels[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, flow_rates[idx], 1.e-18);
+            }
+        }
+    }
+
+    void TestLowRankTopologyChangesWithElimination() throw (Exception)
+    {
+        // The bridge network with a dead end tree, which is eliminated from the system. The tree comes first so
+        // that its nodes are numbered first when it is detached.
+        std::vector<NodePtr3> nodes;
+        nodes.push_back(VesselNode<3>::Create(0.0, 0.0, 0.0)); // inlet
+        nodes.push_back(VesselNode<3>::Create(1.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(2.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(3.0, 1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(3.0, -1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(4.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(5.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(6.0, 0.0, 0.0)); // outlet
+        nodes.push_back(VesselNode<3>::Create(3.0, 2.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(2.0, 3.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(4.0, 3.0, 0.0));
+
+        unsigned connections[12][2] = {{3,8}, {8,9}, {8,10}, {0,1}, {1,2}, {2,3}, {2,4}, {3,4}, {3,5}, {4,5}, {5,6}, {6,7}};
+        std::vector<VesselPtr3> vessels;
+        for(unsigned idx=0; idx<12; idx++)
+        {
+            SegmentPtr3 p_segment = VesselSegment<3>::Create(nodes[connections[idx][0]], nodes[connections[idx][1]]);
+            p_segment->GetFlowProperties()->SetImpedance(double(idx%4 + 1)*1.e14*unit::pascal_second_per_metre_cubed);
+            vessels.push_back(Vessel<3>::Create(p_segment));
+        }
+
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessels(vessels);
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->GetFlowProperties()->SetPressure(3000.0*unit::pascals);
+        nodes[7]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[7]->GetFlowProperties()->SetPressure(1500.0*unit::pascals);
+
+        FlowSolver<3> solver;
+        solver.SetVesselNetwork(p_network);
+        solver.SetMaxLowRankUpdates(4);
+        solver.SetUp();
+        solver.Solve();
+
+        FlowSolver<3> reference_solver;
+        reference_solver.SetVesselNetwork(p_network);
+
+        // Detaching the tree renumbers the rows without changing any conductance in the factorised matrix, then
+        // a vessel regresses
+        for(unsigned step=0; step<2; step++)
+        {
+            p_network->RemoveVessel(vessels[(step == 0) ? 0 : 7], true);
+
+            reference_solver.Update();
+            reference_solver.Solve();
+            std::vector<NodePtr3> network_nodes = p_network->GetNodes();
+            std::vector<VesselPtr3> network_vessels = p_network->GetVessels();
+            std::vector<double> pressures;
+            for(unsigned idx=0; idx<network_nodes.size(); idx++)
+            {
+                pressures.push_back(network_nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals);
+            }
+            std::vector<double> flow_rates;
+            for(unsigned idx=0; idx<network_vessels.size(); idx++)
+            {
+                flow_rates.push_back(network_vessels[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second);
+            }
+
+            solver.Update();
+            solver.Solve();
+            for(unsigned idx=0; idx<network_nodes.size(); idx++)
+            {
+                TS_ASSERT_DELTA(network_nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals, pressures[idx], 1.e-6);
+            }
+            for(unsigned idx=0; idx<network_vessels.size(); idx++)
+            {
+                TS_ASSERT_DELTA(network_vessels[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, flow_rates[idx], 1.e-18);
+            }
+            TS_ASSERT_DELTA(nodes[7]->GetFlowProperties()->GetPressure()/unit::pascals, 1500.0, 1.e-6);
+        }
+    }
+
+    void TestSolveForBoundaryPressures() throw (Exception)
+    {
+        // A bridge network with two inlets and an outlet
+        std::vector<NodePtr3> nodes;
+        nodes.push_back(VesselNode<3>::Create(0.0, 0.0, 0.0)); // inlet
+        nodes.push_back(VesselNode<3>::Create(1.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(2.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(3.0, 1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(3.0, -1.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(4.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(5.0, 0.0, 0.0));
+        nodes.push_back(VesselNode<3>::Create(6.0, 0.0, 0.0)); // outlet
+        nodes.push_back(VesselNode<3>::Create(3.0, -2.0, 0.0)); // inlet
+
+        unsigned connections[10][2] = {{0,1}, {1,2}, {2,3}, {2,4}, {3,4}, {3,5}, {4,5}, {5,6}, {6,7}, {8,4}};
+        std::vector<VesselPtr3> vessels;
+        for(unsigned idx=0; idx<10; idx++)
+        {
+            SegmentPtr3 p_segment = VesselSegment<3>::Create(nodes[connections[idx][0]], nodes[connections[idx][1]]);
+            p_segment->GetFlowProperties()->SetImpedance(double(idx%4 + 1)*1.e14*unit::pascal_second_per_metre_cubed);
+            vessels.push_back(Vessel<3>::Create(p_segment));
+        }
+
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessels(vessels);
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->GetFlowProperties()->SetPressure(3000.0*unit::pascals);
+        nodes[8]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[8]->GetFlowProperties()->SetPressure(2000.0*unit::pascals);
+        nodes[7]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[7]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+
+        FlowSolver<3> solver;
+        solver.SetVesselNetwork(p_network);
+        solver.SetEliminateTreesAndChains(false);
+        std::vector<NodePtr3> boundary_nodes = solver.GetBoundaryConditionNodes();
+        TS_ASSERT_EQUALS(boundary_nodes.size(), 3u);
+
+        std::vector<std::vector<double> > boundary_pressures(3, std::vector<double>(3, 1000.0));
+        for(unsigned idx=0; idx<3; idx++)
+        {
+            if(boundary_nodes[idx] == nodes[0])
+            {
+                boundary_pressures[0][idx] = 3000.0;
+                boundary_pressures[1][idx] = 4000.0;
+            }
+            else if(boundary_nodes[idx] == nodes[8])
+            {
+                boundary_pressures[0][idx] = 2000.0;
+                boundary_pressures[2][idx] = 5000.0;
+            }
+        }
+        std::vector<std::vector<double> > pressures;
+        std::vector<std::vector<double> > flow_rates;
+        solver.SolveForBoundaryPressures(boundary_pressures, pressures, flow_rates);
+        TS_ASSERT_EQUALS(pressures.size(), 3u);
+        TS_ASSERT_EQUALS(flow_rates.size(), 3u);
+
+        // Each scenario matches a solve with the same boundary conditions set on the network
+        std::vector<NodePtr3> network_nodes = p_network->GetVesselEndNodes();
+        std::vector<VesselPtr3> network_vessels = p_network->GetVessels();
+        FlowSolver<3> reference_solver;
+        reference_solver.SetVesselNetwork(p_network);
+        for(unsigned scenario=0; scenario<3; scenario++)
+        {
+            for(unsigned idx=0; idx<3; idx++)
+            {
+                boundary_nodes[idx]->GetFlowProperties()->SetPressure(boundary_pressures[scenario][idx]*unit::pascals);
+            }
+            reference_solver.Update();
+            reference_solver.Solve();
+            for(unsigned idx=0; idx<network_nodes.size(); idx++)
+            {
+                TS_ASSERT_DELTA(network_nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals, pressures[scenario][idx], 1.e-6);
+            }
+            for(unsigned idx=0; idx<network_vessels.size(); idx++)
+            {
+                TS_ASSERT_DELTA(network_vessels[idx]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second,
+                        flow_rates[scenario][idx], 1.e-18);
+            }
+        }
+
+        // Flow goes back out of the first inlet in the last scenario
+        TS_ASSERT(flow_rates[0][p_network->GetVesselIndex(vessels[0])] > 0.0);
+        TS_ASSERT(flow_rates[2][p_network->GetVesselIndex(vessels[0])] < 0.0);
+
+        // The solver's own boundary conditions are still used by Solve
+        solver.Update();
+        solver.Solve();
+        for(unsigned idx=0; idx<network_nodes.size(); idx++)
+        {
+            TS_ASSERT_DELTA(network_nodes[idx]->GetFlowProperties()->GetPressure()/unit::pascals, pressures[2][idx], 1.e-6);
+        }
+    }
+
+    void TestUpdatesWithoutTopologyChangeKeepSetUp() throw (Exception)
+    {
+        // A chain of single segment vessels with fixed impedances, long enough to use the direct solver
+        std::vector<NodePtr3> nodes;
+        for(unsigned idx=0; idx<7; idx++)
+        {
+            nodes.push_back(VesselNode<3>::Create(double(idx), 0.0, 0.0));
+        }
+        std::vector<VesselPtr3> vessels;
+        for(unsigned idx=0; idx<6; idx++)
+        {
+            SegmentPtr3 p_segment = VesselSegment<3>::Create(nodes[idx], nodes[idx+1]);
+            p_segment->GetFlowProperties()->SetImpedance(1.e14*unit::pascal_second_per_metre_cubed);
+            vessels.push_back(Vessel<3>::Create(p_segment));
+        }
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessels(vessels);
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->GetFlowProperties()->SetPressure(3400.0*unit::pascals);
+        nodes[6]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[6]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+
+        FlowSolver<3> solver;
+        solver.SetVesselNetwork(p_network);
+        solver.SetUp();
+        solver.Solve();
+        TS_ASSERT_DELTA(nodes[3]->GetFlowProperties()->GetPressure()/unit::pascals, 2200.0, 1.e-6);
+
+        // New boundary conditions are only read on set up, so they show whether one has been done. Moving a node,
+        // updating the network and committing an empty batch leave the topology alone and do not cause one.
+        nodes[3]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[3]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+        nodes[5]->SetLocation(DimensionalChastePoint<3>(5.0, 1.0, 0.0));
+        p_network->UpdateAll();
+        p_network->BeginBatch();
+        p_network->CommitBatch();
+        solver.Update();
+        solver.Solve();
+        TS_ASSERT_DELTA(nodes[3]->GetFlowProperties()->GetPressure()/unit::pascals, 2200.0, 1.e-6);
+
+        // A structural change does cause a set up. The solve wrote the pressure back to the node, so set it again.
+        nodes[3]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+        p_network->BeginBatch();
+        p_network->DivideVessel(vessels[0], DimensionalChastePoint<3>(0.5, 0.0, 0.0));
+        p_network->CommitBatch();
+        solver.Update();
+        solver.Solve();
+        TS_ASSERT_DELTA(nodes[3]->GetFlowProperties()->GetPressure()/unit::pascals, 1000.0, 1.e-6);
+        // Both halves of the divided vessel keep the full segment impedance
+        TS_ASSERT_DELTA(nodes[1]->GetFlowProperties()->GetPressure()/unit::pascals, 2200.0, 1.e-6);
+    }
+
+    void TestRepeatedUpdatesReuseSystem() throw (Exception)
+    {
+        // A chain of single segment vessels, long enough to use the direct solver
+        std::vector<NodePtr3> nodes;
+        for(unsigned idx=0; idx<7; idx++)
+        {
+            nodes.push_back(VesselNode<3>::Create(double(idx), 0.0, 0.0));
+        }
+        std::vector<SegmentPtr3> segments;
+        std::vector<VesselPtr3> vessels;
+        for(unsigned idx=0; idx<6; idx++)
+        {
+            segments.push_back(VesselSegment<3>::Create(nodes[idx], nodes[idx+1]));
+            segments[idx]->GetFlowProperties()->SetImpedance(1.e14*unit::pascal_second_per_metre_cubed);
+            vessels.push_back(Vessel<3>::Create(segments[idx]));
+        }
+        boost::shared_ptr<VesselNetwork<3> > p_network = VesselNetwork<3>::Create();
+        p_network->AddVessels(vessels);
+
+        nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+        nodes[0]->GetFlowProperties()->SetPressure(3400.0*unit::pascals);
+        nodes[6]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[6]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+
+        FlowSolver<3> solver;
+        solver.SetVesselNetwork(p_network);
+        solver.SetUp();
+        solver.Solve();
+        TS_ASSERT_DELTA(nodes[3]->GetFlowProperties()->GetPressure()/unit::pascals, 2200.0, 1.e-6);
+
+        // New impedances and boundary pressures only need an update of the values
+        segments[0]->GetFlowProperties()->SetImpedance(7.e14*unit::pascal_second_per_metre_cubed);
+        nodes[6]->GetFlowProperties()->SetPressure(1600.0*unit::pascals);
+        solver.Update();
+        solver.Solve();
+        TS_ASSERT_DELTA(nodes[1]->GetFlowProperties()->GetPressure()/unit::pascals, 2350.0, 1.e-6);
+        TS_ASSERT_DELTA(nodes[3]->GetFlowProperties()->GetPressure()/unit::pascals, 2050.0, 1.e-6);
+        TS_ASSERT_DELTA(vessels[5]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, 1.5e-12, 1.e-18);
+
+        // A new boundary node changes the row structure but not the sparsity pattern
+        nodes[4]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[4]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+        solver.SetUp();
+        solver.Solve();
+        TS_ASSERT_DELTA(nodes[4]->GetFlowProperties()->GetPressure()/unit::pascals, 1000.0, 1.e-6);
+        TS_ASSERT_DELTA(nodes[1]->GetFlowProperties()->GetPressure()/unit::pascals, 1720.0, 1.e-6);
+        TS_ASSERT_DELTA(nodes[5]->GetFlowProperties()->GetPressure()/unit::pascals, 1300.0, 1.e-6);
+
+        // A topology change rebuilds the system
+        p_network->RemoveVessel(vessels[5], true);
+        nodes[5]->GetFlowProperties()->SetIsOutputNode(true);
+        nodes[5]->GetFlowProperties()->SetPressure(1600.0*unit::pascals);
+        solver.Update();
+        solver.Solve();
+        TS_ASSERT_DELTA(vessels[4]->GetFlowProperties()->GetFlowRate()/unit::metre_cubed_per_second, -6.e-12, 1.e-18);
+    }
+
     void TestFlowThroughBifurcationHavingSwappedNodeLabels() throw (Exception)
     {
         std::vector<NodePtr3> nodes;
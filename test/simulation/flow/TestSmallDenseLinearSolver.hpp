@@ -0,0 +1,90 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef TESTSMALLDENSELINEARSOLVER_HPP
+#define TESTSMALLDENSELINEARSOLVER_HPP
+
+#include <cxxtest/TestSuite.h>
+#include <vector>
+#include "SmallDenseLinearSolver.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestSmallDenseLinearSolver : public CxxTest::TestSuite
+{
+
+public:
+
+    void TestSolve() throw(Exception)
+    {
+        // A system needing a row swap, with solution (1, 2, 3)
+        double entries[3][4] = {{0.0, 2.0, 1.0, 7.0}, {1.0, 1.0, 1.0, 6.0}, {2.0, 0.0, 3.0, 11.0}};
+        std::vector<std::vector<double> > matrix(3, std::vector<double>(4));
+        for(unsigned row=0; row<3; row++)
+        {
+            matrix[row].assign(entries[row], entries[row] + 4);
+        }
+        std::vector<double> solution;
+        TS_ASSERT(SmallDenseLinearSolver::Solve(matrix, solution));
+        TS_ASSERT_EQUALS(solution.size(), 3u);
+        TS_ASSERT_DELTA(solution[0], 1.0, 1.e-12);
+        TS_ASSERT_DELTA(solution[1], 2.0, 1.e-12);
+        TS_ASSERT_DELTA(solution[2], 3.0, 1.e-12);
+    }
+
+    void TestPivotToleranceIsRelative() throw(Exception)
+    {
+        // Entries of the size of vessel conductances in SI units are solved, not rejected as small pivots
+        double scale = 1.e-16;
+        std::vector<std::vector<double> > matrix(2, std::vector<double>(3));
+        matrix[0][0] = 2.0*scale;
+        matrix[0][1] = -1.0*scale;
+        matrix[0][2] = 0.0;
+        matrix[1][0] = -1.0*scale;
+        matrix[1][1] = 2.0*scale;
+        matrix[1][2] = 3.0*scale;
+        std::vector<double> solution;
+        TS_ASSERT(SmallDenseLinearSolver::Solve(matrix, solution));
+        TS_ASSERT_DELTA(solution[0], 1.0, 1.e-12);
+        TS_ASSERT_DELTA(solution[1], 2.0, 1.e-12);
+
+        // Nearly dependent rows are rejected whatever the scale of the entries
+        matrix.assign(2, std::vector<double>(3, 1.e6));
+        matrix[1][1] = 1.e6*(1.0 + 1.e-14);
+        TS_ASSERT(!SmallDenseLinearSolver::Solve(matrix, solution));
+    }
+};
+
+#endif // TESTSMALLDENSELINEARSOLVER_HPP
@@ -0,0 +1,197 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+ All rights reserved.
+
+ University of Oxford means the Chancellor, Masters and Scholars of the
+ University of Oxford, having an administrative office at Wellington
+ Square, Oxford OX1 2JD, UK.
+
+ This file is part of Chaste.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+ contributors may be used to endorse or promote products derived from this
+ software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#ifndef TESTTOPOLOGICALHAEMATOCRITSOLVER_HPP
+#define TESTTOPOLOGICALHAEMATOCRITSOLVER_HPP
+
+#include <cxxtest/TestSuite.h>
+#include "SmartPointers.hpp"
+#include "FlowSolver.hpp"
+#include "BetteridgeHaematocritSolver.hpp"
+#include "TopologicalHaematocritSolver.hpp"
+#include "FakePetscSetup.hpp"
+#include "UnitCollection.hpp"
+
+class TestTopologicalHaematocritSolver : public CxxTest::TestSuite
+{
+
+public:
+
+void TestBifurcationOutflowNetworkBiasedFlow() throw(Exception)
+{
+    boost::shared_ptr<VesselNode<2> > p_node1 = VesselNode<2>::Create(0.0, 0.0);
+    boost::shared_ptr<VesselNode<2> > p_node2 = VesselNode<2>::Create(80.0, 0.0);
+    boost::shared_ptr<VesselNode<2> > p_node3 = VesselNode<2>::Create(160.0, 0.0);
+    boost::shared_ptr<VesselNode<2> > p_node4 = VesselNode<2>::Create(200.0, 0.0);
+    p_node4->GetFlowProperties()->SetIsInputNode(true);
+
+    boost::shared_ptr<Vessel<2> > p_vessel1(Vessel<2>::Create(p_node1, p_node3));
+    boost::shared_ptr<Vessel<2> > p_vessel2(Vessel<2>::Create(p_node2, p_node3));
+    boost::shared_ptr<Vessel<2> > p_vessel3(Vessel<2>::Create(p_node3, p_node4));
+
+    double parent_flow_rate = 2.0;
+    double competitor_flow_rate = 3.0;
+    double my_flow_rate = 1.0;
+    p_vessel1->GetSegments()[0]->GetFlowProperties()->SetFlowRate(-my_flow_rate * unit::metre_cubed_per_second);
+    p_vessel2->GetSegments()[0]->GetFlowProperties()->SetFlowRate(-competitor_flow_rate * unit::metre_cubed_per_second);
+    p_vessel3->GetSegments()[0]->GetFlowProperties()->SetFlowRate(-parent_flow_rate * unit::metre_cubed_per_second);
+
+    boost::shared_ptr<VesselNetwork<2> > p_network = VesselNetwork<2>::Create();
+    p_network->AddVessel(p_vessel1);
+    p_network->AddVessel(p_vessel2);
+    p_network->AddVessel(p_vessel3);
+
+    boost::shared_ptr<TopologicalHaematocritSolver<2> > p_haematocrit_calculator = TopologicalHaematocritSolver<2>::Create();
+    p_haematocrit_calculator->SetVesselNetwork(p_network);
+    p_haematocrit_calculator->Calculate();
+    TS_ASSERT(!p_haematocrit_calculator->UsedLinearSystem());
+
+    // The sweep is exact, rather than converged to a tolerance
+    double parent_haematocrit = 0.45;
+    double haematocrit_ratio = 1.0 + (1.0 - parent_haematocrit)*(competitor_flow_rate/my_flow_rate - 1.0);
+    double competitor_haematocrit = (parent_flow_rate * parent_haematocrit)/ ((1.0/haematocrit_ratio)*my_flow_rate + competitor_flow_rate);
+    double my_haematocrit = competitor_haematocrit * (1.0/haematocrit_ratio);
+    TS_ASSERT_DELTA(double(p_vessel1->GetSegments()[0]->GetFlowProperties()->GetHaematocrit()), my_haematocrit, 1e-6);
+    TS_ASSERT_DELTA(double(p_vessel2->GetSegments()[0]->GetFlowProperties()->GetHaematocrit()), competitor_haematocrit, 1e-6);
+    TS_ASSERT_DELTA(double(p_vessel3->GetSegments()[0]->GetFlowProperties()->GetHaematocrit()), parent_haematocrit, 1e-6);
+}
+
+void TestNetworkAfterFlowSolve() throw(Exception)
+{
+    // Two bifurcations joined by a bridge, with the flow from a pressure solve
+    std::vector<boost::shared_ptr<VesselNode<2> > > nodes;
+    nodes.push_back(VesselNode<2>::Create(0.0, 0.0));
+    nodes.push_back(VesselNode<2>::Create(100.0, 0.0));
+    nodes.push_back(VesselNode<2>::Create(200.0, 100.0));
+    nodes.push_back(VesselNode<2>::Create(200.0, -100.0));
+    nodes.push_back(VesselNode<2>::Create(300.0, 0.0));
+    nodes.push_back(VesselNode<2>::Create(400.0, 0.0));
+    nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+    nodes[0]->GetFlowProperties()->SetPressure(3000.0*unit::pascals);
+    nodes[5]->GetFlowProperties()->SetIsOutputNode(true);
+    nodes[5]->GetFlowProperties()->SetPressure(1000.0*unit::pascals);
+
+    unsigned connections[7][2] = {{0,1}, {1,2}, {1,3}, {2,3}, {2,4}, {3,4}, {4,5}};
+    double radii[7] = {10.0, 8.0, 6.0, 4.0, 7.0, 9.0, 10.0};
+    std::vector<boost::shared_ptr<Vessel<2> > > vessels;
+    for(unsigned idx=0; idx<7; idx++)
+    {
+        boost::shared_ptr<VesselSegment<2> > p_segment = VesselSegment<2>::Create(nodes[connections[idx][0]], nodes[connections[idx][1]]);
+        p_segment->SetRadius(radii[idx]*1.e-6*unit::metres);
+        p_segment->GetFlowProperties()->SetImpedance(double(idx%3 + 1)*1.e14*unit::pascal_second_per_metre_cubed);
+        vessels.push_back(Vessel<2>::Create(p_segment));
+    }
+    boost::shared_ptr<VesselNetwork<2> > p_network = VesselNetwork<2>::Create();
+    p_network->AddVessels(vessels);
+
+    FlowSolver<2> flow_solver;
+    flow_solver.SetVesselNetwork(p_network);
+    flow_solver.SetUp();
+    flow_solver.Solve();
+
+    boost::shared_ptr<BetteridgeHaematocritSolver<2> > p_linear_calculator(new BetteridgeHaematocritSolver<2>());
+    p_linear_calculator->SetVesselNetwork(p_network);
+    p_linear_calculator->Calculate();
+    std::vector<double> haematocrits;
+    for(unsigned idx=0; idx<vessels.size(); idx++)
+    {
+        haematocrits.push_back(vessels[idx]->GetSegments()[0]->GetFlowProperties()->GetHaematocrit());
+        vessels[idx]->GetSegments()[0]->GetFlowProperties()->SetHaematocrit(0.0);
+    }
+
+    boost::shared_ptr<TopologicalHaematocritSolver<2> > p_haematocrit_calculator = TopologicalHaematocritSolver<2>::Create();
+    p_haematocrit_calculator->SetVesselNetwork(p_network);
+    p_haematocrit_calculator->Calculate();
+    TS_ASSERT(!p_haematocrit_calculator->UsedLinearSystem());
+    for(unsigned idx=0; idx<vessels.size(); idx++)
+    {
+        TS_ASSERT_DELTA(vessels[idx]->GetSegments()[0]->GetFlowProperties()->GetHaematocrit(), haematocrits[idx], 1e-3);
+    }
+
+    // Red cells are conserved at each bifurcation
+    TS_ASSERT_DELTA(vessels[6]->GetFlowProperties()->GetFlowRate()*vessels[6]->GetSegments()[0]->GetFlowProperties()->GetHaematocrit()/unit::metre_cubed_per_second,
+            vessels[0]->GetFlowProperties()->GetFlowRate()*0.45/unit::metre_cubed_per_second, 1.e-18);
+}
+
+void TestCycleUsesLinearSystem() throw(Exception)
+{
+    // Flow set around a loop, which can't be ordered
+    std::vector<boost::shared_ptr<VesselNode<2> > > nodes;
+    nodes.push_back(VesselNode<2>::Create(0.0, 0.0));
+    nodes.push_back(VesselNode<2>::Create(100.0, 0.0));
+    nodes.push_back(VesselNode<2>::Create(200.0, 0.0));
+    nodes.push_back(VesselNode<2>::Create(150.0, 100.0));
+    nodes.push_back(VesselNode<2>::Create(300.0, 0.0));
+    nodes[0]->GetFlowProperties()->SetIsInputNode(true);
+
+    unsigned connections[5][2] = {{0,1}, {1,2}, {2,3}, {3,1}, {2,4}};
+    double flow_rates[5] = {1.0, 2.0, 1.0, 1.0, 1.0};
+    double radii[5] = {10.0, 10.0, 5.0, 5.0, 8.0};
+    std::vector<boost::shared_ptr<Vessel<2> > > vessels;
+    for(unsigned idx=0; idx<5; idx++)
+    {
+        boost::shared_ptr<VesselSegment<2> > p_segment = VesselSegment<2>::Create(nodes[connections[idx][0]], nodes[connections[idx][1]]);
+        p_segment->SetRadius(radii[idx]*1.e-6*unit::metres);
+        p_segment->GetFlowProperties()->SetFlowRate(flow_rates[idx]*unit::metre_cubed_per_second);
+        vessels.push_back(Vessel<2>::Create(p_segment));
+    }
+    boost::shared_ptr<VesselNetwork<2> > p_network = VesselNetwork<2>::Create();
+    p_network->AddVessels(vessels);
+
+    boost::shared_ptr<BetteridgeHaematocritSolver<2> > p_linear_calculator(new BetteridgeHaematocritSolver<2>());
+    p_linear_calculator->SetVesselNetwork(p_network);
+    p_linear_calculator->Calculate();
+    std::vector<double> haematocrits;
+    for(unsigned idx=0; idx<vessels.size(); idx++)
+    {
+        haematocrits.push_back(vessels[idx]->GetSegments()[0]->GetFlowProperties()->GetHaematocrit());
+        vessels[idx]->GetSegments()[0]->GetFlowProperties()->SetHaematocrit(0.0);
+    }
+
+    boost::shared_ptr<TopologicalHaematocritSolver<2> > p_haematocrit_calculator = TopologicalHaematocritSolver<2>::Create();
+    p_haematocrit_calculator->SetVesselNetwork(p_network);
+    p_haematocrit_calculator->Calculate();
+    TS_ASSERT(p_haematocrit_calculator->UsedLinearSystem());
+    for(unsigned idx=0; idx<vessels.size(); idx++)
+    {
+        TS_ASSERT_DELTA(vessels[idx]->GetSegments()[0]->GetFlowProperties()->GetHaematocrit(), haematocrits[idx], 1e-6);
+    }
+    TS_ASSERT(haematocrits[1] > 0.0);
+}
+
+};
+
+#endif // TESTTOPOLOGICALHAEMATOCRITSOLVER_HPP